@@ -1,4 +1,5 @@
 #include "acl.hpp"
+#include "detail/marshal.hpp"
 
 #include <ostream>
 #include <sstream>
@@ -116,6 +117,14 @@ acl::acl(std::vector<acl_rule> rules) noexcept :
 acl::~acl() noexcept
 { }
 
+acl acl::compile() const
+{
+    acl out(*this);
+    if (!out._encoding)
+        out._encoding = detail::acl_encoding::create(_impl);
+    return out;
+}
+
 bool operator==(const acl& lhs, const acl& rhs)
 {
     return std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend());
@@ -154,19 +163,19 @@ std::string to_string(const acl& self)
 
 const acl& acls::creator_all()
 {
-    static acl instance = { { "auth", "", permission::all } };
+    static acl instance = acl({ { "auth", "", permission::all } }).compile();
     return instance;
 }
 
 const acl& acls::open_unsafe()
 {
-    static acl instance = { { "world", "anyone", permission::all } };
+    static acl instance = acl({ { "world", "anyone", permission::all } }).compile();
     return instance;
 }
 
 const acl& acls::read_unsafe()
 {
-    static acl instance = { { "world", "anyone", permission::read } };
+    static acl instance = acl({ { "world", "anyone", permission::read } }).compile();
     return instance;
 }
 
@@ -4,6 +4,7 @@
 
 #include <initializer_list>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -146,6 +147,13 @@ std::ostream& operator<<(std::ostream&, const acl_rule&);
 
 std::string to_string(const acl_rule&);
 
+namespace detail
+{
+
+class acl_encoding;
+
+}
+
 /// An access control list is a wrapper around \ref acl_rule instances. In general, the ACL system is similar to UNIX
 /// file access permissions, where znodes act as files. Unlike UNIX, each znode can have any number of ACLs to
 /// correspond with the potentially limitless (and pluggable) authentication schemes. A more surprising difference is
@@ -183,13 +191,32 @@ public:
 
     ~acl() noexcept;
 
+    /// Get a copy of this ACL which carries the encoding the C client sends to the server. Operations given a compiled
+    /// ACL (\ref client::create, \ref client::set_acl and \ref op::create in a transaction) pass that encoding as it is
+    /// instead of building it again for every request. Compile an ACL once and keep it around when it is used for many
+    /// operations.
+    ///
+    /// The encoding is immutable and shared by every copy of the compiled ACL, so it stays valid for as long as any
+    /// request using it is in flight. Getting mutable access to the rules (through a non-\c const accessor) drops the
+    /// encoding from that instance.
+    ///
+    /// The ACLs in \ref acls are already compiled.
+    acl compile() const;
+
+    /// Does this instance carry an encoding (see \ref compile)?
+    bool compiled() const { return bool(_encoding); }
+
+    /// The encoding built by \ref compile or \c nullptr if this instance is not compiled. This is used internally by
+    /// \ref connection implementations.
+    const std::shared_ptr<const detail::acl_encoding>& encoding() const { return _encoding; }
+
     /// The number of rules in this ACL.
     size_type size() const { return _impl.size(); }
 
     /// \{
     /// Get the rule at the given \a idx.
     const acl_rule& operator[](size_type idx) const { return _impl[idx]; }
-    acl_rule&       operator[](size_type idx)       { return _impl[idx]; }
+    acl_rule&       operator[](size_type idx)       { _encoding.reset(); return _impl[idx]; }
     /// \}
 
     /// \{
@@ -197,19 +224,19 @@ public:
     ///
     /// \throws std::out_of_range if the \a idx is larger than \ref size.
     const acl_rule& at(size_type idx) const { return _impl.at(idx); }
-    acl_rule&       at(size_type idx)       { return _impl.at(idx); }
+    acl_rule&       at(size_type idx)       { _encoding.reset(); return _impl.at(idx); }
     /// \}
 
     /// \{
     /// Get an iterator to the beginning of the rule list.
-    iterator begin()              { return _impl.begin(); }
+    iterator begin()              { _encoding.reset(); return _impl.begin(); }
     const_iterator begin() const  { return _impl.begin(); }
     const_iterator cbegin() const { return _impl.begin(); }
     /// \}
 
     /// \{
     /// Get an iterator to the end of the rule list.
-    iterator end()              { return _impl.end(); }
+    iterator end()              { _encoding.reset(); return _impl.end(); }
     const_iterator end() const  { return _impl.end(); }
     const_iterator cend() const { return _impl.end(); }
     /// \}
@@ -223,6 +250,7 @@ public:
     template <typename... TArgs>
     void emplace_back(TArgs&&... args)
     {
+        _encoding.reset();
         _impl.emplace_back(std::forward<TArgs>(args)...);
     }
 
@@ -233,7 +261,8 @@ public:
     /// \}
 
 private:
-    std::vector<acl_rule> _impl;
+    std::vector<acl_rule>                       _impl;
+    std::shared_ptr<const detail::acl_encoding> _encoding;
 };
 
 [[gnu::pure]] bool operator==(const acl& lhs, const acl& rhs);
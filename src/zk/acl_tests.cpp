@@ -76,4 +76,30 @@ GTEST_TEST(acl_tests, stringification)
             );
 }
 
+GTEST_TEST(acl_tests, compile)
+{
+    acl rules({ { "auth", "", permission::read }, { "ip", "50.40.30.0/24", permission::all } });
+    CHECK_FALSE(rules.compiled());
+
+    auto compiled = rules.compile();
+    CHECK_TRUE(compiled.compiled());
+    CHECK_FALSE(rules.compiled());
+    CHECK_EQ(rules, compiled);
+
+    // Copies share the encoding
+    auto copy = compiled;
+    CHECK_TRUE(copy.encoding() == compiled.encoding());
+    CHECK_TRUE(copy.compile().encoding() == compiled.encoding());
+
+    // Mutable access drops it
+    copy[0] = acl_rule("world", "anyone", permission::read);
+    CHECK_FALSE(copy.compiled());
+    CHECK_TRUE(compiled.compiled());
+    CHECK_NE(copy, compiled);
+
+    CHECK_TRUE(acls::creator_all().compiled());
+    CHECK_TRUE(acls::open_unsafe().compiled());
+    CHECK_TRUE(acls::read_unsafe().compiled());
+}
+
 }
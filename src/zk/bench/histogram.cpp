@@ -0,0 +1,102 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace zk::bench
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// latency_histogram                                                                                                  //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::size_t sub_bucket_bits = 5U;
+
+static_assert(latency_histogram::sub_buckets == (std::size_t(1) << sub_bucket_bits));
+
+latency_histogram::latency_histogram() noexcept :
+        _count(0U),
+        _min(std::numeric_limits<std::uint64_t>::max()),
+        _max(0U),
+        _total(0.0L)
+{
+    _buckets.fill(0U);
+}
+
+std::size_t latency_histogram::bucket_of(std::uint64_t nanos) noexcept
+{
+    if (nanos < sub_buckets)
+        return std::size_t(nanos);
+
+    // The sub-bucket is taken from the bits just below the most significant one, so every power of two gets the same
+    // number of buckets no matter how large it is.
+    auto msb   = std::size_t(63 - __builtin_clzll(nanos));
+    auto shift = msb - sub_bucket_bits;
+    return (shift + 1U) * sub_buckets + std::size_t((nanos >> shift) - sub_buckets);
+}
+
+std::uint64_t latency_histogram::upper_bound_of(std::size_t bucket) noexcept
+{
+    if (bucket < sub_buckets)
+        return bucket;
+
+    auto shift = bucket / sub_buckets - 1U;
+    auto sub   = std::uint64_t(bucket % sub_buckets + sub_buckets);
+    return ((sub + 1U) << shift) - 1U;
+}
+
+void latency_histogram::record(duration sample) noexcept
+{
+    auto nanos = std::uint64_t(std::max<duration::rep>(sample.count(), 0));
+
+    ++_buckets[bucket_of(nanos)];
+    ++_count;
+    _min = std::min(_min, nanos);
+    _max = std::max(_max, nanos);
+    _total += static_cast<long double>(nanos);
+}
+
+void latency_histogram::merge(const latency_histogram& other) noexcept
+{
+    for (std::size_t idx = 0U; idx < bucket_count; ++idx)
+        _buckets[idx] += other._buckets[idx];
+
+    _count += other._count;
+    _min    = std::min(_min, other._min);
+    _max    = std::max(_max, other._max);
+    _total += other._total;
+}
+
+latency_histogram::duration latency_histogram::min() const noexcept
+{
+    return _count == 0U ? duration(0) : duration(duration::rep(_min));
+}
+
+latency_histogram::duration latency_histogram::mean() const noexcept
+{
+    if (_count == 0U)
+        return duration(0);
+    else
+        return duration(duration::rep(_total / static_cast<long double>(_count)));
+}
+
+latency_histogram::duration latency_histogram::percentile(double quantile) const noexcept
+{
+    if (_count == 0U)
+        return duration(0);
+
+    auto q    = std::clamp(quantile, 0.0, 1.0);
+    auto rank = std::max<std::uint64_t>(std::uint64_t(std::ceil(q * double(_count))), 1U);
+
+    std::uint64_t seen = 0U;
+    for (std::size_t idx = 0U; idx < bucket_count; ++idx)
+    {
+        seen += _buckets[idx];
+        if (seen >= rank)
+            return duration(duration::rep(std::clamp(upper_bound_of(idx), _min, _max)));
+    }
+    return duration(duration::rep(_max));
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace zk::bench
+{
+
+/// \defgroup Bench
+/// Measuring the performance of the client against a live ensemble.
+/// \{
+
+/// Records latency samples with bounded relative error and constant memory. Samples are kept in buckets covering each
+/// power of two of nanoseconds, each split linearly into \ref sub_buckets, so a percentile read back from the histogram
+/// is within 1/\ref sub_buckets of the true sample. Recording a sample is a handful of integer operations, so it is
+/// cheap enough to call on every operation from every thread, as long as each thread has its own histogram; combine
+/// them at the end with \ref merge.
+class latency_histogram final
+{
+public:
+    using duration = std::chrono::nanoseconds;
+
+    /// The number of linear buckets each power of two is divided into.
+    static constexpr std::size_t sub_buckets = 32U;
+
+public:
+    latency_histogram() noexcept;
+
+    /// Record a single \a sample. Negative samples are recorded as \c 0.
+    void record(duration sample) noexcept;
+
+    /// Add all samples recorded in \a other to this histogram.
+    void merge(const latency_histogram& other) noexcept;
+
+    /// The number of samples recorded.
+    std::uint64_t count() const noexcept { return _count; }
+
+    /// The smallest sample recorded or \c 0 if none were.
+    duration min() const noexcept;
+
+    /// The largest sample recorded or \c 0 if none were.
+    duration max() const noexcept { return duration(duration::rep(_max)); }
+
+    /// The arithmetic mean of all samples or \c 0 if none were recorded.
+    duration mean() const noexcept;
+
+    /// Get the sample at the given \a quantile (in the range \c [0, 1]). For example, \c percentile(0.99) is the p99
+    /// latency. This is the upper bound of the bucket the quantile falls in, clamped to \ref max.
+    duration percentile(double quantile) const noexcept;
+
+private:
+    static constexpr std::size_t bucket_count = 64U * sub_buckets;
+
+    static std::size_t bucket_of(std::uint64_t nanos) noexcept;
+    static std::uint64_t upper_bound_of(std::size_t bucket) noexcept;
+
+private:
+    std::array<std::uint64_t, bucket_count> _buckets;
+    std::uint64_t                           _count;
+    std::uint64_t                           _min;
+    std::uint64_t                           _max;
+    long double                             _total;
+};
+
+/// \}
+
+}
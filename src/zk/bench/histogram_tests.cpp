@@ -0,0 +1,66 @@
+#include <zk/tests/test.hpp>
+
+#include "histogram.hpp"
+
+namespace zk::bench
+{
+
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+
+GTEST_TEST(latency_histogram_tests, empty)
+{
+    latency_histogram hist;
+    CHECK_EQ(0U, hist.count());
+    CHECK_EQ(nanoseconds(0), hist.min());
+    CHECK_EQ(nanoseconds(0), hist.max());
+    CHECK_EQ(nanoseconds(0), hist.percentile(0.99));
+}
+
+GTEST_TEST(latency_histogram_tests, small_values_are_exact)
+{
+    latency_histogram hist;
+    for (int x = 1; x <= 10; ++x)
+        hist.record(nanoseconds(x));
+
+    CHECK_EQ(10U, hist.count());
+    CHECK_EQ(nanoseconds(1), hist.min());
+    CHECK_EQ(nanoseconds(10), hist.max());
+    CHECK_EQ(nanoseconds(5), hist.percentile(0.5));
+    CHECK_EQ(nanoseconds(10), hist.percentile(1.0));
+}
+
+GTEST_TEST(latency_histogram_tests, percentiles_within_error)
+{
+    latency_histogram hist;
+    for (int x = 1; x <= 10000; ++x)
+        hist.record(microseconds(x));
+
+    auto check_near = [&] (double quantile, microseconds expected)
+                      {
+                          auto actual = hist.percentile(quantile);
+                          auto error  = nanoseconds(expected).count() / long(latency_histogram::sub_buckets);
+                          CHECK_LE(nanoseconds(expected).count() - error, actual.count());
+                          CHECK_GE(nanoseconds(expected).count() + error, actual.count());
+                      };
+    check_near(0.50,  microseconds(5000));
+    check_near(0.99,  microseconds(9900));
+    check_near(0.999, microseconds(9990));
+    CHECK_EQ(microseconds(10000), hist.percentile(1.0));
+}
+
+GTEST_TEST(latency_histogram_tests, merge)
+{
+    latency_histogram a;
+    latency_histogram b;
+    a.record(nanoseconds(100));
+    b.record(nanoseconds(300));
+    a.merge(b);
+
+    CHECK_EQ(2U, a.count());
+    CHECK_EQ(nanoseconds(100), a.min());
+    CHECK_EQ(nanoseconds(300), a.max());
+    CHECK_EQ(nanoseconds(200), a.mean());
+}
+
+}
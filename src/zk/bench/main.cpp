@@ -0,0 +1,125 @@
+#include <zk/server/classpath.hpp>
+#include <zk/server/configuration.hpp>
+#include <zk/server/server_group.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "options.hpp"
+#include "report.hpp"
+#include "runner.hpp"
+
+namespace zk::bench
+{
+
+static server::classpath load_classpath(const bench_options& settings)
+{
+    if (!settings.classpath)
+        return server::classpath::system_default();
+
+    std::vector<std::string> components;
+    string_view remaining = *settings.classpath;
+    while (!remaining.empty())
+    {
+        auto colon = remaining.find(':');
+        if (colon != 0U)
+            components.emplace_back(remaining.substr(0, colon));
+        remaining = colon == string_view::npos ? string_view() : remaining.substr(colon + 1);
+    }
+    return server::classpath(std::move(components));
+}
+
+/// Get a directory for the ensemble's data which does not exist yet (\ref server::server_group::make_ensemble creates
+/// it).
+static std::string ensemble_directory(const bench_options& settings)
+{
+    if (settings.data_directory)
+        return *settings.data_directory;
+
+    auto tmpdir = std::getenv("TMPDIR");
+    std::string parent = std::string(tmpdir && *tmpdir ? tmpdir : "/tmp") + "/zkpp-bench-XXXXXX";
+    if (!::mkdtemp(parent.data()))
+        throw std::system_error(errno, std::system_category(), "Could not create directory for ensemble data");
+    return parent + "/ensemble";
+}
+
+static int run(const std::vector<std::string>& args, string_view program_name)
+{
+    auto settings = bench_options::parse(args);
+    if (settings.help)
+    {
+        usage(std::cout, program_name);
+        return 0;
+    }
+
+    optional<server::server_group> ensemble;
+    std::string                    connection_string;
+    if (settings.connect)
+    {
+        connection_string = *settings.connect;
+    }
+    else
+    {
+        auto directory = ensemble_directory(settings);
+        std::clog << "Starting " << settings.servers << " server(s) in " << directory << std::endl;
+
+        ensemble = server::server_group::make_ensemble(settings.servers,
+                                                       server::configuration::make_minimal(directory)
+                                                      );
+        ensemble->start_all_servers(load_classpath(settings));
+        if (!ensemble->wait_until_ready(std::chrono::seconds(60)))
+            throw std::runtime_error("Ensemble in " + directory + " did not become ready within 60 seconds");
+        connection_string = ensemble->get_connection_string();
+    }
+
+    bench_report report;
+    if (settings.failovers != 0U)
+    {
+        std::clog << "Running " << settings.failovers << " leader election failover(s) between " << settings.threads
+                  << " candidates against " << connection_string << std::endl;
+        report = run_failover_benchmark(settings, connection_string);
+    }
+    else
+    {
+        std::clog << "Running " << settings.mix << " for " << settings.duration.count() << "ms against "
+                  << connection_string << std::endl;
+        report = run_benchmark(settings, connection_string);
+    }
+
+    if (settings.json)
+        write_json(std::cout, report);
+    else
+        write_text(std::cout, report);
+
+    return 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    try
+    {
+        return zk::bench::run(args, argv[0]);
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        std::cerr << argv[0] << ": " << ex.what() << "\n"
+                  << "Try '" << argv[0] << " --help' for more information." << std::endl;
+        return 2;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << argv[0] << ": " << ex.what() << std::endl;
+        return 1;
+    }
+}
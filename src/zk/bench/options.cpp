@@ -0,0 +1,267 @@
+#include "options.hpp"
+
+#include <charconv>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace zk::bench
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// bench_op                                                                                                           //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::array<const char*, bench_op_count> bench_op_names = { "get", "set", "create", "multi", "watch" };
+
+std::ostream& operator<<(std::ostream& os, const bench_op& self)
+{
+    auto idx = static_cast<std::size_t>(self);
+    if (idx < bench_op_count)
+        return os << bench_op_names[idx];
+    else
+        return os << "bench_op(" << idx << ')';
+}
+
+std::string to_string(const bench_op& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// workload_mix                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+static T parse_number(string_view source, string_view what)
+{
+    T out{};
+    auto [end, ec] = std::from_chars(source.data(), source.data() + source.size(), out);
+    if (source.empty() || ec != std::errc() || end != source.data() + source.size())
+        throw std::invalid_argument(std::string("Invalid ") + std::string(what) + ": \"" + std::string(source) + "\"");
+    return out;
+}
+
+workload_mix::workload_mix() noexcept
+{
+    _weights.fill(0U);
+    weight(bench_op::get)    = 80U;
+    weight(bench_op::set)    = 15U;
+    weight(bench_op::create) = 5U;
+}
+
+workload_mix workload_mix::parse(string_view source)
+{
+    workload_mix out;
+    out._weights.fill(0U);
+
+    while (!source.empty())
+    {
+        auto comma = source.find(',');
+        auto item  = source.substr(0, comma);
+        source     = comma == string_view::npos ? string_view() : source.substr(comma + 1);
+
+        auto eq = item.find('=');
+        if (eq == string_view::npos)
+            throw std::invalid_argument("Workload mix item must be op=weight: \"" + std::string(item) + "\"");
+
+        auto name  = item.substr(0, eq);
+        auto found = false;
+        for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+        {
+            if (name == bench_op_names[idx])
+            {
+                out._weights[idx] = parse_number<std::uint32_t>(item.substr(eq + 1), "workload mix weight");
+                found = true;
+            }
+        }
+
+        if (!found)
+            throw std::invalid_argument("Unknown operation in workload mix: \"" + std::string(name) + "\"");
+    }
+
+    if (out.total() == 0U)
+        throw std::invalid_argument("Workload mix must have at least one operation with a non-zero weight");
+
+    return out;
+}
+
+std::uint64_t workload_mix::total() const
+{
+    return std::accumulate(_weights.begin(), _weights.end(), std::uint64_t(0));
+}
+
+bench_op workload_mix::pick(std::uint64_t ticket) const
+{
+    for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+    {
+        if (ticket < _weights[idx])
+            return static_cast<bench_op>(idx);
+        ticket -= _weights[idx];
+    }
+    throw std::out_of_range("Ticket is not less than the total weight of the workload mix");
+}
+
+std::ostream& operator<<(std::ostream& os, const workload_mix& self)
+{
+    bool first = true;
+    for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+    {
+        auto op = static_cast<bench_op>(idx);
+        if (self.weight(op) == 0U)
+            continue;
+
+        if (!std::exchange(first, false))
+            os << ',';
+        os << op << '=' << self.weight(op);
+    }
+    return os;
+}
+
+std::string to_string(const workload_mix& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// bench_options                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Parse a duration such as \c "10s", \c "250ms" or \c "2m". A plain number is in seconds.
+static std::chrono::milliseconds parse_duration(string_view source, string_view what)
+{
+    auto unit_pos = source.find_first_not_of("0123456789");
+    auto number   = parse_number<std::chrono::milliseconds::rep>(source.substr(0, unit_pos), what);
+    auto unit     = unit_pos == string_view::npos ? string_view("s") : source.substr(unit_pos);
+
+    if (unit == "ms")
+        return std::chrono::milliseconds(number);
+    else if (unit == "s")
+        return std::chrono::seconds(number);
+    else if (unit == "m")
+        return std::chrono::minutes(number);
+    else
+        throw std::invalid_argument(std::string("Invalid ") + std::string(what) + ": \"" + std::string(source) + "\"");
+}
+
+static std::size_t parse_positive(string_view source, string_view what)
+{
+    auto out = parse_number<std::size_t>(source, what);
+    if (out == 0U)
+        throw std::invalid_argument(std::string(what) + " must be greater than 0");
+    return out;
+}
+
+bench_options bench_options::parse(const std::vector<std::string>& args)
+{
+    bench_options out;
+
+    for (std::size_t idx = 0U; idx < args.size(); ++idx)
+    {
+        string_view arg = args[idx];
+        if (arg.substr(0, 2) != "--")
+            throw std::invalid_argument("Unexpected argument: \"" + args[idx] + "\"");
+        arg.remove_prefix(2);
+
+        // Flags are accepted as both "--name=value" and "--name value"
+        string_view name = arg.substr(0, arg.find('='));
+        optional<string_view> inline_value;
+        if (name.size() < arg.size())
+            inline_value = arg.substr(name.size() + 1);
+
+        auto value = [&] () -> string_view
+                     {
+                         if (inline_value)
+                             return *inline_value;
+                         else if (idx + 1 < args.size())
+                             return args[++idx];
+                         else
+                             throw std::invalid_argument("Missing value for --" + std::string(name));
+                     };
+
+        if (name == "help")
+            out.help = true;
+        else if (name == "json")
+            out.json = true;
+        else if (name == "connect")
+            out.connect = std::string(value());
+        else if (name == "servers")
+            out.servers = parse_positive(value(), "servers");
+        else if (name == "data-directory")
+            out.data_directory = std::string(value());
+        else if (name == "classpath")
+            out.classpath = std::string(value());
+        else if (name == "threads")
+            out.threads = parse_positive(value(), "threads");
+        else if (name == "sessions")
+            out.sessions = parse_positive(value(), "sessions");
+        else if (name == "duration")
+            out.duration = parse_duration(value(), "duration");
+        else if (name == "warmup")
+            out.warmup = parse_duration(value(), "warmup");
+        else if (name == "mix")
+            out.mix = workload_mix::parse(value());
+        else if (name == "keys")
+            out.keys = parse_positive(value(), "keys");
+        else if (name == "value-size")
+            out.value_size = parse_number<std::size_t>(value(), "value-size");
+        else if (name == "root")
+            out.root = std::string(value());
+        else if (name == "failovers")
+            out.failovers = parse_number<std::size_t>(value(), "failovers");
+        else
+            throw std::invalid_argument("Unknown option: --" + std::string(name));
+    }
+
+    if (out.failovers != 0U && out.threads < 2U)
+        throw std::invalid_argument("failovers needs at least 2 threads");
+    if (out.duration.count() == 0)
+        throw std::invalid_argument("duration must be greater than 0");
+    if (out.root.empty() || out.root.front() != '/' || out.root.back() == '/')
+        throw std::invalid_argument("root must be an absolute path without a trailing '/'");
+
+    return out;
+}
+
+void usage(std::ostream& os, string_view program_name)
+{
+    bench_options defaults;
+
+    os << "Usage: " << program_name << " [OPTIONS]\n"
+       << "\n"
+       << "Measure the throughput and latency of ZooKeeper operations.\n"
+       << "\n"
+       << "Ensemble:\n"
+       << "  --connect=CONN         Use an existing ensemble (e.g.: zk://127.0.0.1:2181) instead of starting one\n"
+       << "  --servers=N            Number of servers in the local ensemble (default: " << defaults.servers << ")\n"
+       << "  --data-directory=DIR   Directory for local ensemble data, which must not exist (default: in $TMPDIR)\n"
+       << "  --classpath=PATHS      ':'-separated classpath for the local ensemble (default: system default)\n"
+       << "\n"
+       << "Workload:\n"
+       << "  --threads=N            Number of threads issuing operations (default: " << defaults.threads << ")\n"
+       << "  --sessions=N           Number of sessions shared by the threads (default: " << defaults.sessions << ")\n"
+       << "  --duration=TIME        How long to measure for, e.g.: 30s, 500ms, 2m (default: "
+                                    << defaults.duration.count() << "ms)\n"
+       << "  --warmup=TIME          How long to run before measuring (default: " << defaults.warmup.count() << "ms)\n"
+       << "  --mix=OP=W,...         Weights of get, set, create, multi and watch (default: " << defaults.mix << ")\n"
+       << "  --keys=N               Number of entries to operate on (default: " << defaults.keys << ")\n"
+       << "  --value-size=BYTES     Size of the data written (default: " << defaults.value_size << ")\n"
+       << "  --root=PATH            Entry to create the benchmark entries under (default: " << defaults.root << ")\n"
+       << "\n"
+       << "Leader election:\n"
+       << "  --failovers=N          Instead of the workload, measure N leader election failovers between --threads\n"
+       << "                         candidates (default: " << defaults.failovers << ")\n"
+       << "\n"
+       << "Output:\n"
+       << "  --json                 Write the report as JSON\n"
+       << "  --help                 Show this message\n"
+       ;
+}
+
+}
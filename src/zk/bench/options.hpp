@@ -0,0 +1,136 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <zk/optional.hpp>
+#include <zk/string_view.hpp>
+
+namespace zk::bench
+{
+
+/// \addtogroup Bench
+/// \{
+
+/// The kinds of operation a benchmark worker can issue.
+enum class bench_op : unsigned int
+{
+    get,    //!< \ref client::get on an existing key.
+    set,    //!< \ref client::set on an existing key.
+    create, //!< \ref client::create of an ephemeral sequential entry.
+    multi,  //!< \ref client::commit of a \c check on one key and a \c set on another.
+    watch,  //!< \ref client::watch on a key, a \ref client::set on it and waiting for the event to be delivered.
+};
+
+/// The number of values in \ref bench_op.
+static constexpr std::size_t bench_op_count = 5U;
+
+std::ostream& operator<<(std::ostream&, const bench_op&);
+
+std::string to_string(const bench_op&);
+
+/// The relative weight of each kind of operation in a workload. Workers pick each operation at random with a chance of
+/// its weight divided by the \ref total of all weights.
+class workload_mix final
+{
+public:
+    /// Create a read-mostly mix: 80% \c get, 15% \c set, 5% \c create.
+    workload_mix() noexcept;
+
+    /// Parse a mix from a comma-separated list of \c op=weight pairs, such as \c "get=70,set=20,multi=10". Operations
+    /// which are not mentioned have a weight of \c 0.
+    ///
+    /// \throws std::invalid_argument if \a source is malformed, names an unknown operation, or all weights are \c 0.
+    static workload_mix parse(string_view source);
+
+    /// \{
+    /// The weight of the given \a op.
+    std::uint32_t  weight(bench_op op) const { return _weights[static_cast<std::size_t>(op)]; }
+    std::uint32_t& weight(bench_op op)       { return _weights[static_cast<std::size_t>(op)]; }
+    /// \}
+
+    /// The sum of all weights.
+    std::uint64_t total() const;
+
+    /// Select the operation for the given \a ticket, which must be in the range <tt>[0, total())</tt>.
+    bench_op pick(std::uint64_t ticket) const;
+
+private:
+    std::array<std::uint32_t, bench_op_count> _weights;
+};
+
+std::ostream& operator<<(std::ostream&, const workload_mix&);
+
+std::string to_string(const workload_mix&);
+
+/// Settings for a run of \c zkpp-bench. Each field corresponds to a command-line flag of the same name (with \c '-' in
+/// place of \c '_'), which is described by \ref usage.
+struct bench_options final
+{
+    /// Connect to this existing ensemble instead of starting one.
+    optional<std::string> connect;
+
+    /// The number of servers in the local ensemble to start. Ignored if \ref connect is set.
+    std::size_t servers = 1U;
+
+    /// The directory to keep the data of the local ensemble in. This must not exist. If unset, a new directory is
+    /// created in \c $TMPDIR.
+    optional<std::string> data_directory;
+
+    /// The classpath to start the local ensemble with. If unset, \ref server::classpath::system_default is used.
+    optional<std::string> classpath;
+
+    /// The number of threads issuing operations.
+    std::size_t threads = 4U;
+
+    /// The number of sessions (\ref client instances) shared between the threads. Thread \c n uses session
+    /// <tt>n % sessions</tt>.
+    std::size_t sessions = 1U;
+
+    /// How long to issue operations for before reporting results.
+    std::chrono::milliseconds duration = std::chrono::seconds(10);
+
+    /// How long to issue operations for before starting to record results.
+    std::chrono::milliseconds warmup = std::chrono::seconds(1);
+
+    /// The mix of operations to issue.
+    workload_mix mix;
+
+    /// The number of entries which \c get, \c set, \c multi and \c watch operations pick from.
+    std::size_t keys = 1000U;
+
+    /// The size of the data written by \c set and \c create.
+    std::size_t value_size = 128U;
+
+    /// The base path all entries used by the benchmark are created under.
+    std::string root = "/zkpp-bench";
+
+    /// If not \c 0, measure leader election failover over this many rounds instead of running \ref mix. Each round,
+    /// the leader of a \ref recipes::leader_election between \ref threads candidates resigns and the time until the
+    /// next candidate is elected is recorded.
+    std::size_t failovers = 0U;
+
+    /// Write the report as JSON instead of a human-readable table.
+    bool json = false;
+
+    /// Was \c --help requested?
+    bool help = false;
+
+    /// Parse options from the command-line \a args (not including the program name).
+    ///
+    /// \throws std::invalid_argument if an argument is unknown or its value is malformed.
+    static bench_options parse(const std::vector<std::string>& args);
+};
+
+/// Write the description of the command-line flags of \c zkpp-bench to \a os.
+void usage(std::ostream& os, string_view program_name);
+
+/// \}
+
+}
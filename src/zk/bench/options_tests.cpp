@@ -0,0 +1,59 @@
+#include <zk/tests/test.hpp>
+
+#include <stdexcept>
+
+#include "options.hpp"
+
+namespace zk::bench
+{
+
+GTEST_TEST(workload_mix_tests, parse)
+{
+    auto mix = workload_mix::parse("get=70,multi=20,watch=10");
+    CHECK_EQ(70U, mix.weight(bench_op::get));
+    CHECK_EQ(0U,  mix.weight(bench_op::set));
+    CHECK_EQ(20U, mix.weight(bench_op::multi));
+    CHECK_EQ(100U, mix.total());
+    CHECK_EQ("get=70,multi=20,watch=10", to_string(mix));
+
+    CHECK_EQ(bench_op::get,   mix.pick(0U));
+    CHECK_EQ(bench_op::get,   mix.pick(69U));
+    CHECK_EQ(bench_op::multi, mix.pick(70U));
+    CHECK_EQ(bench_op::watch, mix.pick(99U));
+}
+
+GTEST_TEST(workload_mix_tests, parse_invalid)
+{
+    CHECK_THROWS(std::invalid_argument) { workload_mix::parse("get"); };
+    CHECK_THROWS(std::invalid_argument) { workload_mix::parse("get=x"); };
+    CHECK_THROWS(std::invalid_argument) { workload_mix::parse("delete=1"); };
+    CHECK_THROWS(std::invalid_argument) { workload_mix::parse("get=0"); };
+}
+
+GTEST_TEST(bench_options_tests, parse)
+{
+    auto opts = bench_options::parse({ "--threads=8", "--sessions", "2", "--duration=500ms", "--mix=set=1", "--json" });
+    CHECK_EQ(8U, opts.threads);
+    CHECK_EQ(2U, opts.sessions);
+    CHECK_EQ(std::chrono::milliseconds(500), opts.duration);
+    CHECK_EQ(1U, opts.mix.total());
+    CHECK_TRUE(opts.json);
+    CHECK_FALSE(opts.connect);
+
+    CHECK_EQ(std::chrono::minutes(2), bench_options::parse({ "--warmup=2m" }).warmup);
+    CHECK_EQ(std::chrono::seconds(3), bench_options::parse({ "--duration=3" }).duration);
+    CHECK_EQ(50U, bench_options::parse({ "--failovers=50" }).failovers);
+}
+
+GTEST_TEST(bench_options_tests, parse_invalid)
+{
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--nope" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--threads" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--threads=0" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--duration=5h" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--root=/trailing/" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "positional" }); };
+    CHECK_THROWS(std::invalid_argument) { bench_options::parse({ "--failovers=10", "--threads=1" }); };
+}
+
+}
@@ -0,0 +1,175 @@
+#include "report.hpp"
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <utility>
+
+namespace zk::bench
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// op_report                                                                                                          //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void op_report::merge(const op_report& other) noexcept
+{
+    latency.merge(other.latency);
+    errors += other.errors;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// bench_report                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+op_report bench_report::total() const
+{
+    op_report out;
+    for (const auto& op : ops)
+        out.merge(op);
+    return out;
+}
+
+double bench_report::throughput(const op_report& results) const
+{
+    if (elapsed.count() <= 0)
+        return 0.0;
+
+    return double(results.latency.count()) / std::chrono::duration<double>(elapsed).count();
+}
+
+static double micros(std::chrono::nanoseconds value)
+{
+    return std::chrono::duration<double, std::micro>(value).count();
+}
+
+static void write_text_row(std::ostream& os, const bench_report& report, string_view name, const op_report& results)
+{
+    const auto& latency = results.latency;
+    os << std::left  << std::setw(8)  << name
+       << std::right << std::setw(12) << latency.count()
+       << std::setw(8)  << results.errors
+       << std::setw(12) << report.throughput(results)
+       << std::setw(10) << micros(latency.mean())
+       << std::setw(10) << micros(latency.percentile(0.50))
+       << std::setw(10) << micros(latency.percentile(0.99))
+       << std::setw(10) << micros(latency.percentile(0.999))
+       << std::setw(10) << micros(latency.max())
+       << '\n';
+}
+
+void write_text(std::ostream& os, const bench_report& report)
+{
+    const auto& settings = report.settings;
+
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(1);
+    table << "ensemble:  " << report.connection_string << '\n'
+          << "threads:   " << settings.threads << " over " << settings.sessions << " session(s)\n"
+          << "mix:       " << (settings.failovers != 0U ? "leader election failover" : to_string(settings.mix)) << '\n'
+          << "keys:      " << settings.keys << " of " << settings.value_size << " bytes\n"
+          << "elapsed:   " << std::chrono::duration<double>(report.elapsed).count() << "s\n"
+          << '\n'
+          << std::left  << std::setw(8)  << "op"
+          << std::right << std::setw(12) << "count"
+          << std::setw(8)  << "errors"
+          << std::setw(12) << "ops/sec"
+          << std::setw(10) << "mean(us)"
+          << std::setw(10) << "p50(us)"
+          << std::setw(10) << "p99(us)"
+          << std::setw(10) << "p999(us)"
+          << std::setw(10) << "max(us)"
+          << '\n';
+
+    if (settings.failovers != 0U)
+    {
+        write_text_row(table, report, "failover", report.failover);
+    }
+    else
+    {
+        for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+        {
+            auto op = static_cast<bench_op>(idx);
+            if (settings.mix.weight(op) != 0U)
+                write_text_row(table, report, to_string(op), report[op]);
+        }
+        write_text_row(table, report, "total", report.total());
+    }
+
+    os << table.str();
+}
+
+static void write_json_string(std::ostream& os, string_view value)
+{
+    os << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+static void write_json_results(std::ostream& os, const bench_report& report, const op_report& results)
+{
+    const auto& latency = results.latency;
+    os << "{\"count\":" << latency.count()
+       << ",\"errors\":" << results.errors
+       << ",\"ops_per_sec\":" << report.throughput(results)
+       << ",\"latency_us\":{"
+       <<   "\"min\":"   << micros(latency.min())
+       <<   ",\"mean\":" << micros(latency.mean())
+       <<   ",\"p50\":"  << micros(latency.percentile(0.50))
+       <<   ",\"p99\":"  << micros(latency.percentile(0.99))
+       <<   ",\"p999\":" << micros(latency.percentile(0.999))
+       <<   ",\"max\":"  << micros(latency.max())
+       << "}}";
+}
+
+void write_json(std::ostream& os, const bench_report& report)
+{
+    const auto& settings = report.settings;
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"connection_string\":";
+    write_json_string(json, report.connection_string);
+    json << ",\"threads\":"     << settings.threads
+         << ",\"sessions\":"    << settings.sessions
+         << ",\"keys\":"        << settings.keys
+         << ",\"value_size\":"  << settings.value_size
+         << ",\"mix\":";
+    write_json_string(json, to_string(settings.mix));
+    json << ",\"elapsed_sec\":" << std::chrono::duration<double>(report.elapsed).count()
+         << ",\"ops\":{";
+
+    bool first = true;
+    for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+    {
+        auto op = static_cast<bench_op>(idx);
+        if (settings.mix.weight(op) == 0U)
+            continue;
+
+        if (!std::exchange(first, false))
+            json << ',';
+        write_json_string(json, to_string(op));
+        json << ':';
+        write_json_results(json, report, report[op]);
+    }
+    json << "},\"total\":";
+    write_json_results(json, report, report.total());
+    if (settings.failovers != 0U)
+    {
+        json << ",\"failover\":";
+        write_json_results(json, report, report.failover);
+    }
+    json << "}\n";
+
+    os << json.str();
+}
+
+}
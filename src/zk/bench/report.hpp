@@ -0,0 +1,73 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "histogram.hpp"
+#include "options.hpp"
+
+namespace zk::bench
+{
+
+/// \addtogroup Bench
+/// \{
+
+/// The results of a single kind of operation.
+struct op_report final
+{
+    /// The latency of operations which completed successfully.
+    latency_histogram latency;
+
+    /// The number of operations which failed.
+    std::uint64_t errors = 0U;
+
+    /// Add the results from \a other to this one.
+    void merge(const op_report& other) noexcept;
+};
+
+/// The results of a benchmark run.
+struct bench_report final
+{
+    /// The settings the benchmark was run with.
+    bench_options settings;
+
+    /// The connection string of the ensemble the benchmark was run against.
+    std::string connection_string;
+
+    /// How long results were recorded for. This does not include the warmup.
+    std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+
+    /// The results for each kind of operation, indexed by \ref bench_op.
+    std::array<op_report, bench_op_count> ops;
+
+    /// The time from the leader resigning until the next candidate was elected, if \ref bench_options::failovers was
+    /// set. In that case, no other operations are run.
+    op_report failover;
+
+    /// \{
+    /// The results for the given \a op.
+    const op_report& operator[](bench_op op) const { return ops[static_cast<std::size_t>(op)]; }
+    op_report&       operator[](bench_op op)       { return ops[static_cast<std::size_t>(op)]; }
+    /// \}
+
+    /// The results of all kinds of operation combined.
+    op_report total() const;
+
+    /// The number of successful operations per second over \a results.
+    double throughput(const op_report& results) const;
+};
+
+/// Write \a report as a human-readable table.
+void write_text(std::ostream& os, const bench_report& report);
+
+/// Write \a report as a JSON object. Latencies are in microseconds.
+void write_json(std::ostream& os, const bench_report& report);
+
+/// \}
+
+}
@@ -0,0 +1,342 @@
+#include "runner.hpp"
+
+#include <zk/client.hpp>
+#include <zk/error.hpp>
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+#include <zk/recipes/leader_election.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace zk::bench
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup                                                                                                              //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// The names of the entries used by a run.
+struct bench_paths final
+{
+    std::vector<std::string> keys;
+    std::vector<std::string> watched;
+    std::string              sequential;
+
+    explicit bench_paths(const bench_options& settings) :
+            sequential(settings.root + "/seq/item-")
+    {
+        keys.reserve(settings.keys);
+        for (std::size_t idx = 0U; idx < settings.keys; ++idx)
+        {
+            char name[32];
+            std::snprintf(name, sizeof name, "/key-%08zu", idx);
+            keys.emplace_back(settings.root + name);
+        }
+
+        watched.reserve(settings.threads);
+        for (std::size_t idx = 0U; idx < settings.threads; ++idx)
+            watched.emplace_back(settings.root + "/watch-" + std::to_string(idx));
+    }
+};
+
+}
+
+/// Create \a path with \a value, or set it to \a value if it was left over from an earlier run.
+static void ensure_entry(client& conn, const std::string& path, const buffer& value)
+{
+    try
+    {
+        conn.create(path, value).get();
+    }
+    catch (const entry_exists&)
+    {
+        conn.set(path, value).get();
+    }
+}
+
+static void create_entries(client& conn, const bench_options& settings, const bench_paths& paths, const buffer& value)
+{
+    ensure_entry(conn, settings.root, buffer());
+    ensure_entry(conn, settings.root + "/seq", buffer());
+
+    // Creating one entry at a time takes a long time with many keys, so keep a bounded number in flight.
+    static constexpr std::size_t max_in_flight = 256U;
+
+    std::vector<std::string> all_paths = paths.keys;
+    all_paths.insert(all_paths.end(), paths.watched.begin(), paths.watched.end());
+
+    for (std::size_t first = 0U; first < all_paths.size(); first += max_in_flight)
+    {
+        auto last = std::min(first + max_in_flight, all_paths.size());
+
+        std::vector<future<create_result>> creates;
+        creates.reserve(last - first);
+        for (std::size_t idx = first; idx < last; ++idx)
+            creates.emplace_back(conn.create(all_paths[idx], value));
+
+        for (std::size_t idx = first; idx < last; ++idx)
+        {
+            try
+            {
+                creates[idx - first].get();
+            }
+            catch (const entry_exists&)
+            {
+                conn.set(all_paths[idx], value).get();
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Workers                                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+enum class bench_phase : int
+{
+    warmup,
+    measure,
+    stop,
+};
+
+class bench_worker final
+{
+public:
+    explicit bench_worker(const bench_options&     settings,
+                          const bench_paths&       paths,
+                          const buffer&            value,
+                          client                   conn,
+                          std::size_t              index,
+                          std::atomic<bench_phase>& phase
+                         ) :
+            _settings(settings),
+            _paths(paths),
+            _value(value),
+            _conn(std::move(conn)),
+            _index(index),
+            _phase(phase),
+            _rng(std::uint32_t(std::random_device{}() + index))
+    { }
+
+    void run()
+    {
+        std::uniform_int_distribution<std::uint64_t> tickets(0U, _settings.mix.total() - 1U);
+
+        for (auto phase = _phase.load(); phase != bench_phase::stop; phase = _phase.load())
+        {
+            auto kind  = _settings.mix.pick(tickets(_rng));
+            auto start = std::chrono::steady_clock::now();
+            bool ok;
+            try
+            {
+                issue(kind);
+                ok = true;
+            }
+            catch (const std::exception&)
+            {
+                ok = false;
+            }
+            auto finish = std::chrono::steady_clock::now();
+
+            // Only count operations which both started and finished while measuring, so the results are not skewed
+            // by the ramp up or the operations which were cut short at the end.
+            if (phase != bench_phase::measure || _phase.load() != bench_phase::measure)
+                continue;
+
+            auto& results = _results[static_cast<std::size_t>(kind)];
+            if (ok)
+                results.latency.record(finish - start);
+            else
+                ++results.errors;
+        }
+    }
+
+    const std::array<op_report, bench_op_count>& results() const { return _results; }
+
+private:
+    const std::string& pick_key()
+    {
+        std::uniform_int_distribution<std::size_t> dist(0U, _paths.keys.size() - 1U);
+        return _paths.keys[dist(_rng)];
+    }
+
+    void issue(bench_op kind)
+    {
+        switch (kind)
+        {
+        case bench_op::get:
+            _conn.get(pick_key()).get();
+            break;
+        case bench_op::set:
+            _conn.set(pick_key(), _value).get();
+            break;
+        case bench_op::create:
+            _conn.create(_paths.sequential, _value, create_mode::ephemeral | create_mode::sequential).get();
+            break;
+        case bench_op::multi:
+            _conn.commit({ op::check(pick_key()), op::set(pick_key(), _value) }).get();
+            break;
+        case bench_op::watch:
+        {
+            const auto& path = _paths.watched[_index];
+            auto watch = _conn.watch(path).get();
+            _conn.set(path, _value).get();
+            watch.next().get();
+            break;
+        }
+        }
+    }
+
+private:
+    const bench_options&                  _settings;
+    const bench_paths&                    _paths;
+    const buffer&                         _value;
+    client                                _conn;
+    std::size_t                           _index;
+    std::atomic<bench_phase>&             _phase;
+    std::minstd_rand                      _rng;
+    std::array<op_report, bench_op_count> _results;
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// run_benchmark                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bench_report run_benchmark(const bench_options& settings, const std::string& connection_string)
+{
+    bench_paths paths(settings);
+    buffer      value(settings.value_size, 'x');
+
+    std::vector<client> sessions;
+    sessions.reserve(settings.sessions);
+    for (std::size_t idx = 0U; idx < settings.sessions; ++idx)
+        sessions.emplace_back(client::connect(connection_string).get());
+
+    create_entries(sessions.front(), settings, paths, value);
+
+    std::atomic<bench_phase> phase(bench_phase::warmup);
+    std::vector<bench_worker> workers;
+    workers.reserve(settings.threads);
+    for (std::size_t idx = 0U; idx < settings.threads; ++idx)
+        workers.emplace_back(settings, paths, value, sessions[idx % sessions.size()], idx, phase);
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers.size());
+    for (auto& worker : workers)
+        threads.emplace_back([&worker] { worker.run(); });
+
+    std::this_thread::sleep_for(settings.warmup);
+    auto start = std::chrono::steady_clock::now();
+    phase = bench_phase::measure;
+
+    std::this_thread::sleep_for(settings.duration);
+    phase = bench_phase::stop;
+    auto finish = std::chrono::steady_clock::now();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    bench_report report;
+    report.settings          = settings;
+    report.connection_string = connection_string;
+    report.elapsed           = finish - start;
+    for (const auto& worker : workers)
+    {
+        for (std::size_t idx = 0U; idx < bench_op_count; ++idx)
+            report.ops[idx].merge(worker.results()[idx]);
+    }
+
+    for (auto& session : sessions)
+        session.close();
+
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// run_failover_benchmark                                                                                             //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bench_report run_failover_benchmark(const bench_options& settings, const std::string& connection_string)
+{
+    std::vector<client> sessions;
+    sessions.reserve(settings.sessions);
+    for (std::size_t idx = 0U; idx < settings.sessions; ++idx)
+        sessions.emplace_back(client::connect(connection_string).get());
+
+    ensure_entry(sessions.front(), settings.root, buffer());
+    auto path = settings.root + "/election";
+
+    // Candidates are kept in the order they joined, which is the order they will be elected in. Each candidate creates
+    // its entry on its own thread, so wait for the entry to exist before the next one joins to keep that order.
+    std::size_t joined = 0U;
+    std::deque<std::unique_ptr<recipes::leader_election>> candidates;
+    auto join = [&]
+                {
+                    auto& conn = sessions[joined++ % sessions.size()];
+                    candidates.emplace_back(std::make_unique<recipes::leader_election>(conn, path));
+
+                    while (true)
+                    {
+                        try
+                        {
+                            if (conn.get_children(path).get().children().size() >= candidates.size())
+                                break;
+                        }
+                        catch (const no_entry&)
+                        { }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                };
+    for (std::size_t idx = 0U; idx < settings.threads; ++idx)
+        join();
+    candidates.front()->leadership_gained().get();
+
+    bench_report report;
+    report.settings          = settings;
+    report.connection_string = connection_string;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0U; round < settings.failovers; ++round)
+    {
+        auto gained = candidates[1]->leadership_gained();
+
+        auto resign_start = std::chrono::steady_clock::now();
+        candidates.front()->resign();
+        try
+        {
+            gained.get();
+            report.failover.latency.record(std::chrono::steady_clock::now() - resign_start);
+        }
+        catch (const std::exception&)
+        {
+            ++report.failover.errors;
+        }
+
+        candidates.pop_front();
+        join();
+    }
+    report.elapsed = std::chrono::steady_clock::now() - start;
+
+    candidates.clear();
+    for (auto& session : sessions)
+        session.close();
+
+    return report;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <string>
+
+#include "options.hpp"
+#include "report.hpp"
+
+namespace zk::bench
+{
+
+/// \addtogroup Bench
+/// \{
+
+/// Run the workload described by \a settings against the ensemble at \a connection_string.
+///
+/// Before any operations are issued, \ref bench_options::keys entries of \ref bench_options::value_size bytes are
+/// created under \ref bench_options::root (entries left by a previous run are reused). Each of the
+/// \ref bench_options::threads threads then issues one operation at a time, picked at random from
+/// \ref bench_options::mix, and waits for it to complete, so the reported latency is the round-trip time a caller sees.
+/// Each thread watches its own entry for \ref bench_op::watch, so the event it waits for is always triggered by its
+/// own \c set.
+///
+/// \throws std::exception if the ensemble could not be connected to or the entries could not be created.
+bench_report run_benchmark(const bench_options& settings, const std::string& connection_string);
+
+/// Measure how long it takes a \ref recipes::leader_election to fail over, for \ref bench_options::failovers rounds.
+/// \ref bench_options::threads candidates join an election under \ref bench_options::root, spread over
+/// \ref bench_options::sessions sessions. Each round, the leader resigns and the time from the call to
+/// \ref recipes::leader_election::resign until the next candidate is notified of its leadership is recorded in
+/// \ref bench_report::failover. The resigned candidate then rejoins at the back of the line, so the number of
+/// candidates stays the same.
+///
+/// \throws std::exception if the ensemble could not be connected to.
+bench_report run_failover_benchmark(const bench_options& settings, const std::string& connection_string);
+
+/// \}
+
+}
@@ -1,8 +1,11 @@
 #include "client.hpp"
 #include "acl.hpp"
+#include "codec.hpp"
 #include "connection.hpp"
 #include "multi.hpp"
+#include "retry.hpp"
 #include "exceptions.hpp"
+#include "detail/children_diff.hpp"
 
 #include <sstream>
 #include <ostream>
@@ -37,7 +40,7 @@ future<client> client::connect(connection_params conn_params)
     {
         auto conn = connection::connect(conn_params);
         auto state_change_fut = conn->watch_state();
-        if (conn->state() == state::connected)
+        if (conn->state() == zk::state::connected)
         {
             promise<client> p;
             p.set_value(client(std::move(conn)));
@@ -51,8 +54,8 @@ future<client> client::connect(connection_params conn_params)
                        zk::launch::async,
                        [state_change_fut = std::move(state_change_fut), conn = std::move(conn)] () mutable -> client
                        {
-                         state s(state_change_fut.get());
-                         if (s == state::connected)
+                         zk::state s(state_change_fut.get());
+                         if (s == zk::state::connected)
                             return client(conn);
                          else
                             zk::throw_exception(std::runtime_error(std::string("Unexpected state: ") + to_string(s)));
@@ -75,46 +78,105 @@ void client::close()
     _conn->close();
 }
 
-future<get_result> client::get(string_view path) const
+zk::state client::state() const
 {
-    return _conn->get(path);
+    return _conn->state();
 }
 
-future<watch_result> client::watch(string_view path) const
+future<zk::state> client::watch_state() const
 {
-    return _conn->watch(path);
+    return _conn->watch_state();
 }
 
-future<get_children_result> client::get_children(string_view path) const
+client client::with_timeout(std::chrono::milliseconds timeout) const
 {
-    return _conn->get_children(path);
+    client out(*this);
+    out._timeout = timeout;
+    return out;
 }
 
-future<watch_children_result> client::watch_children(string_view path) const
+client client::with_retry(retry_policy policy) const
 {
-    return _conn->watch_children(path);
+    client out(*this);
+    out._retry = std::make_shared<const retry_policy>(std::move(policy));
+    return out;
 }
 
-future<exists_result> client::exists(string_view path) const
+client client::with_codec(std::shared_ptr<const payload_codec> codec) const
 {
-    return _conn->exists(path);
+    client out(*this);
+    out._codec = std::move(codec);
+    return out;
 }
 
-future<watch_exists_result> client::watch_exists(string_view path) const
+request_options client::options() const
 {
-    return _conn->watch_exists(path);
+    request_options out;
+    if (_timeout)
+        out.deadline = std::chrono::steady_clock::now() + *_timeout;
+    out.retry = _retry;
+    out.codec = _codec;
+    return out;
 }
 
-future<create_result> client::create(string_view   path,
+future<get_result> client::get(path_view path) const
+{
+    return _conn->get(path, options());
+}
+
+future<watch_result> client::watch(path_view path) const
+{
+    return _conn->watch(path, options());
+}
+
+future<get_children_result> client::get_children(path_view path) const
+{
+    return _conn->get_children(path, options());
+}
+
+future<watch_children_result> client::watch_children(path_view path) const
+{
+    return _conn->watch_children(path, options());
+}
+
+future<watch_children_diff_result> client::watch_children_diff(path_view path) const
+{
+    return detail::children_diff_state::start(*this, std::string(path));
+}
+
+void client::listen(path_view path, std::shared_ptr<watch_listener> listener) const
+{
+    _conn->listen(path, options(), std::move(listener));
+}
+
+void client::listen_children(path_view path, std::shared_ptr<watch_children_listener> listener) const
+{
+    _conn->listen_children(path, options(), std::move(listener));
+}
+
+future<exists_result> client::exists(path_view path) const
+{
+    return _conn->exists(path, options());
+}
+
+future<watch_exists_result> client::watch_exists(path_view path) const
+{
+    return _conn->watch_exists(path, options());
+}
+
+future<create_result> client::create(path_view     path,
                                      const buffer& data,
                                      const acl&    rules,
                                      create_mode   mode
                                     )
 {
-    return _conn->create(path, data, rules, mode);
+    if (_codec)
+        return _conn->create(path, _codec->encode(data), rules, mode, options());
+    else
+        return _conn->create(path, data, rules, mode, options());
 }
 
-future<create_result> client::create(string_view   path,
+future<create_result> client::create(path_view     path,
                                      const buffer& data,
                                      create_mode   mode
                                     )
@@ -122,34 +184,61 @@ future<create_result> client::create(string_view   path,
     return create(path, data, acls::open_unsafe(), mode);
 }
 
-future<set_result> client::set(string_view path, const buffer& data, version check)
+future<set_result> client::set(path_view path, const buffer& data, version check)
 {
-    return _conn->set(path, data, check);
+    if (_codec)
+        return _conn->set(path, _codec->encode(data), check, options());
+    else
+        return _conn->set(path, data, check, options());
 }
 
-future<get_acl_result> client::get_acl(string_view path) const
+future<get_acl_result> client::get_acl(path_view path) const
 {
-    return _conn->get_acl(path);
+    return _conn->get_acl(path, options());
 }
 
-future<void> client::set_acl(string_view path, const acl& rules, acl_version check)
+future<void> client::set_acl(path_view path, const acl& rules, acl_version check)
 {
-    return _conn->set_acl(path, rules, check);
+    return _conn->set_acl(path, rules, check, options());
 }
 
-future<void> client::erase(string_view path, version check)
+future<void> client::erase(path_view path, version check)
 {
-    return _conn->erase(path, check);
+    return _conn->erase(path, check, options());
 }
 
 future<void> client::load_fence() const
 {
-    return _conn->load_fence();
+    return _conn->load_fence(options());
 }
 
 future<multi_result> client::commit(multi_op txn)
 {
-    return _conn->commit(std::move(txn));
+    if (_codec)
+    {
+        multi_op encoded;
+        encoded.reserve(txn.size());
+        for (const auto& x : txn)
+        {
+            if (x.type() == op_type::create)
+            {
+                const auto& src = x.as_create();
+                encoded.push_back(op::create(src.path, _codec->encode(src.data), src.rules, src.mode));
+            }
+            else if (x.type() == op_type::set)
+            {
+                const auto& src = x.as_set();
+                encoded.push_back(op::set(src.path, _codec->encode(src.data), src.check));
+            }
+            else
+            {
+                encoded.push_back(x);
+            }
+        }
+        return _conn->commit(std::move(encoded), options());
+    }
+
+    return _conn->commit(std::move(txn), options());
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include <zk/config.hpp>
 
+#include <chrono>
 #include <memory>
 #include <utility>
 
@@ -9,6 +10,7 @@
 #include "forwards.hpp"
 #include "future.hpp"
 #include "optional.hpp"
+#include "path.hpp"
 #include "string_view.hpp"
 #include "results.hpp"
 #include "types.hpp"
@@ -59,10 +61,68 @@ public:
     /// automatically.
     void close();
 
+    /// The current state of the underlying \ref connection.
+    zk::state state() const;
+
+    /// Watch for the next change in the \ref state of the underlying \ref connection. The future is delivered with the
+    /// new state or with \ref session_expired or \ref authentication_failed if the session can no longer be used.
+    future<zk::state> watch_state() const;
+
+    /// Get a client which issues operations through the same connection, but delivers any operation which has not
+    /// completed within \a timeout with \ref operation_timeout. This is much shorter than waiting for the session
+    /// timeout to notice a problem. When the reply for an operation which timed out arrives, it is discarded. Creating
+    /// the client is cheap, so it is reasonable to do for a single call:
+    ///
+    /// \code
+    /// auto result = client.with_timeout(std::chrono::milliseconds(50)).get("/some/path");
+    /// \endcode
+    ///
+    /// For a watch, the timeout only applies to the delivery of the data, not the event.
+    client with_timeout(std::chrono::milliseconds timeout) const;
+
+    /// The timeout applied to each operation issued by this client. By default, there is none.
+    ///
+    /// \see with_timeout
+    const optional<std::chrono::milliseconds>& timeout() const { return _timeout; }
+
+    /// Get a client which issues operations through the same connection, but retries operations which fail with a
+    /// transient error (such as \ref connection_loss) according to \a policy. Retries are scheduled by the connection,
+    /// so the returned future is simply delivered later -- no thread is blocked waiting for the backoff. Only
+    /// operations the policy considers \ref retry_policy::idempotent are retried.
+    ///
+    /// \code
+    /// auto retrying = client.with_retry(zk::retry_policy());
+    /// auto result   = retrying.get("/some/path").get();
+    /// \endcode
+    client with_retry(retry_policy policy) const;
+
+    /// The policy for retrying operations issued by this client. By default, there is none and operations are attempted
+    /// only once.
+    ///
+    /// \see with_retry
+    const std::shared_ptr<const retry_policy>& retry() const { return _retry; }
+
+    /// Get a client which issues operations through the same connection, but encodes the data it writes with \a codec
+    /// and decodes the data it reads with it (see \ref payload_codec). This applies to \ref create, \ref set, the
+    /// create and set operations of \ref commit, \ref get and \ref watch. Data which was not encoded is read as-is, so
+    /// clients with and without a codec can share entries as long as only clients with a codec read them.
+    ///
+    /// \code
+    /// auto codec  = std::make_shared<zk::payload_codec>();
+    /// auto packed = client.with_codec(codec);
+    /// packed.set("/config/big", data).get();
+    /// \endcode
+    client with_codec(std::shared_ptr<const payload_codec> codec) const;
+
+    /// The codec applied to data written and read by this client. By default, there is none.
+    ///
+    /// \see with_codec
+    const std::shared_ptr<const payload_codec>& codec() const { return _codec; }
+
     /// Return the data and the \ref stat of the entry of the given \a path.
     ///
     /// \throws no_entry If no entry exists at the given \a path, the future will be delievered with \ref no_entry.
-    future<get_result> get(string_view path) const;
+    future<get_result> get(path_view path) const;
 
     /// Similar to \ref get, but if the call is successful (no error is returned), a watch will be left on the entry
     /// with the given \a path. The watch will be triggered by a successful operation that sets data or erases the
@@ -70,7 +130,7 @@ public:
     ///
     /// \throws no_entry If no entry exists at the given \a path, the future will be delievered with \ref no_entry. To
     ///  watch for the creation of an entry, use \ref watch_exists.
-    future<watch_result> watch(string_view path) const;
+    future<watch_result> watch(path_view path) const;
 
     /// Return the list of the children of the entry of the given \a path. The returned values are not prefixed with the
     /// provided \a path; i.e. if the database contains \c "/path/a" and \c "/path/b", the result of \c get_children for
@@ -78,20 +138,35 @@ public:
     /// its natural or lexical order.
     ///
     /// \throws no_entry If no entry exists at the given \a path, the future will be delievered with \ref no_entry.
-    future<get_children_result> get_children(string_view path) const;
+    future<get_children_result> get_children(path_view path) const;
 
     /// Similar to \ref get_children, but if the call is successful (no error is returned), a watch will be left on the
     /// entry with the given \a path. The watch will be triggered by a successful operation that erases the entry at the
     /// given \a path or creates or erases a child immediately under the path (it is not recursive).
-    future<watch_children_result> watch_children(string_view path) const;
+    future<watch_children_result> watch_children(path_view path) const;
+
+    /// Similar to \ref watch_children, but instead of the full list of children, each trigger of the watch delivers
+    /// only the names which were added and removed since the previous list (see
+    /// \ref watch_children_diff_result::next). The previous list is kept in a hash set, so the work per change is a
+    /// lookup for each child instead of sorting and comparing two lists, and the caller only sees the difference.
+    /// The watch is left on the entry again each time the change is fetched.
+    future<watch_children_diff_result> watch_children_diff(path_view path) const;
+
+    /// Similar to \ref watch, but the data and the event are delivered to \a listener as soon as they arrive instead of
+    /// through futures, so nothing has to wait for them (see \ref connection::listen).
+    void listen(path_view path, std::shared_ptr<watch_listener> listener) const;
+
+    /// Similar to \ref watch_children, but the children and the event are delivered to \a listener as soon as they
+    /// arrive instead of through futures, so nothing has to wait for them (see \ref connection::listen_children).
+    void listen_children(path_view path, std::shared_ptr<watch_children_listener> listener) const;
 
     /// Return the \ref stat of the entry of the given \a path or \c nullopt if it does not exist.
-    future<exists_result> exists(string_view path) const;
+    future<exists_result> exists(path_view path) const;
 
     /// Similar to \ref watch, but if the call is successful (no error is returned), a watch will be left on the entry
     /// with the given \a path. The watch will be triggered by a successful operation that creates the entry, erases the
     /// entry, or sets the data on the entry.
-    future<watch_exists_result> watch_exists(string_view path) const;
+    future<watch_exists_result> watch_exists(path_view path) const;
 
     /// \{
     /// Create an entry at the given \a path.
@@ -116,12 +191,12 @@ public:
     /// \throws invalid_acl If the \a acl is invalid or empty, the future will be delivered with \ref invalid_acl.
     /// \throws invalid_arguments The maximum allowable size of the data array is 1 MiB (1,048,576 bytes). If \a data
     ///  is larger than this the future will be delivered with \ref invalid_arguments.
-    future<create_result> create(string_view   path,
+    future<create_result> create(path_view     path,
                                  const buffer& data,
                                  const acl&    rules,
                                  create_mode   mode = create_mode::normal
                                 );
-    future<create_result> create(string_view   path,
+    future<create_result> create(path_view     path,
                                  const buffer& data,
                                  create_mode   mode = create_mode::normal
                                 );
@@ -136,12 +211,12 @@ public:
     ///  delivered with \ref version_mismatch.
     /// \throws invalid_arguments The maximum allowable size of the data array is 1 MiB (1,048,576 bytes). If \a data
     ///  is larger than this the future will be delivered with \ref invalid_arguments.
-    future<set_result> set(string_view path, const buffer& data, version check = version::any());
+    future<set_result> set(path_view path, const buffer& data, version check = version::any());
 
     /// Return the ACL and \ref stat of the entry of the given path.
     ///
     /// \throws no_entry If no entry exists at the given \a path, the future will be delievered with \ref no_entry.
-    future<get_acl_result> get_acl(string_view path) const;
+    future<get_acl_result> get_acl(path_view path) const;
 
     /// Set the ACL for the entry of the given \a path if such an entry exists and the given version \a check matches
     /// the version of the entry.
@@ -153,7 +228,7 @@ public:
     /// \throws no_entry If no entry exists at the given \a path, the future will be delievered with \ref no_entry.
     /// \throws version_mismatch If the given version \a check does not match the entry's version, the future will be
     ///  delivered with \ref version_mismatch.
-    future<void> set_acl(string_view path, const acl& rules, acl_version check = acl_version::any());
+    future<void> set_acl(path_view path, const acl& rules, acl_version check = acl_version::any());
 
     /// Erase the entry at the given \a path. The call will succeed if such an entry exists, and the given version
     /// \a check matches the entry's version (if the given version is \ref version::any, it matches any entry's
@@ -166,7 +241,7 @@ public:
     ///  delivered with \ref version_mismatch.
     /// \throws not_empty You are only allowed to erase entries with no children. If the entry has children, the future
     ///  will be delievered with \ref not_empty.
-    future<void> erase(string_view path, version check = version::any());
+    future<void> erase(path_view path, version check = version::any());
 
     /// Ensure that all subsequent reads observe the data at the transaction on the server at or past real-time \e now.
     /// If your application communicates only through reads and writes of ZooKeeper, this operation is never needed.
@@ -213,7 +288,14 @@ public:
     future<multi_result> commit(multi_op txn);
 
 private:
-    std::shared_ptr<connection> _conn;
+    /// Get the options for an operation issued now.
+    request_options options() const;
+
+private:
+    std::shared_ptr<connection>          _conn;
+    optional<std::chrono::milliseconds>  _timeout;
+    std::shared_ptr<const retry_policy>  _retry;
+    std::shared_ptr<const payload_codec> _codec;
 };
 
 /// \}
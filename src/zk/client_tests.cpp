@@ -1,15 +1,21 @@
 #include <zk/server/server_tests.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include "client.hpp"
+#include "codec.hpp"
+#include "connection.hpp"
 #include "error.hpp"
 #include "multi.hpp"
+#include "retry.hpp"
 #include "string_view.hpp"
+#include "trace.hpp"
 
 namespace zk
 {
@@ -155,6 +161,107 @@ GTEST_TEST_F(client_tests, watch_children)
     CHECK_EQ(ev2.state(), state::connected);
 }
 
+GTEST_TEST_F(client_tests, watch_children_diff)
+{
+    client c = get_connected_client();
+    auto root_name = c.create("/test-node-", buffer_from("Hello!"), create_mode::sequential).get().name();
+
+    c.commit({
+        op::create(root_name + "/a", buffer_from("a")),
+        op::create(root_name + "/b", buffer_from("b")),
+    }).get();
+
+    auto watch = c.watch_children_diff(root_name).get();
+    CHECK_EQ(2U, watch.initial().children().size());
+
+    c.create(root_name + "/c", buffer_from("c")).get();
+    auto diff = watch.next().get();
+    CHECK_EQ(std::vector<std::string>({ "c" }), diff.added());
+    CHECK_TRUE(diff.removed().empty());
+
+    // Both changes might be seen by the same trigger, so keep going until both have been delivered
+    c.erase(root_name + "/a").get();
+    c.create(root_name + "/d", buffer_from("d")).get();
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    while (added.empty() || removed.empty())
+    {
+        auto next = watch.next().get();
+        added.insert(added.end(), next.added().begin(), next.added().end());
+        removed.insert(removed.end(), next.removed().begin(), next.removed().end());
+    }
+    CHECK_EQ(std::vector<std::string>({ "d" }), added);
+    CHECK_EQ(std::vector<std::string>({ "a" }), removed);
+
+    // Erasing the parent reports the remaining children as removed, then the watch ends
+    c.commit({
+        op::erase(root_name + "/b"),
+        op::erase(root_name + "/c"),
+        op::erase(root_name + "/d"),
+        op::erase(root_name),
+    }).get();
+    std::size_t removed_count = 0U;
+    while (removed_count < 3U)
+        removed_count += watch.next().get().removed().size();
+    CHECK_THROWS(no_entry) { watch.next().get(); };
+}
+
+GTEST_TEST_F(client_tests, watch_children_diff_drop_next)
+{
+    client c = get_connected_client();
+    auto root_name = c.create("/test-node-", buffer_from("Hello!"), create_mode::sequential).get().name();
+    auto watch     = c.watch_children_diff(root_name).get();
+
+    // Nothing waits on a future which is not wanted, so dropping it does not block...
+    watch.next();
+    c.create(root_name + "/a", buffer_from("a")).get();
+
+    // ...and the changes after it are still delivered
+    for (std::size_t idx = 0U; ; ++idx)
+    {
+        auto next = watch.next();
+        auto name = "n" + std::to_string(idx);
+        c.create(root_name + "/" + name, buffer_from(name)).get();
+        auto diff = next.get();
+        if (std::find(diff.added().begin(), diff.added().end(), name) != diff.added().end())
+            break;
+    }
+}
+
+GTEST_TEST_F(client_tests, codec)
+{
+    client c      = get_connected_client();
+    auto   codec  = std::make_shared<payload_codec>();
+    client packed = c.with_codec(codec);
+
+    std::string text;
+    for (std::size_t idx = 0U; idx < 100U; ++idx)
+        text += "{\"key\":\"value-" + std::to_string(idx % 10U) + "\"}";
+    auto data = buffer_from(text);
+
+    auto name   = packed.create("/test-node-", data, create_mode::sequential).get().name();
+    auto stored = c.get(name).get();
+    CHECK_TRUE(payload_codec::is_encoded(stored.data()));
+    CHECK_LT(stored.data().size(), data.size());
+    CHECK_TRUE(data == packed.get(name).get().data());
+
+    // Data written without the codec is still readable through it
+    c.set(name, buffer_from("plain")).get();
+    auto watch = packed.watch(name).get();
+    CHECK_TRUE(buffer_from("plain") == watch.initial().data());
+
+    packed.commit({ op::set(name, data) }).get();
+    watch.next().get();
+    CHECK_TRUE(data == packed.get(name).get().data());
+
+    auto stats = codec->stats();
+    CHECK_EQ(2U, stats.encoded);
+    CHECK_EQ(2U, stats.compressed);
+    CHECK_GT(stats.ratio(), 1.0);
+
+    c.erase(name).get();
+}
+
 GTEST_TEST_F(client_tests, watch_exists)
 {
     client c = get_connected_client();
@@ -197,6 +304,129 @@ GTEST_TEST_F(client_tests, watch_close)
     CHECK_EQ(ev.state(), state::closed);
 }
 
+GTEST_TEST_F(client_tests, request_window_wait)
+{
+    auto conn = connection::connect(get_connection_string() + "/?max_in_flight=2");
+    client c(conn);
+
+    std::vector<future<exists_result>> results;
+    for (std::size_t idx = 0U; idx < 64U; ++idx)
+        results.emplace_back(c.exists("/"));
+
+    CHECK_LE(conn->window_stats().in_flight, 2U);
+    for (auto& result : results)
+        CHECK_TRUE(result.get());
+
+    auto stats = conn->window_stats();
+    CHECK_EQ(0U, stats.queued);
+    CHECK_EQ(0U, stats.rejected);
+    c.close();
+}
+
+GTEST_TEST_F(client_tests, request_window_reject)
+{
+    auto conn = connection::connect(get_connection_string() + "/?max_in_flight=1&backpressure=reject");
+    client c(conn);
+
+    // The first request holds the only slot until the session is established, so the rest are rejected.
+    std::vector<future<exists_result>> results;
+    for (std::size_t idx = 0U; idx < 16U; ++idx)
+        results.emplace_back(c.exists("/"));
+
+    std::size_t rejected = 0U;
+    for (auto& result : results)
+    {
+        try
+        {
+            result.get();
+        }
+        catch (const throttled&)
+        {
+            ++rejected;
+        }
+    }
+
+    CHECK_LT(0U, rejected);
+    CHECK_EQ(rejected, conn->window_stats().rejected);
+    c.close();
+}
+
+GTEST_TEST_F(client_tests, timeout_already_passed)
+{
+    client c = get_connected_client();
+    CHECK_THROWS(operation_timeout) { c.with_timeout(std::chrono::milliseconds(0)).get("/").get(); };
+
+    // The original client is not affected
+    CHECK_FALSE(c.timeout());
+    c.get("/").get();
+}
+
+GTEST_TEST_F(client_tests, retry_throttled)
+{
+    auto conn = connection::connect(get_connection_string() + "/?max_in_flight=1&backpressure=reject");
+    retry_policy policy;
+    policy.max_attempts()    = 1000U;
+    policy.initial_backoff() = std::chrono::milliseconds(1);
+    policy.max_backoff()     = std::chrono::milliseconds(20);
+    client c = client(conn).with_retry(policy);
+
+    std::vector<future<exists_result>> results;
+    for (std::size_t idx = 0U; idx < 16U; ++idx)
+        results.emplace_back(c.exists("/"));
+
+    // Every rejected request was retried until it made it through the window.
+    for (auto& result : results)
+        CHECK_TRUE(result.get());
+    CHECK_LT(0U, conn->window_stats().rejected);
+    c.close();
+}
+
+GTEST_TEST_F(client_tests, retry_skips_non_idempotent)
+{
+    auto conn = connection::connect(get_connection_string() + "/?max_in_flight=1&backpressure=reject");
+    client c = client(conn).with_retry(retry_policy());
+
+    std::vector<future<create_result>> results;
+    for (std::size_t idx = 0U; idx < 16U; ++idx)
+        results.emplace_back(c.create("/retry-skip-", buffer(), create_mode::sequential | create_mode::ephemeral));
+
+    std::size_t rejected = 0U;
+    for (auto& result : results)
+    {
+        try
+        {
+            result.get();
+        }
+        catch (const throttled&)
+        {
+            ++rejected;
+        }
+    }
+
+    CHECK_LT(0U, rejected);
+    CHECK_EQ(rejected, conn->window_stats().rejected);
+    c.close();
+}
+
+GTEST_TEST(client_timeout_tests, unreachable_server)
+{
+    // Nothing listens here, so requests wait in the C client until the session times out -- unless they have a deadline.
+    client c(connection::connect("zk://127.0.0.1:1/?timeout=30"));
+    auto   timed = c.with_timeout(std::chrono::milliseconds(50));
+
+    auto start   = std::chrono::steady_clock::now();
+    auto f_get   = timed.get("/");
+    auto f_watch = timed.watch("/");
+    auto f_txn   = timed.commit(multi_op({ op::check("/") }));
+    CHECK_THROWS(operation_timeout) { f_get.get(); };
+    CHECK_THROWS(operation_timeout) { f_watch.get(); };
+    CHECK_THROWS(operation_timeout) { f_txn.get(); };
+    CHECK_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+
+    // Closing delivers the late completions, which must be discarded
+    c.close();
+}
+
 class stopping_client_tests :
         public server::server_fixture
 { };
@@ -212,4 +442,96 @@ GTEST_TEST_F(stopping_client_tests, watch_server_stop)
     CHECK_EQ(ev.type(), event_type::session);
 }
 
+namespace
+{
+
+/// Counts how many times requests were issued and how many times they were sent, which is more if any were retried.
+class attempt_counter final :
+        public request_observer
+{
+public:
+    virtual void on_start(const request_trace&) override { ++start_count; }
+
+    virtual void on_send(const request_trace&) override { ++send_count; }
+
+public:
+    std::atomic<std::size_t> start_count{0U};
+    std::atomic<std::size_t> send_count{0U};
+};
+
+}
+
+GTEST_TEST_F(stopping_client_tests, retry_across_restart)
+{
+    auto conn     = connection::connect(get_connection_string());
+    auto attempts = std::make_shared<attempt_counter>();
+    conn->observer(attempts);
+    client c(conn);
+    c.create("/retry", buffer_from("data")).get();
+
+    retry_policy policy;
+    policy.max_attempts()    = 100U;
+    policy.initial_backoff() = std::chrono::milliseconds(50);
+    policy.max_backoff()     = std::chrono::milliseconds(500);
+    auto retrying = c.with_retry(policy);
+
+    // Requests issued while the server is down fail with connection_loss each time the client fails to reconnect and
+    // are sent again until it comes back.
+    this->stop_server(true);
+
+    std::vector<future<get_result>> results;
+    for (std::size_t idx = 0U; idx < 64U; ++idx)
+        results.emplace_back(retrying.get("/retry"));
+    auto fence = retrying.load_fence();
+
+    this->start_server();
+
+    for (auto& result : results)
+        CHECK_EQ(buffer_from("data"), result.get().data());
+    fence.get();
+#if ZKPP_ENABLE_TRACING
+    CHECK_LT(attempts->start_count.load(), attempts->send_count.load());
+#endif
+    c.close();
+}
+
+GTEST_TEST_F(stopping_client_tests, session_recovery)
+{
+    client c(connection::connect(get_connection_string() + "/?session_recovery=ephemerals"));
+    c.create("/owned", buffer_from("mine"), create_mode::ephemeral).get();
+    c.create("/watched", buffer_from("data")).get();
+    auto root_watch    = c.watch("/").get();
+    auto watched_watch = c.watch("/watched").get();
+
+    // Starting without the data expires the session when the client reconnects.
+    this->stop_server(true);
+    this->start_server(false);
+
+    // "/watched" was lost along with the data, which the re-armed watch reports as the event it missed.
+    CHECK_EQ(event_type::erased, watched_watch.next().get().type());
+
+    bool recreated = false;
+    for (auto until = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+         !recreated && std::chrono::steady_clock::now() < until;
+        )
+    {
+        try
+        {
+            recreated = bool(c.exists("/owned").get());
+        }
+        catch (const error&)
+        { }
+
+        if (!recreated)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CHECK_TRUE(recreated);
+    CHECK_EQ(buffer_from("mine"), c.get("/owned").get().data());
+
+    // The watch on the root was re-armed on the new session.
+    c.set("/", buffer_from("changed")).get();
+    CHECK_EQ(event_type::changed, root_watch.next().get().type());
+    c.close();
+}
+
 }
@@ -0,0 +1,339 @@
+#include "codec.hpp"
+#include "error.hpp"
+#include "exceptions.hpp"
+
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <sstream>
+
+namespace zk
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// compressor                                                                                                         //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+compressor::~compressor() noexcept = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fast_compressor                                                                                                    //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The compressed form is a list of sequences. Each sequence is a token byte, whose high nibble is the number of literal
+// bytes and whose low nibble is the length of the match minus min_match, followed by the literal bytes, then the offset
+// of the match (16 bits, little-endian). A nibble of 15 means the length continues in the following bytes, each of
+// which is added to it, until one is not 255. The last sequence has no match, so it ends after its literals.
+
+static constexpr std::size_t min_match  = 4U;
+static constexpr std::size_t max_offset = 65535U;
+static constexpr std::size_t hash_bits  = 12U;
+
+static std::uint32_t read32(const char* p)
+{
+    std::uint32_t out;
+    std::memcpy(&out, p, sizeof out);
+    return out;
+}
+
+static std::size_t hash_of(std::uint32_t value)
+{
+    return std::size_t((value * 2654435761U) >> (32U - hash_bits));
+}
+
+static void put_length(buffer& out, std::size_t length)
+{
+    for (length -= 15U; length >= 255U; length -= 255U)
+        out.push_back(char(255));
+    out.push_back(char(length));
+}
+
+static void put_sequence(buffer&     out,
+                         const char* literals,
+                         std::size_t literal_count,
+                         std::size_t offset,
+                         std::size_t match_length
+                        )
+{
+    std::size_t match_code = match_length == 0U ? 0U : match_length - min_match;
+    out.push_back(char((std::min<std::size_t>(literal_count, 15U) << 4) | std::min<std::size_t>(match_code, 15U)));
+    if (literal_count >= 15U)
+        put_length(out, literal_count);
+    out.insert(out.end(), literals, literals + literal_count);
+
+    if (match_length == 0U)
+        return;
+
+    out.push_back(char(offset & 0xffU));
+    out.push_back(char(offset >> 8));
+    if (match_code >= 15U)
+        put_length(out, match_code);
+}
+
+void fast_compressor::compress(const char* data, std::size_t size, buffer& out) const
+{
+    // Positions are stored off by one, so 0 means the slot is empty
+    std::array<std::uint32_t, std::size_t(1) << hash_bits> table;
+    table.fill(0U);
+
+    std::size_t anchor = 0U;
+    std::size_t pos    = 0U;
+    while (pos + min_match <= size)
+    {
+        auto  value     = read32(data + pos);
+        auto& slot      = table[hash_of(value)];
+        auto  candidate = std::size_t(slot);
+        slot = std::uint32_t(pos + 1U);
+
+        if (candidate == 0U || pos - (candidate - 1U) > max_offset || read32(data + candidate - 1U) != value)
+        {
+            ++pos;
+            continue;
+        }
+
+        --candidate;
+        std::size_t length = min_match;
+        while (pos + length < size && data[candidate + length] == data[pos + length])
+            ++length;
+
+        put_sequence(out, data + anchor, pos - anchor, pos - candidate, length);
+        pos   += length;
+        anchor = pos;
+    }
+
+    put_sequence(out, data + anchor, size - anchor, 0U, 0U);
+}
+
+void fast_compressor::decompress(const char* data, std::size_t size, std::size_t original_size, buffer& out) const
+{
+    auto ip  = reinterpret_cast<const unsigned char*>(data);
+    auto end = ip + size;
+
+    auto corrupt = [] { zk::throw_exception(marshalling_error()); };
+    auto read_length = [&] (std::size_t length)
+                       {
+                           if (length == 15U)
+                           {
+                               unsigned char more;
+                               do
+                               {
+                                   if (ip == end)
+                                       corrupt();
+                                   more = *ip++;
+                                   length += more;
+                               } while (more == 255U);
+                           }
+                           return length;
+                       };
+
+    const auto base = out.size();
+    out.reserve(base + original_size);
+    while (true)
+    {
+        if (ip == end)
+            corrupt();
+        auto token = *ip++;
+
+        auto literal_count = read_length(token >> 4);
+        if (std::size_t(end - ip) < literal_count || out.size() - base + literal_count > original_size)
+            corrupt();
+        out.insert(out.end(), ip, ip + literal_count);
+        ip += literal_count;
+
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            corrupt();
+        std::size_t offset = std::size_t(ip[0]) | (std::size_t(ip[1]) << 8);
+        ip += 2;
+
+        auto length   = read_length(token & 0x0fU) + min_match;
+        auto produced = out.size() - base;
+        if (offset == 0U || offset > produced || produced + length > original_size)
+            corrupt();
+
+        // The match can overlap the bytes it produces, so it is copied a byte at a time
+        auto from = out.size() - offset;
+        for (std::size_t idx = 0U; idx < length; ++idx)
+        {
+            char c = out[from + idx];
+            out.push_back(c);
+        }
+    }
+
+    if (out.size() - base != original_size)
+        corrupt();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// codec_stats                                                                                                        //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double codec_stats::ratio() const
+{
+    return bytes_out == 0U ? 1.0 : double(bytes_in) / double(bytes_out);
+}
+
+std::ostream& operator<<(std::ostream& os, const codec_stats& self)
+{
+    os << "{encoded=" << self.encoded;
+    os << " compressed=" << self.compressed;
+    os << " bytes_in=" << self.bytes_in;
+    os << " bytes_out=" << self.bytes_out;
+    os << " ratio=" << self.ratio();
+    os << " encode_time=" << std::chrono::duration_cast<std::chrono::microseconds>(self.encode_time).count() << "us";
+    os << " decoded=" << self.decoded;
+    os << " decode_time=" << std::chrono::duration_cast<std::chrono::microseconds>(self.decode_time).count() << "us";
+    return os << '}';
+}
+
+std::string to_string(const codec_stats& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// payload_codec                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::uint8_t stored_format = 0U;
+
+/// The CPU time used by the calling thread. Encoding and decoding never block, so this is the cost of the work itself,
+/// without any time the thread spent descheduled.
+static std::int64_t thread_cpu_nanos()
+{
+    ::timespec now;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static void put_header(buffer& out, std::uint8_t format, std::size_t original_size)
+{
+    out.insert(out.end(), payload_codec::magic.begin(), payload_codec::magic.end());
+    out.push_back(char(format));
+    for (std::size_t shift = 0U; shift < 32U; shift += 8U)
+        out.push_back(char((original_size >> shift) & 0xffU));
+}
+
+payload_codec::payload_codec(std::shared_ptr<const compressor> format, std::size_t min_size) :
+        _format(std::move(format)),
+        _min_size(min_size),
+        _encoded(0U),
+        _compressed(0U),
+        _bytes_in(0U),
+        _bytes_out(0U),
+        _encode_nanos(0),
+        _decoded(0U),
+        _decode_nanos(0)
+{
+    if (!_format)
+        _format = std::make_shared<fast_compressor>();
+}
+
+bool payload_codec::is_encoded(const buffer& data)
+{
+    return data.size() >= magic.size() && std::equal(magic.begin(), magic.end(), data.begin());
+}
+
+const compressor& payload_codec::compressor_for(std::uint8_t format) const
+{
+    static const fast_compressor fast;
+
+    if (format == _format->format())
+        return *_format;
+    else if (format == fast_compressor::format_id)
+        return fast;
+    else
+        zk::throw_exception(marshalling_error());
+}
+
+buffer payload_codec::encode(const buffer& data) const
+{
+    auto started = thread_cpu_nanos();
+
+    buffer out;
+    bool   compressed = false;
+    if (data.size() >= _min_size && data.size() <= std::numeric_limits<std::uint32_t>::max())
+    {
+        out.reserve(header_size + data.size());
+        put_header(out, _format->format(), data.size());
+        _format->compress(data.data(), data.size(), out);
+        compressed = out.size() < data.size();
+    }
+
+    if (!compressed)
+    {
+        out.clear();
+        if (is_encoded(data))
+        {
+            // Stored as-is, this would be mistaken for a header
+            put_header(out, stored_format, data.size());
+            out.insert(out.end(), data.begin(), data.end());
+        }
+        else
+        {
+            out = data;
+        }
+    }
+
+    _encoded.fetch_add(1U, std::memory_order_relaxed);
+    if (compressed)
+        _compressed.fetch_add(1U, std::memory_order_relaxed);
+    _bytes_in.fetch_add(data.size(), std::memory_order_relaxed);
+    _bytes_out.fetch_add(out.size(), std::memory_order_relaxed);
+    _encode_nanos.fetch_add(thread_cpu_nanos() - started, std::memory_order_relaxed);
+    return out;
+}
+
+buffer payload_codec::decode(const buffer& data) const
+{
+    _decoded.fetch_add(1U, std::memory_order_relaxed);
+    if (!is_encoded(data))
+        return data;
+
+    auto started = thread_cpu_nanos();
+    if (data.size() < header_size)
+        zk::throw_exception(marshalling_error());
+
+    auto format        = std::uint8_t(data[magic.size()]);
+    auto original_size = std::size_t(0U);
+    for (std::size_t idx = 0U; idx < 4U; ++idx)
+        original_size |= std::size_t(std::uint8_t(data[magic.size() + 1U + idx])) << (8U * idx);
+
+    buffer out;
+    if (format == stored_format)
+    {
+        if (data.size() - header_size != original_size)
+            zk::throw_exception(marshalling_error());
+        out.assign(data.begin() + header_size, data.end());
+    }
+    else
+    {
+        compressor_for(format).decompress(data.data() + header_size, data.size() - header_size, original_size, out);
+    }
+
+    _decode_nanos.fetch_add(thread_cpu_nanos() - started, std::memory_order_relaxed);
+    return out;
+}
+
+codec_stats payload_codec::stats() const
+{
+    codec_stats out;
+    out.encoded     = _encoded.load(std::memory_order_relaxed);
+    out.compressed  = _compressed.load(std::memory_order_relaxed);
+    out.bytes_in    = _bytes_in.load(std::memory_order_relaxed);
+    out.bytes_out   = _bytes_out.load(std::memory_order_relaxed);
+    out.encode_time = std::chrono::nanoseconds(_encode_nanos.load(std::memory_order_relaxed));
+    out.decoded     = _decoded.load(std::memory_order_relaxed);
+    out.decode_time = std::chrono::nanoseconds(_decode_nanos.load(std::memory_order_relaxed));
+    return out;
+}
+
+}
@@ -0,0 +1,175 @@
+/// \file
+/// Transparent compression of the data stored in entries.
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "buffer.hpp"
+#include "string_view.hpp"
+
+namespace zk
+{
+
+/// \addtogroup Client
+/// \{
+
+/// A compression format which can be used by a \ref payload_codec. Implement this to plug in a different compression
+/// library; \ref fast_compressor is always available.
+class compressor
+{
+public:
+    virtual ~compressor() noexcept;
+
+    /// The identifier of this format, which is written in the header of every entry compressed with it. \c 0 is
+    /// reserved for data which is stored without compression and \c 1 is used by \ref fast_compressor.
+    virtual std::uint8_t format() const = 0;
+
+    /// A human-readable name for this format.
+    virtual string_view name() const = 0;
+
+    /// Append the compressed form of the \a size bytes at \a data to \a out.
+    virtual void compress(const char* data, std::size_t size, buffer& out) const = 0;
+
+    /// Append the \a original_size bytes compressed as the \a size bytes at \a data to \a out.
+    ///
+    /// \throws marshalling_error if \a data is not valid compressed data or does not decompress to exactly
+    ///  \a original_size bytes.
+    virtual void decompress(const char* data, std::size_t size, std::size_t original_size, buffer& out) const = 0;
+};
+
+/// A byte-oriented LZ77 compressor in the style of LZ4, which trades some compression ratio for speed. There is no
+/// entropy coding, so compressing and decompressing are a few table lookups and copies per byte. Text formats like
+/// JSON usually shrink to between a third and a half of their size.
+class fast_compressor final :
+        public compressor
+{
+public:
+    static constexpr std::uint8_t format_id = 1U;
+
+public:
+    virtual std::uint8_t format() const override { return format_id; }
+
+    virtual string_view name() const override { return "fast"; }
+
+    virtual void compress(const char* data, std::size_t size, buffer& out) const override;
+
+    virtual void decompress(const char* data, std::size_t size, std::size_t original_size, buffer& out) const override;
+};
+
+/// A snapshot of the work done by a \ref payload_codec.
+struct codec_stats final
+{
+    /// The number of payloads encoded.
+    std::uint64_t encoded = 0U;
+
+    /// The number of encoded payloads which were stored compressed. The rest were too small or did not shrink.
+    std::uint64_t compressed = 0U;
+
+    /// The total size of the payloads passed to \ref payload_codec::encode.
+    std::uint64_t bytes_in = 0U;
+
+    /// The total size of the payloads \ref payload_codec::encode produced, including headers.
+    std::uint64_t bytes_out = 0U;
+
+    /// The CPU time spent encoding.
+    std::chrono::nanoseconds encode_time = std::chrono::nanoseconds(0);
+
+    /// The number of payloads decoded, including ones which were not encoded.
+    std::uint64_t decoded = 0U;
+
+    /// The CPU time spent decoding.
+    std::chrono::nanoseconds decode_time = std::chrono::nanoseconds(0);
+
+    /// The compression ratio of everything encoded so far: \ref bytes_in divided by \ref bytes_out. Higher is better;
+    /// this is \c 1 if nothing has been encoded.
+    double ratio() const;
+};
+
+std::ostream& operator<<(std::ostream&, const codec_stats&);
+
+std::string to_string(const codec_stats&);
+
+/// Compresses entry data before it is written and decompresses it when it is read. Use it with
+/// \ref client::with_codec, which encodes the data of \ref client::create, \ref client::set and the create and set
+/// operations of \ref client::commit, and decodes the data delivered by \ref client::get and \ref client::watch.
+///
+/// Encoded data starts with a 9 byte header: the 4 byte magic \c "\0zkc", the \ref compressor::format and the size of
+/// the original data (32 bits, little-endian). Data without the magic is delivered as-is by \ref decode, so entries
+/// written by clients without a codec can still be read and a codec can be introduced without rewriting existing
+/// entries. Data which is smaller than the threshold or does not shrink is stored as-is, unless it happens to start
+/// with the magic, in which case it is stored behind a header with format \c 0.
+///
+/// Keep in mind \ref stat::data_size and the 1 MiB limit on entries apply to the encoded data.
+///
+/// \code
+/// auto codec  = std::make_shared<zk::payload_codec>();
+/// auto packed = client.with_codec(codec);
+/// packed.set("/config/big", buffer(json.begin(), json.end())).get();
+/// std::cout << codec->stats() << std::endl;
+/// \endcode
+class payload_codec final
+{
+public:
+    /// The magic the header of encoded data starts with.
+    static constexpr string_view magic = string_view("\0zkc", 4U);
+
+    /// The size of the header of encoded data.
+    static constexpr std::size_t header_size = 9U;
+
+public:
+    /// Create a codec which compresses with \a format data which is at least \a min_size bytes. Data compressed with
+    /// \a format or \ref fast_compressor can be decoded.
+    explicit payload_codec(std::shared_ptr<const compressor> format   = std::make_shared<fast_compressor>(),
+                           std::size_t                       min_size = 256U
+                          );
+
+    payload_codec(const payload_codec&) = delete;
+    payload_codec& operator=(const payload_codec&) = delete;
+
+    /// The format used to compress.
+    const compressor& format() const { return *_format; }
+
+    /// Data smaller than this is never compressed.
+    std::size_t min_size() const { return _min_size; }
+
+    /// Get the form of \a data to store in an entry.
+    buffer encode(const buffer& data) const;
+
+    /// Get the original data from the stored \a data.
+    ///
+    /// \throws marshalling_error if \a data has a header, but is not valid or uses a format this codec can not decode.
+    buffer decode(const buffer& data) const;
+
+    /// Does \a data start with the magic of an encoded header?
+    static bool is_encoded(const buffer& data);
+
+    /// Get the work done by this codec so far. This is safe to call while other threads use the codec.
+    codec_stats stats() const;
+
+private:
+    const compressor& compressor_for(std::uint8_t format) const;
+
+private:
+    std::shared_ptr<const compressor> _format;
+    std::size_t                       _min_size;
+
+    mutable std::atomic<std::uint64_t> _encoded;
+    mutable std::atomic<std::uint64_t> _compressed;
+    mutable std::atomic<std::uint64_t> _bytes_in;
+    mutable std::atomic<std::uint64_t> _bytes_out;
+    mutable std::atomic<std::int64_t>  _encode_nanos;
+    mutable std::atomic<std::uint64_t> _decoded;
+    mutable std::atomic<std::int64_t>  _decode_nanos;
+};
+
+/// \}
+
+}
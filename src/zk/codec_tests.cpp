@@ -0,0 +1,119 @@
+#include <zk/tests/test.hpp>
+
+#include "codec.hpp"
+#include "error.hpp"
+
+#include <string>
+
+namespace zk
+{
+
+static buffer buffer_of(const std::string& text)
+{
+    return buffer(text.begin(), text.end());
+}
+
+static std::string repetitive_json(std::size_t entries)
+{
+    std::string out = "[";
+    for (std::size_t idx = 0U; idx < entries; ++idx)
+    {
+        if (idx > 0U)
+            out += ",";
+        out += "{\"host\":\"host-" + std::to_string(idx % 7U) + ".example.com\",\"port\":" + std::to_string(8000U + idx)
+             + ",\"healthy\":true}";
+    }
+    return out + "]";
+}
+
+GTEST_TEST(fast_compressor_tests, round_trip)
+{
+    fast_compressor compress;
+    for (const auto& text : { std::string(), std::string("a"), std::string("abcabcabcabcabcabcabc"),
+                              std::string(1000U, 'x'), repetitive_json(200U)
+                            }
+        )
+    {
+        buffer packed;
+        compress.compress(text.data(), text.size(), packed);
+
+        buffer unpacked;
+        compress.decompress(packed.data(), packed.size(), text.size(), unpacked);
+        CHECK_EQ(text, std::string(unpacked.begin(), unpacked.end()));
+    }
+}
+
+GTEST_TEST(fast_compressor_tests, corrupt_data)
+{
+    fast_compressor compress;
+    auto text = repetitive_json(50U);
+    buffer packed;
+    compress.compress(text.data(), text.size(), packed);
+
+    buffer out;
+    CHECK_THROWS(marshalling_error)
+    {
+        compress.decompress(packed.data(), packed.size(), text.size() + 1U, out);
+    };
+
+    CHECK_THROWS(marshalling_error)
+    {
+        compress.decompress(packed.data(), packed.size() / 2U, text.size(), out);
+    };
+}
+
+GTEST_TEST(payload_codec_tests, compresses_large_payloads)
+{
+    payload_codec codec;
+    auto original = buffer_of(repetitive_json(500U));
+    auto encoded  = codec.encode(original);
+    CHECK_TRUE(payload_codec::is_encoded(encoded));
+    CHECK_LT(encoded.size(), original.size() / 2U);
+    CHECK_TRUE(original == codec.decode(encoded));
+
+    auto stats = codec.stats();
+    CHECK_EQ(1U, stats.encoded);
+    CHECK_EQ(1U, stats.compressed);
+    CHECK_EQ(original.size(), stats.bytes_in);
+    CHECK_EQ(encoded.size(), stats.bytes_out);
+    CHECK_GT(stats.ratio(), 2.0);
+    CHECK_EQ(1U, stats.decoded);
+}
+
+GTEST_TEST(payload_codec_tests, small_payloads_stored_as_is)
+{
+    payload_codec codec;
+    auto original = buffer_of("{\"small\":true}");
+    auto encoded  = codec.encode(original);
+    CHECK_TRUE(original == encoded);
+    CHECK_EQ(0U, codec.stats().compressed);
+}
+
+GTEST_TEST(payload_codec_tests, reads_unencoded_data)
+{
+    payload_codec codec;
+    auto original = buffer_of(repetitive_json(100U));
+    CHECK_TRUE(original == codec.decode(original));
+}
+
+GTEST_TEST(payload_codec_tests, escapes_data_resembling_header)
+{
+    payload_codec codec;
+    auto original = buffer_of(std::string(payload_codec::magic) + "not a header");
+    auto encoded  = codec.encode(original);
+    CHECK_EQ(original.size() + payload_codec::header_size, encoded.size());
+    CHECK_TRUE(original == codec.decode(encoded));
+}
+
+GTEST_TEST(payload_codec_tests, unknown_format)
+{
+    payload_codec codec;
+    auto encoded = codec.encode(buffer_of(repetitive_json(100U)));
+    encoded[payload_codec::magic.size()] = char(200);
+    CHECK_THROWS(marshalling_error)
+    {
+        codec.decode(encoded);
+    };
+}
+
+}
@@ -1,14 +1,20 @@
 #include "connection.hpp"
 #include "connection_zk.hpp"
 #include "error.hpp"
+#include "results.hpp"
 #include "types.hpp"
 #include "exceptions.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
-#include <regex>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_set>
 
 #include <zookeeper/zookeeper.h>
@@ -16,6 +22,16 @@
 namespace zk
 {
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// watch_children_listener                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+watch_listener::~watch_listener() noexcept
+{ }
+
+watch_children_listener::~watch_children_listener() noexcept
+{ }
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // connection                                                                                                         //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -59,6 +75,128 @@ void connection::on_session_event(zk::state new_state)
     }
 }
 
+/** Deliver the progress of the watch \a fut to \a listener, handing the initial result over with \a deliver_initial.
+ *  There is no way to be called when a future is delivered, so something has to wait on it. The thread is detached so
+ *  dropping the listener never blocks; it ends once the watch is delivered (at the latest, when the connection closes).
+**/
+template <typename TResult, typename TListener, typename FDeliverInitial>
+static void listen_on_thread(future<TResult> fut, std::shared_ptr<TListener> listener, FDeliverInitial deliver_initial)
+{
+    std::thread([fut = std::move(fut), listener = std::move(listener), deliver_initial] () mutable
+                {
+                    optional<TResult> result;
+                    try
+                    {
+                        result.emplace(fut.get());
+                    }
+                    catch (...)
+                    {
+                        listener->on_error(zk::current_exception());
+                        return;
+                    }
+
+                    auto next = std::move(result->next());
+                    deliver_initial(*listener, std::move(*result).initial());
+
+                    try
+                    {
+                        listener->on_event(next.get());
+                    }
+                    catch (...)
+                    {
+                        // The connection was destroyed without delivering the watch -- there is no event to report
+                    }
+                }
+               ).detach();
+}
+
+void connection::listen(path_view path, const request_options& options, std::shared_ptr<watch_listener> listener)
+{
+    listen_on_thread(watch(path, options),
+                     std::move(listener),
+                     [] (watch_listener& target, get_result initial) { target.on_data(std::move(initial)); }
+                    );
+}
+
+void connection::listen_children(path_view                                path,
+                                 const request_options&                   options,
+                                 std::shared_ptr<watch_children_listener> listener
+                                )
+{
+    listen_on_thread(watch_children(path, options),
+                     std::move(listener),
+                     [] (watch_children_listener& target, get_children_result initial)
+                     {
+                         target.on_children(std::move(initial));
+                     }
+                    );
+}
+
+request_window_stats connection::window_stats() const
+{
+    return request_window_stats();
+}
+
+std::shared_ptr<request_observer> connection::observer() const
+{
+    // Loading the shared_ptr takes a lock, so the common case of no observer only checks the flag
+    if (!_has_observer.load(std::memory_order_acquire))
+        return nullptr;
+    return std::atomic_load(&_observer);
+}
+
+void connection::observer(std::shared_ptr<request_observer> observer)
+{
+    // A request which still sees the old flag only loads the pointer for nothing (or misses an observer set while it
+    // was starting), which is no different from a request issued just before the call
+    bool has_observer = bool(observer);
+    std::atomic_store(&_observer, std::move(observer));
+    _has_observer.store(has_observer, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// backpressure                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const backpressure& self)
+{
+    switch (self)
+    {
+    case backpressure::wait:   return os << "wait";
+    case backpressure::reject: return os << "reject";
+    default:                   return os << "backpressure(" << static_cast<int>(self) << ')';
+    }
+}
+
+std::string to_string(const backpressure& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// session_recovery                                                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const session_recovery& self)
+{
+    switch (self)
+    {
+    case session_recovery::none:       return os << "none";
+    case session_recovery::watches:    return os << "watches";
+    case session_recovery::ephemerals: return os << "ephemerals";
+    default:                           return os << "session_recovery(" << static_cast<int>(self) << ')';
+    }
+}
+
+std::string to_string(const session_recovery& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // connection_params                                                                                                  //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -69,37 +207,21 @@ connection_params::connection_params() noexcept :
         _chroot("/"),
         _randomize_hosts(true),
         _read_only(false),
-        _timeout(default_timeout)
+        _timeout(default_timeout),
+        _max_in_flight(0U),
+        _backpressure(backpressure::wait),
+        _session_recovery(session_recovery::none),
+        _recovery_batch_size(default_recovery_batch_size)
 { }
 
 connection_params::~connection_params() noexcept
 { }
 
-template <typename TMatch>
-static string_view sv_from_match(const TMatch& src)
-{
-    return string_view(src.first, std::distance(src.first, src.second));
-}
-
-template <typename FAction>
-void split_each_substr(string_view src, char delim, const FAction& action)
-{
-    while (!src.empty())
-    {
-        // if next_div is src.end, the logic still works
-        auto next_div = std::find(src.begin(), src.end(), delim);
-        action(string_view(src.data(), std::distance(src.begin(), next_div)));
-        src.remove_prefix(std::distance(src.begin(), next_div));
-        if (!src.empty())
-            src.remove_prefix(1U);
-    }
-}
-
 static connection_params::host_list extract_host_list(string_view src)
 {
     connection_params::host_list out;
-    out.reserve(std::count(src.begin(), src.end(), ','));
-    split_each_substr(src, ',', [&] (string_view sub) { out.emplace_back(std::string(sub)); });
+    out.reserve(std::size_t(std::count(src.begin(), src.end(), ',')) + 1U);
+    detail::split_each(src, ',', [&] (string_view sub) { out.emplace_back(sub); });
     return out;
 }
 
@@ -136,11 +258,78 @@ static std::chrono::milliseconds extract_millis(string_view key, string_view val
     }
     else
     {
-        double seconds = std::stod(std::string(val));
+        // strtod needs a terminated string, which val is not -- copy it to the stack unless it is absurdly long
+        char            small[64];
+        std::string     large;
+        ptr<const char> text;
+        if (val.size() < sizeof small)
+        {
+            std::memcpy(small, val.data(), val.size());
+            small[val.size()] = '\0';
+            text = small;
+        }
+        else
+        {
+            large = std::string(val);
+            text  = large.c_str();
+        }
+
+        // Same as std::stod, without building a std::string
+        ptr<char> end = nullptr;
+        errno = 0;
+        double seconds = std::strtod(text, &end);
+        if (end == text)
+            zk::throw_exception(std::invalid_argument("stod"));
+        if (errno == ERANGE)
+            zk::throw_exception(std::out_of_range("stod"));
         return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(seconds));
     }
 }
 
+static std::size_t extract_size(string_view key, string_view val)
+{
+    if (val.empty() || !std::all_of(val.begin(), val.end(), [] (char c) { return '0' <= c && c <= '9'; }))
+        zk::throw_exception(std::invalid_argument(std::string("Invalid value for ") + std::string(key) + std::string(" \"")
+                                    + std::string(val) + "\" -- expected a non-negative integer"
+                                    ));
+
+    std::size_t out = 0U;
+    for (char c : val)
+    {
+        auto digit = std::size_t(c - '0');
+        if (out > (std::numeric_limits<std::size_t>::max() - digit) / 10U)
+            zk::throw_exception(std::out_of_range(std::string("Value for ") + std::string(key) + " is too large"));
+        out = out * 10U + digit;
+    }
+    return out;
+}
+
+static backpressure extract_backpressure(string_view key, string_view val)
+{
+    if (val == "wait")
+        return backpressure::wait;
+    else if (val == "reject")
+        return backpressure::reject;
+    else
+        zk::throw_exception(std::invalid_argument(std::string("Invalid value for ") + std::string(key) + std::string(" \"")
+                                    + std::string(val) + "\" -- expected \"wait\" or \"reject\""
+                                    ));
+}
+
+static session_recovery extract_session_recovery(string_view key, string_view val)
+{
+    if (val == "none")
+        return session_recovery::none;
+    else if (val == "watches")
+        return session_recovery::watches;
+    else if (val == "ephemerals")
+        return session_recovery::ephemerals;
+    else
+        zk::throw_exception(std::invalid_argument(std::string("Invalid value for ") + std::string(key) + std::string(" \"")
+                                    + std::string(val) + "\" -- expected \"none\", \"watches\" or \"ephemerals\""
+                                    ));
+}
+
 static void extract_advanced_options(string_view src, connection_params& out)
 {
     if (src.empty() || src.size() == 1U)
@@ -159,7 +348,7 @@ static void extract_advanced_options(string_view src, connection_params& out)
                            invalid_keys_msg += std::string(key);
                        };
 
-    split_each_substr(src, '&', [&] (string_view qp_part)
+    detail::split_each(src, '&', [&] (string_view qp_part)
     {
         auto eq_it = std::find(qp_part.begin(), qp_part.end(), '=');
         if (eq_it == qp_part.end())
@@ -176,6 +365,14 @@ static void extract_advanced_options(string_view src, connection_params& out)
             out.read_only() = extract_bool(key, val);
         else if (key == "timeout")
             out.timeout() = extract_millis(key, val);
+        else if (key == "max_in_flight")
+            out.max_in_flight() = extract_size(key, val);
+        else if (key == "backpressure")
+            out.backpressure() = extract_backpressure(key, val);
+        else if (key == "session_recovery")
+            out.session_recovery() = extract_session_recovery(key, val);
+        else if (key == "recovery_batch_size")
+            out.recovery_batch_size() = extract_size(key, val);
         else
             invalid_key(key);
     });
@@ -186,40 +383,35 @@ static void extract_advanced_options(string_view src, connection_params& out)
 
 connection_params connection_params::parse(string_view conn_string)
 {
-    static const std::regex expr(R"(([^:]+)://([^/]+)((/[^\?]*)(\?.*)?)?)",
-                                 std::regex_constants::ECMAScript | std::regex_constants::optimize
-                                );
-    constexpr auto schema_idx      = 1U;
-    constexpr auto hostaddr_idx    = 2U;
-    constexpr auto path_idx        = 4U;
-    constexpr auto querystring_idx = 5U;
-
-    std::cmatch match;
-    if (!std::regex_match(conn_string.begin(), conn_string.end(), match, expr))
+    auto parts = detail::split_connection_string(conn_string);
+    if (!parts.valid)
         zk::throw_exception(std::invalid_argument(std::string("Invalid connection string (") + std::string(conn_string)
                                     + " -- format is \"schema://[auth@]${host_addrs}/[path][?options]\""
                                     ));
 
     connection_params out;
-    out.connection_schema() = match[schema_idx].str();
-    out.hosts()             = extract_host_list(sv_from_match(match[hostaddr_idx]));
-    out.chroot()            = match[path_idx].str();
-    if (out.chroot().empty())
-        out.chroot() = "/";
+    out.connection_schema().assign(parts.schema.data(), parts.schema.size());
+    out.hosts() = extract_host_list(parts.hosts);
+    if (!parts.chroot.empty())
+        out.chroot().assign(parts.chroot.data(), parts.chroot.size());
 
-    extract_advanced_options(sv_from_match(match[querystring_idx]), out);
+    extract_advanced_options(parts.query, out);
 
     return out;
 }
 
 bool operator==(const connection_params& lhs, const connection_params& rhs)
 {
-    return lhs.connection_schema() == rhs.connection_schema()
-        && lhs.hosts()             == rhs.hosts()
-        && lhs.chroot()            == rhs.chroot()
-        && lhs.randomize_hosts()   == rhs.randomize_hosts()
-        && lhs.read_only()         == rhs.read_only()
-        && lhs.timeout()           == rhs.timeout();
+    return lhs.connection_schema()   == rhs.connection_schema()
+        && lhs.hosts()               == rhs.hosts()
+        && lhs.chroot()              == rhs.chroot()
+        && lhs.randomize_hosts()     == rhs.randomize_hosts()
+        && lhs.read_only()           == rhs.read_only()
+        && lhs.timeout()             == rhs.timeout()
+        && lhs.max_in_flight()       == rhs.max_in_flight()
+        && lhs.backpressure()        == rhs.backpressure()
+        && lhs.session_recovery()    == rhs.session_recovery()
+        && lhs.recovery_batch_size() == rhs.recovery_batch_size();
 }
 
 bool operator!=(const connection_params& lhs, const connection_params& rhs)
@@ -263,6 +455,14 @@ std::ostream& operator<<(std::ostream& os, const connection_params& x)
         query_string("read_only", "true");
     if (x.timeout() != connection_params::default_timeout)
         query_string("timeout", std::chrono::duration<double>(x.timeout()).count());
+    if (x.max_in_flight() != 0U)
+        query_string("max_in_flight", x.max_in_flight());
+    if (x.backpressure() != backpressure::wait)
+        query_string("backpressure", x.backpressure());
+    if (x.session_recovery() != session_recovery::none)
+        query_string("session_recovery", x.session_recovery());
+    if (x.recovery_batch_size() != connection_params::default_recovery_batch_size)
+        query_string("recovery_batch_size", x.recovery_batch_size());
     return os;
 }
 
@@ -273,4 +473,15 @@ std::string to_string(const connection_params& x)
     return os.str();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// connection_string                                                                                                  //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+string_view connection_string::invalid(string_view src)
+{
+    zk::throw_exception(std::invalid_argument(std::string("Invalid connection string (") + std::string(src)
+                                              + " -- format is \"schema://[auth@]${host_addrs}/[path][?options]\""
+                                              ));
+}
+
 }
@@ -2,6 +2,7 @@
 
 #include <zk/config.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <iosfwd>
 #include <memory>
@@ -10,8 +11,12 @@
 #include <vector>
 
 #include "buffer.hpp"
+#include "detail/connection_string.hpp"
+#include "exceptions.hpp"
 #include "forwards.hpp"
 #include "future.hpp"
+#include "optional.hpp"
+#include "path.hpp"
 #include "string_view.hpp"
 
 namespace zk
@@ -20,6 +25,82 @@ namespace zk
 /// \addtogroup Client
 /// \{
 
+/// The point in time an operation must complete by. An operation which has not completed by then is delivered with
+/// \ref operation_timeout. \c nullopt means the operation is only bounded by the session timeout.
+///
+/// \see client::with_timeout
+using request_deadline = optional<std::chrono::steady_clock::time_point>;
+
+/// Options for a single operation issued through a \ref connection. The \ref client fills these in from its own
+/// settings (see \ref client::with_timeout, \ref client::with_retry and \ref client::with_codec).
+struct request_options final
+{
+    /// When the operation must complete by.
+    request_deadline deadline;
+
+    /// How to retry the operation if it fails with a transient error. If this is \c nullptr, the operation is attempted
+    /// only once.
+    std::shared_ptr<const retry_policy> retry;
+
+    /// The codec to decode the data delivered by \ref connection::get and \ref connection::watch with. If this is
+    /// \c nullptr, the data is delivered as stored. Data which is written is encoded by the \ref client, so the
+    /// connection only has to decode.
+    std::shared_ptr<const payload_codec> codec;
+};
+
+/// A snapshot of the requests a \ref connection is tracking.
+///
+/// \see connection::window_stats
+struct request_window_stats final
+{
+    /// The number of requests which have been sent and have not yet completed. A watch counts as in flight until its
+    /// data is delivered.
+    std::size_t in_flight = 0U;
+
+    /// The number of requests waiting for one of the \ref connection_params::max_in_flight slots to free up.
+    std::size_t queued = 0U;
+
+    /// The total number of requests rejected with \ref error_code::throttled since the connection was created.
+    std::size_t rejected = 0U;
+};
+
+/// Receives the progress of a watch issued with \ref connection::listen, in place of the futures of a
+/// \ref watch_result. As with \ref watch_children_listener, the functions are called on the thread which delivers
+/// results from the server.
+class watch_listener
+{
+public:
+    virtual ~watch_listener() noexcept;
+
+    /// The data was fetched and the watch was left on the entry.
+    virtual void on_data(get_result result) = 0;
+
+    /// The data could not be fetched, so no watch was left. \a ex is what the future would have been delivered with.
+    virtual void on_error(zk::exception_ptr ex) = 0;
+
+    /// The watch left by \ref on_data was triggered. This is only called after \ref on_data.
+    virtual void on_event(event ev) = 0;
+};
+
+/// Receives the progress of a watch issued with \ref connection::listen_children, in place of the futures of a
+/// \ref watch_children_result. The functions are called on the thread which delivers results from the server, so they
+/// must return quickly and must never wait for another request to complete.
+class watch_children_listener
+{
+public:
+    virtual ~watch_children_listener() noexcept;
+
+    /// The children were fetched and the watch was left on the entry.
+    virtual void on_children(get_children_result result) = 0;
+
+    /// The children could not be fetched, so no watch was left. \a ex is what the future would have been delivered
+    /// with.
+    virtual void on_error(zk::exception_ptr ex) = 0;
+
+    /// The watch left by \ref on_children was triggered. This is only called after \ref on_children.
+    virtual void on_event(event ev) = 0;
+};
+
 /// An actual connection to the server. The majority of methods have the same signature and meaning as \ref client.
 ///
 /// \see connection_zk
@@ -34,51 +115,127 @@ public:
 
     virtual void close() = 0;
 
-    virtual future<get_result> get(string_view path) = 0;
+    /// \{
+    /// Issue an operation. If the \ref request_options::deadline passes before the server has responded, the returned
+    /// future is delivered with \ref operation_timeout; for watches, it only applies to the delivery of the data, not
+    /// the event. If the operation fails with a transient error, it is retried according to \ref request_options::retry.
+    virtual future<get_result> get(path_view path, const request_options& options) = 0;
 
-    virtual future<watch_result> watch(string_view path) = 0;
+    virtual future<watch_result> watch(path_view path, const request_options& options) = 0;
 
-    virtual future<get_children_result> get_children(string_view path) = 0;
+    virtual future<get_children_result> get_children(path_view path, const request_options& options) = 0;
 
-    virtual future<watch_children_result> watch_children(string_view path) = 0;
+    virtual future<watch_children_result> watch_children(path_view path, const request_options& options) = 0;
 
-    virtual future<exists_result> exists(string_view path) = 0;
+    virtual future<exists_result> exists(path_view path, const request_options& options) = 0;
 
-    virtual future<watch_exists_result> watch_exists(string_view path) = 0;
+    virtual future<watch_exists_result> watch_exists(path_view path, const request_options& options) = 0;
 
-    virtual future<create_result> create(string_view   path,
-                                         const buffer& data,
-                                         const acl&    rules,
-                                         create_mode   mode
+    virtual future<create_result> create(path_view              path,
+                                         const buffer&          data,
+                                         const acl&             rules,
+                                         create_mode            mode,
+                                         const request_options& options
                                         ) = 0;
 
-    virtual future<set_result> set(string_view path, const buffer& data, version check) = 0;
+    virtual future<set_result> set(path_view              path,
+                                   const buffer&          data,
+                                   version                check,
+                                   const request_options& options
+                                  ) = 0;
 
-    virtual future<void> erase(string_view path, version check) = 0;
+    virtual future<void> erase(path_view path, version check, const request_options& options) = 0;
 
-    virtual future<get_acl_result> get_acl(string_view path) const = 0;
+    virtual future<get_acl_result> get_acl(path_view path, const request_options& options) const = 0;
 
-    virtual future<void> set_acl(string_view path, const acl& rules, acl_version check) = 0;
+    virtual future<void> set_acl(path_view              path,
+                                 const acl&             rules,
+                                 acl_version            check,
+                                 const request_options& options
+                                ) = 0;
 
-    virtual future<multi_result> commit(multi_op&& txn) = 0;
+    virtual future<multi_result> commit(multi_op&& txn, const request_options& options) = 0;
 
-    virtual future<void> load_fence() = 0;
+    virtual future<void> load_fence(const request_options& options) = 0;
+    /// \}
+
+    /// Like \ref watch, but the progress of the watch is delivered to \a listener instead of through futures (see
+    /// \ref listen_children).
+    virtual void listen(path_view path, const request_options& options, std::shared_ptr<watch_listener> listener);
+
+    /// Like \ref watch_children, but the progress of the watch is delivered to \a listener instead of through futures,
+    /// so nothing has to wait for it. The connection keeps \a listener alive until it has been called for the last
+    /// time. The default implementation waits on the futures of \ref watch_children with a thread of its own;
+    /// \ref connection_zk calls \a listener as the results arrive.
+    virtual void listen_children(path_view                                path,
+                                 const request_options&                   options,
+                                 std::shared_ptr<watch_children_listener> listener
+                                );
 
     virtual zk::state state() const = 0;
 
     /// Watch for a state change.
     virtual future<zk::state> watch_state();
 
+    /// Get the current depth of the request window. Connections which do not track their requests report all zeros.
+    ///
+    /// \see connection_params::max_in_flight
+    virtual request_window_stats window_stats() const;
+
+    /// \{
+    /// The \ref request_observer notified of the lifecycle of every request issued through this connection. By default,
+    /// there is no observer, which costs each request the check of a flag. Once one is set, each request also loads
+    /// the \c shared_ptr, which takes a lock in common standard libraries. Setting the observer only affects requests
+    /// issued after the call; requests already in flight report to the observer they started with.
+    std::shared_ptr<request_observer> observer() const;
+    void                              observer(std::shared_ptr<request_observer> observer);
+    /// \}
+
 protected:
     /// Call this from derived classes when a session event happens. This triggers the delivery of all promises of state
     /// changes (issued through \ref watch_state).
     virtual void on_session_event(zk::state new_state);
 
 private:
-    mutable std::mutex              _state_change_promises_protect;
-    std::vector<promise<zk::state>> _state_change_promises;
+    mutable std::mutex                _state_change_promises_protect;
+    std::vector<promise<zk::state>>   _state_change_promises;
+    std::shared_ptr<request_observer> _observer;
+    std::atomic<bool>                 _has_observer = false;
 };
 
+/// What a \ref connection does with a request issued while \ref connection_params::max_in_flight requests are already
+/// outstanding.
+enum class backpressure : int
+{
+    /// Hold the request until an outstanding one completes, then send it. The caller is not blocked -- the returned
+    /// future is simply delivered later. Held requests are sent in the order they were issued.
+    wait,
+    /// Fail the request immediately with \ref error_code::throttled.
+    reject,
+};
+
+std::ostream& operator<<(std::ostream&, const backpressure&);
+
+std::string to_string(const backpressure&);
+
+/// What a \ref connection does when the server expires its session.
+enum class session_recovery : int
+{
+    /// Nothing -- the connection is dead and every outstanding watch is delivered with a \ref event_type::session
+    /// event.
+    none,
+    /// Start a new session and re-arm every outstanding watch on it. If the watched entry changed while there was no
+    /// session, the watch is delivered with the event it missed instead.
+    watches,
+    /// Everything \ref watches does. In addition, ephemeral entries this connection created (and has not erased) are
+    /// created again in the new session.
+    ephemerals,
+};
+
+std::ostream& operator<<(std::ostream&, const session_recovery&);
+
+std::string to_string(const session_recovery&);
+
 /// Used to specify parameters for a \c connection. This can either be created manually or through a
 /// \ref ConnectionStrings "connection string".
 class connection_params final
@@ -89,6 +246,9 @@ public:
 public:
     static constexpr std::chrono::milliseconds default_timeout = std::chrono::seconds(10);
 
+    /// The default for \ref recovery_batch_size.
+    static constexpr std::size_t default_recovery_batch_size = 64U;
+
 public:
     /// Create an instance with default values.
     connection_params() noexcept;
@@ -116,6 +276,14 @@ public:
     ///   - `randomize_hosts`: \ref connection_params::randomize_hosts
     ///   - `read_only`: \ref connection_params::read_only
     ///   - `timeout`: \ref connection_params::timeout
+    ///   - `max_in_flight`: \ref connection_params::max_in_flight
+    ///   - `backpressure`: \ref connection_params::backpressure (\c wait or \c reject)
+    ///   - `session_recovery`: \ref connection_params::session_recovery (\c none, \c watches or \c ephemerals)
+    ///   - `recovery_batch_size`: \ref connection_params::recovery_batch_size
+    ///
+    /// Parsing only copies out the parts stored in the result -- the schema, each host and the chroot -- so it is cheap
+    /// enough to do for every short-lived connection. Use a \ref connection_string to check a literal connection string
+    /// at compile time.
     ///
     /// \throws std::invalid_argument if the string is malformed in some way.
     static connection_params parse(string_view conn_string);
@@ -176,6 +344,46 @@ public:
     std::chrono::milliseconds& timeout()       { return _timeout; }
     /// \}
 
+    /// \{
+    /// The maximum number of requests allowed to be outstanding on the connection at once. Without a limit, a burst of
+    /// requests is queued in the underlying client without bound, which costs memory and delays every request behind
+    /// it. When the limit is reached, new requests are handled according to \ref backpressure. The default (\c 0) is
+    /// unlimited.
+    std::size_t  max_in_flight() const { return _max_in_flight; }
+    std::size_t& max_in_flight()       { return _max_in_flight; }
+    /// \}
+
+    /// \{
+    /// What to do with requests issued when \ref max_in_flight requests are already outstanding. The default is
+    /// \ref backpressure::wait.
+    zk::backpressure  backpressure() const { return _backpressure; }
+    zk::backpressure& backpressure()       { return _backpressure; }
+    /// \}
+
+    /// \{
+    /// What to do when the session expires. With anything other than \ref session_recovery::none, the connection starts
+    /// a new session in the background and outstanding watches survive the expiration -- as well as the temporary loss
+    /// of a connection, which otherwise delivers them with a \ref event_type::session event. Operations issued in the
+    /// short time between the expiration and the start of the new session fail, just as they would without recovery.
+    /// Operations issued after that are not failed -- they wait for the new session to be established, just as they do
+    /// while reconnecting. If recovery fails several times in a row (an attempt fails if its session expires or is not
+    /// established within the session timeout), or the server rejects the credentials, recovery gives up and the
+    /// outstanding watches are delivered with a \ref event_type::session event. The default is
+    /// \ref session_recovery::none.
+    ///
+    /// Sequential ephemeral entries are never created again, as they can not be given the same name.
+    zk::session_recovery  session_recovery() const { return _session_recovery; }
+    zk::session_recovery& session_recovery()       { return _session_recovery; }
+    /// \}
+
+    /// \{
+    /// The maximum number of watches and ephemeral entries re-registered at once when recovering a session. The next
+    /// batch is only sent once the previous one has completed, so a client with many watches does not flood the
+    /// ensemble right after reconnecting. The default is \ref default_recovery_batch_size.
+    std::size_t  recovery_batch_size() const { return _recovery_batch_size; }
+    std::size_t& recovery_batch_size()       { return _recovery_batch_size; }
+    /// \}
+
 private:
     std::string               _connection_schema;
     host_list                 _hosts;
@@ -183,6 +391,10 @@ private:
     bool                      _randomize_hosts;
     bool                      _read_only;
     std::chrono::milliseconds _timeout;
+    std::size_t               _max_in_flight;
+    zk::backpressure          _backpressure;
+    zk::session_recovery      _session_recovery;
+    std::size_t               _recovery_batch_size;
 };
 
 bool operator==(const connection_params& lhs, const connection_params& rhs);
@@ -191,6 +403,47 @@ bool operator!=(const connection_params& lhs, const connection_params& rhs);
 std::string to_string(const connection_params&);
 std::ostream& operator<<(std::ostream&, const connection_params&);
 
+/// A \ref ConnectionStrings "connection string" which is checked when it is built. Declaring one \c constexpr checks a
+/// literal connection string at compile time: a malformed one does not compile. It converts to a \ref string_view, so
+/// it can be passed anywhere a connection string is taken.
+///
+/// The check is a little stricter than \ref connection_params::parse: a \c timeout must be a plain decimal number of
+/// seconds. Anything accepted here is accepted by \c parse.
+///
+/// \code
+/// constexpr zk::connection_string cluster("zk://zk-1:2181,zk-2:2181/app?timeout=5");
+/// auto client = zk::client::connect(cluster).get();
+/// \endcode
+class connection_string final
+{
+public:
+    /// \throws std::invalid_argument if \a src is malformed. In a constant expression, this is a compilation error.
+    constexpr explicit connection_string(string_view src) :
+            _src(detail::is_valid_connection_string(src) ? src : invalid(src))
+    { }
+
+    /// Is \a src a valid connection string?
+    static constexpr bool is_valid(string_view src) noexcept
+    {
+        return detail::is_valid_connection_string(src);
+    }
+
+    /// \{
+    /// The connection string.
+    constexpr string_view view() const noexcept { return _src; }
+    constexpr operator string_view() const noexcept { return _src; }
+    /// \}
+
+private:
+    /// Not \c constexpr on purpose: reaching it while evaluating a constant expression is what makes a malformed
+    /// literal fail to compile.
+    [[noreturn]]
+    static string_view invalid(string_view src);
+
+private:
+    string_view _src;
+};
+
 /// \}
 
 }
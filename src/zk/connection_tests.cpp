@@ -1,5 +1,9 @@
 #include <zk/tests/test.hpp>
 
+#include <random>
+#include <regex>
+#include <string>
+
 #include "connection.hpp"
 
 namespace zk
@@ -76,4 +80,93 @@ GTEST_TEST(connection_params_tests, timeout)
     CHECK_EQ(manual, res);
 }
 
+GTEST_TEST(connection_params_tests, request_window)
+{
+    const auto res = connection_params::parse("zk://localhost/?max_in_flight=64&backpressure=reject");
+    connection_params manual;
+    manual.hosts()         = { "localhost" };
+    manual.max_in_flight() = 64U;
+    manual.backpressure()  = backpressure::reject;
+    CHECK_EQ(manual, res);
+    CHECK_EQ(res, connection_params::parse(to_string(res)));
+}
+
+GTEST_TEST(connection_params_tests, request_window_invalid)
+{
+    CHECK_THROWS(std::invalid_argument) { connection_params::parse("zk://localhost/?max_in_flight=-1"); };
+    CHECK_THROWS(std::invalid_argument) { connection_params::parse("zk://localhost/?backpressure=block"); };
+}
+
+GTEST_TEST(connection_params_tests, session_recovery)
+{
+    const auto res = connection_params::parse("zk://localhost/?session_recovery=ephemerals&recovery_batch_size=8");
+    connection_params manual;
+    manual.hosts()               = { "localhost" };
+    manual.session_recovery()    = session_recovery::ephemerals;
+    manual.recovery_batch_size() = 8U;
+    CHECK_EQ(manual, res);
+    CHECK_EQ(res, connection_params::parse(to_string(res)));
+
+    CHECK_THROWS(std::invalid_argument) { connection_params::parse("zk://localhost/?session_recovery=all"); };
+}
+
+GTEST_TEST(connection_params_tests, numeric_values)
+{
+    // The same values std::stod and std::stoull took before
+    CHECK_EQ(std::chrono::milliseconds(1500), connection_params::parse("zk://localhost/?timeout= 1.5").timeout());
+    CHECK_EQ(std::chrono::milliseconds(2000), connection_params::parse("zk://localhost/?timeout=2s").timeout());
+    CHECK_THROWS(std::invalid_argument) { connection_params::parse("zk://localhost/?timeout=s"); };
+    CHECK_THROWS(std::out_of_range) { connection_params::parse("zk://localhost/?timeout=1e999"); };
+    CHECK_THROWS(std::out_of_range)
+    {
+        connection_params::parse("zk://localhost/?max_in_flight=999999999999999999999999");
+    };
+}
+
+// Check the parser splits strings exactly like the regular expression it replaced, over random strings made of the
+// characters which matter to the grammar.
+GTEST_TEST(connection_params_tests, grammar_equivalence)
+{
+    static const std::regex expr(R"(([^:]+)://([^/]+)((/[^\?]*)(\?.*)?)?)");
+
+    const char   alphabet[] = { ':', '/', '/', '?', '&', '=', 'z', 'k', ',', '\n', '\r' };
+    std::mt19937 rng(7U);
+    for (std::size_t count = 0U; count < 20000U; ++count)
+    {
+        std::string src = count % 2U == 0U ? "zk://" : "";
+        auto        len = rng() % 16U;
+        for (std::size_t idx = 0U; idx < len; ++idx)
+            src.push_back(alphabet[rng() % sizeof alphabet]);
+
+        std::smatch match;
+        bool        expected = std::regex_match(src, match, expr);
+        auto        parts    = detail::split_connection_string(src);
+        CHECK_EQ(expected, parts.valid) << src;
+        if (!expected)
+            continue;
+
+        CHECK_EQ(match[1].str(), parts.schema) << src;
+        CHECK_EQ(match[2].str(), parts.hosts) << src;
+        CHECK_EQ(match[4].str(), parts.chroot) << src;
+        CHECK_EQ(match[5].str(), parts.query) << src;
+    }
+}
+
+GTEST_TEST(connection_params_tests, connection_string)
+{
+    static_assert(connection_string::is_valid("zk://localhost/"));
+    static_assert(connection_string::is_valid("zk://a:2181,b:2181/app?timeout=2.5&read_only=t&max_in_flight=64"));
+    static_assert(!connection_string::is_valid("localhost:2181"));
+    static_assert(!connection_string::is_valid("zk://localhost/?timeout=soon"));
+    static_assert(!connection_string::is_valid("zk://localhost/?bogus=1"));
+
+    constexpr connection_string literal("zk://server-a,server-b/app?session_recovery=watches");
+    const auto res = connection_params::parse(literal);
+    CHECK_EQ(2U, res.hosts().size());
+    CHECK_EQ("/app", res.chroot());
+    CHECK_EQ(session_recovery::watches, res.session_recovery());
+
+    CHECK_THROWS(std::invalid_argument) { connection_string(std::string("zk://localhost/?timeout=soon")); };
+}
+
 }
@@ -2,8 +2,10 @@
 #include "exceptions.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
 #include <map>
@@ -12,56 +14,51 @@
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <zookeeper/zookeeper.h>
 
 #include "acl.hpp"
+#include "codec.hpp"
+#include "detail/marshal.hpp"
 #include "error.hpp"
 #include "multi.hpp"
+#include "path.hpp"
 #include "results.hpp"
+#include "retry.hpp"
+#include "trace.hpp"
 #include "types.hpp"
 
 namespace zk
 {
 
+using detail::acl_from_raw;
+using detail::stat_from_raw;
+using detail::string_vector_from_raw;
+using detail::with_acl;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Utility Functions                                                                                                  //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <typename FAction>
-auto with_str(string_view src, FAction&& action) noexcept(noexcept(std::forward<FAction>(action)(ptr<const char>())))
+auto with_str(path_view src, FAction&& action) noexcept(noexcept(std::forward<FAction>(action)(ptr<const char>())))
         -> decltype(std::forward<FAction>(action)(ptr<const char>()))
 {
+    // Most paths already end in a null terminator, so they can be passed to the C client as they are
+    if (src.null_terminated())
+        return std::forward<FAction>(action)(src.data());
+
     char buffer[src.size() + 1];
     buffer[src.size()] = '\0';
     std::memcpy(buffer, src.data(), src.size());
     return std::forward<FAction>(action)(buffer);
 }
 
-static ACL encode_acl_part(const acl_rule& src)
-{
-    ACL out;
-    out.perms     = static_cast<int>(src.permissions());
-    out.id.scheme = const_cast<ptr<char>>(src.scheme().c_str());
-    out.id.id     = const_cast<ptr<char>>(src.id().c_str());
-    return out;
-}
-
-template <typename FAction>
-auto with_acl(const acl& rules, FAction&& action) noexcept(noexcept(std::forward<FAction>(action)(ptr<ACL_vector>())))
-        -> decltype(std::forward<FAction>(action)(ptr<ACL_vector>()))
-{
-    ACL parts[rules.size()];
-    for (std::size_t idx = 0; idx < rules.size(); ++idx)
-        parts[idx] = encode_acl_part(rules[idx]);
-
-    ACL_vector vec;
-    vec.count = int(rules.size());
-    vec.data  = parts;
-    return std::forward<FAction>(action)(&vec);
-}
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Native Adaptors                                                                                                    //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -121,73 +118,299 @@ static state state_from_raw(int raw)
     return static_cast<state>(raw);
 }
 
-static stat stat_from_raw(const struct Stat& raw)
-{
-    stat out;
-    out.acl_version = acl_version(raw.aversion);
-    out.child_modified_transaction = transaction_id(raw.pzxid);
-    out.child_version = child_version(raw.cversion);
-    out.children_count = raw.numChildren;
-    out.create_time = stat::time_point() + std::chrono::milliseconds(raw.ctime);
-    out.create_transaction = transaction_id(raw.czxid);
-    out.data_size = raw.dataLength;
-    out.data_version = version(raw.version);
-    out.ephemeral_owner = raw.ephemeralOwner;
-    out.modified_time = stat::time_point() + std::chrono::milliseconds(raw.mtime);
-    out.modified_transaction = transaction_id(raw.mzxid);
-    return out;
-}
-
-static std::vector<std::string> string_vector_from_raw(const struct String_vector& raw)
+static std::size_t children_size(const std::vector<std::string>& children)
 {
-    std::vector<std::string> out;
-    out.reserve(raw.count);
-    for (std::int32_t idx = 0; idx < raw.count; ++idx)
-        out.emplace_back(raw.data[idx]);
+    std::size_t out = 0U;
+    for (const auto& child : children)
+        out += child.size();
     return out;
 }
 
-static acl acl_from_raw(const struct ACL_vector& raw)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tracing                                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Reports the lifecycle of a single request to the \ref request_observer of the connection it was issued through. If
+/// the connection has no observer, this only costs a check of a flag (and nothing at all if \c ZKPP_ENABLE_TRACING is
+/// off).
+class request_tracer final
 {
-    auto sz = std::size_t(raw.count);
+public:
+    explicit request_tracer(const connection& conn, request_type type, string_view path, std::size_t request_size)
+    {
+#if ZKPP_ENABLE_TRACING
+        if (auto observer = conn.observer())
+        {
+            static std::atomic<std::uint64_t> next_id(1U);
+
+            _trace               = std::make_unique<request_trace>();
+            _trace->id           = next_id.fetch_add(1U, std::memory_order_relaxed);
+            _trace->type         = type;
+            _trace->path         = std::string(path);
+            _trace->request_size = request_size;
+            _trace->start_time   = request_trace::clock::now();
+            _observer            = std::move(observer);
+            notify(&request_observer::on_start);
+        }
+#else
+        static_cast<void>(conn);
+        static_cast<void>(type);
+        static_cast<void>(path);
+        static_cast<void>(request_size);
+#endif
+    }
 
-    acl out;
-    out.reserve(sz);
-    for (std::size_t idx = 0; idx < sz; ++idx)
+    /// The request is about to be handed to the C client.
+    void sent()
     {
-        const auto& item = raw.data[idx];
-        out.emplace_back(item.id.scheme, item.id.id, static_cast<permission>(item.perms));
+#if ZKPP_ENABLE_TRACING
+        if (_observer)
+        {
+            _trace->send_time = request_trace::clock::now();
+            notify(&request_observer::on_send);
+        }
+#endif
     }
-    return out;
-}
+
+    /// The request has finished with \a rc.
+    void complete(error_code rc, std::size_t response_size = 0U, optional<transaction_id> transaction = nullopt)
+    {
+#if ZKPP_ENABLE_TRACING
+        if (_observer)
+        {
+            _trace->complete_time = request_trace::clock::now();
+            _trace->error         = rc;
+            _trace->response_size = response_size;
+            _trace->transaction   = transaction;
+            notify(&request_observer::on_complete);
+        }
+#else
+        static_cast<void>(rc);
+        static_cast<void>(response_size);
+        static_cast<void>(transaction);
+#endif
+    }
+
+private:
+    void notify(void (request_observer::*event)(const request_trace&)) noexcept
+    {
+        // Observers are a diagnostic tool -- a broken one should not be able to break the request it is observing.
+        try
+        {
+            ((*_observer).*event)(*_trace);
+        }
+        catch (...)
+        { }
+    }
+
+private:
+    std::shared_ptr<request_observer> _observer;
+    std::unique_ptr<request_trace>    _trace;
+};
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // connection_zk                                                                                                      //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/// Runs actions at points in the future: delivering requests with \ref error_code::operation_timeout when their
+/// deadline passes and sending requests again after a \ref retry_policy backoff. The background thread is only started
+/// when the first action is scheduled.
+class connection_zk::timer_queue final
+{
+public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    /// An action to run. The argument is \c true if the queue was stopped before the action was due.
+    using action_function = std::function<void (bool cancelled)>;
+
+public:
+    timer_queue() :
+            _stopping(false)
+    { }
+
+    ~timer_queue() noexcept
+    {
+        stop();
+    }
+
+    /// Run \a action at \a when.
+    ///
+    /// \returns \c false if the queue has been stopped, in which case \a action is never run.
+    bool schedule(time_point when, action_function action)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (_stopping)
+            return false;
+
+        if (!_worker.joinable())
+            _worker = std::thread([this] { run(); });
+
+        _entries.push_back(entry{ when, std::move(action) });
+        std::push_heap(_entries.begin(), _entries.end(), later_first);
+        if (_entries.front().when == when)
+            _wakeup.notify_one();
+        return true;
+    }
+
+    /// Deliver \a req with \ref error_code::operation_timeout at \a when (see \c expire). The request is referenced
+    /// weakly, so a request which completes normally is not kept alive until its deadline.
+    template <typename TRequest>
+    void schedule_deadline(time_point when, const std::shared_ptr<TRequest>& req)
+    {
+        schedule(when,
+                 [weak_req = std::weak_ptr<TRequest>(req)] (bool cancelled)
+                 {
+                     if (cancelled)
+                         return;
+
+                     if (auto req = weak_req.lock())
+                         req->expire();
+                 }
+                );
+    }
+
+    /// Stop the background thread. Actions which were not yet due are run with \c cancelled set.
+    void stop() noexcept
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _stopping = true;
+        _wakeup.notify_one();
+        ax.unlock();
+
+        if (_worker.joinable())
+            _worker.join();
+
+        ax.lock();
+        auto l_entries = std::move(_entries);
+        _entries.clear();
+        ax.unlock();
+        for (auto& x : l_entries)
+            x.action(true);
+    }
+
+private:
+    struct entry
+    {
+        time_point      when;
+        action_function action;
+    };
+
+    static bool later_first(const entry& lhs, const entry& rhs)
+    {
+        return lhs.when > rhs.when;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        while (!_stopping)
+        {
+            if (_entries.empty())
+            {
+                _wakeup.wait(ax);
+            }
+            else if (clock::now() < _entries.front().when)
+            {
+                _wakeup.wait_until(ax, _entries.front().when);
+            }
+            else
+            {
+                std::pop_heap(_entries.begin(), _entries.end(), later_first);
+                auto action = std::move(_entries.back().action);
+                _entries.pop_back();
+
+                ax.unlock();
+                action(false);
+                ax.lock();
+            }
+        }
+    }
+
+private:
+    std::mutex              _protect;
+    std::condition_variable _wakeup;
+    std::vector<entry>      _entries;
+    bool                    _stopping;
+    std::thread             _worker;
+};
+
+/// Counts the outstanding requests of one batch of session recovery.
+class connection_zk::recovery_batch final
+{
+public:
+    explicit recovery_batch(std::size_t count) :
+            _remaining(count)
+    { }
+
+    void complete()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (--_remaining == 0U)
+            _done.notify_all();
+    }
+
+    /// Wait up to \a timeout for every request in the batch to complete.
+    ///
+    /// \returns \c true if they have all completed.
+    bool wait_for(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        return _done.wait_for(ax, timeout, [this] { return _remaining == 0U; });
+    }
+
+private:
+    std::mutex              _protect;
+    std::condition_variable _done;
+    std::size_t             _remaining;
+};
+
+/// The completion context of a request issued while recovering a session. Exactly one of \c target (re-arming a watch)
+/// or \c path (creating an owned ephemeral again) is set.
+struct connection_zk::recovery_request
+{
+    ptr<const connection_zk>        conn;
+    std::shared_ptr<watcher>        target;
+    std::string                     path;
+    std::shared_ptr<recovery_batch> batch;
+};
+
 connection_zk::connection_zk(const connection_params& params) :
-        _handle(nullptr)
+        _handle(nullptr),
+        _max_in_flight(params.max_in_flight()),
+        _backpressure(params.backpressure()),
+        _in_flight(0U),
+        _rejected(0U),
+        _draining(false),
+        _closing(false),
+        _timers(std::make_unique<timer_queue>()),
+        _session_timeout(params.timeout()),
+        _session_recovery(params.session_recovery()),
+        _recovery_batch_size(std::max<std::size_t>(params.recovery_batch_size(), 1U)),
+        _recovery_running(false),
+        _recovery_requested(false),
+        _recovery_stopping(false)
 {
     if (params.connection_schema() != "zk")
         zk::throw_exception(std::invalid_argument(std::string("Invalid connection string \"") + to_string(params) + "\""));
 
-    auto conn_string = [&] ()
+    _conn_string = [&] ()
+                   {
+                       std::ostringstream os;
+                       bool first = true;
+                       for (const auto& host : params.hosts())
                        {
-                           std::ostringstream os;
-                           bool first = true;
-                           for (const auto& host : params.hosts())
-                           {
-                               if (first)
-                                   first = false;
-                               else
-                                   os << ',';
-
-                               os << host;
-                           }
-                           return os.str();
-                       }();
-
-    _handle = ::zookeeper_init(conn_string.c_str(),
+                           if (first)
+                               first = false;
+                           else
+                               os << ',';
+
+                           os << host;
+                       }
+                       return os.str();
+                   }();
+
+    _handle = ::zookeeper_init(_conn_string.c_str(),
                                on_session_event_raw,
                                static_cast<int>(params.timeout().count()),
                                nullptr,
@@ -195,13 +418,463 @@ connection_zk::connection_zk(const connection_params& params) :
                                0
                               );
 
-    if (!_handle)
-        std::system_error(errno, std::system_category(), "Failed to create ZooKeeper client");
+    if (!_handle)
+        std::system_error(errno, std::system_category(), "Failed to create ZooKeeper client");
+}
+
+connection_zk::~connection_zk() noexcept
+{
+    close();
+}
+
+
+/// A slot in the request window of a connection. The slot is given back when this is destroyed or \c reset. A request's
+/// slot is only touched by the thread which owns the request at the time -- the one sending it, then the completion
+/// callback of the C client -- so it is never given back twice.
+class connection_zk::window_slot final
+{
+public:
+    window_slot() noexcept :
+            _owner(nullptr)
+    { }
+
+    explicit window_slot(const connection_zk& owner) noexcept :
+            _owner(&owner)
+    { }
+
+    window_slot(window_slot&& src) noexcept :
+            _owner(std::exchange(src._owner, nullptr))
+    { }
+
+    window_slot& operator=(window_slot&& src) noexcept
+    {
+        if (this != &src)
+        {
+            reset();
+            _owner = std::exchange(src._owner, nullptr);
+        }
+        return *this;
+    }
+
+    ~window_slot() noexcept
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if (auto owner = std::exchange(_owner, nullptr))
+            owner->release_slot();
+    }
+
+private:
+    ptr<const connection_zk> _owner;
+};
+
+/// The retry bookkeeping of a single request. A request which can not be retried (the common case) never arms this, so
+/// it only costs a null check on failure.
+class connection_zk::retry_state final
+{
+public:
+    /// Send the request again after the given delay.
+    ///
+    /// \returns \c false if the request could not be scheduled (the connection is closing).
+    using resubmit_function = std::function<bool (retry_policy::duration delay)>;
+
+public:
+    retry_state() noexcept :
+            _attempt(1U)
+    { }
+
+    void arm(std::shared_ptr<const retry_policy> policy, resubmit_function resubmit)
+    {
+        _policy   = std::move(policy);
+        _resubmit = std::move(resubmit);
+    }
+
+    /// Called when an attempt fails with \a rc. If the failure can be retried, \a slot is given back (the request does
+    /// not count against the request window while it waits) and the next attempt is scheduled. Like the slot, this is
+    /// only called by the thread which owns the request: never from the deadline timer (see \c expire).
+    ///
+    /// \returns \c true if another attempt was scheduled, in which case the failure should not be delivered.
+    bool try_again(error_code rc, window_slot& slot)
+    {
+        if (!_policy || !_policy->should_retry(rc, _attempt))
+            return false;
+
+        auto delay = _policy->backoff(_attempt);
+        ++_attempt;
+        slot.reset();
+        return _resubmit(delay);
+    }
+
+private:
+    std::shared_ptr<const retry_policy> _policy;
+    std::size_t                         _attempt;
+    resubmit_function                   _resubmit;
+};
+
+/// The state of a single request which is not a watch. When the request is handed to the C client, the request keeps a
+/// reference to itself which is reclaimed in the completion callback. This keeps the request alive until the C client
+/// is done with it, even if the result has already been delivered because the deadline passed.
+template <typename TResult>
+class connection_zk::pending_request
+{
+public:
+    explicit pending_request(const connection_zk& conn,
+                             request_type        type,
+                             string_view         path,
+                             std::size_t         request_size = 0U
+                            ) :
+            _type(type),
+            _delivered(false),
+            _tracer(conn, type, path, request_size)
+    { }
+
+    virtual ~pending_request() noexcept = default;
+
+    /// Take back the reference the request held to itself from the completion context \a ctx.
+    template <typename TRequest = pending_request>
+    static std::shared_ptr<TRequest> reclaim(ptr<const void> ctx)
+    {
+        ptr<pending_request> self = static_cast<ptr<TRequest>>(const_cast<ptr<void>>(ctx));
+        return std::static_pointer_cast<TRequest>(std::move(self->_self));
+    }
+
+    void retain(std::shared_ptr<pending_request> self)
+    {
+        _self = std::move(self);
+    }
+
+    future<TResult> get_future()
+    {
+        return _promise.get_future();
+    }
+
+    void occupy(window_slot slot)
+    {
+        _slot = std::move(slot);
+    }
+
+    /// Is it safe to send this request again under \a policy?
+    bool idempotent(const retry_policy& policy) const
+    {
+        return policy.idempotent(_type);
+    }
+
+    void arm_retry(std::shared_ptr<const retry_policy> policy, retry_state::resubmit_function resubmit)
+    {
+        _retry.arm(std::move(policy), std::move(resubmit));
+    }
+
+    /// Run \a action when the request succeeds, before the result is delivered.
+    void on_success(std::function<void ()> action)
+    {
+        _on_success = std::move(action);
+    }
+
+    /// Has the result already been delivered?
+    bool delivered() const
+    {
+        return _delivered.load(std::memory_order_acquire);
+    }
+
+    void sent()
+    {
+        _tracer.sent();
+    }
+
+    template <typename... TValue>
+    void deliver(std::size_t response_size, optional<transaction_id> transaction, TValue&&... value)
+    {
+        if (_delivered.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        _tracer.complete(error_code::ok, response_size, transaction);
+        if (_on_success)
+            _on_success();
+        _promise.set_value(std::forward<TValue>(value)...);
+    }
+
+    void deliver_error(error_code rc, zk::exception_ptr ex_ptr)
+    {
+        if (!retry(rc))
+            deliver_failure(rc, std::move(ex_ptr));
+    }
+
+    void deliver_error(error_code rc)
+    {
+        if (!retry(rc))
+            deliver_failure(rc, get_exception_ptr_of(rc));
+    }
+
+    /// Deliver \ref error_code::operation_timeout because the deadline passed. This runs on the timer thread while the
+    /// C client might still own the request, so it only delivers the result: the request is not retried and keeps its
+    /// slot in the window until the completion arrives.
+    void expire()
+    {
+        if (!delivered())
+            deliver_failure(error_code::operation_timeout, get_exception_ptr_of(error_code::operation_timeout));
+    }
+
+private:
+    bool retry(error_code rc)
+    {
+        return !delivered() && _retry.try_again(rc, _slot);
+    }
+
+    void deliver_failure(error_code rc, zk::exception_ptr ex_ptr)
+    {
+        if (_delivered.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        _tracer.complete(rc);
+        _promise.set_exception(std::move(ex_ptr));
+    }
+
+private:
+    request_type                     _type;
+    std::atomic<bool>                _delivered;
+    promise<TResult>                 _promise;
+    request_tracer                   _tracer;
+    window_slot                      _slot;
+    retry_state                      _retry;
+    std::function<void ()>           _on_success;
+    std::shared_ptr<pending_request> _self;
+};
+
+/// Arguments to a request are usually borrowed from the caller. When the request has to wait for a slot in the request
+/// window, it holds an owning copy instead.
+template <typename T>
+struct queued_argument
+{
+    using type = std::decay_t<T>;
+};
+
+template <>
+struct queued_argument<string_view>
+{
+    using type = std::string;
+};
+
+template <>
+struct queued_argument<path_view>
+{
+    using type = std::string;
+};
+
+template <typename T>
+using queued_argument_t = typename queued_argument<std::decay_t<T>>::type;
+
+template <typename TRequest, typename FSubmit, typename... TArgs>
+auto connection_zk::dispatch(std::shared_ptr<TRequest> req,
+                             const request_options&    options,
+                             FSubmit&&                 submit,
+                             TArgs&&...                args
+                            ) const
+{
+    auto fut = req->get_future();
+
+    if (options.deadline)
+    {
+        if (*options.deadline <= timer_queue::clock::now())
+        {
+            req->expire();
+            return fut;
+        }
+
+        _timers->schedule_deadline(*options.deadline, req);
+    }
+
+    if (options.retry && options.retry->max_attempts() > 1U && req->idempotent(*options.retry))
+    {
+        // Later attempts can not borrow the arguments from the caller. The request is referenced weakly here, as this
+        // state is owned by the request itself; a scheduled attempt holds it strongly until it is sent.
+        auto state = std::make_shared<std::tuple<std::weak_ptr<TRequest>,
+                                                 std::decay_t<FSubmit>,
+                                                 queued_argument_t<TArgs>...
+                                                >
+                                     >
+                     (req, submit, args...);
+        req->arm_retry(options.retry,
+                       [this, state] (retry_policy::duration delay)
+                       {
+                           auto req = std::get<0>(*state).lock();
+                           if (!req)
+                               return false;
+
+                           return _timers->schedule(timer_queue::clock::now() + delay,
+                                                    [this, state, req = std::move(req)] (bool cancelled) mutable
+                                                    {
+                                                        if (cancelled)
+                                                        {
+                                                            req->deliver_error(error_code::closed);
+                                                            return;
+                                                        }
+
+                                                        std::apply([&] (auto&, auto& submit, auto&... args)
+                                                                   {
+                                                                       admit(std::move(req), submit, args...);
+                                                                   },
+                                                                   *state
+                                                                  );
+                                                    }
+                                                   );
+                       }
+                      );
+    }
+
+    admit(std::move(req), std::forward<FSubmit>(submit), std::forward<TArgs>(args)...);
+    return fut;
+}
+
+template <typename TRequest, typename FSubmit, typename... TArgs>
+void connection_zk::admit(std::shared_ptr<TRequest> req, FSubmit&& submit, TArgs&&... args) const
+{
+    // Without a limit, the window only keeps count.
+    if (_max_in_flight == 0U)
+    {
+        _in_flight.fetch_add(1U, std::memory_order_relaxed);
+        submit_request(std::move(req), submit, args...);
+        return;
+    }
+
+    std::unique_lock<std::mutex> ax(_window_protect);
+    if (_closing)
+    {
+        ax.unlock();
+        req->deliver_error(error_code::closed);
+    }
+    else if (_queued.empty() && _in_flight.load(std::memory_order_relaxed) < _max_in_flight)
+    {
+        _in_flight.fetch_add(1U, std::memory_order_relaxed);
+        ax.unlock();
+        submit_request(std::move(req), submit, args...);
+    }
+    else if (_backpressure == backpressure::reject)
+    {
+        _rejected.fetch_add(1U, std::memory_order_relaxed);
+        ax.unlock();
+        req->deliver_error(error_code::throttled);
+    }
+    else
+    {
+        auto state = std::make_shared<std::tuple<std::shared_ptr<TRequest>,
+                                                 std::decay_t<FSubmit>,
+                                                 queued_argument_t<TArgs>...
+                                                >
+                                     >
+                     (
+                        std::move(req),
+                        std::forward<FSubmit>(submit),
+                        std::forward<TArgs>(args)...
+                     );
+        _queued.push_back(queued_request
+                          {
+                              [this, state]
+                              {
+                                  std::apply([this] (auto& req, auto& submit, auto&... args)
+                                             {
+                                                 submit_request(std::move(req), submit, args...);
+                                             },
+                                             *state
+                                            );
+                              },
+                              [state] (error_code rc) { std::get<0>(*state)->deliver_error(rc); }
+                          }
+                         );
+    }
+}
+
+template <typename TRequest, typename FSubmit, typename... TArgs>
+void connection_zk::submit_request(std::shared_ptr<TRequest> req, FSubmit& submit, TArgs&... args) const
+{
+    window_slot slot(*this);
+
+    // A queued request might have passed its deadline while it was waiting -- there is no point in sending it, and the
+    // slot is given back right away.
+    if (req->delivered())
+        return;
+    req->occupy(std::move(slot));
+
+    // Session recovery replaces the handle, so it can only be used while holding this lock. Without recovery, the
+    // handle never changes and there is no need to pay for it.
+    std::shared_lock<std::shared_mutex> handle_ax(_handle_protect, std::defer_lock);
+    if (_session_recovery != session_recovery::none)
+        handle_ax.lock();
+
+    if constexpr (std::is_base_of_v<watcher, TRequest>)
+    {
+        // Track the watcher before the C client knows about it, so the watch can not fire before it is tracked.
+        std::unique_lock<std::mutex> ax(_watches_protect);
+        _watches.emplace(req.get(), req);
+        ax.unlock();
+
+        req->sent();
+        auto rc = error_code_from_raw(submit(static_cast<ptr<void>>(req.get()), args...));
+        if (handle_ax.owns_lock())
+            handle_ax.unlock();
+        if (rc != error_code::ok)
+        {
+            try_extract_watch(req.get());
+            req->deliver_error(rc);
+        }
+    }
+    else
+    {
+        req->retain(req);
+        req->sent();
+        auto rc = error_code_from_raw(submit(static_cast<ptr<const void>>(req.get()), args...));
+        if (handle_ax.owns_lock())
+            handle_ax.unlock();
+        if (rc != error_code::ok)
+        {
+            req->retain(nullptr);
+            req->deliver_error(rc);
+        }
+    }
+}
+
+void connection_zk::release_slot() const noexcept
+{
+    if (_max_in_flight == 0U)
+    {
+        _in_flight.fetch_sub(1U, std::memory_order_relaxed);
+        return;
+    }
+
+    std::unique_lock<std::mutex> ax(_window_protect);
+    _in_flight.fetch_sub(1U, std::memory_order_relaxed);
+
+    // Queued requests are sent by a single thread at a time. This keeps them in order and keeps a request which fails
+    // immediately (releasing its slot from inside this loop) from recursing.
+    if (_draining)
+        return;
+
+    _draining = true;
+    while (!_closing && !_queued.empty() && _in_flight.load(std::memory_order_relaxed) < _max_in_flight)
+    {
+        auto next = std::move(_queued.front());
+        _queued.pop_front();
+        _in_flight.fetch_add(1U, std::memory_order_relaxed);
+        ax.unlock();
+        next.submit();
+        ax.lock();
+    }
+    _draining = false;
 }
 
-connection_zk::~connection_zk() noexcept
+request_window_stats connection_zk::window_stats() const
 {
-    close();
+    request_window_stats out;
+    out.in_flight = _in_flight.load(std::memory_order_relaxed);
+    out.rejected  = _rejected.load(std::memory_order_relaxed);
+    if (_max_in_flight != 0U)
+    {
+        std::unique_lock<std::mutex> ax(_window_protect);
+        out.queued = _queued.size();
+    }
+    return out;
 }
 
 class connection_zk::watcher
@@ -226,6 +899,21 @@ public:
         return _event_promise.get_future();
     }
 
+    /// Has the data been delivered successfully, so the watch is waiting for its event?
+    virtual bool armed() const
+    {
+        return false;
+    }
+
+    /// Register the watch again on a new session \a handle. When the registration completes, the C client calls
+    /// \ref finish_rearm with \a ctx.
+    virtual int rearm(ptr<zhandle_t> handle, ptr<const void> ctx)
+    {
+        static_cast<void>(handle);
+        static_cast<void>(ctx);
+        return ZUNIMPLEMENTED;
+    }
+
 protected:
     std::atomic<bool> _event_delivered;
     promise<event>    _event_promise;
@@ -236,46 +924,149 @@ class connection_zk::basic_watcher :
         public connection_zk::watcher
 {
 public:
-    basic_watcher() :
-            _data_delivered(false)
-    { }
+    explicit basic_watcher(const connection_zk& conn, request_type type, string_view path) :
+            _type(type),
+            _data_delivered(false),
+            _armed(false),
+            _tracer(conn, type, path, 0U)
+    {
+        // The path is only needed to re-arm the watch on a new session.
+        if (conn._session_recovery != session_recovery::none)
+            _path = std::string(path);
+    }
 
-    future<TResult> get_data_future()
+    const std::string& path() const
+    {
+        return _path;
+    }
+
+    virtual bool armed() const override
+    {
+        return _armed.load(std::memory_order_acquire);
+    }
+
+    future<TResult> get_future()
     {
         return _data_promise.get_future();
     }
 
+    void occupy(window_slot slot)
+    {
+        _slot = std::move(slot);
+    }
+
+    bool idempotent(const retry_policy& policy) const
+    {
+        return policy.idempotent(_type);
+    }
+
+    void arm_retry(std::shared_ptr<const retry_policy> policy, retry_state::resubmit_function resubmit)
+    {
+        _retry.arm(std::move(policy), std::move(resubmit));
+    }
+
+    bool delivered() const
+    {
+        return _data_delivered.load(std::memory_order_acquire);
+    }
+
+    void sent()
+    {
+        _tracer.sent();
+    }
+
     virtual void deliver_event(event ev) override
     {
-        if (!_data_delivered.load(std::memory_order_relaxed))
-        {
-            deliver_data(nullopt, get_exception_ptr_of(error_code::closed));
-        }
+        deliver_error(error_code::closed);
 
         watcher::deliver_event(std::move(ev));
     }
 
-    void deliver_data(optional<TResult> data, zk::exception_ptr ex_ptr)
+    void deliver(TResult data, std::size_t response_size, optional<transaction_id> transaction)
     {
-        if (!_data_delivered.exchange(true, std::memory_order_relaxed))
+        if (_data_delivered.exchange(true, std::memory_order_acq_rel))
         {
-            if (ex_ptr)
-            {
-                _data_promise.set_exception(std::move(ex_ptr));
-            }
-            else
-            {
-                _data_promise.set_value(std::move(*data));
-            }
+            // The deadline passed first, but the C client is only done with the request now
+            _slot.reset();
+            return;
         }
+
+        _tracer.complete(error_code::ok, response_size, transaction);
+        set_data(std::move(data));
+        _armed.store(true, std::memory_order_release);
+
+        // The watch no longer counts against the request window once the data has been delivered.
+        _slot.reset();
+    }
+
+    void deliver_error(error_code rc, zk::exception_ptr ex_ptr)
+    {
+        if (retry(rc))
+            return;
+
+        deliver_failure(rc, std::move(ex_ptr));
+        _slot.reset();
+    }
+
+    void deliver_error(error_code rc)
+    {
+        if (retry(rc))
+            return;
+
+        // Checking first avoids creating an exception for the common case of an event after the data was delivered.
+        if (!delivered())
+            deliver_failure(rc, get_exception_ptr_of(rc));
+        _slot.reset();
+    }
+
+    /// Deliver \ref error_code::operation_timeout because the deadline passed. As with \ref pending_request::expire,
+    /// the watch keeps its slot until the C client is done with it and is never retried from here.
+    void expire()
+    {
+        if (!delivered())
+            deliver_failure(error_code::operation_timeout, get_exception_ptr_of(error_code::operation_timeout));
+    }
+
+private:
+    bool retry(error_code rc)
+    {
+        return !delivered() && _retry.try_again(rc, _slot);
+    }
+
+    void deliver_failure(error_code rc, zk::exception_ptr ex_ptr)
+    {
+        if (_data_delivered.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        _tracer.complete(rc);
+        set_failure(std::move(ex_ptr));
+    }
+
+protected:
+    /// Hand the data to whoever is waiting for it. This is only called once, and never along with \ref set_failure.
+    virtual void set_data(TResult data)
+    {
+        _data_promise.set_value(std::move(data));
+    }
+
+    /// Hand the failure to fetch the data to whoever is waiting for it.
+    virtual void set_failure(zk::exception_ptr ex_ptr)
+    {
+        _data_promise.set_exception(std::move(ex_ptr));
     }
 
 private:
+    request_type      _type;
     std::atomic<bool> _data_delivered;
+    std::atomic<bool> _armed;
     promise<TResult>  _data_promise;
+    request_tracer    _tracer;
+    window_slot       _slot;
+    retry_state       _retry;
+    std::string       _path;
 };
 
-std::shared_ptr<connection_zk::watcher> connection_zk::try_extract_watch(ptr<const void> addr)
+std::shared_ptr<connection_zk::watcher> connection_zk::try_extract_watch(ptr<const void> addr) const
 {
     std::unique_lock<std::mutex> ax(_watches_protect);
     auto iter = _watches.find(addr);
@@ -298,19 +1089,50 @@ void connection_zk::deliver_watch(ptr<zhandle_t>  zh,
                                  )
 {
     auto& self = *connection_from_context(zh);
+    auto  type = event_from_raw(type_in);
+    auto  st   = state_from_raw(state_in);
+
+    if (self._session_recovery != session_recovery::none)
+    {
+        // A watch survives losing the connection (the C client restores it when it reconnects to the same session) and
+        // an expired session (it is re-armed on the new one). Handles replaced by recovery are closed, so anything
+        // they still deliver is noise.
+        if (type == event_type::session && st != zk::state::authentication_failed)
+            return;
+        if (self.is_stale(zh))
+            return;
+    }
+
     if (auto watcher = self.try_extract_watch(proms_in))
-        watcher->deliver_event(event(event_from_raw(type_in), state_from_raw(state_in)));
+        watcher->deliver_event(event(type, st));
 }
 
 void connection_zk::close()
 {
+    // Recovery must not install a new handle while (or after) this one is closed.
+    stop_recovery();
+
     if (_handle)
     {
+        // Requests still waiting for a slot in the window are never sent.
+        std::unique_lock<std::mutex> window_ax(_window_protect);
+        _closing = true;
+        auto l_queued = std::move(_queued);
+        window_ax.unlock();
+        for (auto& queued : l_queued)
+            queued.cancel(error_code::closed);
+
+        // Everything still outstanding is about to be delivered with closed, so deadlines no longer matter. Requests
+        // waiting to be retried are delivered with closed now.
+        _timers->stop();
+
         auto err = error_code_from_raw(::zookeeper_close(_handle));
         if (err != error_code::ok)
             throw_error(err);
 
+        std::unique_lock<std::shared_mutex> handle_ax(_handle_protect);
         _handle = nullptr;
+        handle_ax.unlock();
 
         // Deliver a session event as if there was a close.
         std::unique_lock<std::mutex> ax(_watches_protect);
@@ -323,47 +1145,113 @@ void connection_zk::close()
 
 zk::state connection_zk::state() const
 {
+    std::shared_lock<std::shared_mutex> handle_ax(_handle_protect);
     if (_handle)
         return state_from_raw(::zoo_state(_handle));
     else
         return zk::state::closed;
 }
 
-future<get_result> connection_zk::get(string_view path)
+/// Copy the \a data_sz bytes at \a data the C client delivered, decoding them with \a codec if there is one.
+///
+/// \throws marshalling_error if the data has a header \a codec can not decode.
+static buffer decode_data(const payload_codec* codec, ptr<const char> data, int data_sz)
 {
-    ::data_completion_t callback =
-        [] (int rc_in, ptr<const char> data, int data_sz, ptr<const struct Stat> pstat, ptr<const void> prom_in) noexcept
-        {
-            std::unique_ptr<promise<get_result>> prom((ptr<promise<get_result>>) prom_in);
-            auto rc = error_code_from_raw(rc_in);
-            if (rc == error_code::ok)
-                prom->set_value(get_result(buffer(data, data + data_sz), stat_from_raw(*pstat)));
-            else
-                prom->set_exception(get_exception_ptr_of(rc));
-        };
+    if (codec)
+        return codec->decode(buffer(data, data + data_sz));
+    else
+        return buffer(data, data + data_sz);
+}
+
+class connection_zk::data_request final :
+        public connection_zk::pending_request<get_result>
+{
+public:
+    explicit data_request(const connection_zk& conn, string_view path, std::shared_ptr<const payload_codec> codec) :
+            pending_request<get_result>(conn, request_type::get, path),
+            _codec(std::move(codec))
+    { }
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
+    static void deliver_raw(int                    rc_in,
+                            ptr<const char>        data,
+                            int                    data_sz,
+                            ptr<const struct Stat> pstat,
+                            ptr<const void>        req_in
+                           ) noexcept
     {
-        auto ppromise = std::make_unique<promise<get_result>>();
-        auto fut      = ppromise->get_future();
-        auto rc = error_code_from_raw(::zoo_aget(_handle, path, 0, callback, ppromise.get()));
-        if (rc == error_code::ok)
+        auto req = reclaim<data_request>(req_in);
+        auto rc  = error_code_from_raw(rc_in);
+        if (rc != error_code::ok)
         {
-            ppromise.release();
-            return fut;
+            req->deliver_error(rc);
+            return;
         }
-        else
+
+        buffer payload;
+        try
         {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
+            payload = decode_data(req->_codec.get(), data, data_sz);
         }
-    });
+        catch (...)
+        {
+            req->deliver_error(error_code::marshalling_error, zk::current_exception());
+            return;
+        }
+
+        auto st = stat_from_raw(*pstat);
+        req->deliver(std::size_t(data_sz), st.modified_transaction, get_result(std::move(payload), st));
+    }
+
+private:
+    std::shared_ptr<const payload_codec> _codec;
+};
+
+future<get_result> connection_zk::get(path_view path, const request_options& options)
+{
+    return dispatch(std::make_shared<data_request>(*this, path, options.codec),
+                    options,
+                    [this] (ptr<const void> req, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_aget(_handle, path_str, 0, data_request::deliver_raw, req);
+                        });
+                    },
+                    path
+                   );
 }
 
 class connection_zk::data_watcher :
         public connection_zk::basic_watcher<watch_result>
 {
 public:
+    explicit data_watcher(const connection_zk&                  conn,
+                          string_view                          path,
+                          std::shared_ptr<const payload_codec> codec
+                         ) :
+            basic_watcher<watch_result>(conn, request_type::watch, path),
+            _codec(std::move(codec))
+    { }
+
+    /// Deliver everything to \a listener instead of the futures (see \ref connection::listen).
+    explicit data_watcher(const connection_zk&                  conn,
+                          string_view                          path,
+                          std::shared_ptr<const payload_codec> codec,
+                          std::shared_ptr<watch_listener>      listener
+                         ) :
+            basic_watcher<watch_result>(conn, request_type::watch, path),
+            _codec(std::move(codec)),
+            _listener(std::move(listener))
+    { }
+
+    virtual void deliver_event(event ev) override
+    {
+        if (_listener && armed())
+            _listener->on_event(ev);
+
+        basic_watcher::deliver_event(std::move(ev));
+    }
+
     static void deliver_raw(int                    rc_in,
                             ptr<const char>        data,
                             int                    data_sz,
@@ -374,96 +1262,177 @@ public:
         auto& self = *static_cast<ptr<data_watcher>>(const_cast<ptr<void>>(self_in));
         auto  rc   = error_code_from_raw(rc_in);
 
-        if (rc == error_code::ok)
+        if (rc != error_code::ok)
         {
-            self.deliver_data(watch_result(get_result(buffer(data, data + data_sz), stat_from_raw(*pstat)),
-                                           self.get_event_future()
-                                          ),
-                              zk::exception_ptr()
-                             );
+            self.deliver_error(rc);
+            return;
         }
-        else
+
+        buffer payload;
+        try
+        {
+            payload = decode_data(self._codec.get(), data, data_sz);
+        }
+        catch (...)
         {
-            self.deliver_data(nullopt, get_exception_ptr_of(rc));
+            self.deliver_error(error_code::marshalling_error, zk::current_exception());
+            return;
         }
+
+        auto st = stat_from_raw(*pstat);
+        self._modified = st.modified_transaction;
+        self.deliver(watch_result(get_result(std::move(payload), st), self.get_event_future()),
+                     std::size_t(data_sz),
+                     st.modified_transaction
+                    );
     }
-};
 
-future<watch_result> connection_zk::watch(string_view path)
-{
-    return with_str(path, [&] (ptr<const char> path) noexcept
+    virtual int rearm(ptr<zhandle_t> handle, ptr<const void> ctx) override
     {
-        std::unique_lock<std::mutex> ax(_watches_protect);
-        auto watcher = std::make_shared<data_watcher>();
-        auto rc      = error_code_from_raw(::zoo_awget(_handle,
-                                                       path,
-                                                       deliver_watch,
-                                                       watcher.get(),
-                                                       data_watcher::deliver_raw,
-                                                       watcher.get()
-                                                      )
-                                          );
+        return ::zoo_awget(handle, path().c_str(), deliver_watch, this, rearmed_raw, ctx);
+    }
+
+private:
+    static void rearmed_raw(int rc_in, ptr<const char>, int, ptr<const struct Stat> pstat, ptr<const void> ctx) noexcept
+    {
+        auto& self = static_cast<const data_watcher&>(*static_cast<ptr<const recovery_request>>(ctx)->target);
+        auto  rc   = error_code_from_raw(rc_in);
+
         if (rc == error_code::ok)
-            _watches.emplace(watcher.get(), watcher);
+        {
+            bool same = self._modified == transaction_id(pstat->mzxid);
+            finish_rearm(ctx, rc, same ? nullopt : some(event_type::changed));
+        }
+        else if (rc == error_code::no_entry)
+            finish_rearm(ctx, error_code::ok, event_type::erased);
         else
-            watcher->deliver_data(nullopt, get_exception_ptr_of(rc));
+            finish_rearm(ctx, rc, nullopt);
+    }
 
-        return watcher->get_data_future();
-    });
+protected:
+    virtual void set_data(watch_result data) override
+    {
+        if (_listener)
+            _listener->on_data(std::move(data).initial());
+        else
+            basic_watcher::set_data(std::move(data));
+    }
+
+    virtual void set_failure(zk::exception_ptr ex_ptr) override
+    {
+        if (_listener)
+            _listener->on_error(std::move(ex_ptr));
+        else
+            basic_watcher::set_failure(std::move(ex_ptr));
+    }
+
+private:
+    std::shared_ptr<const payload_codec> _codec;
+    transaction_id                       _modified;
+    std::shared_ptr<watch_listener>      _listener;
+};
+
+future<watch_result> connection_zk::watch(path_view path, const request_options& options)
+{
+    return dispatch_data(std::make_shared<data_watcher>(*this, path, options.codec), path, options);
+}
+
+void connection_zk::listen(path_view path, const request_options& options, std::shared_ptr<watch_listener> listener)
+{
+    // The future is never delivered -- everything goes to the listener
+    dispatch_data(std::make_shared<data_watcher>(*this, path, options.codec, std::move(listener)), path, options);
+}
+
+future<watch_result> connection_zk::dispatch_data(std::shared_ptr<data_watcher> watcher,
+                                                  path_view                     path,
+                                                  const request_options&        options
+                                                 )
+{
+    return dispatch(std::move(watcher),
+                    options,
+                    [this] (ptr<void> watcher, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_awget(_handle,
+                                               path_str,
+                                               deliver_watch,
+                                               watcher,
+                                               data_watcher::deliver_raw,
+                                               watcher
+                                              );
+                        });
+                    },
+                    path
+                   );
 }
 
-future<get_children_result> connection_zk::get_children(string_view path)
+future<get_children_result> connection_zk::get_children(path_view path, const request_options& options)
 {
     ::strings_stat_completion_t callback =
         [] (int                             rc_in,
             ptr<const struct String_vector> strings_in,
             ptr<const struct Stat>          stat_in,
-            ptr<const void>                 prom_in
+            ptr<const void>                 req_in
            )
         {
-            std::unique_ptr<promise<get_children_result>> prom((ptr<promise<get_children_result>>) prom_in);
+            auto req = pending_request<get_children_result>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
-            try
+            if (rc != error_code::ok)
             {
-                if (rc != error_code::ok)
-                    throw_error(rc);
+                req->deliver_error(rc);
+                return;
+            }
 
-                prom->set_value(get_children_result(string_vector_from_raw(*strings_in), stat_from_raw(*stat_in)));
+            try
+            {
+                auto children = string_vector_from_raw(*strings_in);
+                auto st       = stat_from_raw(*stat_in);
+                auto sz       = children_size(children);
+                req->deliver(sz, st.modified_transaction, get_children_result(std::move(children), st));
             }
             catch (...)
             {
-                prom->set_exception(zk::current_exception());
+                req->deliver_error(error_code::marshalling_error, zk::current_exception());
             }
         };
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
-    {
-        auto ppromise = std::make_unique<promise<get_children_result>>();
-        auto fut      = ppromise->get_future();
-        auto rc       = error_code_from_raw(::zoo_aget_children2(_handle,
-                                                                 path,
-                                                                 0,
-                                                                 callback,
-                                                                 ppromise.get()
-                                                                )
-                                           );
-        if (rc == error_code::ok)
-        {
-            ppromise.release();
-            return fut;
-        }
-        else
-        {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
-        }
-    });
+    return dispatch(std::make_shared<pending_request<get_children_result>>(*this, request_type::get_children, path),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_aget_children2(_handle, path_str, 0, callback, req);
+                        });
+                    },
+                    path
+                   );
 }
 
 class connection_zk::child_watcher :
         public connection_zk::basic_watcher<watch_children_result>
 {
 public:
+    using basic_watcher<watch_children_result>::basic_watcher;
+
+    /// Deliver everything to \a listener instead of the futures (see \ref connection::listen_children).
+    explicit child_watcher(const connection_zk&                     conn,
+                           string_view                              path,
+                           std::shared_ptr<watch_children_listener> listener
+                          ) :
+            basic_watcher(conn, request_type::watch_children, path),
+            _listener(std::move(listener))
+    { }
+
+    virtual void deliver_event(event ev) override
+    {
+        if (_listener && armed())
+            _listener->on_event(ev);
+
+        basic_watcher::deliver_event(std::move(ev));
+    }
+
     static void deliver_raw(int                             rc_in,
                             ptr<const struct String_vector> strings_in,
                             ptr<const struct Stat>          stat_in,
@@ -473,87 +1442,160 @@ public:
         auto& self = *static_cast<ptr<child_watcher>>(const_cast<ptr<void>>(prom_in));
         auto  rc   = error_code_from_raw(rc_in);
 
+        if (rc != error_code::ok)
+        {
+            self.deliver_error(rc);
+            return;
+        }
+
         try
         {
-            if (rc != error_code::ok)
-                throw_error(rc);
-
-            self.deliver_data(watch_children_result(get_children_result(string_vector_from_raw(*strings_in),
-                                                                        stat_from_raw(*stat_in)
-                                                                       ),
-                                                    self.get_event_future()
-                                                   ),
-                              zk::exception_ptr()
-                             );
+            auto children = string_vector_from_raw(*strings_in);
+            auto st       = stat_from_raw(*stat_in);
+            auto sz       = children_size(children);
+            self._child_modified = st.child_modified_transaction;
+            self.deliver(watch_children_result(get_children_result(std::move(children), st), self.get_event_future()),
+                         sz,
+                         st.modified_transaction
+                        );
         }
         catch (...)
         {
-            self.deliver_data(nullopt, zk::current_exception());
+            self.deliver_error(error_code::marshalling_error, zk::current_exception());
         }
+    }
 
+    virtual int rearm(ptr<zhandle_t> handle, ptr<const void> ctx) override
+    {
+        return ::zoo_awget_children2(handle, path().c_str(), deliver_watch, this, rearmed_raw, ctx);
     }
-};
 
-future<watch_children_result> connection_zk::watch_children(string_view path)
-{
-    return with_str(path, [&] (ptr<const char> path) noexcept
+private:
+    static void rearmed_raw(int                             rc_in,
+                            ptr<const struct String_vector>,
+                            ptr<const struct Stat>          stat_in,
+                            ptr<const void>                 ctx
+                           ) noexcept
     {
-        std::unique_lock<std::mutex> ax(_watches_protect);
-        auto watcher = std::make_shared<child_watcher>();
-        auto rc      = error_code_from_raw(::zoo_awget_children2(_handle,
-                                                                 path,
-                                                                 deliver_watch,
-                                                                 watcher.get(),
-                                                                 child_watcher::deliver_raw,
-                                                                 watcher.get()
-                                                                )
-                                          );
+        auto& self = static_cast<const child_watcher&>(*static_cast<ptr<const recovery_request>>(ctx)->target);
+        auto  rc   = error_code_from_raw(rc_in);
+
         if (rc == error_code::ok)
-            _watches.emplace(watcher.get(), watcher);
+        {
+            bool same = self._child_modified == transaction_id(stat_in->pzxid);
+            finish_rearm(ctx, rc, same ? nullopt : some(event_type::child));
+        }
+        else if (rc == error_code::no_entry)
+        {
+            finish_rearm(ctx, error_code::ok, event_type::erased);
+        }
+        else
+        {
+            finish_rearm(ctx, rc, nullopt);
+        }
+    }
+
+protected:
+    virtual void set_data(watch_children_result data) override
+    {
+        if (_listener)
+            _listener->on_children(std::move(data).initial());
         else
-            watcher->deliver_data(nullopt, get_exception_ptr_of(rc));
+            basic_watcher::set_data(std::move(data));
+    }
 
-        return watcher->get_data_future();
-    });
+    virtual void set_failure(zk::exception_ptr ex_ptr) override
+    {
+        if (_listener)
+            _listener->on_error(std::move(ex_ptr));
+        else
+            basic_watcher::set_failure(std::move(ex_ptr));
+    }
+
+private:
+    transaction_id                           _child_modified;
+    std::shared_ptr<watch_children_listener> _listener;
+};
+
+future<watch_children_result> connection_zk::watch_children(path_view path, const request_options& options)
+{
+    return dispatch_children(std::make_shared<child_watcher>(*this, request_type::watch_children, path), path, options);
+}
+
+void connection_zk::listen_children(path_view                                path,
+                                    const request_options&                   options,
+                                    std::shared_ptr<watch_children_listener> listener
+                                   )
+{
+    // The future is never delivered -- everything goes to the listener
+    dispatch_children(std::make_shared<child_watcher>(*this, path, std::move(listener)), path, options);
+}
+
+future<watch_children_result> connection_zk::dispatch_children(std::shared_ptr<child_watcher> watcher,
+                                                               path_view                      path,
+                                                               const request_options&         options
+                                                              )
+{
+    return dispatch(std::move(watcher),
+                    options,
+                    [this] (ptr<void> watcher, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_awget_children2(_handle,
+                                                         path_str,
+                                                         deliver_watch,
+                                                         watcher,
+                                                         child_watcher::deliver_raw,
+                                                         watcher
+                                                        );
+                        });
+                    },
+                    path
+                   );
 }
 
-future<exists_result> connection_zk::exists(string_view path)
+future<exists_result> connection_zk::exists(path_view path, const request_options& options)
 {
     ::stat_completion_t callback =
-        [] (int rc_in, ptr<const struct Stat> stat_in, ptr<const void> prom_in)
+        [] (int rc_in, ptr<const struct Stat> stat_in, ptr<const void> req_in)
         {
-            std::unique_ptr<promise<exists_result>> prom((ptr<promise<exists_result>>) prom_in);
+            auto req = pending_request<exists_result>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
             if (rc == error_code::ok)
-                prom->set_value(exists_result(stat_from_raw(*stat_in)));
+            {
+                auto st = stat_from_raw(*stat_in);
+                req->deliver(0U, st.modified_transaction, exists_result(st));
+            }
             else if (rc == error_code::no_entry)
-                prom->set_value(exists_result(nullopt));
-            else
-                prom->set_exception(get_exception_ptr_of(rc));
-        };
-
-    return with_str(path, [&] (ptr<const char> path) noexcept
-    {
-        auto ppromise = std::make_unique<promise<exists_result>>();
-        auto fut      = ppromise->get_future();
-        auto rc       = error_code_from_raw(::zoo_aexists(_handle, path, 0, callback, ppromise.get()));
-        if (rc == error_code::ok)
-        {
-            ppromise.release();
-            return fut;
-        }
-        else
-        {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
-        }
-    });
+            {
+                req->deliver(0U, nullopt, exists_result(nullopt));
+            }
+            else
+            {
+                req->deliver_error(rc);
+            }
+        };
+
+    return dispatch(std::make_shared<pending_request<exists_result>>(*this, request_type::exists, path),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_aexists(_handle, path_str, 0, callback, req);
+                        });
+                    },
+                    path
+                   );
 }
 
 class connection_zk::exists_watcher :
         public connection_zk::basic_watcher<watch_exists_result>
 {
 public:
+    using basic_watcher<watch_exists_result>::basic_watcher;
+
     static void deliver_raw(int rc_in, ptr<const struct Stat> stat_in, ptr<const void> self_in)
     {
         auto& self = *static_cast<ptr<exists_watcher>>(const_cast<ptr<void>>(self_in));
@@ -561,245 +1603,321 @@ public:
 
         if (rc == error_code::ok)
         {
-            self.deliver_data(watch_exists_result(exists_result(stat_from_raw(*stat_in)), self.get_event_future()),
-                              zk::exception_ptr()
-                             );
+            auto st = stat_from_raw(*stat_in);
+            self._modified = st.modified_transaction;
+            self.deliver(watch_exists_result(exists_result(st), self.get_event_future()), 0U, st.modified_transaction);
         }
         else if (rc == error_code::no_entry)
         {
-            self.deliver_data(watch_exists_result(exists_result(nullopt), self.get_event_future()),
-                              zk::exception_ptr()
-                             );
+            self._modified = nullopt;
+            self.deliver(watch_exists_result(exists_result(nullopt), self.get_event_future()), 0U, nullopt);
         }
         else
         {
-            self.deliver_data(nullopt, get_exception_ptr_of(rc));
+            self.deliver_error(rc);
         }
     }
-};
 
-future<watch_exists_result> connection_zk::watch_exists(string_view path)
-{
-    return with_str(path, [&] (ptr<const char> path) noexcept
+    virtual int rearm(ptr<zhandle_t> handle, ptr<const void> ctx) override
     {
-        std::unique_lock<std::mutex> ax(_watches_protect);
-        auto watcher = std::make_shared<exists_watcher>();
-        auto rc      = error_code_from_raw(::zoo_awexists(_handle,
-                                                          path,
-                                                          deliver_watch,
-                                                          watcher.get(),
-                                                          exists_watcher::deliver_raw,
-                                                          watcher.get()
-                                                         )
-                                          );
-        if (rc == error_code::ok)
-            _watches.emplace(watcher.get(), watcher);
+        return ::zoo_awexists(handle, path().c_str(), deliver_watch, this, rearmed_raw, ctx);
+    }
+
+private:
+    static void rearmed_raw(int rc_in, ptr<const struct Stat> stat_in, ptr<const void> ctx) noexcept
+    {
+        auto& self = static_cast<const exists_watcher&>(*static_cast<ptr<const recovery_request>>(ctx)->target);
+        auto  rc   = error_code_from_raw(rc_in);
+
+        if (rc == error_code::ok && !self._modified)
+        {
+            finish_rearm(ctx, rc, event_type::created);
+        }
+        else if (rc == error_code::ok)
+        {
+            bool same = *self._modified == transaction_id(stat_in->mzxid);
+            finish_rearm(ctx, rc, same ? nullopt : some(event_type::changed));
+        }
+        else if (rc == error_code::no_entry)
+        {
+            finish_rearm(ctx, error_code::ok, self._modified ? some(event_type::erased) : nullopt);
+        }
         else
-            watcher->deliver_data(nullopt, get_exception_ptr_of(rc));
+        {
+            finish_rearm(ctx, rc, nullopt);
+        }
+    }
 
-        return watcher->get_data_future();
-    });
+private:
+    optional<transaction_id> _modified;
+};
+
+future<watch_exists_result> connection_zk::watch_exists(path_view path, const request_options& options)
+{
+    return dispatch(std::make_shared<exists_watcher>(*this, request_type::watch_exists, path),
+                    options,
+                    [this] (ptr<void> watcher, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_awexists(_handle,
+                                                  path_str,
+                                                  deliver_watch,
+                                                  watcher,
+                                                  exists_watcher::deliver_raw,
+                                                  watcher
+                                                 );
+                        });
+                    },
+                    path
+                   );
 }
 
-future<create_result> connection_zk::create(string_view   path,
-                                            const buffer& data,
-                                            const acl&    rules,
-                                            create_mode   mode
+future<create_result> connection_zk::create(path_view              path,
+                                            const buffer&          data,
+                                            const acl&             rules,
+                                            create_mode            mode,
+                                            const request_options& options
                                            )
 {
     ::string_completion_t callback =
-        [] (int rc_in, ptr<const char> name_in, ptr<const void> prom_in)
+        [] (int rc_in, ptr<const char> name_in, ptr<const void> req_in)
         {
-            std::unique_ptr<promise<create_result>> prom((ptr<promise<create_result>>) prom_in);
+            auto req = pending_request<create_result>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
-            if (rc == error_code::ok)
-                prom->set_value(create_result(std::string(name_in)));
-            else
-                prom->set_exception(get_exception_ptr_of(rc));
-        };
-
-        return with_str(path, [&] (ptr<const char> path) noexcept
-        {
-            auto ppromise = std::make_unique<promise<create_result>>();
-            auto fut      = ppromise->get_future();
-            auto rc       = with_acl(rules, [&] (ptr<const ACL_vector> rules) noexcept
-            {
-                return error_code_from_raw(::zoo_acreate(_handle,
-                                                         path,
-                                                         data.data(),
-                                                         int(data.size()),
-                                                         rules,
-                                                         static_cast<int>(mode),
-                                                         callback,
-                                                         ppromise.get()
-                                                        )
-                                          );
-            });
-
             if (rc == error_code::ok)
             {
-                ppromise.release();
-                return fut;
+                std::string name(name_in);
+                auto        sz = name.size();
+                req->deliver(sz, nullopt, create_result(std::move(name)));
             }
             else
             {
-                ppromise->set_exception(get_exception_ptr_of(rc));
-                return fut;
+                req->deliver_error(rc);
             }
-        });
+        };
+
+    auto req = std::make_shared<pending_request<create_result>>(*this, request_type::create, path, data.size());
+    if (_session_recovery == session_recovery::ephemerals
+       && is_set(mode, create_mode::ephemeral)
+       && !is_set(mode, create_mode::sequential)
+       )
+    {
+        req->on_success([this, path = std::string(path), entry = owned_ephemeral{ data, rules, mode }] () mutable
+                        {
+                            track_ephemeral(std::move(path), std::move(entry));
+                        }
+                       );
+    }
+
+    return dispatch(std::move(req),
+                    options,
+                    [this, callback] (ptr<const void>   req,
+                                      path_view         path,
+                                      const buffer&     data,
+                                      const acl&        rules,
+                                      create_mode       mode
+                                     )
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return with_acl(rules, [&] (ptr<const ACL_vector> rules) noexcept
+                            {
+                                return ::zoo_acreate(_handle,
+                                                     path_str,
+                                                     data.data(),
+                                                     int(data.size()),
+                                                     rules,
+                                                     static_cast<int>(mode),
+                                                     callback,
+                                                     req
+                                                    );
+                            });
+                        });
+                    },
+                    path,
+                    data,
+                    rules,
+                    mode
+                   );
 }
 
-future<set_result> connection_zk::set(string_view path, const buffer& data, version check)
+future<set_result> connection_zk::set(path_view              path,
+                                      const buffer&          data,
+                                      version                check,
+                                      const request_options& options
+                                     )
 {
     ::stat_completion_t callback =
-        [] (int rc_in, ptr<const struct Stat> stat_raw, ptr<const void> prom_in)
+        [] (int rc_in, ptr<const struct Stat> stat_raw, ptr<const void> req_in)
         {
-            std::unique_ptr<promise<set_result>> prom((ptr<promise<set_result>>) prom_in);
+            auto req = pending_request<set_result>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
             if (rc == error_code::ok)
-                prom->set_value(set_result(stat_from_raw(*stat_raw)));
+            {
+                auto st = stat_from_raw(*stat_raw);
+                req->deliver(0U, st.modified_transaction, set_result(st));
+            }
             else
-                prom->set_exception(get_exception_ptr_of(rc));
+            {
+                req->deliver_error(rc);
+            }
         };
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
-    {
-        auto ppromise = std::make_unique<promise<set_result>>();
-        auto fut      = ppromise->get_future();
-        auto rc       = error_code_from_raw(::zoo_aset(_handle,
-                                                       path,
-                                                       data.data(),
-                                                       int(data.size()),
-                                                       check.value,
-                                                       callback,
-                                                       ppromise.get()
-                                                      ));
-
-        if (rc == error_code::ok)
-        {
-            ppromise.release();
-            return fut;
-        }
-        else
-        {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
-        }
-    });
+    return dispatch(std::make_shared<pending_request<set_result>>(*this, request_type::set, path, data.size()),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path, const buffer& data, version check)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_aset(_handle,
+                                              path_str,
+                                              data.data(),
+                                              int(data.size()),
+                                              check.value,
+                                              callback,
+                                              req
+                                             );
+                        });
+                    },
+                    path,
+                    data,
+                    check
+                   );
 }
 
-future<void> connection_zk::erase(string_view path, version check)
+future<void> connection_zk::erase(path_view path, version check, const request_options& options)
 {
     ::void_completion_t callback =
-        [] (int rc_in, ptr<const void> prom_in)
+        [] (int rc_in, ptr<const void> req_in)
         {
-            std::unique_ptr<promise<void>> prom((ptr<promise<void>>) prom_in);
+            auto req = pending_request<void>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
             if (rc == error_code::ok)
-                prom->set_value();
+                req->deliver(0U, nullopt);
             else
-                prom->set_exception(get_exception_ptr_of(rc));
+                req->deliver_error(rc);
         };
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
-    {
-        auto ppromise = std::make_unique<promise<void>>();
-        auto fut      = ppromise->get_future();
-        auto rc       = error_code_from_raw(::zoo_adelete(_handle, path, check.value, callback, ppromise.get()));
-        if (rc == error_code::ok)
-        {
-            ppromise.release();
-            return fut;
-        }
-        else
-        {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
-        }
-    });
+    auto req = std::make_shared<pending_request<void>>(*this, request_type::erase, path);
+    if (_session_recovery == session_recovery::ephemerals)
+        req->on_success([this, path = std::string(path)] { forget_ephemeral(path); });
+
+    return dispatch(std::move(req),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path, version check)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_adelete(_handle, path_str, check.value, callback, req);
+                        });
+                    },
+                    path,
+                    check
+                   );
 }
 
-future<get_acl_result> connection_zk::get_acl(string_view path) const
+future<get_acl_result> connection_zk::get_acl(path_view path, const request_options& options) const
 {
     ::acl_completion_t callback =
-        [] (int rc_in, ptr<struct ACL_vector> acl_raw, ptr<struct Stat> stat_raw, ptr<const void> prom_in) noexcept
+        [] (int rc_in, ptr<struct ACL_vector> acl_raw, ptr<struct Stat> stat_raw, ptr<const void> req_in) noexcept
         {
-            std::unique_ptr<promise<get_acl_result>> prom((ptr<promise<get_acl_result>>) prom_in);
+            auto req = pending_request<get_acl_result>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
             if (rc == error_code::ok)
-                prom->set_value(get_acl_result(acl_from_raw(*acl_raw), stat_from_raw(*stat_raw)));
+            {
+                auto st = stat_from_raw(*stat_raw);
+                req->deliver(0U, st.modified_transaction, get_acl_result(acl_from_raw(*acl_raw), st));
+            }
             else
-                prom->set_exception(get_exception_ptr_of(rc));
+            {
+                req->deliver_error(rc);
+            }
         };
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
-    {
-        auto ppromise = std::make_unique<promise<get_acl_result>>();
-        auto fut      = ppromise->get_future();
-        auto rc       = error_code_from_raw(::zoo_aget_acl(_handle, path, callback, ppromise.get()));
-        if (rc == error_code::ok)
-        {
-            ppromise.release();
-            return fut;
-        }
-        else
-        {
-            ppromise->set_exception(get_exception_ptr_of(rc));
-            return fut;
-        }
-    });
+    return dispatch(std::make_shared<pending_request<get_acl_result>>(*this, request_type::get_acl, path),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return ::zoo_aget_acl(_handle, path_str, callback, req);
+                        });
+                    },
+                    path
+                   );
 }
 
-future<void> connection_zk::set_acl(string_view path, const acl& rules, acl_version check)
+future<void> connection_zk::set_acl(path_view              path,
+                                    const acl&             rules,
+                                    acl_version            check,
+                                    const request_options& options
+                                   )
 {
     ::void_completion_t callback =
-        [] (int rc_in, ptr<const void> prom_in)
+        [] (int rc_in, ptr<const void> req_in)
         {
-            std::unique_ptr<promise<void>> prom((ptr<promise<void>>) prom_in);
+            auto req = pending_request<void>::reclaim(req_in);
             auto rc = error_code_from_raw(rc_in);
             if (rc == error_code::ok)
-                prom->set_value();
+                req->deliver(0U, nullopt);
             else
-                prom->set_exception(get_exception_ptr_of(rc));
+                req->deliver_error(rc);
         };
 
-    return with_str(path, [&] (ptr<const char> path) noexcept
+    return dispatch(std::make_shared<pending_request<void>>(*this, request_type::set_acl, path),
+                    options,
+                    [this, callback] (ptr<const void> req, path_view path, const acl& rules, acl_version check)
+                    {
+                        return with_str(path, [&] (ptr<const char> path_str) noexcept
+                        {
+                            return with_acl(rules, [&] (ptr<struct ACL_vector> rules) noexcept
+                            {
+                                return ::zoo_aset_acl(_handle, path_str, check.value, rules, callback, req);
+                            });
+                        });
+                    },
+                    path,
+                    rules,
+                    check
+                   );
+}
+
+static string_view first_path_of(const multi_op& txn)
+{
+    if (txn.size() == 0U)
+        return string_view();
+
+    const auto& first = txn[0];
+    switch (first.type())
     {
-        return with_acl(rules, [&] (ptr<struct ACL_vector> rules) noexcept
-        {
-            auto ppromise = std::make_unique<promise<void>>();
-            auto fut      = ppromise->get_future();
-            auto rc       = error_code_from_raw(::zoo_aset_acl(_handle,
-                                                               path,
-                                                               check.value,
-                                                               rules,
-                                                               callback,
-                                                               ppromise.get()
-                                                              )
-                                               );
-            if (rc == error_code::ok)
-            {
-                ppromise.release();
-                return fut;
-            }
-            else
-            {
-                ppromise->set_exception(get_exception_ptr_of(rc));
-                return fut;
-            }
-        });
-    });
+    case op_type::check:  return first.as_check().path;
+    case op_type::create: return first.as_create().path;
+    case op_type::erase:  return first.as_erase().path;
+    case op_type::set:    return first.as_set().path;
+    default:              return string_view();
+    }
 }
 
-struct connection_zk_commit_completer
+static std::size_t payload_size_of(const multi_op& txn)
 {
-    multi_op                                 source_txn;
-    promise<multi_result>                    prom;
-    std::vector<zoo_op_result_t>             raw_results;
-    std::map<std::size_t, Stat>              raw_stats;
-    std::map<std::size_t, std::vector<char>> path_buffers;
+    std::size_t out = 0U;
+    for (const auto& tx : txn)
+    {
+        if (tx.type() == op_type::create)
+            out += tx.as_create().data.size();
+        else if (tx.type() == op_type::set)
+            out += tx.as_set().data.size();
+    }
+    return out;
+}
 
-    explicit connection_zk_commit_completer(multi_op&& src) :
+class connection_zk::commit_completer final :
+        public connection_zk::pending_request<multi_result>
+{
+public:
+    explicit commit_completer(const connection_zk& conn, multi_op&& src) :
+            pending_request<multi_result>(conn, request_type::commit, first_path_of(src), payload_size_of(src)),
             source_txn(std::move(src)),
             raw_results(source_txn.size())
     {
@@ -807,26 +1925,75 @@ struct connection_zk_commit_completer
             x.err = -42;
     }
 
-    ptr<Stat> raw_stat_at(std::size_t idx)
+    /// Check the transaction is valid and allocate the buffers the C client writes results to. Paths are checked here
+    /// so a bad one fails the transaction with its index before anything is sent.
+    ///
+    /// \throws std::invalid_argument if an operation in the transaction has an invalid \ref op_type.
+    /// \throws invalid_arguments if an operation in the transaction has an invalid path.
+    void prepare()
+    {
+        for (std::size_t idx = 0; idx < source_txn.size(); ++idx)
+        {
+            const auto& src_op = source_txn[idx];
+            switch (src_op.type())
+            {
+            case op_type::check:
+                check_path(idx, src_op.as_check().path);
+                break;
+            case op_type::erase:
+                check_path(idx, src_op.as_erase().path);
+                break;
+            case op_type::create:
+            {
+                // If the creation is sequential, append 12 extra characters to store the digits
+                const auto& cdata      = src_op.as_create();
+                bool        sequential = is_set(cdata.mode, create_mode::sequential);
+                if (sequential ? !path::is_valid_sequential_prefix(cdata.path) : !path::is_valid(cdata.path))
+                    detail::throw_invalid_path(idx, cdata.path);
+
+                auto sz = cdata.path.size() + (sequential ? 12 : 1);
+                path_buffers[idx] = std::vector<char>(sz);
+                break;
+            }
+            case op_type::set:
+                check_path(idx, src_op.as_set().path);
+                raw_stats[idx] = Stat();
+                break;
+            default:
+            {
+                using std::to_string;
+                zk::throw_exception(std::invalid_argument("Invalid op_type at index=" + to_string(idx) + ": "
+                                                          + to_string(src_op.type())
+                                                         ));
+            }
+            }
+        }
+    }
+
+    static void check_path(std::size_t idx, const std::string& src)
     {
-        return &raw_stats[idx];
+        if (!path::is_valid(src))
+            detail::throw_invalid_path(idx, src);
     }
 
-    ptr<std::vector<char>> path_buffer_for(std::size_t idx, const std::string& path, create_mode mode)
+    /// A transaction can only be retried if every operation in it can be.
+    bool idempotent(const retry_policy& policy) const
     {
-        // If the creation is sequential, append 12 extra characters to store the digits
-        auto sz = path.size() + (is_set(mode, create_mode::sequential) ? 12 : 1);
-        path_buffers[idx] = std::vector<char>(sz);
-        return &path_buffers[idx];
+        return policy.idempotent(source_txn);
     }
 
-    void deliver(error_code rc)
+    void deliver_raw(error_code rc)
     {
+        // Nothing to decode if the result was already delivered when the deadline passed.
+        if (delivered())
+            return;
+
         try
         {
             if (rc == error_code::ok)
             {
-                multi_result out;
+                multi_result             out;
+                optional<transaction_id> last_transaction;
                 out.reserve(raw_results.size());
                 for (std::size_t idx = 0; idx < source_txn.size(); ++idx)
                 {
@@ -839,6 +2006,7 @@ struct connection_zk_commit_completer
                         break;
                     case op_type::set:
                         out.emplace_back(set_result(stat_from_raw(*raw_res.stat)));
+                        last_transaction = out[idx].as_set().stat().modified_transaction;
                         break;
                     default:
                         out.emplace_back(source_txn[idx].type(), nullptr);
@@ -846,7 +2014,7 @@ struct connection_zk_commit_completer
                     }
                 }
 
-                prom.set_value(std::move(out));
+                deliver(0U, last_transaction, std::move(out));
             }
             else
             {
@@ -859,154 +2027,356 @@ struct connection_zk_commit_completer
         }
         catch (...)
         {
-            prom.set_exception(zk::current_exception());
+            deliver_error(rc == error_code::ok ? error_code::marshalling_error : rc, zk::current_exception());
         }
     }
+
+public:
+    multi_op                                 source_txn;
+    std::vector<zoo_op_result_t>             raw_results;
+    std::map<std::size_t, Stat>              raw_stats;
+    std::map<std::size_t, std::vector<char>> path_buffers;
 };
 
-future<multi_result> connection_zk::commit(multi_op&& txn_in)
+future<multi_result> connection_zk::commit(multi_op&& txn_in, const request_options& options)
 {
     ::void_completion_t callback =
         [] (int rc_in, ptr<const void> completer_in)
         {
-            std::unique_ptr<connection_zk_commit_completer>
-                completer((ptr<connection_zk_commit_completer>) completer_in);
-            completer->deliver(error_code_from_raw(rc_in));
+            auto completer = pending_request<multi_result>::reclaim<commit_completer>(completer_in);
+            completer->deliver_raw(error_code_from_raw(rc_in));
         };
 
-    auto pcompleter = std::make_unique<connection_zk_commit_completer>(std::move(txn_in));
-    auto& txn = pcompleter->source_txn;
+    auto pcompleter = std::make_shared<commit_completer>(*this, std::move(txn_in));
     try
     {
-        ::zoo_op raw_ops[txn.size()];
-        std::size_t create_op_count = 0;
-        std::size_t acl_piece_count = 0;
-        for (const auto& tx : txn)
-        {
-            if (tx.type() == op_type::create)
-            {
-                ++create_op_count;
-                acl_piece_count += tx.as_create().rules.size();
-            }
-        }
-        ACL_vector      encoded_acls[create_op_count];
-        ACL             acl_pieces[acl_piece_count];
-        ptr<ACL_vector> encoded_acl_iter = encoded_acls;
-        ptr<ACL>        acl_piece_iter   = acl_pieces;
+        pcompleter->prepare();
+    }
+    catch (...)
+    {
+        pcompleter->deliver_error(error_code::invalid_arguments, zk::current_exception());
+        return pcompleter->get_future();
+    }
 
-        for (std::size_t idx = 0; idx < txn.size(); ++idx)
+    // The completer owns everything needed to encode the transaction, so there is nothing to copy if it has to wait
+    // for a slot in the request window.
+    return dispatch(std::move(pcompleter),
+                    options,
+                    [this, callback] (ptr<const void> completer_in)
+                    {
+                        auto& completer = *static_cast<ptr<commit_completer>>(const_cast<ptr<void>>(completer_in));
+                        auto& txn       = completer.source_txn;
+
+                        // A retried transaction must not see the results of the previous attempt.
+                        for (zoo_op_result_t& x : completer.raw_results)
+                            x.err = -42;
+
+                        auto       acl_count = detail::acl_count_of(txn);
+                        ::zoo_op   raw_ops[txn.size()];
+                        ACL_vector encoded_acls[acl_count.vectors];
+                        ACL        acl_pieces[acl_count.pieces];
+                        detail::encode_multi(txn,
+                                             raw_ops,
+                                             encoded_acls,
+                                             acl_pieces,
+                                             completer.path_buffers,
+                                             completer.raw_stats
+                                            );
+
+                        return ::zoo_amulti(_handle,
+                                            int(txn.size()),
+                                            raw_ops,
+                                            completer.raw_results.data(),
+                                            callback,
+                                            completer_in
+                                           );
+                    }
+                   );
+}
+
+future<void> connection_zk::load_fence(const request_options& options)
+{
+    ::string_completion_t callback =
+        [] (int rc_in, ptr<const char>, ptr<const void> req_in)
         {
-            auto& raw_op = raw_ops[idx];
-            auto& src_op = txn[idx];
-            switch (src_op.type())
-            {
-                case op_type::check:
-                    zoo_check_op_init(&raw_op, src_op.as_check().path.c_str(), src_op.as_check().check.value);
-                    break;
-                case op_type::create:
-                {
-                    const auto& cdata = src_op.as_create();
-                    encoded_acl_iter->count = int(cdata.rules.size());
-                    encoded_acl_iter->data  = acl_piece_iter;
-                    for (const auto& acl : cdata.rules)
+            auto req = pending_request<void>::reclaim(req_in);
+            auto rc = error_code_from_raw(rc_in);
+            if (rc == error_code::ok)
+                req->deliver(0U, nullopt);
+            else
+                req->deliver_error(rc);
+        };
+
+    return dispatch(std::make_shared<pending_request<void>>(*this, request_type::load_fence, "/"),
+                    options,
+                    [this, callback] (ptr<const void> req)
                     {
-                        *acl_piece_iter = encode_acl_part(acl);
-                        ++acl_piece_iter;
+                        return ::zoo_async(_handle, "/", callback, req);
                     }
+                   );
+}
 
-                    auto path_buf_ref = pcompleter->path_buffer_for(idx, cdata.path, cdata.mode);
-                    zoo_create_op_init(&raw_op,
-                                       cdata.path.c_str(),
-                                       cdata.data.data(),
-                                       int(cdata.data.size()),
-                                       encoded_acl_iter,
-                                       static_cast<int>(cdata.mode),
-                                       path_buf_ref->data(),
-                                       int(path_buf_ref->size())
-                                      );
-                    ++encoded_acl_iter;
-                    break;
-                }
-                case op_type::erase:
-                    zoo_delete_op_init(&raw_op, src_op.as_erase().path.c_str(), src_op.as_erase().check.value);
-                    break;
-                case op_type::set:
-                {
-                    const auto& setting = src_op.as_set();
-                    zoo_set_op_init(&raw_op,
-                                    setting.path.c_str(),
-                                    setting.data.data(),
-                                    int(setting.data.size()),
-                                    setting.check.value,
-                                    pcompleter->raw_stat_at(idx)
-                                   );
-                    break;
-                }
-                default:
-                {
-                    using std::to_string;
-                    zk::throw_exception(std::invalid_argument("Invalid op_type at index=" + to_string(idx) + ": "
-                                                + to_string(src_op.type())
-                                               ));
-                }
-            }
+bool connection_zk::is_stale(ptr<zhandle_t> handle) const
+{
+    std::shared_lock<std::shared_mutex> ax(_handle_protect);
+    return _handle != nullptr && _handle != handle;
+}
+
+void connection_zk::track_ephemeral(std::string path, owned_ephemeral entry) const
+{
+    std::unique_lock<std::mutex> ax(_owned_ephemerals_protect);
+    _owned_ephemerals.insert_or_assign(std::move(path), std::move(entry));
+}
+
+void connection_zk::forget_ephemeral(const std::string& path) const
+{
+    std::unique_lock<std::mutex> ax(_owned_ephemerals_protect);
+    _owned_ephemerals.erase(path);
+}
+
+void connection_zk::start_recovery()
+{
+    std::unique_lock<std::mutex> ax(_recovery_protect);
+    if (_recovery_stopping)
+        return;
+
+    _recovery_requested = true;
+    if (_recovery_running)
+    {
+        _recovery_wakeup.notify_all();
+        return;
+    }
+
+    // A previous recovery has finished, but its thread has not been joined yet. It no longer touches the lock once it
+    // is no longer running, so this does not block for long.
+    if (_recovery.joinable())
+        _recovery.join();
+
+    _recovery_running = true;
+    _recovery = std::thread([this] { run_recovery(); });
+}
+
+void connection_zk::stop_recovery() noexcept
+{
+    std::unique_lock<std::mutex> ax(_recovery_protect);
+    _recovery_stopping = true;
+    _recovery_wakeup.notify_all();
+    ax.unlock();
+
+    if (_recovery.joinable())
+        _recovery.join();
+}
+
+void connection_zk::run_recovery()
+{
+    std::unique_lock<std::mutex> ax(_recovery_protect);
+    std::size_t failures = 0U;
+    while (_recovery_requested && !_recovery_stopping)
+    {
+        _recovery_requested = false;
+        ax.unlock();
+        bool recovered = recover_session();
+        ax.lock();
+
+        if (recovered)
+        {
+            failures = 0U;
         }
-        auto fut = pcompleter->prom.get_future();
-        auto rc = error_code_from_raw(::zoo_amulti(_handle,
-                                                   int(txn.size()),
-                                                   raw_ops,
-                                                   pcompleter->raw_results.data(),
-                                                   callback,
-                                                   pcompleter.get()
-                                                  )
-                                     );
-        if (rc == error_code::ok)
+        else if (++failures >= max_recovery_attempts)
         {
-            pcompleter.release();
-            return fut;
+            // Nothing will ever re-arm the watches, so they have to be told the session is gone
+            ax.unlock();
+            abandon_watches(event(event_type::session, zk::state::expired_session));
+            ax.lock();
+        }
+        else if (!_recovery_stopping)
+        {
+            _recovery_requested = true;
+            _recovery_wakeup.wait_for(ax, std::chrono::seconds(1), [this] { return _recovery_stopping; });
+        }
+    }
+    _recovery_running = false;
+}
+
+void connection_zk::abandon_watches(const event& ev)
+{
+    // Only armed watches can be delivered -- the C client is still using the others, and they are delivered by their
+    // completion.
+    std::unique_lock<std::mutex> ax(_watches_protect);
+    std::vector<std::shared_ptr<watcher>> abandoned;
+    for (auto iter = _watches.begin(); iter != _watches.end(); )
+    {
+        if (iter->second->armed())
+        {
+            abandoned.emplace_back(std::move(iter->second));
+            iter = _watches.erase(iter);
         }
         else
         {
-            pcompleter->prom.set_exception(get_exception_ptr_of(rc));
-            return pcompleter->prom.get_future();
+            ++iter;
         }
     }
-    catch (...)
+    ax.unlock();
+
+    for (const auto& target : abandoned)
+        target->deliver_event(ev);
+}
+
+template <typename TItem, typename FIssue>
+void connection_zk::in_batches(const std::vector<TItem>& items, const FIssue& issue)
+{
+    for (std::size_t first = 0U; first < items.size(); first += _recovery_batch_size)
     {
-        pcompleter->prom.set_exception(zk::current_exception());
-        return pcompleter->prom.get_future();
+        auto last  = std::min(items.size(), first + _recovery_batch_size);
+        auto batch = std::make_shared<recovery_batch>(last - first);
+        for (auto idx = first; idx < last; ++idx)
+            issue(items[idx], batch);
+
+        while (!batch->wait_for(std::chrono::milliseconds(100)))
+        {
+            std::unique_lock<std::mutex> ax(_recovery_protect);
+            if (_recovery_stopping)
+                return;
+        }
     }
 }
 
-future<void> connection_zk::load_fence()
+void connection_zk::finish_rearm(ptr<const void> ctx, error_code rc, optional<event_type> missed) noexcept
 {
-    ::string_completion_t callback =
-        [] (int rc_in, ptr<const char>, ptr<const void> prom_in)
+    std::unique_ptr<recovery_request> req(static_cast<ptr<recovery_request>>(const_cast<ptr<void>>(ctx)));
+    if (rc != error_code::ok || missed)
+    {
+        auto ev = rc == error_code::ok ? event(*missed, zk::state::connected)
+                                       : event(event_type::session, zk::state::expired_session);
+        if (auto target = req->conn->try_extract_watch(req->target.get()))
+            target->deliver_event(std::move(ev));
+    }
+    req->batch->complete();
+}
+
+bool connection_zk::recover_session()
+{
+    auto handle = ::zookeeper_init(_conn_string.c_str(),
+                                   on_session_event_raw,
+                                   static_cast<int>(_session_timeout.count()),
+                                   nullptr,
+                                   this,
+                                   0
+                                  );
+    if (!handle)
+        return false;
+
+    std::unique_lock<std::shared_mutex> handle_ax(_handle_protect);
+    auto expired = std::exchange(_handle, handle);
+    handle_ax.unlock();
+
+    // Requests still outstanding on the expired session are delivered with closed. Its watches are not -- they are
+    // still tracked and re-armed below.
+    ::zookeeper_close(expired);
+
+    // The new session might have connected before its handle was installed, in which case the event was dropped as
+    // stale. Poll the state instead of relying on it. A session which can not be established within the session
+    // timeout counts as a failed attempt.
+    auto give_up_at = std::chrono::steady_clock::now() + _session_timeout;
+    std::unique_lock<std::mutex> ax(_recovery_protect);
+    zk::state st;
+    while (true)
+    {
+        // close() takes care of the new handle and the watches.
+        if (_recovery_stopping)
+            return true;
+
+        st = state_from_raw(::zoo_state(handle));
+        if (st == zk::state::connected || st == zk::state::read_only)
         {
-            std::unique_ptr<promise<void>> prom((ptr<promise<void>>) prom_in);
-            auto rc = error_code_from_raw(rc_in);
-            if (rc == error_code::ok)
-                prom->set_value();
-            else
-                prom->set_exception(get_exception_ptr_of(rc));
-        };
+            break;
+        }
+        else if (st == zk::state::expired_session || std::chrono::steady_clock::now() >= give_up_at)
+        {
+            return false;
+        }
+        else if (st == zk::state::authentication_failed)
+        {
+            // Trying again will not help
+            ax.unlock();
+            abandon_watches(event(event_type::session, st));
+            return true;
+        }
+
+        _recovery_wakeup.wait_for(ax, std::chrono::milliseconds(100));
+    }
+    ax.unlock();
+    on_session_event(st);
 
-    auto ppromise = std::make_unique<zk::promise<void>>();
-    auto rc = error_code_from_raw(::zoo_async(_handle, "/", callback, ppromise.get()));
-    if (rc == error_code::ok)
+    // Ephemerals go first, so a watch on one of them sees it was created again instead of missing it.
+    if (_session_recovery == session_recovery::ephemerals)
     {
-        auto f = ppromise->get_future();
-        ppromise.release();
-        return f;
+        std::unique_lock<std::mutex> ephemerals_ax(_owned_ephemerals_protect);
+        std::vector<std::pair<std::string, owned_ephemeral>> ephemerals(_owned_ephemerals.begin(),
+                                                                        _owned_ephemerals.end()
+                                                                       );
+        ephemerals_ax.unlock();
+
+        in_batches(ephemerals, [this] (const auto& entry, const std::shared_ptr<recovery_batch>& batch)
+        {
+            ::string_completion_t callback =
+                [] (int rc_in, ptr<const char>, ptr<const void> ctx)
+                {
+                    auto raw_req = static_cast<ptr<recovery_request>>(const_cast<ptr<void>>(ctx));
+                    std::unique_ptr<recovery_request> req(raw_req);
+                    // Someone else created the entry while there was no session, so this connection no longer owns it.
+                    if (error_code_from_raw(rc_in) == error_code::entry_exists)
+                        req->conn->forget_ephemeral(req->path);
+                    req->batch->complete();
+                };
+
+            auto req = std::make_unique<recovery_request>(recovery_request{ this, nullptr, entry.first, batch });
+            auto rc  = with_acl(entry.second.rules, [&] (ptr<ACL_vector> rules) noexcept
+                       {
+                           std::shared_lock<std::shared_mutex> handle_ax(_handle_protect);
+                           return ::zoo_acreate(_handle,
+                                                req->path.c_str(),
+                                                entry.second.data.data(),
+                                                int(entry.second.data.size()),
+                                                rules,
+                                                static_cast<int>(entry.second.mode),
+                                                callback,
+                                                req.get()
+                                               );
+                       });
+            if (rc == ZOK)
+                req.release();
+            else
+                batch->complete();
+        });
     }
-    else
+
+    std::unique_lock<std::mutex> watches_ax(_watches_protect);
+    std::vector<std::shared_ptr<watcher>> watches;
+    watches.reserve(_watches.size());
+    for (const auto& pair : _watches)
     {
-        ppromise->set_exception(get_exception_ptr_of(rc));
-        return ppromise->get_future();
+        if (pair.second->armed())
+            watches.emplace_back(pair.second);
     }
+    watches_ax.unlock();
+
+    in_batches(watches, [this] (const std::shared_ptr<watcher>& target, const std::shared_ptr<recovery_batch>& batch)
+    {
+        auto req = std::make_unique<recovery_request>(recovery_request{ this, target, std::string(), batch });
+        std::shared_lock<std::shared_mutex> handle_ax(_handle_protect);
+        auto rc = target->rearm(_handle, req.get());
+        handle_ax.unlock();
+        if (rc == ZOK)
+            req.release();
+        else
+            finish_rearm(req.release(), error_code_from_raw(rc), nullopt);
+    });
+
+    return true;
 }
 
-void connection_zk::on_session_event_raw(ptr<zhandle_t>  handle      [[gnu::unused]],
+void connection_zk::on_session_event_raw(ptr<zhandle_t>  handle,
                                          int             ev_type,
                                          int             state,
                                          ptr<const char> path_ptr,
@@ -1014,10 +2384,6 @@ void connection_zk::on_session_event_raw(ptr<zhandle_t>  handle      [[gnu::unus
                                         ) noexcept
 {
     auto self = static_cast<ptr<connection_zk>>(watcher_ctx);
-    // Most of the time, self's _handle will be the same thing that ZK provides to us. However, if we connect very
-    // quickly, a session event will happen trigger *before* we set the _handle. This isn't a problem, just something to
-    // be aware of.
-    assert(self->_handle == nullptr || self->_handle == handle);
     auto ev = event_from_raw(ev_type);
     auto st = state_from_raw(state);
     auto path = string_view(path_ptr);
@@ -1028,6 +2394,27 @@ void connection_zk::on_session_event_raw(ptr<zhandle_t>  handle      [[gnu::unus
         std::cerr << "WARNING: Got unexpected event " << ev << " in state=" << st << " with path=" << path << std::endl;
         return;
     }
+
+    if (self->_session_recovery != session_recovery::none)
+    {
+        // A recovery waiting for its new session to connect polls the state, as the handle is not installed yet.
+        std::unique_lock<std::mutex> ax(self->_recovery_protect);
+        self->_recovery_wakeup.notify_all();
+        ax.unlock();
+
+        if (self->is_stale(handle))
+            return;
+
+        if (st == zk::state::expired_session)
+            self->start_recovery();
+    }
+    else
+    {
+        // Most of the time, self's _handle will be the same thing that ZK provides to us. However, if we connect very
+        // quickly, a session event will happen trigger *before* we set the _handle. This isn't a problem, just
+        // something to be aware of.
+        assert(self->_handle == nullptr || self->_handle == handle);
+    }
     self->on_session_event(st);
 }
 
@@ -2,13 +2,25 @@
 
 #include <zk/config.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include "acl.hpp"
+#include "buffer.hpp"
 #include "connection.hpp"
 #include "string_view.hpp"
+#include "types.hpp"
 
 typedef struct _zhandle zhandle_t;
 
@@ -30,35 +42,56 @@ public:
 
     virtual zk::state state() const override;
 
-    virtual future<get_result> get(string_view path) override;
+    virtual future<get_result> get(path_view path, const request_options& options) override;
 
-    virtual future<watch_result> watch(string_view path) override;
+    virtual future<watch_result> watch(path_view path, const request_options& options) override;
 
-    virtual future<get_children_result> get_children(string_view path) override;
+    virtual void listen(path_view                       path,
+                        const request_options&          options,
+                        std::shared_ptr<watch_listener> listener
+                       ) override;
 
-    virtual future<watch_children_result> watch_children(string_view path) override;
+    virtual future<get_children_result> get_children(path_view path, const request_options& options) override;
 
-    virtual future<exists_result> exists(string_view path) override;
+    virtual future<watch_children_result> watch_children(path_view path, const request_options& options) override;
 
-    virtual future<watch_exists_result> watch_exists(string_view path) override;
+    virtual void listen_children(path_view                                path,
+                                 const request_options&                   options,
+                                 std::shared_ptr<watch_children_listener> listener
+                                ) override;
 
-    virtual future<create_result> create(string_view   path,
-                                         const buffer& data,
-                                         const acl&    rules,
-                                         create_mode   mode
+    virtual future<exists_result> exists(path_view path, const request_options& options) override;
+
+    virtual future<watch_exists_result> watch_exists(path_view path, const request_options& options) override;
+
+    virtual future<create_result> create(path_view              path,
+                                         const buffer&          data,
+                                         const acl&             rules,
+                                         create_mode            mode,
+                                         const request_options& options
                                         ) override;
 
-    virtual future<set_result> set(string_view path, const buffer& data, version check) override;
+    virtual future<set_result> set(path_view              path,
+                                   const buffer&          data,
+                                   version                check,
+                                   const request_options& options
+                                  ) override;
+
+    virtual future<void> erase(path_view path, version check, const request_options& options) override;
 
-    virtual future<void> erase(string_view path, version check) override;
+    virtual future<get_acl_result> get_acl(path_view path, const request_options& options) const override;
 
-    virtual future<get_acl_result> get_acl(string_view path) const override;
+    virtual future<void> set_acl(path_view              path,
+                                 const acl&             rules,
+                                 acl_version            check,
+                                 const request_options& options
+                                ) override;
 
-    virtual future<void> set_acl(string_view path, const acl& rules, acl_version check) override;
+    virtual future<multi_result> commit(multi_op&& txn, const request_options& options) override;
 
-    virtual future<multi_result> commit(multi_op&& txn) override;
+    virtual future<void> load_fence(const request_options& options) override;
 
-    virtual future<void> load_fence() override;
+    virtual request_window_stats window_stats() const override;
 
 private:
     static void on_session_event_raw(ptr<zhandle_t>  handle,
@@ -81,18 +114,161 @@ private:
 
     class exists_watcher;
 
+    template <typename TResult>
+    class pending_request;
+
+    class data_request;
+
+    class commit_completer;
+
+    class window_slot;
+
+    class retry_state;
+
+    class timer_queue;
+
+    class recovery_batch;
+
+    struct recovery_request;
+
+    /** An ephemeral entry created by this connection, which is created again when the session is recovered. **/
+    struct owned_ephemeral
+    {
+        buffer      data;
+        acl         rules;
+        create_mode mode;
+    };
+
+    /** A request which could not be sent because the request window was full. **/
+    struct queued_request
+    {
+        std::function<void ()>           submit;
+        std::function<void (error_code)> cancel;
+    };
+
+    /** Issue \a req. If the request has not completed by the \ref request_options::deadline, it is delivered with
+     *  \ref error_code::operation_timeout. If the request can be retried under the \ref request_options::retry policy,
+     *  owning copies of \a args are kept so the request can be sent through \ref admit again after a transient failure.
+     *
+     *  \param req The request state -- either a \ref pending_request or a watcher.
+     *  \returns the future for the result of \a req.
+    **/
+    template <typename TRequest, typename FSubmit, typename... TArgs>
+    auto dispatch(std::shared_ptr<TRequest> req,
+                  const request_options&    options,
+                  FSubmit&&                 submit,
+                  TArgs&&...                args
+                 ) const;
+
+    /** Issue the \c watch request for \a watcher, which either delivers to its future or to a listener. **/
+    future<watch_result> dispatch_data(std::shared_ptr<data_watcher> watcher,
+                                       path_view                     path,
+                                       const request_options&        options
+                                      );
+
+    /** Issue the \c watch_children request for \a watcher, which either delivers to its future or to a listener. **/
+    future<watch_children_result> dispatch_children(std::shared_ptr<child_watcher> watcher,
+                                                     path_view                      path,
+                                                     const request_options&         options
+                                                    );
+
+    /** Send \a req through the request window. If there is a free slot, this calls \a submit with the completion context
+     *  and \a args immediately; otherwise, the request is either rejected or queued (with owning copies of \a args)
+     *  according to the configured \ref backpressure.
+    **/
+    template <typename TRequest, typename FSubmit, typename... TArgs>
+    void admit(std::shared_ptr<TRequest> req, FSubmit&& submit, TArgs&&... args) const;
+
+    /** Hand \a req, which already holds a slot in the request window, to the C client. If \a submit succeeds, a
+     *  reference to \a req is held by the completion callback (or the watch table); otherwise, the failure is
+     *  delivered immediately.
+    **/
+    template <typename TRequest, typename FSubmit, typename... TArgs>
+    void submit_request(std::shared_ptr<TRequest> req, FSubmit& submit, TArgs&... args) const;
+
+    /** Give back a slot in the request window, sending queued requests if there are any. **/
+    void release_slot() const noexcept;
+
     /** Erase the watch tracker for the watch with the value \a p.
      *
      *  \returns \c true if it was deleted (the watch should be delivered); \c false if \a p was not in the list.
     **/
-    std::shared_ptr<watcher> try_extract_watch(ptr<const void> p);
+    std::shared_ptr<watcher> try_extract_watch(ptr<const void> p) const;
 
     static void deliver_watch(ptr<zhandle_t> zh, int type_in, int state_in, ptr<const char>, ptr<void> proms_in);
 
+    /** Is \a handle an old handle replaced by session recovery (or a new one not yet installed)? **/
+    bool is_stale(ptr<zhandle_t> handle) const;
+
+    /** Start recovering the session in the background (if it is not already being recovered). **/
+    void start_recovery();
+
+    /** Stop the background recovery and wait for it to finish. **/
+    void stop_recovery() noexcept;
+
+    /** The number of failed attempts in a row after which recovery gives up and delivers the outstanding watches with a
+     *  session event.
+    **/
+    static constexpr std::size_t max_recovery_attempts = 5U;
+
+    /** The body of the background recovery thread. **/
+    void run_recovery();
+
+    /** Replace the expired session with a new one, then restore owned ephemerals and watches on it. An attempt fails if
+     *  the new session expires or is not established within the session timeout.
+     *
+     *  \returns \c true if the session was recovered (or recovery is over); \c false if the attempt failed.
+    **/
+    bool recover_session();
+
+    /** Deliver \a ev to every armed watch. This is used when the session is gone for good. **/
+    void abandon_watches(const event& ev);
+
+    /** Call \a issue with each item of \a items, at most \ref connection_params::recovery_batch_size at a time. Each
+     *  call must arrange for \c recovery_batch::complete to be called when the issued request completes.
+    **/
+    template <typename TItem, typename FIssue>
+    void in_batches(const std::vector<TItem>& items, const FIssue& issue);
+
+    /** Finish re-arming a watch. If \a rc is not \c ok, the watch could not be re-armed and is delivered with a
+     *  session event; if \a missed is set, the watched entry changed while there was no session, so the watch is
+     *  delivered with that event.
+    **/
+    static void finish_rearm(ptr<const void> ctx, error_code rc, optional<event_type> missed) noexcept;
+
+    void track_ephemeral(std::string path, owned_ephemeral entry) const;
+
+    void forget_ephemeral(const std::string& path) const;
+
 private:
-    ptr<zhandle_t>                                                _handle;
-    std::unordered_map<ptr<const void>, std::shared_ptr<watcher>> _watches;
-    mutable std::mutex                                            _watches_protect;
+    ptr<zhandle_t>                                                        _handle;
+    mutable std::unordered_map<ptr<const void>, std::shared_ptr<watcher>> _watches;
+    mutable std::mutex                                                    _watches_protect;
+
+    std::size_t                                                           _max_in_flight;
+    zk::backpressure                                                      _backpressure;
+    mutable std::atomic<std::size_t>                                      _in_flight;
+    mutable std::atomic<std::size_t>                                      _rejected;
+    mutable std::deque<queued_request>                                    _queued;
+    mutable bool                                                          _draining;
+    mutable bool                                                          _closing;
+    mutable std::mutex                                                    _window_protect;
+
+    std::unique_ptr<timer_queue>                                          _timers;
+
+    std::string                                                           _conn_string;
+    std::chrono::milliseconds                                             _session_timeout;
+    zk::session_recovery                                                  _session_recovery;
+    std::size_t                                                           _recovery_batch_size;
+    mutable std::shared_mutex                                             _handle_protect;
+    mutable std::map<std::string, owned_ephemeral>                        _owned_ephemerals;
+    mutable std::mutex                                                    _owned_ephemerals_protect;
+    std::thread                                                           _recovery;
+    bool                                                                  _recovery_running;
+    bool                                                                  _recovery_requested;
+    bool                                                                  _recovery_stopping;
+    std::mutex                                                            _recovery_protect;
+    std::condition_variable                                               _recovery_wakeup;
 };
 
 /// \}
@@ -0,0 +1,246 @@
+#include "children_diff.hpp"
+
+#include <zk/connection.hpp>
+#include <zk/error.hpp>
+
+#include <exception>
+#include <utility>
+
+namespace zk::detail
+{
+
+/** Passes the progress of each watch on to the state. While the children are being fetched, it keeps the state alive
+ *  so the result is not lost; once the watch is left, it only refers to the state weakly, so dropping the
+ *  \ref watch_children_diff_result drops the state even though the connection keeps the listener until the watch is
+ *  triggered.
+**/
+class children_diff_state::listener final :
+        public watch_children_listener
+{
+public:
+    explicit listener(std::shared_ptr<children_diff_state> state) :
+            _state(state),
+            _fetching(std::move(state))
+    { }
+
+    virtual void on_children(get_children_result result) override
+    {
+        auto state = std::move(_fetching);
+        state->on_children(std::move(result));
+    }
+
+    virtual void on_error(zk::exception_ptr ex) override
+    {
+        auto state = std::move(_fetching);
+        state->on_error(std::move(ex));
+    }
+
+    virtual void on_event(event) override
+    {
+        if (auto state = _state.lock())
+            state->on_event();
+    }
+
+private:
+    std::weak_ptr<children_diff_state>   _state;
+    std::shared_ptr<children_diff_state> _fetching;
+};
+
+future<watch_children_diff_result> children_diff_state::start(client conn, std::string path)
+{
+    auto state = std::make_shared<children_diff_state>(std::move(conn), std::move(path));
+    auto fut   = state->_starting.emplace().get_future();
+    state->_fetching = true;
+    state->fetch();
+    return fut;
+}
+
+children_diff_state::children_diff_state(client conn, std::string path) :
+        _conn(std::move(conn)),
+        _path(std::move(path)),
+        _fetching(false),
+        _triggered(false),
+        _generation(0U),
+        _parent_stat(),
+        _erased(false)
+{ }
+
+future<children_diff> children_diff_state::next()
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    if (_erased)
+    {
+        promise<children_diff> erased;
+        erased.set_exception(get_exception_ptr_of(error_code::no_entry));
+        return erased.get_future();
+    }
+
+    auto fut = _waiting.emplace_back().get_future();
+
+    // The watch was triggered while nobody was waiting -- the change can be fetched now
+    bool fetch_now = _triggered && !_fetching;
+    if (fetch_now)
+    {
+        _triggered = false;
+        _fetching  = true;
+    }
+    ax.unlock();
+
+    if (fetch_now)
+        fetch();
+    return fut;
+}
+
+void children_diff_state::fetch()
+{
+    try
+    {
+        _conn.listen_children(_path, std::make_shared<listener>(shared_from_this()));
+    }
+    catch (...)
+    {
+        on_error(zk::current_exception());
+    }
+}
+
+void children_diff_state::on_children(get_children_result result)
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    _fetching = false;
+    auto diff = apply(result);
+
+    if (_starting)
+    {
+        auto starting = std::move(*_starting);
+        _starting.reset();
+        ax.unlock();
+        starting.set_value(watch_children_diff_result(std::move(result), shared_from_this()));
+        return;
+    }
+
+    // A fetch is only started for a waiting caller, and only a fetch takes callers off the queue
+    auto waiting = std::move(_waiting.front());
+    _waiting.pop_front();
+    ax.unlock();
+    waiting.set_value(std::move(diff));
+}
+
+void children_diff_state::on_error(zk::exception_ptr ex)
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    _fetching = false;
+
+    if (_starting)
+    {
+        auto starting = std::move(*_starting);
+        _starting.reset();
+        ax.unlock();
+        starting.set_exception(std::move(ex));
+        return;
+    }
+
+    auto waiting = std::move(_waiting.front());
+    _waiting.pop_front();
+
+    bool erased = false;
+    try
+    {
+        std::rethrow_exception(ex);
+    }
+    catch (const no_entry&)
+    {
+        erased = true;
+    }
+    catch (...)
+    { }
+
+    if (erased)
+    {
+        // Everything is gone with the parent: the first caller gets the removal of the remaining children, everyone
+        // after it is told the entry is gone
+        _erased    = true;
+        auto diff  = erase_all();
+        auto after = std::move(_waiting);
+        _waiting.clear();
+        ax.unlock();
+
+        waiting.set_value(std::move(diff));
+        for (auto& p : after)
+            p.set_exception(get_exception_ptr_of(error_code::no_entry));
+        return;
+    }
+
+    // There is no watch left, so the next caller has to fetch the list right away -- if someone is already waiting,
+    // that is now
+    bool fetch_now = !_waiting.empty();
+    if (fetch_now)
+        _fetching = true;
+    else
+        _triggered = true;
+    ax.unlock();
+
+    waiting.set_exception(std::move(ex));
+    if (fetch_now)
+        fetch();
+}
+
+void children_diff_state::on_event()
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    bool fetch_now = !_waiting.empty() && !_fetching;
+    if (fetch_now)
+        _fetching = true;
+    else
+        _triggered = true;
+    ax.unlock();
+
+    if (fetch_now)
+        fetch();
+}
+
+children_diff children_diff_state::apply(const get_children_result& children)
+{
+    auto generation = ++_generation;
+
+    children_diff::children_list_type added;
+    for (const auto& name : children.children())
+    {
+        auto [iter, inserted] = _known.try_emplace(name, generation);
+        if (inserted)
+            added.emplace_back(name);
+        else
+            iter->second = generation;
+    }
+
+    children_diff::children_list_type removed;
+    if (_known.size() != children.children().size())
+    {
+        for (auto iter = _known.begin(); iter != _known.end(); )
+        {
+            if (iter->second != generation)
+            {
+                removed.emplace_back(iter->first);
+                iter = _known.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
+
+    _parent_stat = children.parent_stat();
+    return children_diff(std::move(added), std::move(removed), _parent_stat);
+}
+
+children_diff children_diff_state::erase_all()
+{
+    children_diff::children_list_type removed;
+    removed.reserve(_known.size());
+    for (auto& entry : _known)
+        removed.emplace_back(entry.first);
+    _known.clear();
+    return children_diff({}, std::move(removed), _parent_stat);
+}
+
+}
@@ -0,0 +1,82 @@
+/** \file
+ *  The state shared between the calls to \ref zk::watch_children_diff_result::next.
+**/
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <zk/client.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/future.hpp>
+#include <zk/optional.hpp>
+#include <zk/results.hpp>
+
+namespace zk::detail
+{
+
+/** Keeps the last list of children fetched by a \ref client::watch_children_diff and the watch for the next change.
+ *  Each name maps to the generation of the list it was last seen in: when a new list arrives, each name in it is
+ *  looked up once and stamped with the new generation, so names which did not change are never copied, and the names
+ *  left with an older generation are the ones which were removed.
+ *
+ *  Nothing ever waits on the server: the watch is issued through \ref connection::listen_children, so the list is
+ *  fetched again as soon as the watch is triggered and the difference is delivered to the oldest caller of \ref next
+ *  as soon as the list arrives. If nobody is waiting when the watch is triggered, the fetch is put off until the next
+ *  call to \ref next.
+**/
+class children_diff_state final :
+        public std::enable_shared_from_this<children_diff_state>
+{
+public:
+    /** Fetch the children of \a path and leave the watch for the next change. **/
+    static future<watch_children_diff_result> start(client conn, std::string path);
+
+    explicit children_diff_state(client conn, std::string path);
+
+    /** Get a future for the change after the one delivered to the previous call. **/
+    future<children_diff> next();
+
+private:
+    class listener;
+
+    /** Issue the fetch of the children, leaving a new watch. This must be called without holding \c _protect, as a
+     *  request which fails right away is delivered from inside the call.
+    **/
+    void fetch();
+
+    void on_children(get_children_result result);
+
+    void on_error(zk::exception_ptr ex);
+
+    void on_event();
+
+    /** Stamp each of \a children with a new generation, returning the ones which were not known before and removing
+     *  the ones which are not in \a children.
+    **/
+    children_diff apply(const get_children_result& children);
+
+    /** The parent is gone, so every known child is removed with it. **/
+    children_diff erase_all();
+
+private:
+    client                                         _conn;
+    std::string                                    _path;
+    std::mutex                                     _protect;
+    optional<promise<watch_children_diff_result>>  _starting;
+    std::deque<promise<children_diff>>             _waiting;
+    bool                                           _fetching;
+    bool                                           _triggered;
+    std::unordered_map<std::string, std::uint64_t> _known;
+    std::uint64_t                                  _generation;
+    stat                                           _parent_stat;
+    bool                                           _erased;
+};
+
+}
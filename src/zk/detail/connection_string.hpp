@@ -0,0 +1,176 @@
+/** \file
+ *  The grammar of \ref ConnectionStrings "connection strings", written as \c constexpr functions over views so a
+ *  connection string can be checked at compile time (see \ref zk::connection_string) and parsed at run time without
+ *  building anything but the final \ref zk::connection_params.
+**/
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <cstddef>
+#include <limits>
+
+#include <zk/string_view.hpp>
+
+namespace zk::detail
+{
+
+/** The parts of a connection string `schema://hosts[/chroot][?query]`, as views into it. **/
+struct connection_string_parts final
+{
+    bool        valid;  //!< Does the string have the structure of a connection string at all?
+    string_view schema; //!< Everything before the first \c ':'.
+    string_view hosts;  //!< The comma-separated hosts, up to the first \c '/'.
+    string_view chroot; //!< From the first \c '/' after the hosts up to the first \c '?' (empty if there is none).
+    string_view query;  //!< From that \c '?' to the end, including the \c '?' (empty if there is none).
+};
+
+/** Split \a src into its parts. This accepts exactly the strings the original pattern
+ *  `([^:]+)://([^/]+)((/[^\?]*)(\?.*)?)?` matched in ECMAScript syntax -- so the query can not have a line break, as
+ *  \c '.' does not match one.
+**/
+constexpr connection_string_parts split_connection_string(string_view src) noexcept
+{
+    connection_string_parts out{ false, string_view(), string_view(), string_view(), string_view() };
+
+    auto colon = src.find(':');
+    if (colon == 0U || colon == string_view::npos || src.substr(colon, 3U) != "://")
+        return out;
+    out.schema = src.substr(0U, colon);
+
+    auto rest  = src.substr(colon + 3U);
+    auto slash = rest.find('/');
+    out.hosts  = rest.substr(0U, slash);
+    if (out.hosts.empty())
+        return out;
+
+    if (slash != string_view::npos)
+    {
+        auto tail     = rest.substr(slash);
+        auto question = tail.find('?');
+        out.chroot    = tail.substr(0U, question);
+        if (question != string_view::npos)
+        {
+            out.query = tail.substr(question);
+            if (out.query.find_first_of("\r\n") != string_view::npos)
+                return out;
+        }
+    }
+
+    out.valid = true;
+    return out;
+}
+
+/** Call \a action with each part of \a src between \a delim characters. An empty \a src has no parts, and neither does
+ *  the end of a \a src ending with \a delim.
+**/
+template <typename FAction>
+constexpr void split_each(string_view src, char delim, FAction&& action)
+{
+    while (!src.empty())
+    {
+        auto next = src.find(delim);
+        action(src.substr(0U, next));
+        src.remove_prefix(next == string_view::npos ? src.size() : next + 1U);
+    }
+}
+
+/** Is \a val accepted for a boolean option? Only the first character is looked at. **/
+constexpr bool is_bool_value(string_view val) noexcept
+{
+    return !val.empty() && string_view("1tT0fF").find(val[0]) != string_view::npos;
+}
+
+/** Is \a val a decimal integer which fits in a \c std::size_t? **/
+constexpr bool is_size_value(string_view val) noexcept
+{
+    if (val.empty())
+        return false;
+
+    std::size_t out = 0U;
+    for (char c : val)
+    {
+        if (c < '0' || c > '9')
+            return false;
+
+        auto digit = std::size_t(c - '0');
+        if (out > (std::numeric_limits<std::size_t>::max() - digit) / 10U)
+            return false;
+        out = out * 10U + digit;
+    }
+    return true;
+}
+
+/** Is \a val a plain decimal number of seconds (`digits[.digits][e[+-]digits]`)? This is stricter than the run-time
+ *  parse, which takes anything \c std::strtod does.
+**/
+constexpr bool is_seconds_value(string_view val) noexcept
+{
+    std::size_t idx    = 0U;
+    auto        digits = [&]
+                         {
+                             auto first = idx;
+                             while (idx < val.size() && '0' <= val[idx] && val[idx] <= '9')
+                                 ++idx;
+                             return idx - first;
+                         };
+
+    auto whole = digits();
+    auto frac  = std::size_t(0U);
+    if (idx < val.size() && val[idx] == '.')
+    {
+        ++idx;
+        frac = digits();
+    }
+    if (whole + frac == 0U)
+        return false;
+
+    if (idx < val.size() && (val[idx] == 'e' || val[idx] == 'E'))
+    {
+        ++idx;
+        if (idx < val.size() && (val[idx] == '+' || val[idx] == '-'))
+            ++idx;
+        if (digits() == 0U)
+            return false;
+    }
+    return idx == val.size();
+}
+
+/** Is \a key=\a val a valid query parameter? **/
+constexpr bool is_valid_option(string_view key, string_view val) noexcept
+{
+    if (key == "randomize_hosts" || key == "read_only")
+        return is_bool_value(val);
+    else if (key == "timeout")
+        return is_seconds_value(val);
+    else if (key == "max_in_flight" || key == "recovery_batch_size")
+        return is_size_value(val);
+    else if (key == "backpressure")
+        return val == "wait" || val == "reject";
+    else if (key == "session_recovery")
+        return val == "none" || val == "watches" || val == "ephemerals";
+    else
+        return false;
+}
+
+/** Is \a src a valid connection string? Anything accepted here is also accepted by \ref connection_params::parse. **/
+constexpr bool is_valid_connection_string(string_view src) noexcept
+{
+    auto parts = split_connection_string(src);
+    if (!parts.valid)
+        return false;
+
+    if (parts.query.size() <= 1U)
+        return true;
+
+    bool valid = true;
+    split_each(parts.query.substr(1U), '&', [&] (string_view part)
+    {
+        auto eq = part.find('=');
+        if (eq == string_view::npos || !is_valid_option(part.substr(0U, eq), part.substr(eq + 1U)))
+            valid = false;
+    });
+    return valid;
+}
+
+}
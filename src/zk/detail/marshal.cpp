@@ -0,0 +1,180 @@
+#include "marshal.hpp"
+
+#include <chrono>
+
+#include <zk/multi.hpp>
+
+namespace zk::detail
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ACLs                                                                                                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ACL encode_acl_part(const acl_rule& src)
+{
+    ACL out;
+    out.perms     = static_cast<int>(src.permissions());
+    out.id.scheme = const_cast<ptr<char>>(src.scheme().c_str());
+    out.id.id     = const_cast<ptr<char>>(src.id().c_str());
+    return out;
+}
+
+std::shared_ptr<const acl_encoding> acl_encoding::create(const std::vector<acl_rule>& rules)
+{
+    return std::make_shared<const acl_encoding>(rules);
+}
+
+acl_encoding::acl_encoding(const std::vector<acl_rule>& rules) :
+        _rules(rules)
+{
+    _parts.reserve(_rules.size());
+    for (const auto& rule : _rules)
+        _parts.push_back(encode_acl_part(rule));
+
+    _raw.count = int(_parts.size());
+    _raw.data  = _parts.data();
+}
+
+acl acl_from_raw(const struct ACL_vector& raw)
+{
+    auto sz = std::size_t(raw.count);
+
+    acl out;
+    out.reserve(sz);
+    for (std::size_t idx = 0; idx < sz; ++idx)
+    {
+        const auto& item = raw.data[idx];
+        out.emplace_back(item.id.scheme, item.id.id, static_cast<permission>(item.perms));
+    }
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Results                                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+stat stat_from_raw(const struct Stat& raw)
+{
+    stat out;
+    out.acl_version = acl_version(raw.aversion);
+    out.child_modified_transaction = transaction_id(raw.pzxid);
+    out.child_version = child_version(raw.cversion);
+    out.children_count = raw.numChildren;
+    out.create_time = stat::time_point() + std::chrono::milliseconds(raw.ctime);
+    out.create_transaction = transaction_id(raw.czxid);
+    out.data_size = raw.dataLength;
+    out.data_version = version(raw.version);
+    out.ephemeral_owner = raw.ephemeralOwner;
+    out.modified_time = stat::time_point() + std::chrono::milliseconds(raw.mtime);
+    out.modified_transaction = transaction_id(raw.mzxid);
+    return out;
+}
+
+std::vector<std::string> string_vector_from_raw(const struct String_vector& raw)
+{
+    std::vector<std::string> out;
+    out.reserve(raw.count);
+    for (std::int32_t idx = 0; idx < raw.count; ++idx)
+        out.emplace_back(raw.data[idx]);
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transactions                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+multi_acl_count acl_count_of(const multi_op& txn)
+{
+    multi_acl_count out{ 0U, 0U };
+    for (const auto& tx : txn)
+    {
+        if (tx.type() == op_type::create && !tx.as_create().rules.compiled())
+        {
+            ++out.vectors;
+            out.pieces += tx.as_create().rules.size();
+        }
+    }
+    return out;
+}
+
+void encode_multi(const multi_op&                           txn,
+                  ptr<zoo_op_t>                             raw_ops,
+                  ptr<ACL_vector>                           encoded_acls,
+                  ptr<ACL>                                  acl_pieces,
+                  std::map<std::size_t, std::vector<char>>& path_buffers,
+                  std::map<std::size_t, Stat>&              raw_stats
+                 )
+{
+    ptr<ACL_vector> encoded_acl_iter = encoded_acls;
+    ptr<ACL>        acl_piece_iter   = acl_pieces;
+
+    for (std::size_t idx = 0; idx < txn.size(); ++idx)
+    {
+        auto& raw_op = raw_ops[idx];
+        auto& src_op = txn[idx];
+        switch (src_op.type())
+        {
+            case op_type::check:
+                zoo_check_op_init(&raw_op,
+                                  src_op.as_check().path.c_str(),
+                                  src_op.as_check().check.value
+                                 );
+                break;
+            case op_type::create:
+            {
+                const auto&     cdata = src_op.as_create();
+                ptr<ACL_vector> rules;
+                if (const auto& encoding = cdata.rules.encoding())
+                {
+                    rules = encoding->raw();
+                }
+                else
+                {
+                    rules = encoded_acl_iter++;
+                    rules->count = int(cdata.rules.size());
+                    rules->data  = acl_piece_iter;
+                    for (const auto& acl : cdata.rules)
+                    {
+                        *acl_piece_iter = encode_acl_part(acl);
+                        ++acl_piece_iter;
+                    }
+                }
+
+                auto& path_buf = path_buffers[idx];
+                zoo_create_op_init(&raw_op,
+                                   cdata.path.c_str(),
+                                   cdata.data.data(),
+                                   int(cdata.data.size()),
+                                   rules,
+                                   static_cast<int>(cdata.mode),
+                                   path_buf.data(),
+                                   int(path_buf.size())
+                                  );
+                break;
+            }
+            case op_type::erase:
+                zoo_delete_op_init(&raw_op,
+                                   src_op.as_erase().path.c_str(),
+                                   src_op.as_erase().check.value
+                                  );
+                break;
+            case op_type::set:
+            {
+                const auto& setting = src_op.as_set();
+                zoo_set_op_init(&raw_op,
+                                setting.path.c_str(),
+                                setting.data.data(),
+                                int(setting.data.size()),
+                                setting.check.value,
+                                &raw_stats[idx]
+                               );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+}
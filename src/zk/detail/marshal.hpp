@@ -0,0 +1,104 @@
+/** \file
+ *  Translation between the types of the library and those of the ZooKeeper C client. These are the pure-CPU parts of
+ *  \ref zk::connection_zk, kept separate so they can be measured without a server.
+**/
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zookeeper/zookeeper.h>
+
+#include <zk/acl.hpp>
+#include <zk/forwards.hpp>
+#include <zk/types.hpp>
+
+namespace zk::detail
+{
+
+/** Encode \a src as an \c ACL. The strings of the result point into \a src, so it must outlive the result. **/
+ACL encode_acl_part(const acl_rule& src);
+
+/** The \c ACL_vector of a compiled \ref acl (see \ref acl::compile). It keeps its own copy of the rules, so the strings
+ *  the encoding points to stay put no matter what happens to the \c acl it was built from.
+**/
+class acl_encoding final
+{
+public:
+    static std::shared_ptr<const acl_encoding> create(const std::vector<acl_rule>& rules);
+
+    explicit acl_encoding(const std::vector<acl_rule>& rules);
+
+    acl_encoding(const acl_encoding&)            = delete;
+    acl_encoding& operator=(const acl_encoding&) = delete;
+
+    /** The encoded ACL. The C client takes a non-\c const pointer in places, but never writes through it. **/
+    ptr<ACL_vector> raw() const noexcept { return const_cast<ptr<ACL_vector>>(&_raw); }
+
+private:
+    std::vector<acl_rule> _rules;
+    std::vector<ACL>      _parts;
+    ACL_vector            _raw;
+};
+
+/** Call \a action with an \c ACL_vector encoding \a rules. If \a rules is compiled, this is its encoding; otherwise, the
+ *  encoding lives on the stack. Either way, it is only valid for the duration of the call.
+**/
+template <typename FAction>
+auto with_acl(const acl& rules, FAction&& action) noexcept(noexcept(std::forward<FAction>(action)(ptr<ACL_vector>())))
+        -> decltype(std::forward<FAction>(action)(ptr<ACL_vector>()))
+{
+    if (const auto& encoding = rules.encoding())
+        return std::forward<FAction>(action)(encoding->raw());
+
+    ACL parts[rules.size()];
+    for (std::size_t idx = 0; idx < rules.size(); ++idx)
+        parts[idx] = encode_acl_part(rules[idx]);
+
+    ACL_vector vec;
+    vec.count = int(rules.size());
+    vec.data  = parts;
+    return std::forward<FAction>(action)(&vec);
+}
+
+stat stat_from_raw(const struct Stat& raw);
+
+std::vector<std::string> string_vector_from_raw(const struct String_vector& raw);
+
+acl acl_from_raw(const struct ACL_vector& raw);
+
+/** The amount of storage needed to encode the ACLs of the \c create operations in a transaction. Compiled ACLs bring
+ *  their own encoding, so they do not count.
+**/
+struct multi_acl_count final
+{
+    std::size_t vectors; //!< The number of \c ACL_vector (one per \c create operation with an ACL to encode).
+    std::size_t pieces;  //!< The number of \c ACL in all of those vectors.
+};
+
+multi_acl_count acl_count_of(const multi_op& txn);
+
+/** Encode every operation of \a txn into \a raw_ops, which must have room for \c txn.size() operations.
+ *
+ *  \param encoded_acls Storage for the ACLs of \c create operations, with room for \ref multi_acl_count::vectors.
+ *  \param acl_pieces Storage for the parts of those ACLs, with room for \ref multi_acl_count::pieces.
+ *  \param path_buffers The buffers the C client writes the paths of created entries to, by operation index.
+ *  \param raw_stats The \c Stat the C client writes the result of \c set operations to, by operation index.
+ *
+ *  Operations with an invalid \ref op_type are skipped -- they must be rejected before encoding.
+**/
+void encode_multi(const multi_op&                           txn,
+                  ptr<zoo_op_t>                             raw_ops,
+                  ptr<ACL_vector>                           encoded_acls,
+                  ptr<ACL>                                  acl_pieces,
+                  std::map<std::size_t, std::vector<char>>& path_buffers,
+                  std::map<std::size_t, Stat>&              raw_stats
+                 );
+
+}
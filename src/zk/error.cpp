@@ -36,6 +36,7 @@ void throw_error(error_code code)
     case error_code::connection_loss:               zk::throw_exception( connection_loss() );
     case error_code::marshalling_error:             zk::throw_exception( marshalling_error() );
     case error_code::not_implemented:               zk::throw_exception( not_implemented("unspecified") );
+    case error_code::operation_timeout:             zk::throw_exception( operation_timeout() );
     case error_code::invalid_arguments:             zk::throw_exception( invalid_arguments() );
     case error_code::new_configuration_no_quorum:   zk::throw_exception( new_configuration_no_quorum() );
     case error_code::reconfiguration_in_progress:   zk::throw_exception( reconfiguration_in_progress() );
@@ -51,6 +52,7 @@ void throw_error(error_code code)
     case error_code::read_only_connection:          zk::throw_exception( read_only_connection() );
     case error_code::ephemeral_on_local_session:    zk::throw_exception( ephemeral_on_local_session() );
     case error_code::reconfiguration_disabled:      zk::throw_exception( reconfiguration_disabled() );
+    case error_code::throttled:                     zk::throw_exception( throttled() );
     case error_code::transaction_failed:            zk::throw_exception( transaction_failed(error_code::transaction_failed, 0U) );
     default:                                        zk::throw_exception( error(code, "unknown") );
     }
@@ -128,6 +130,18 @@ marshalling_error::marshalling_error() :
 
 marshalling_error::~marshalling_error() noexcept = default;
 
+operation_timeout::operation_timeout() :
+        transport_error(error_code::operation_timeout, "")
+{ }
+
+operation_timeout::~operation_timeout() noexcept = default;
+
+throttled::throttled() :
+        transport_error(error_code::throttled, "")
+{ }
+
+throttled::~throttled() noexcept = default;
+
 not_implemented::not_implemented(ptr<const char> op_name) :
         error(error_code::not_implemented, std::string("Operation not implemented: ") + op_name)
 { }
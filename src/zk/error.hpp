@@ -22,6 +22,7 @@ enum class error_code : int
     connection_loss             =   -4, //!< Code for \ref connection_loss.
     marshalling_error           =   -5, //!< Code for \ref marshalling_error.
     not_implemented             =   -6, //!< Code for \ref not_implemented.
+    operation_timeout           =   -7, //!< Code for \ref operation_timeout.
     invalid_arguments           =   -8, //!< Code for \ref invalid_arguments.
     new_configuration_no_quorum =  -13, //!< Code for \ref new_configuration_no_quorum.
     reconfiguration_in_progress =  -14, //!< Code for \ref reconfiguration_in_progress.
@@ -37,6 +38,7 @@ enum class error_code : int
     read_only_connection        = -119, //!< Code for \ref read_only_connection.
     ephemeral_on_local_session  = -120, //!< Code for \ref ephemeral_on_local_session.
     reconfiguration_disabled    = -123, //!< Code for \ref reconfiguration_disabled.
+    throttled                   = -127, //!< Code for \ref throttled.
     transaction_failed          = -199, //!< Code for \ref transaction_failed.
 };
 
@@ -44,7 +46,9 @@ enum class error_code : int
 inline constexpr bool is_transport_error(error_code code)
 {
     return code == error_code::connection_loss
-        || code == error_code::marshalling_error;
+        || code == error_code::marshalling_error
+        || code == error_code::operation_timeout
+        || code == error_code::throttled;
 }
 
 /// Check if the provided \a code is an exception code for a \ref invalid_arguments type of exception.
@@ -163,6 +167,30 @@ public:
     virtual ~marshalling_error() noexcept;
 };
 
+/// The operation did not complete before its deadline (see \ref client::with_timeout). As with \ref connection_loss, a
+/// modifying operation which fails with this error might have been applied by the server -- the client has simply
+/// stopped waiting for the result.
+class operation_timeout :
+        public transport_error
+{
+public:
+    explicit operation_timeout();
+
+    virtual ~operation_timeout() noexcept;
+};
+
+/// The request was rejected by the client because the connection already has \ref connection_params::max_in_flight
+/// requests outstanding and is configured with \ref backpressure::reject. The request was never sent to the server, so
+/// it is always safe to retry.
+class throttled :
+        public transport_error
+{
+public:
+    explicit throttled();
+
+    virtual ~throttled() noexcept;
+};
+
 /// Operation was attempted that was not implemented. If you happen to be writing a \ref connection implementation, you
 /// are encouraged to raise this error in cases where you have not implemented an operation.
 class not_implemented:
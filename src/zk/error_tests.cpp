@@ -10,6 +10,7 @@ static error_code all_error_codes[] =
         error_code::connection_loss,
         error_code::marshalling_error,
         error_code::not_implemented,
+        error_code::operation_timeout,
         error_code::invalid_arguments,
         error_code::new_configuration_no_quorum,
         error_code::reconfiguration_in_progress,
@@ -25,6 +26,7 @@ static error_code all_error_codes[] =
         error_code::read_only_connection,
         error_code::ephemeral_on_local_session,
         error_code::reconfiguration_disabled,
+        error_code::throttled,
         error_code::transaction_failed,
     };
 
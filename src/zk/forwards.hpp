@@ -8,7 +8,9 @@ namespace zk
 class acl;
 class acl_rule;
 struct acl_version;
+enum class backpressure : int;
 struct child_version;
+class children_diff;
 class client;
 class connection;
 class connection_params;
@@ -26,13 +28,27 @@ class multi_result;
 class multi_op;
 class op;
 enum class op_type : int;
+class path;
+class path_view;
+class payload_codec;
 enum class permission : unsigned int;
+class request_observer;
+struct request_options;
+class request_recorder;
+struct request_trace;
+struct request_window_stats;
+enum class request_type : int;
+class retry_policy;
+enum class session_recovery : int;
 class set_result;
 enum class state : int;
 struct transaction_id;
 struct version;
+class watch_children_diff_result;
+class watch_children_listener;
 class watch_children_result;
 class watch_exists_result;
+class watch_listener;
 class watch_result;
 
 }
@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/server/configuration.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace zk::server
+{
+
+/// A configuration file like the ones generated for test ensembles: the usual settings, then one \c server.N line for
+/// each of \a servers servers in the ZooKeeper 3.5 form.
+static std::string ensemble_config(std::int64_t servers)
+{
+    std::ostringstream os;
+    os << "# generated ensemble\n"
+       << "tickTime=2000\n"
+       << "initLimit=10\n"
+       << "syncLimit=5\n"
+       << "dataDir=/var/lib/zookeeper\n"
+       << "4lw.commands.whitelist=srvr,ruok,mntr\n";
+    for (std::int64_t id = 1; id <= servers; ++id)
+        os << "server." << id << "=zk-" << id << ".example.com:2888:3888:participant;0.0.0.0:2181\n";
+    return os.str();
+}
+
+static void configuration_from_string(benchmark::State& state)
+{
+    auto source = ensemble_config(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(configuration::from_string(source));
+    state.SetBytesProcessed(state.iterations() * std::int64_t(source.size()));
+}
+BENCHMARK(configuration_from_string)->ArgName("servers")->Arg(3)->Arg(255);
+
+static void configuration_from_stream(benchmark::State& state)
+{
+    auto source = ensemble_config(state.range(0));
+    for (auto _ : state)
+    {
+        std::istringstream stream(source);
+        benchmark::DoNotOptimize(configuration::from_stream(stream));
+    }
+    state.SetBytesProcessed(state.iterations() * std::int64_t(source.size()));
+}
+BENCHMARK(configuration_from_stream)->ArgName("servers")->Arg(3)->Arg(255);
+
+static void configuration_server_specs(benchmark::State& state)
+{
+    auto config = configuration::from_string(ensemble_config(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(config.server_specs());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(configuration_server_specs)->ArgName("servers")->Arg(3)->Arg(255);
+
+}
@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/connection.hpp>
+
+namespace zk
+{
+
+static void connection_params_parse_simple(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(connection_params::parse("zk://127.0.0.1:2181/"));
+}
+BENCHMARK(connection_params_parse_simple);
+
+static void connection_params_parse_ensemble(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(connection_params::parse("zk://zk-1.example.com:2181,zk-2.example.com:2181,"
+                                                          "zk-3.example.com:2181,zk-4.example.com:2181,"
+                                                          "zk-5.example.com:2181/chroot/path"
+                                                          "?randomize_hosts=false&read_only=true&timeout=2.5"
+                                                         ));
+    }
+}
+BENCHMARK(connection_params_parse_ensemble);
+
+static void connection_params_parse_options(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(connection_params::parse("zk://127.0.0.1:2181/tenant-4821?timeout=2.5&max_in_flight=64"
+                                                          "&backpressure=reject&session_recovery=ephemerals"
+                                                          "&recovery_batch_size=16"
+                                                         ));
+    }
+}
+BENCHMARK(connection_params_parse_options);
+
+static void connection_string_validate(benchmark::State& state)
+{
+    string_view src = "zk://zk-1.example.com:2181,zk-2.example.com:2181/chroot/path?read_only=true&timeout=2.5";
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(src);
+        benchmark::DoNotOptimize(connection_string::is_valid(src));
+    }
+}
+BENCHMARK(connection_string_validate);
+
+}
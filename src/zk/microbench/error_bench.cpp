@@ -0,0 +1,20 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/error.hpp>
+
+namespace zk
+{
+
+static void get_exception_ptr_of_bench(benchmark::State& state)
+{
+    auto code = static_cast<error_code>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(get_exception_ptr_of(code));
+}
+BENCHMARK(get_exception_ptr_of_bench)
+    ->ArgName("code")
+    ->Arg(static_cast<int>(error_code::connection_loss))
+    ->Arg(static_cast<int>(error_code::no_entry))
+    ->Arg(static_cast<int>(error_code::version_mismatch));
+
+}
@@ -0,0 +1,4 @@
+#include <benchmark/benchmark.h>
+
+// The benchmarks themselves are registered by the *_bench.cpp files in libzkpp-microbench.
+BENCHMARK_MAIN();
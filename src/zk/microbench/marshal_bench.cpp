@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/detail/marshal.hpp>
+#include <zk/multi.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace zk
+{
+
+static void stat_from_raw_bench(benchmark::State& state)
+{
+    struct Stat raw = {};
+    raw.czxid      = 1000;
+    raw.mzxid      = 2000;
+    raw.pzxid      = 2000;
+    raw.version    = 12;
+    raw.dataLength = 128;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(raw);
+        benchmark::DoNotOptimize(detail::stat_from_raw(raw));
+    }
+}
+BENCHMARK(stat_from_raw_bench);
+
+static void string_vector_from_raw_bench(benchmark::State& state)
+{
+    std::vector<std::string> names;
+    std::vector<ptr<char>>   name_ptrs;
+    for (std::int64_t idx = 0; idx < state.range(0); ++idx)
+        names.emplace_back("child-" + std::to_string(idx));
+    for (auto& name : names)
+        name_ptrs.emplace_back(name.data());
+
+    struct String_vector raw;
+    raw.count = std::int32_t(name_ptrs.size());
+    raw.data  = name_ptrs.data();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(detail::string_vector_from_raw(raw));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(string_vector_from_raw_bench)->ArgName("children")->Arg(1)->Arg(100)->Arg(10000);
+
+static acl sample_acl(std::int64_t size)
+{
+    acl out;
+    for (std::int64_t idx = 0; idx < size; ++idx)
+        out.emplace_back("digest", "user-" + std::to_string(idx) + ":c2VjcmV0", permission::all);
+    return out;
+}
+
+static void acl_from_raw_bench(benchmark::State& state)
+{
+    auto rules = sample_acl(state.range(0));
+    detail::with_acl(rules,
+                     [&] (ptr<ACL_vector> raw)
+                     {
+                         for (auto _ : state)
+                             benchmark::DoNotOptimize(detail::acl_from_raw(*raw));
+                     }
+                    );
+}
+BENCHMARK(acl_from_raw_bench)->ArgName("rules")->Arg(1)->Arg(8);
+
+static void with_acl_bench(benchmark::State& state)
+{
+    auto rules = sample_acl(state.range(0));
+    for (auto _ : state)
+    {
+        detail::with_acl(rules, [] (ptr<ACL_vector> raw) { benchmark::DoNotOptimize(raw->data); });
+    }
+}
+BENCHMARK(with_acl_bench)->ArgName("rules")->Arg(1)->Arg(8);
+
+static void with_acl_compiled_bench(benchmark::State& state)
+{
+    auto rules = sample_acl(state.range(0)).compile();
+    for (auto _ : state)
+    {
+        detail::with_acl(rules, [] (ptr<ACL_vector> raw) { benchmark::DoNotOptimize(raw->data); });
+    }
+}
+BENCHMARK(with_acl_compiled_bench)->ArgName("rules")->Arg(1)->Arg(8);
+
+/// Encode a transaction the same way \ref connection_zk::commit does, minus submitting it.
+static void encode_multi_bench(benchmark::State& state)
+{
+    multi_op txn;
+    for (std::int64_t idx = 0; idx < state.range(0); ++idx)
+    {
+        auto path = "/bench/entry-" + std::to_string(idx);
+        switch (idx % 4)
+        {
+        case 0: txn.push_back(op::check(path, version(1))); break;
+        case 1: txn.push_back(op::create(path, buffer(64, 'x'), acls::open_unsafe())); break;
+        case 2: txn.push_back(op::set(path, buffer(64, 'y'))); break;
+        case 3: txn.push_back(op::erase(path)); break;
+        }
+    }
+
+    for (auto _ : state)
+    {
+        std::map<std::size_t, std::vector<char>> path_buffers;
+        std::map<std::size_t, Stat>              raw_stats;
+        for (std::size_t idx = 0U; idx < txn.size(); ++idx)
+        {
+            if (txn[idx].type() == op_type::create)
+                path_buffers[idx] = std::vector<char>(txn[idx].as_create().path.size() + 1);
+            else if (txn[idx].type() == op_type::set)
+                raw_stats[idx] = Stat();
+        }
+
+        auto       acl_count = detail::acl_count_of(txn);
+        zoo_op_t   raw_ops[txn.size()];
+        ACL_vector encoded_acls[acl_count.vectors];
+        ACL        acl_pieces[acl_count.pieces];
+        detail::encode_multi(txn, raw_ops, encoded_acls, acl_pieces, path_buffers, raw_stats);
+        benchmark::DoNotOptimize(raw_ops[0]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(encode_multi_bench)->ArgName("ops")->Arg(4)->Arg(64);
+
+}
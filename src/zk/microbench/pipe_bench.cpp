@@ -0,0 +1,152 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/server/detail/output_buffer.hpp>
+#include <zk/server/detail/pipe.hpp>
+#include <zk/server/detail/subprocess.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace zk::server::detail
+{
+
+/// Start a subprocess which writes \a bytes bytes to its standard output as fast as it can, like a very chatty JVM.
+static subprocess start_writer(std::int64_t bytes)
+{
+    return subprocess("head", { "-c", std::to_string(bytes), "/dev/zero" });
+}
+
+/// Block until \a src has something to read (or its writer is closed).
+static void wait_readable(pipe& src)
+{
+    ::pollfd entry = { src.native_read_handle(), POLLIN, 0 };
+    ::poll(&entry, 1, -1);
+}
+
+/// Run \a transfer on the standard output of a writer of `state.range(0)` bytes until the writer is done.
+/// \a transfer returns a \ref read_result for what it moved.
+template <typename FTransfer>
+static void run_writer(benchmark::State& state, FTransfer&& transfer)
+{
+    for (auto _ : state)
+    {
+        auto         proc  = start_writer(state.range(0));
+        std::int64_t total = 0;
+        while (true)
+        {
+            wait_readable(proc.stdout());
+            auto result = transfer(proc.stdout());
+            total += std::int64_t(result.size);
+            if (result.end_of_file)
+                break;
+        }
+
+        if (total != state.range(0))
+            state.SkipWithError("Writer output was cut short");
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+/// The original approach: read everything available into a new string each time.
+static void pipe_read_string(benchmark::State& state)
+{
+    run_writer(state,
+               [] (pipe& src)
+               {
+                   auto out = src.read();
+                   benchmark::DoNotOptimize(out.data());
+                   // An empty read after poll reported readable means the writer closed
+                   return read_result{ out.size(), out.empty() };
+               }
+              );
+}
+BENCHMARK(pipe_read_string)->ArgName("bytes")->Arg(64 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// Read into one reused caller-provided buffer.
+static void pipe_read_buffer(benchmark::State& state)
+{
+    std::vector<char> buffer(64U * 1024U);
+    run_writer(state,
+               [&] (pipe& src)
+               {
+                   auto result = src.read(buffer.data(), buffer.size());
+                   benchmark::DoNotOptimize(buffer.data());
+                   return result;
+               }
+              );
+}
+BENCHMARK(pipe_read_buffer)->ArgName("bytes")->Arg(64 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// Read straight into the ring of an \ref output_buffer, as a \ref server does with its output.
+static void pipe_read_output_buffer(benchmark::State& state)
+{
+    output_buffer buffer(64U * 1024U);
+    run_writer(state, [&] (pipe& src) { return src.read(buffer, buffer.capacity()); });
+}
+BENCHMARK(pipe_read_output_buffer)->ArgName("bytes")->Arg(64 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// A temporary log file which is emptied after every writer, so it does not grow across iterations.
+class log_file final
+{
+public:
+    log_file() :
+            _file(std::tmpfile())
+    { }
+
+    log_file(const log_file&) = delete;
+    log_file& operator=(const log_file&) = delete;
+
+    ~log_file() noexcept
+    {
+        if (_file)
+            std::fclose(_file);
+    }
+
+    int native_handle() const { return ::fileno(_file); }
+
+    /// Pass along \a result, emptying the file once the writer is done.
+    read_result reset_at_end(read_result result)
+    {
+        if (result.end_of_file && (::ftruncate(native_handle(), 0) != 0 || ::lseek(native_handle(), 0, SEEK_SET) != 0))
+            throw std::system_error(errno, std::system_category(), "Failed to reset log file");
+        return result;
+    }
+
+private:
+    std::FILE* _file;
+};
+
+/// Copy the output to a log file through user space: read into a buffer, then write it out.
+static void pipe_read_write_file(benchmark::State& state)
+{
+    std::vector<char> buffer(64U * 1024U);
+    log_file          log;
+    run_writer(state,
+               [&] (pipe& src)
+               {
+                   auto result = src.read(buffer.data(), buffer.size());
+                   if (result.size != 0U
+                      && ::write(log.native_handle(), buffer.data(), result.size) != ::ssize_t(result.size)
+                      )
+                       state.SkipWithError("Failed to write log");
+                   return log.reset_at_end(result);
+               }
+              );
+}
+BENCHMARK(pipe_read_write_file)->ArgName("bytes")->Arg(64 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// Copy the output to a log file without it passing through user space.
+static void pipe_splice_file(benchmark::State& state)
+{
+    log_file log;
+    run_writer(state, [&] (pipe& src) { return log.reset_at_end(src.splice_to(log.native_handle(), 64U * 1024U)); });
+}
+BENCHMARK(pipe_splice_file)->ArgName("bytes")->Arg(64 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace zk
+{
+
+static stat sample_stat()
+{
+    stat out;
+    out.create_transaction         = transaction_id(1000);
+    out.modified_transaction       = transaction_id(2000);
+    out.child_modified_transaction = transaction_id(2000);
+    out.data_version               = version(12);
+    out.child_version              = child_version(3);
+    out.acl_version                = acl_version(1);
+    out.data_size                  = 128;
+    out.children_count             = 3;
+    return out;
+}
+
+static void get_result_to_string(benchmark::State& state)
+{
+    get_result result(buffer(std::size_t(state.range(0)), 'x'), sample_stat());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(to_string(result));
+}
+BENCHMARK(get_result_to_string)->ArgName("data_size")->Arg(16)->Arg(1024);
+
+static void get_children_result_to_string(benchmark::State& state)
+{
+    std::vector<std::string> children;
+    for (std::int64_t idx = 0; idx < state.range(0); ++idx)
+        children.emplace_back("child-" + std::to_string(idx));
+
+    get_children_result result(std::move(children), sample_stat());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(to_string(result));
+}
+BENCHMARK(get_children_result_to_string)->ArgName("children")->Arg(10)->Arg(1000);
+
+static void multi_result_stream(benchmark::State& state)
+{
+    multi_result result;
+    result.emplace_back(create_result("/created-0000000001"));
+    result.emplace_back(set_result(sample_stat()));
+    result.emplace_back(op_type::check, nullptr);
+    result.emplace_back(op_type::erase, nullptr);
+
+    std::ostringstream os;
+    for (auto _ : state)
+    {
+        os.str(std::string());
+        os << result;
+        benchmark::DoNotOptimize(os);
+    }
+}
+BENCHMARK(multi_result_stream);
+
+}
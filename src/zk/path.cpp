@@ -0,0 +1,423 @@
+#include "path.hpp"
+#include "error.hpp"
+#include "exceptions.hpp"
+
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+
+namespace zk
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation                                                                                                         //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// These follow the rules the server applies (see PathUtils.validatePath), which checks every UTF-16 code unit of the
+// path. Besides the structure of the path, it does not allow:
+//  - the null character and ASCII control characters (including 0x7f)
+//  - the C1 control characters U+0080 to U+009F, which are 0xc2 0x80 to 0xc2 0x9f in UTF-8
+//  - U+D800 to U+F8FF, which are 0xed 0xa0 to 0xef 0xa3 (0xee is never allowed)
+//  - U+FFF0 to U+FFFF, which are 0xef 0xbf 0xb0 and up
+//  - anything outside the Basic Multilingual Plane (a lead byte of 0xf0 or more), as the server decodes it into a pair
+//    of UTF-16 surrogates, which are in the range above
+// Other malformed UTF-8 is not checked here; the server sees it as U+FFFD and rejects it.
+
+/// Get byte \a idx of \a src, or \c 0 if it is past the end.
+static unsigned char byte_at(string_view src, std::size_t idx) noexcept
+{
+    return idx < src.size() ? static_cast<unsigned char>(src[idx]) : static_cast<unsigned char>(0U);
+}
+
+/// Is the character starting at byte \a idx of \a src, which is \a c followed by \a next, one the server rejects?
+static bool is_forbidden(string_view src, std::size_t idx, unsigned char c, unsigned char next) noexcept
+{
+    if (c < 0x80U)
+        return c < 0x20U || c == 0x7fU;
+
+    switch (c)
+    {
+        case 0xc2U: return next >= 0x80U && next <= 0x9fU;
+        case 0xedU: return next >= 0xa0U;
+        case 0xeeU: return true;
+        case 0xefU: return next <= 0xa3U || (next == 0xbfU && byte_at(src, idx + 2U) >= 0xb0U);
+        default:    return c >= 0xf0U;
+    }
+}
+
+static bool is_valid_component(string_view name) noexcept
+{
+    if (name.empty() || name == "." || name == "..")
+        return false;
+
+    for (std::size_t idx = 0U; idx < name.size(); ++idx)
+    {
+        auto c = static_cast<unsigned char>(name[idx]);
+        if (c == '/' || is_forbidden(name, idx, c, byte_at(name, idx + 1U)))
+            return false;
+    }
+    return true;
+}
+
+/// Check every component of \a relative, which is a path without the leading \c '/'.
+static bool is_valid_relative(string_view relative) noexcept
+{
+    while (true)
+    {
+        auto slash = relative.find('/');
+        if (!is_valid_component(relative.substr(0, slash)))
+            return false;
+        if (slash == string_view::npos)
+            return true;
+        relative.remove_prefix(slash + 1U);
+    }
+}
+
+// A whole path is checked by looking at every byte together with the one after it, which is enough to find almost every
+// violation: a forbidden character, an empty component (a '/' followed by another '/' or by the end of the path) and a
+// component starting with '.' (a '/' followed by '.'), which is then checked for being "." or "..". The only character
+// which needs a third byte is 0xef 0xbf, which is U+FFC0 to U+FFFF. Both of these are rare, so almost every byte takes
+// the fast path, which classifies 16 bytes at once when SSE2 is available.
+
+/// Check the byte at \a idx of \a src, which is \a c, followed by \a next (\c 0 at the end of the path).
+static bool is_valid_at(string_view src, std::size_t idx, unsigned char c, unsigned char next) noexcept
+{
+    if (is_forbidden(src, idx, c, next))
+        return false;
+    else if (c != '/')
+        return true;
+    else if (next == '/' || idx + 1U == src.size())
+        return false;
+    else if (next != '.')
+        return true;
+
+    auto name = src.substr(idx + 1U, src.find('/', idx + 1U) - (idx + 1U));
+    return name != "." && name != "..";
+}
+
+static bool is_valid_scalar(string_view src, std::size_t first) noexcept
+{
+    for (std::size_t idx = first; idx < src.size(); ++idx)
+    {
+        if (!is_valid_at(src, idx, static_cast<unsigned char>(src[idx]), byte_at(src, idx + 1U)))
+            return false;
+    }
+    return true;
+}
+
+#if defined(__SSE2__)
+
+static bool is_valid_simd(string_view src) noexcept
+{
+    const auto ctrl_max = _mm_set1_epi8(0x1f);
+    const auto del      = _mm_set1_epi8(0x7f);
+    const auto c1_lead  = _mm_set1_epi8(static_cast<char>(0xc2));
+    const auto c1_base  = _mm_set1_epi8(static_cast<char>(0x80));
+    const auto ed_lead  = _mm_set1_epi8(static_cast<char>(0xed));
+    const auto ee_lead  = _mm_set1_epi8(static_cast<char>(0xee));
+    const auto ef_lead  = _mm_set1_epi8(static_cast<char>(0xef));
+    const auto f0_lead  = _mm_set1_epi8(static_cast<char>(0xf0));
+    const auto sur_min  = _mm_set1_epi8(static_cast<char>(0xa0));
+    const auto pua_max  = _mm_set1_epi8(static_cast<char>(0xa3));
+    const auto bf       = _mm_set1_epi8(static_cast<char>(0xbf));
+    const auto slash    = _mm_set1_epi8('/');
+    const auto dot      = _mm_set1_epi8('.');
+
+    // Each block needs the byte after it, so the last 16 bytes are left to the scalar loop
+    std::size_t idx = 0U;
+    for (; idx + 17U <= src.size(); idx += 16U)
+    {
+        auto here = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src.data() + idx));
+        auto next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src.data() + idx + 1U));
+
+        // Unsigned c <= 0x1f is min(c, 0x1f) == c; the C1 range check is the same after moving 0x80 to 0
+        auto ctrl  = _mm_cmpeq_epi8(_mm_min_epu8(here, ctrl_max), here);
+        auto next1 = _mm_sub_epi8(next, c1_base);
+        auto c1    = _mm_and_si128(_mm_cmpeq_epi8(here, c1_lead),
+                                   _mm_cmpeq_epi8(_mm_min_epu8(next1, ctrl_max), next1)
+                                  );
+        auto bad   = _mm_or_si128(_mm_or_si128(ctrl, _mm_cmpeq_epi8(here, del)), c1);
+
+        // 0xf0 and up or 0xee: outside the BMP or U+E000 to U+EFFF
+        auto high = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(here, f0_lead), here), _mm_cmpeq_epi8(here, ee_lead));
+        // 0xed 0xa0 and up: U+D800 to U+DFFF
+        auto sur  = _mm_and_si128(_mm_cmpeq_epi8(here, ed_lead), _mm_cmpeq_epi8(_mm_max_epu8(next, sur_min), next));
+        // 0xef 0xa3 and below: U+F000 to U+F8FF
+        auto here_ef = _mm_cmpeq_epi8(here, ef_lead);
+        auto pua     = _mm_and_si128(here_ef, _mm_cmpeq_epi8(_mm_min_epu8(next, pua_max), next));
+        bad = _mm_or_si128(bad, _mm_or_si128(high, _mm_or_si128(sur, pua)));
+        if (_mm_movemask_epi8(bad) != 0)
+            return false;
+
+        // A '/' followed by '/' or '.', or a 0xef 0xbf which needs the byte after it, is checked one byte at a time
+        auto special = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(here, slash),
+                                                  _mm_or_si128(_mm_cmpeq_epi8(next, slash), _mm_cmpeq_epi8(next, dot))
+                                                 ),
+                                    _mm_and_si128(here_ef, _mm_cmpeq_epi8(next, bf))
+                                   );
+        if (_mm_movemask_epi8(special) != 0)
+        {
+            for (std::size_t sub = idx; sub < idx + 16U; ++sub)
+            {
+                if (!is_valid_at(src,
+                                 sub,
+                                 static_cast<unsigned char>(src[sub]),
+                                 static_cast<unsigned char>(src[sub + 1U])
+                                ))
+                    return false;
+            }
+        }
+    }
+    return is_valid_scalar(src, idx);
+}
+
+#endif
+
+bool path::is_valid(string_view src) noexcept
+{
+    if (src.empty() || src[0] != '/')
+        return false;
+    else if (src.size() == 1U)
+        return true;
+#if defined(__SSE2__)
+    else
+        return is_valid_simd(src);
+#else
+    else
+        return is_valid_scalar(src, 0U);
+#endif
+}
+
+bool path::is_valid_sequential_prefix(string_view src) noexcept
+{
+    // The server appends the sequence number before checking, so "/a/" is fine (it becomes "/a/0000000001")
+    if (src.size() > 1U && src.back() == '/' && src[src.size() - 2U] != '/')
+        return is_valid(src.substr(0, src.size() - 1U));
+    else
+        return is_valid(src);
+}
+
+bool path::is_valid_name(string_view name) noexcept
+{
+    return is_valid_component(name);
+}
+
+[[noreturn]]
+static void throw_invalid(string_view src)
+{
+    zk::throw_exception(invalid_arguments(error_code::invalid_arguments, "Invalid path: \"" + std::string(src) + "\""));
+}
+
+namespace detail
+{
+
+void throw_invalid_path(std::size_t index, string_view src)
+{
+    zk::throw_exception(invalid_arguments(error_code::invalid_arguments,
+                                          "Invalid path at index=" + std::to_string(index) + ": \"" + std::string(src)
+                                          + "\""
+                                         ));
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// path                                                                                                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+path::path() noexcept :
+        _size(1U)
+{
+    _inline[0] = '/';
+    _inline[1] = '\0';
+}
+
+path::path(string_view src)
+{
+    if (!is_valid(src))
+        throw_invalid(src);
+    assign(src);
+}
+
+path::path(string_view src, unchecked_tag)
+{
+    assign(src);
+}
+
+path::path(const path& src) noexcept :
+        _size(src._size),
+        _shared(src._shared)
+{
+    if (!_shared)
+        std::memcpy(_inline, src._inline, _size + 1U);
+}
+
+path& path::operator=(const path& src) noexcept
+{
+    if (this == &src)
+        return *this;
+
+    _size   = src._size;
+    _shared = src._shared;
+    if (!_shared)
+        std::memcpy(_inline, src._inline, _size + 1U);
+    return *this;
+}
+
+path::~path() noexcept = default;
+
+void path::assign(string_view src)
+{
+    _size = src.size();
+    if (_size <= inline_capacity)
+    {
+        std::memcpy(_inline, src.data(), _size);
+        _inline[_size] = '\0';
+    }
+    else
+    {
+        _shared = std::make_shared<const std::string>(src);
+    }
+}
+
+path path::intern(string_view src)
+{
+    // Interned paths are never released, so they are leaked on purpose: this keeps them valid while other static
+    // objects are destroyed at exit.
+    static std::mutex& protect = *new std::mutex;
+    static auto&       table   = *new std::map<std::string, path, std::less<>>;
+
+    std::unique_lock<std::mutex> ax(protect);
+    auto iter = table.find(src);
+    if (iter != table.end())
+        return iter->second;
+
+    path created(src);
+    if (!created._shared)
+    {
+        // Share the storage even for short paths, so copies of an interned path never copy the characters
+        created._shared = std::make_shared<const std::string>(src);
+    }
+    return table.emplace(std::string(src), std::move(created)).first->second;
+}
+
+path path::normalize(string_view src)
+{
+    if (src.empty() || src[0] != '/')
+        throw_invalid(src);
+
+    std::vector<string_view> names;
+    for (auto rest = src.substr(1U); !rest.empty(); )
+    {
+        auto slash = rest.find('/');
+        auto name  = rest.substr(0, slash);
+        rest.remove_prefix(slash == string_view::npos ? rest.size() : slash + 1U);
+
+        if (name.empty() || name == ".")
+        {
+            continue;
+        }
+        else if (name == "..")
+        {
+            if (names.empty())
+                throw_invalid(src);
+            names.pop_back();
+        }
+        else if (!is_valid_component(name))
+        {
+            throw_invalid(src);
+        }
+        else
+        {
+            names.push_back(name);
+        }
+    }
+
+    std::string out;
+    out.reserve(src.size());
+    for (const auto& name : names)
+    {
+        out.push_back('/');
+        out.append(name.data(), name.size());
+    }
+    if (out.empty())
+        out.push_back('/');
+    return path(out, unchecked_tag());
+}
+
+string_view path::name() const noexcept
+{
+    auto full = view();
+    return full.substr(full.rfind('/') + 1U);
+}
+
+path path::parent() const
+{
+    auto full  = view();
+    auto slash = full.rfind('/');
+    return path(slash == 0U ? full.substr(0, 1U) : full.substr(0, slash), unchecked_tag());
+}
+
+path path::child(string_view name) const
+{
+    if (!is_valid_component(name))
+        throw_invalid(name);
+    return append_unchecked(name);
+}
+
+path path::append(string_view relative) const
+{
+    if (!is_valid_relative(relative))
+        throw_invalid(relative);
+    return append_unchecked(relative);
+}
+
+path path::append_unchecked(string_view relative) const
+{
+    auto base = is_root() ? string_view() : view();
+
+    path out;
+    out._size = base.size() + 1U + relative.size();
+    if (out._size <= inline_capacity)
+    {
+        if (!base.empty())
+            std::memcpy(out._inline, base.data(), base.size());
+        out._inline[base.size()] = '/';
+        std::memcpy(out._inline + base.size() + 1U, relative.data(), relative.size());
+        out._inline[out._size] = '\0';
+    }
+    else
+    {
+        std::string joined;
+        joined.reserve(out._size);
+        joined.append(base.data(), base.size());
+        joined.push_back('/');
+        joined.append(relative.data(), relative.size());
+        out._shared = std::make_shared<const std::string>(std::move(joined));
+    }
+    return out;
+}
+
+std::size_t hash(const path& self)
+{
+    return std::hash<string_view>()(self.view());
+}
+
+std::ostream& operator<<(std::ostream& os, const path& self)
+{
+    return os << self.view();
+}
+
+std::string to_string(const path& self)
+{
+    return self.str();
+}
+
+}
@@ -0,0 +1,254 @@
+/// \file
+/// Validated paths of entries.
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "string_view.hpp"
+
+namespace zk
+{
+
+/// \addtogroup Client
+/// \{
+
+/// The path of an entry, validated once when it is built. A path is absolute, has no empty, \c "." or \c ".."
+/// components, does not end in \c '/' (unless it is the root) and has no control characters.
+///
+/// Paths of up to \ref inline_capacity characters are stored inside the object, so building, copying and navigating
+/// them (\ref parent, \ref child) does not allocate. Longer paths are stored in an immutable shared string, so copying
+/// one only touches a reference count. Paths used over and over can be \ref intern "interned" to build them once.
+///
+/// The characters are always followed by a null terminator, so passing a path to a \ref client (which takes a
+/// \ref path_view) hands the characters to the C client as they are, instead of copying them to add the terminator.
+///
+/// \code
+/// zk::path root("/services/billing");
+/// auto instance = root.child("host-17");
+/// client.get(instance).get();
+/// \endcode
+class path final
+{
+public:
+    /// The length of the longest path stored inside the object.
+    static constexpr std::size_t inline_capacity = 63U;
+
+public:
+    /// The root path \c "/".
+    path() noexcept;
+
+    /// Create a path from \a src.
+    ///
+    /// \throws invalid_arguments if \a src is not a valid path.
+    explicit path(string_view src);
+
+    path(const path&) noexcept;
+    path& operator=(const path&) noexcept;
+
+    ~path() noexcept;
+
+    /// Get the interned path for \a src. The first call for a given path builds it; later calls return a copy of the
+    /// same path, which shares its storage. Interned paths are never released, so only intern paths which are used
+    /// repeatedly and not an unbounded number of distinct paths.
+    ///
+    /// \throws invalid_arguments if \a src is not a valid path.
+    static path intern(string_view src);
+
+    /// Build the path \a src refers to, the way a file system would: repeated and trailing \c '/' are dropped, \c "."
+    /// components are dropped and \c ".." components remove the component before them. For example,
+    /// \c "/a//b/./c/../d/" is \c "/a/b/d".
+    ///
+    /// \throws invalid_arguments if \a src is not absolute, has a \c ".." above the root or has a forbidden character.
+    static path normalize(string_view src);
+
+    /// Is \a src a valid path? This is checked 16 bytes at a time on platforms with SSE2, so it is cheap enough to run
+    /// over large batches of paths (see \ref validate_paths).
+    static bool is_valid(string_view src) noexcept;
+
+    /// Is \a src valid as the path given to a sequential create (see \ref create_mode::sequential)? This is the same as
+    /// \ref is_valid, except that it can end in \c '/', as the server appends the sequence number before checking.
+    static bool is_valid_sequential_prefix(string_view src) noexcept;
+
+    /// Is \a name a valid name for a single component of a path?
+    static bool is_valid_name(string_view name) noexcept;
+
+    /// The characters of the path, followed by a null terminator.
+    const char* c_str() const noexcept { return _shared ? _shared->c_str() : _inline; }
+
+    /// \{
+    /// The characters of the path.
+    const char* data() const noexcept { return c_str(); }
+    string_view view() const noexcept { return string_view(c_str(), _size); }
+    operator string_view() const noexcept { return view(); }
+    std::string str() const { return std::string(c_str(), _size); }
+    /// \}
+
+    /// The number of characters in the path, not counting the null terminator.
+    std::size_t size() const noexcept { return _size; }
+
+    /// Is this the root path?
+    bool is_root() const noexcept { return _size == 1U; }
+
+    /// The last component of the path. This is empty for the root.
+    string_view name() const noexcept;
+
+    /// The path of the parent entry. The parent of the root is the root.
+    path parent() const;
+
+    /// The path of the child \a name of this entry.
+    ///
+    /// \throws invalid_arguments if \a name is not a valid component (see \ref is_valid_name).
+    path child(string_view name) const;
+
+    /// The path of the descendant at \a relative (which does not start with \c '/') below this entry.
+    ///
+    /// \throws invalid_arguments if \a relative does not form a valid path when appended.
+    path append(string_view relative) const;
+
+    /// \see child
+    path operator/(string_view name) const { return child(name); }
+
+private:
+    struct unchecked_tag final
+    { };
+
+    /// Create a path from \a src, which is known to be valid.
+    explicit path(string_view src, unchecked_tag);
+
+    void assign(string_view src);
+
+    path append_unchecked(string_view relative) const;
+
+private:
+    std::size_t                        _size;
+    std::shared_ptr<const std::string> _shared;
+    char                               _inline[inline_capacity + 1U];
+};
+
+inline bool operator==(const path& a, const path& b) { return a.view() == b.view(); }
+inline bool operator!=(const path& a, const path& b) { return a.view() != b.view(); }
+inline bool operator< (const path& a, const path& b) { return a.view() <  b.view(); }
+inline bool operator<=(const path& a, const path& b) { return a.view() <= b.view(); }
+inline bool operator> (const path& a, const path& b) { return a.view() >  b.view(); }
+inline bool operator>=(const path& a, const path& b) { return a.view() >= b.view(); }
+
+std::size_t hash(const path&);
+
+std::ostream& operator<<(std::ostream&, const path&);
+
+std::string to_string(const path&);
+
+/// The path argument of \ref client and \ref connection operations. This can be made from any string type and
+/// remembers if the characters are known to be followed by a null terminator, as they are for a \ref path, a
+/// \c std::string or a C string. Only a path given as a plain \ref string_view has to be copied before it is passed
+/// to the C client.
+///
+/// A \c path_view does not own the characters, so it must not outlive the argument it was made from.
+class path_view final
+{
+public:
+    path_view(const path& src) noexcept :
+            _view(src.view()),
+            _terminated(true)
+    { }
+
+    path_view(const std::string& src) noexcept :
+            _view(src),
+            _terminated(true)
+    { }
+
+    path_view(const char* src) noexcept :
+            _view(src),
+            _terminated(true)
+    { }
+
+    path_view(string_view src) noexcept :
+            _view(src),
+            _terminated(false)
+    { }
+
+    /// The characters of the path.
+    const char* data() const noexcept { return _view.data(); }
+
+    /// The number of characters in the path, not counting any null terminator.
+    std::size_t size() const noexcept { return _view.size(); }
+
+    /// Are the characters known to be followed by a null terminator?
+    bool null_terminated() const noexcept { return _terminated; }
+
+    /// \{
+    /// The characters of the path.
+    string_view view() const noexcept { return _view; }
+    operator string_view() const noexcept { return _view; }
+    /// \}
+
+private:
+    string_view _view;
+    bool        _terminated;
+};
+
+namespace detail
+{
+
+[[noreturn]]
+void throw_invalid_path(std::size_t index, string_view src);
+
+}
+
+/// Find the first path in [\a first, \a last) which is not valid (see \ref path::is_valid). The elements can be
+/// anything a \ref path_view can be made from.
+///
+/// \returns The iterator to the first invalid path or \a last if they are all valid.
+template <typename TIter>
+TIter find_invalid_path(TIter first, TIter last)
+{
+    for (; first != last; ++first)
+    {
+        if (!path::is_valid(path_view(*first).view()))
+            break;
+    }
+    return first;
+}
+
+/// Check every path in \a paths (see \ref path::is_valid) before doing anything with them, so a batch fails as a whole
+/// instead of partway through.
+///
+/// \throws invalid_arguments if a path is not valid, with the index and the path of the first one in the message.
+template <typename TRange>
+void validate_paths(const TRange& paths)
+{
+    std::size_t idx = 0U;
+    for (const auto& src : paths)
+    {
+        path_view view(src);
+        if (!path::is_valid(view.view()))
+            detail::throw_invalid_path(idx, view.view());
+        ++idx;
+    }
+}
+
+/// \}
+
+}
+
+namespace std
+{
+
+template <>
+struct hash<zk::path>
+{
+    using argument_type = zk::path;
+    using result_type   = std::size_t;
+
+    result_type operator()(const argument_type& x) const
+    {
+        return zk::hash(x);
+    }
+};
+
+}
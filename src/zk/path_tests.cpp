@@ -0,0 +1,210 @@
+#include <zk/tests/test.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "error.hpp"
+#include "path.hpp"
+
+namespace zk
+{
+
+GTEST_TEST(path_tests, validation)
+{
+    CHECK_TRUE(path::is_valid("/"));
+    CHECK_TRUE(path::is_valid("/a"));
+    CHECK_TRUE(path::is_valid("/a/b.c/..d"));
+    CHECK_TRUE(path::is_valid("/caf\xc3\xa9"));
+
+    CHECK_FALSE(path::is_valid(""));
+    CHECK_FALSE(path::is_valid("a"));
+    CHECK_FALSE(path::is_valid("/a/"));
+    CHECK_FALSE(path::is_valid("//a"));
+    CHECK_FALSE(path::is_valid("/a/./b"));
+    CHECK_FALSE(path::is_valid("/a/.."));
+    CHECK_FALSE(path::is_valid(string_view("/a\0b", 4U)));
+    CHECK_FALSE(path::is_valid("/a\x7f"));
+    CHECK_FALSE(path::is_valid("/a\xc2\x85"));
+
+    CHECK_THROWS(invalid_arguments) { path("/a//b"); };
+}
+
+GTEST_TEST(path_tests, validation_code_points)
+{
+    // U+D7FF is the last allowed before the surrogates; U+D800 to U+F8FF are forbidden
+    CHECK_TRUE(path::is_valid("/a\xed\x9f\xbf"));
+    CHECK_FALSE(path::is_valid("/a\xed\xa0\x80"));
+    CHECK_FALSE(path::is_valid("/a\xed\xbf\xbf"));
+    CHECK_FALSE(path::is_valid("/a\xee\x80\x80"));
+    CHECK_FALSE(path::is_valid("/a\xef\x80\x80"));
+    CHECK_FALSE(path::is_valid("/a\xef\xa3\xbf"));
+    CHECK_TRUE(path::is_valid("/a\xef\xa4\x80"));
+
+    // U+FFEF is allowed, U+FFF0 to U+FFFF (including the U+FFFD replacement character) are not
+    CHECK_TRUE(path::is_valid("/a\xef\xbf\xaf"));
+    CHECK_FALSE(path::is_valid("/a\xef\xbf\xb0"));
+    CHECK_FALSE(path::is_valid("/a\xef\xbf\xbd"));
+    CHECK_FALSE(path::is_valid("/a\xef\xbf\xbf"));
+
+    // Outside the Basic Multilingual Plane, which the server sees as surrogates
+    CHECK_FALSE(path::is_valid("/a\xf0\x9f\x98\x80"));
+
+    CHECK_TRUE(path::is_valid_name("\xef\xbf\xaf"));
+    CHECK_FALSE(path::is_valid_name("\xed\xa0\x80"));
+    CHECK_FALSE(path::is_valid_name("\xef\xbf\xb0"));
+}
+
+GTEST_TEST(path_tests, validation_long)
+{
+    // Long enough to go through the vectorized checks, with the problem in the middle of a block and across blocks
+    std::string base = "/a-fairly-long/path.with/some.dots/in/it";
+    CHECK_TRUE(path::is_valid(base));
+    CHECK_TRUE(path::is_valid(base + "/..x/.y/z."));
+    CHECK_FALSE(path::is_valid(base + "/"));
+    CHECK_FALSE(path::is_valid(base + "//more/components"));
+    CHECK_FALSE(path::is_valid(base + "/./more/components"));
+    CHECK_FALSE(path::is_valid(base + "/../more/components"));
+    CHECK_FALSE(path::is_valid(base + "/\x01/more/components"));
+    CHECK_FALSE(path::is_valid(base + "/\xc2\x9f/more/components"));
+    CHECK_TRUE(path::is_valid(base + "/\xc2\xa0/more/components"));
+
+    // Every forbidden code point at every offset, so it lands inside a block and across the boundary of two
+    for (std::size_t offset = 0U; offset < 40U; ++offset)
+    {
+        auto with = [&] (const char* code_point)
+                    {
+                        return "/" + std::string(offset, 'a') + code_point + std::string(40U, 'b');
+                    };
+        CHECK_FALSE(path::is_valid(with("\xed\xa0\x80"))) << offset;
+        CHECK_FALSE(path::is_valid(with("\xee\x80\x80"))) << offset;
+        CHECK_FALSE(path::is_valid(with("\xef\xa3\xbf"))) << offset;
+        CHECK_FALSE(path::is_valid(with("\xef\xbf\xb0"))) << offset;
+        CHECK_FALSE(path::is_valid(with("\xef\xbf\xbf"))) << offset;
+        CHECK_FALSE(path::is_valid(with("\xf0\x9f\x98\x80"))) << offset;
+        CHECK_TRUE(path::is_valid(with("\xed\x9f\xbf"))) << offset;
+        CHECK_TRUE(path::is_valid(with("\xef\xa4\x80"))) << offset;
+        CHECK_TRUE(path::is_valid(with("\xef\xbf\xaf"))) << offset;
+    }
+
+    // Compare against checking each component on its own over random paths from an alphabet full of trouble
+    const char alphabet[] = { '/', '/', '.', '.', 'a', 'b', '\x1f', '\x7f', '\xc2', '\x85', '\xa0',
+                              '\xed', '\xee', '\xef', '\xf0', '\x9f', '\xa3', '\xa4', '\xbf', '\xb0',
+                            };
+    std::mt19937 rng(42U);
+    for (std::size_t count = 0U; count < 20000U; ++count)
+    {
+        std::string src = "/";
+        auto        len = rng() % 48U;
+        for (std::size_t idx = 0U; idx < len; ++idx)
+            src.push_back(alphabet[rng() % sizeof alphabet]);
+
+        bool expected = true;
+        for (string_view rest = string_view(src).substr(1U); expected && src.size() > 1U; )
+        {
+            auto slash = rest.find('/');
+            expected   = path::is_valid_name(rest.substr(0, slash));
+            if (slash == string_view::npos)
+                break;
+            rest.remove_prefix(slash + 1U);
+        }
+        CHECK_EQ(expected, path::is_valid(src)) << src;
+    }
+}
+
+GTEST_TEST(path_tests, validation_sequential)
+{
+    CHECK_TRUE(path::is_valid_sequential_prefix("/"));
+    CHECK_TRUE(path::is_valid_sequential_prefix("/a/"));
+    CHECK_TRUE(path::is_valid_sequential_prefix("/a/lock-"));
+    CHECK_FALSE(path::is_valid_sequential_prefix("//"));
+    CHECK_FALSE(path::is_valid_sequential_prefix("/a//"));
+    CHECK_FALSE(path::is_valid_sequential_prefix("/a/../"));
+}
+
+GTEST_TEST(path_tests, validate_paths)
+{
+    std::vector<std::string> good = { "/a", "/a/b", "/c" };
+    validate_paths(good);
+    CHECK_TRUE(find_invalid_path(good.begin(), good.end()) == good.end());
+
+    std::vector<std::string> bad = { "/a", "/a/b", "/a//b", "/c/" };
+    CHECK_TRUE(find_invalid_path(bad.begin(), bad.end()) == bad.begin() + 2);
+    try
+    {
+        validate_paths(bad);
+        CHECK_FAIL() << "validate_paths should have thrown";
+    }
+    catch (const invalid_arguments& ex)
+    {
+        CHECK_NE(std::string::npos, std::string(ex.what()).find("index=2"));
+    }
+}
+
+GTEST_TEST(path_tests, normalize)
+{
+    CHECK_EQ(path("/a/b/d"), path::normalize("/a//b/./c/../d/"));
+    CHECK_EQ(path("/"),      path::normalize("/a/.."));
+    CHECK_EQ(path("/"),      path::normalize("///"));
+    CHECK_EQ(path("/a/..b"), path::normalize("/a/..b"));
+
+    CHECK_THROWS(invalid_arguments) { path::normalize("a/b"); };
+    CHECK_THROWS(invalid_arguments) { path::normalize("/.."); };
+    CHECK_THROWS(invalid_arguments) { path::normalize("/a/\x7f"); };
+}
+
+GTEST_TEST(path_tests, navigation)
+{
+    path root;
+    CHECK_TRUE(root.is_root());
+    CHECK_EQ("/", root.view());
+    CHECK_EQ(root, root.parent());
+
+    auto a = root.child("a");
+    CHECK_EQ("/a", a.view());
+    CHECK_EQ(root, a.parent());
+
+    auto abc = a.append("b/c");
+    CHECK_EQ("/a/b/c", abc.view());
+    CHECK_EQ("c", abc.name());
+    CHECK_EQ(path("/a/b"), abc.parent());
+    CHECK_EQ(abc, a / "b" / "c");
+    CHECK_EQ('\0', abc.c_str()[abc.size()]);
+
+    CHECK_THROWS(invalid_arguments) { a.child("b/c"); };
+    CHECK_THROWS(invalid_arguments) { a.child(".."); };
+    CHECK_THROWS(invalid_arguments) { a.append("b//c"); };
+}
+
+GTEST_TEST(path_tests, long_paths)
+{
+    std::string long_name(100U, 'x');
+    auto base = path("/base").child(long_name);
+    CHECK_EQ(std::string("/base/") + long_name, base.str());
+    CHECK_EQ('\0', base.c_str()[base.size()]);
+
+    auto copy = base;
+    CHECK_EQ(base.c_str(), copy.c_str());
+    CHECK_EQ(path("/base"), base.parent());
+}
+
+GTEST_TEST(path_tests, intern)
+{
+    auto first  = path::intern("/interned/path");
+    auto second = path::intern("/interned/path");
+    CHECK_EQ(first, second);
+    CHECK_EQ(first.c_str(), second.c_str());
+
+    CHECK_THROWS(invalid_arguments) { path::intern("interned"); };
+}
+
+GTEST_TEST(path_tests, path_view_termination)
+{
+    std::string owned = "/a/b";
+    CHECK_TRUE(path_view(path("/a")).null_terminated());
+    CHECK_TRUE(path_view(owned).null_terminated());
+    CHECK_TRUE(path_view("/a").null_terminated());
+    CHECK_FALSE(path_view(string_view(owned).substr(0, 2U)).null_terminated());
+}
+
+}
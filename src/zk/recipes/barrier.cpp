@@ -0,0 +1,304 @@
+#include "barrier.hpp"
+
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/results.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// barrier_core                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// The state of a single participant in a barrier. This is shared with the thread waiting on the barrier, so the
+/// participant can be destroyed while it is waiting.
+class barrier_core final :
+        public std::enable_shared_from_this<barrier_core>
+{
+public:
+    explicit barrier_core(client conn, std::string path, std::size_t size) :
+            _conn(std::move(conn)),
+            _path(std::move(path)),
+            _ready_path(child_path(_path, "ready")),
+            _size(size),
+            _busy(false)
+    { }
+
+    const std::string& path() const { return _path; }
+
+    std::size_t size() const { return _size; }
+
+    /// Start entering the barrier on a new thread. If \a withdraw is set, the entry of this participant is removed once
+    /// the barrier opens.
+    future<void> enter(bool withdraw)
+    {
+        return start(false, [withdraw] (barrier_core& self) { self.run_enter(withdraw); });
+    }
+
+    future<void> leave()
+    {
+        return start(true, [] (barrier_core& self) { self.run_leave(); });
+    }
+
+    /// Called when the owner of this participant is destroyed. Remove the entry if there is one, so the participant
+    /// does not hold up the others until its session ends.
+    void abandon() noexcept
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (_node)
+        {
+            _conn.erase(*_node);
+            _node.reset();
+        }
+    }
+
+private:
+    /// Run \a func on a new thread, after checking this participant has (if \a entered is set) or has not (otherwise)
+    /// entered the barrier.
+    template <typename FAction>
+    future<void> start(bool entered, FAction func)
+    {
+        try
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            if (_busy)
+                zk::throw_exception(std::logic_error("Barrier " + _path + " is already being entered or left"));
+            else if (entered && !_node)
+                zk::throw_exception(std::logic_error("Barrier " + _path + " was not entered"));
+            else if (!entered && _node)
+                zk::throw_exception(std::logic_error("Barrier " + _path + " was already entered"));
+            _busy = true;
+        }
+        catch (...)
+        {
+            promise<void> p;
+            p.set_exception(zk::current_exception());
+            return p.get_future();
+        }
+
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), func]
+                         {
+                             try
+                             {
+                                 func(*self);
+                             }
+                             catch (...)
+                             {
+                                 self->finish();
+                                 throw;
+                             }
+                             self->finish();
+                         }
+                        );
+    }
+
+    void finish()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _busy = false;
+    }
+
+    /// Get the names of the participants, in the order they arrived. The \c ready entry is not included, as it does not
+    /// have a sequence number.
+    std::vector<std::string> participants()
+    {
+        return sorted_by_sequence(_conn.get_children(_path).get().children());
+    }
+
+    void run_enter(bool withdraw)
+    {
+        ensure_path(_conn, _path);
+        auto node = _conn.create(child_path(_path, "participant-"),
+                                 buffer(),
+                                 create_mode::ephemeral | create_mode::sequential
+                                )
+                         .get()
+                         .name();
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            _node = node;
+        }
+
+        // The watch is armed before counting, so the participant which completes the count can not be missed. The count
+        // is only read once: the last participant to arrive is guaranteed to see every other entry, as its server has
+        // applied all the writes before its own.
+        auto watch = _conn.watch_exists(_ready_path).get();
+        if (!watch.initial())
+        {
+            if (participants().size() >= _size)
+            {
+                try
+                {
+                    _conn.create(_ready_path, buffer()).get();
+                }
+                catch (const entry_exists&)
+                { }
+            }
+            watch.next().get();
+        }
+
+        if (withdraw)
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            _node.reset();
+            ax.unlock();
+            _conn.erase(node).get();
+        }
+    }
+
+    void run_leave()
+    {
+        std::string node;
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            node = *_node;
+        }
+        auto own     = std::string(leaf_of(node));
+        bool removed = false;
+
+        auto remove_own = [&]
+                          {
+                              if (std::exchange(removed, true))
+                                  return;
+
+                              try
+                              {
+                                  _conn.erase(node).get();
+                              }
+                              catch (const no_entry&)
+                              { }
+                              std::unique_lock<std::mutex> ax(_protect);
+                              _node.reset();
+                          };
+
+        while (true)
+        {
+            auto sorted = participants();
+            if (sorted.empty())
+                break;
+
+            if (sorted.size() == 1U && sorted.front() == own)
+            {
+                // Last one out: clear the ready entry so the root can be used again
+                try
+                {
+                    _conn.erase(_ready_path).get();
+                }
+                catch (const no_entry&)
+                { }
+                remove_own();
+                break;
+            }
+
+            string_view watched;
+            if (sorted.front() == own)
+            {
+                // The lowest entry waits for the highest, so it is the last to leave
+                watched = sorted.back();
+            }
+            else
+            {
+                remove_own();
+                watched = sorted.front();
+            }
+
+            // A data watch leaves nothing behind if the entry is already gone, unlike an existence watch, which would
+            // wait for a sequential name that will never be used again
+            try
+            {
+                _conn.watch(child_path(_path, watched)).get().next().get();
+            }
+            catch (const no_entry&)
+            { }
+        }
+    }
+
+private:
+    client                _conn;
+    std::string           _path;
+    std::string           _ready_path;
+    std::size_t           _size;
+    mutable std::mutex    _protect;
+    bool                  _busy;
+    optional<std::string> _node;
+};
+
+}
+
+using detail::barrier_core;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// barrier                                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+barrier::barrier(client conn, std::string path, std::size_t size) :
+        _core(std::make_shared<barrier_core>(std::move(conn), std::move(path), size))
+{ }
+
+barrier::~barrier() noexcept
+{
+    _core->abandon();
+}
+
+const std::string& barrier::path() const
+{
+    return _core->path();
+}
+
+std::size_t barrier::size() const
+{
+    return _core->size();
+}
+
+future<void> barrier::arrive_and_wait()
+{
+    return _core->enter(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// double_barrier                                                                                                     //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double_barrier::double_barrier(client conn, std::string path, std::size_t size) :
+        _core(std::make_shared<barrier_core>(std::move(conn), std::move(path), size))
+{ }
+
+double_barrier::~double_barrier() noexcept
+{
+    _core->abandon();
+}
+
+const std::string& double_barrier::path() const
+{
+    return _core->path();
+}
+
+std::size_t double_barrier::size() const
+{
+    return _core->size();
+}
+
+future<void> double_barrier::enter()
+{
+    return _core->enter(false);
+}
+
+future<void> double_barrier::leave()
+{
+    return _core->leave();
+}
+
+}
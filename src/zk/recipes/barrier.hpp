@@ -0,0 +1,109 @@
+/// \file
+/// Barriers which hold participants back until enough of them have arrived.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+namespace detail
+{
+
+class barrier_core;
+
+}
+
+/// A barrier which opens once a given number of participants have arrived at it, using the entry at a given path as its
+/// root. Each participant creates an ephemeral sequential entry under the root, then watches a single \c ready entry
+/// with \ref client::watch_exists. The participant which finds the count complete creates the \c ready entry, so the
+/// barrier opens for everyone with a single event each -- nobody polls the list of participants.
+///
+/// Once open, a barrier stays open: to synchronize again, use a different root.
+///
+/// \code
+/// zk::recipes::barrier start(client, "/jobs/1234/start", worker_count);
+/// start.arrive_and_wait().get();
+/// \endcode
+class barrier final
+{
+public:
+    /// Create a participant in the barrier rooted at \a path, which opens once \a size participants have arrived.
+    explicit barrier(client conn, std::string path, std::size_t size);
+
+    barrier(const barrier&) = delete;
+    barrier& operator=(const barrier&) = delete;
+
+    /// If this participant arrived, but the barrier has not opened yet, withdraw from it.
+    ~barrier() noexcept;
+
+    /// The path of the root of the barrier.
+    const std::string& path() const;
+
+    /// The number of participants the barrier waits for.
+    std::size_t size() const;
+
+    /// Arrive at the barrier. The returned future is delivered once the barrier is open. This is run on its own thread,
+    /// so keep in mind that destroying the future waits for the barrier to open.
+    ///
+    /// \throws std::logic_error if this participant already arrived, the future will be delivered with
+    ///  \c std::logic_error.
+    future<void> arrive_and_wait();
+
+private:
+    std::shared_ptr<detail::barrier_core> _core;
+};
+
+/// A barrier which participants both enter and leave together: \ref enter waits until \ref size participants have
+/// entered, like \ref barrier, and \ref leave waits until all of them have left.
+///
+/// Leaving costs a single watch at a time for each participant. The participant with the lowest entry watches the
+/// highest one and every other participant removes its entry, then watches the lowest, so each participant is woken a
+/// bounded number of times no matter how many there are. The last participant to leave removes the \c ready entry, so
+/// the root can be used again once everyone has left.
+class double_barrier final
+{
+public:
+    /// Create a participant in the barrier rooted at \a path, which opens once \a size participants have entered.
+    explicit double_barrier(client conn, std::string path, std::size_t size);
+
+    double_barrier(const double_barrier&) = delete;
+    double_barrier& operator=(const double_barrier&) = delete;
+
+    /// Withdraw from the barrier if this participant entered it but did not leave.
+    ~double_barrier() noexcept;
+
+    /// The path of the root of the barrier.
+    const std::string& path() const;
+
+    /// The number of participants the barrier waits for.
+    std::size_t size() const;
+
+    /// Enter the barrier. The returned future is delivered once \ref size participants have entered.
+    ///
+    /// \throws std::logic_error if this participant already entered, the future will be delivered with
+    ///  \c std::logic_error.
+    future<void> enter();
+
+    /// Leave the barrier. The returned future is delivered once every participant has left.
+    ///
+    /// \throws std::logic_error if this participant has not entered, the future will be delivered with
+    ///  \c std::logic_error.
+    future<void> leave();
+
+private:
+    std::shared_ptr<detail::barrier_core> _core;
+};
+
+/// \}
+
+}
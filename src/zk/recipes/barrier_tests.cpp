@@ -0,0 +1,62 @@
+#include <zk/results.hpp>
+#include <zk/server/server_tests.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+#include "barrier.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class barrier_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(barrier_tests, opens_when_full)
+{
+    barrier a(get_connected_client(), "/barrier_tests/opens_when_full", 3U);
+    barrier b(get_connected_client(), "/barrier_tests/opens_when_full", 3U);
+    barrier c(get_connected_client(), "/barrier_tests/opens_when_full", 3U);
+
+    auto a_open = a.arrive_and_wait();
+    auto b_open = b.arrive_and_wait();
+    CHECK_EQ(std::future_status::timeout, a_open.wait_for(200ms));
+    CHECK_EQ(std::future_status::timeout, b_open.wait_for(0ms));
+
+    c.arrive_and_wait().get();
+    a_open.get();
+    b_open.get();
+
+    CHECK_THROWS(std::logic_error) { a.arrive_and_wait().get(); };
+}
+
+GTEST_TEST_F(barrier_tests, double_barrier_enter_leave)
+{
+    double_barrier a(get_connected_client(), "/barrier_tests/double_barrier_enter_leave", 2U);
+    double_barrier b(get_connected_client(), "/barrier_tests/double_barrier_enter_leave", 2U);
+
+    CHECK_THROWS(std::logic_error) { a.leave().get(); };
+
+    auto a_entered = a.enter();
+    CHECK_EQ(std::future_status::timeout, a_entered.wait_for(200ms));
+    b.enter().get();
+    a_entered.get();
+
+    auto a_left = a.leave();
+    CHECK_EQ(std::future_status::timeout, a_left.wait_for(200ms));
+    b.leave().get();
+    a_left.get();
+
+    // Everyone left, so the barrier can be used again
+    auto remaining = get_connected_client().get_children("/barrier_tests/double_barrier_enter_leave").get();
+    CHECK_TRUE(remaining.children().empty());
+    auto a_again = a.enter();
+    CHECK_EQ(std::future_status::timeout, a_again.wait_for(200ms));
+    b.enter().get();
+    a_again.get();
+}
+
+}
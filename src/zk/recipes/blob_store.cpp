@@ -0,0 +1,341 @@
+#include "blob_store.hpp"
+
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// blob_info                                                                                                          //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const blob_info& self)
+{
+    os << "{generation=" << self.generation;
+    os << " size=" << self.size;
+    os << " chunk_size=" << self.chunk_size;
+    os << " chunk_count=" << self.chunk_count;
+    os << " checksum=" << std::hex << self.checksum << std::dec;
+    return os << '}';
+}
+
+std::string to_string(const blob_info& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Chunks and manifests                                                                                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+static const std::string manifest_tag = "zkblob-1";
+
+/// The number of transactions (when writing) or gets (when reading) of a single blob in flight at once. This bounds
+/// the memory held by requests on top of the blob itself.
+static constexpr std::size_t pipeline_depth = 8U;
+
+/// The most chunk data put in a single transaction, which leaves room for the rest of the request under the server's
+/// 1 MiB limit.
+static constexpr std::size_t max_batch_bytes = 768U * 1024U;
+
+/// The largest chunk which fits in a single entry with room to spare.
+static constexpr std::size_t max_chunk_size = 1000U * 1024U;
+
+static std::uint64_t checksum_of(const char* data, std::size_t size)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t idx = 0U; idx < size; ++idx)
+    {
+        hash ^= std::uint8_t(data[idx]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string chunk_name(std::size_t idx)
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "chunk-%06zu", idx);
+    return name;
+}
+
+static buffer encode_manifest(const blob_info& info)
+{
+    std::ostringstream os;
+    os << manifest_tag << ' ' << info.generation << ' ' << info.size << ' ' << info.chunk_size << ' '
+       << info.chunk_count << ' ' << std::hex << info.checksum;
+    auto text = os.str();
+    return buffer(text.begin(), text.end());
+}
+
+/// Parse the manifest stored in \a data. An empty manifest means there is no blob.
+///
+/// \throws marshalling_error if \a data is not a manifest.
+static optional<blob_info> parse_manifest(const buffer& data)
+{
+    if (data.empty())
+        return nullopt;
+
+    std::istringstream is(std::string(data.begin(), data.end()));
+    std::string tag;
+    blob_info   info;
+    is >> tag >> info.generation >> info.size >> info.chunk_size >> info.chunk_count >> std::hex >> info.checksum;
+    if (!is || tag != manifest_tag)
+        zk::throw_exception(marshalling_error());
+
+    if (info.size > 0U && info.chunk_size == 0U)
+        zk::throw_exception(marshalling_error());
+    if (info.size > 0U && info.chunk_count != (info.size + info.chunk_size - 1U) / info.chunk_size)
+        zk::throw_exception(marshalling_error());
+    if (info.size == 0U && info.chunk_count != 0U)
+        zk::throw_exception(marshalling_error());
+
+    return info;
+}
+
+struct manifest final
+{
+    optional<blob_info> info;
+    version             data_version;
+};
+
+static manifest read_manifest(const client& conn, const std::string& path)
+{
+    auto result = conn.get(path).get();
+    return manifest{ parse_manifest(result.data()), result.stat().data_version };
+}
+
+/// Erase the generation \a name under \a path and whatever chunks it has. This is best-effort: a generation which can
+/// not be erased is only wasted space, as nothing refers to it.
+static void erase_generation(client& conn, const std::string& path, const std::string& name) noexcept
+{
+    try
+    {
+        auto gen_path = child_path(path, name);
+        auto chunks   = conn.get_children(gen_path).get().children();
+
+        std::vector<future<void>> erases;
+        erases.reserve(chunks.size());
+        for (const auto& chunk : chunks)
+            erases.emplace_back(conn.erase(child_path(gen_path, chunk)));
+        for (auto& erase : erases)
+        {
+            try
+            {
+                erase.get();
+            }
+            catch (const no_entry&)
+            { }
+        }
+
+        conn.erase(gen_path).get();
+    }
+    catch (...)
+    { }
+}
+
+/// Write \a data as the chunks of a new generation under \a path.
+static blob_info write_generation(client& conn, const std::string& path, const buffer& data, std::size_t chunk_size)
+{
+    blob_info info;
+    info.generation  = std::string(leaf_of(conn.create(child_path(path, "gen-"), buffer(), create_mode::sequential)
+                                                .get()
+                                                .name()
+                                           ));
+    info.size        = data.size();
+    info.chunk_size  = chunk_size;
+    info.chunk_count = (data.size() + chunk_size - 1U) / chunk_size;
+    info.checksum    = checksum_of(data.data(), data.size());
+
+    auto gen_path  = child_path(path, info.generation);
+    auto per_batch = std::max<std::size_t>(1U, max_batch_bytes / chunk_size);
+    try
+    {
+        std::deque<future<multi_result>> in_flight;
+        for (std::size_t first = 0U; first < info.chunk_count; first += per_batch)
+        {
+            auto last = std::min(first + per_batch, info.chunk_count);
+
+            multi_op txn;
+            txn.reserve(last - first);
+            for (std::size_t idx = first; idx < last; ++idx)
+            {
+                auto offset = idx * chunk_size;
+                auto length = std::min(chunk_size, data.size() - offset);
+                txn.push_back(op::create(child_path(gen_path, chunk_name(idx)),
+                                         buffer(data.begin() + offset, data.begin() + offset + length)
+                                        )
+                             );
+            }
+
+            if (in_flight.size() == pipeline_depth)
+            {
+                in_flight.front().get();
+                in_flight.pop_front();
+            }
+            in_flight.emplace_back(conn.commit(std::move(txn)));
+        }
+
+        for (auto& batch : in_flight)
+            batch.get();
+    }
+    catch (...)
+    {
+        erase_generation(conn, path, info.generation);
+        throw;
+    }
+
+    return info;
+}
+
+/// Read the chunks of the generation described by \a info into a single buffer.
+///
+/// \throws no_entry if the generation has been erased.
+/// \throws marshalling_error if the chunks do not match \a info.
+static buffer read_generation(const client& conn, const std::string& path, const blob_info& info)
+{
+    auto   gen_path = child_path(path, info.generation);
+    buffer out(info.size);
+
+    std::deque<std::pair<std::size_t, future<get_result>>> in_flight;
+    auto collect = [&]
+                   {
+                       auto idx    = in_flight.front().first;
+                       auto result = in_flight.front().second.get();
+                       in_flight.pop_front();
+
+                       auto offset = idx * info.chunk_size;
+                       auto length = std::min(info.chunk_size, info.size - offset);
+                       if (result.data().size() != length)
+                           zk::throw_exception(marshalling_error());
+                       std::memcpy(out.data() + offset, result.data().data(), length);
+                   };
+
+    for (std::size_t idx = 0U; idx < info.chunk_count; ++idx)
+    {
+        if (in_flight.size() == pipeline_depth)
+            collect();
+        in_flight.emplace_back(idx, conn.get(child_path(gen_path, chunk_name(idx))));
+    }
+    while (!in_flight.empty())
+        collect();
+
+    if (checksum_of(out.data(), out.size()) != info.checksum)
+        zk::throw_exception(marshalling_error());
+    return out;
+}
+
+/// Point the manifest at \a info (or at no blob, if \a info is \c nullopt), then erase the generation it replaced.
+static void switch_manifest(client& conn, const std::string& path, const optional<blob_info>& info)
+{
+    auto encoded = info ? encode_manifest(*info) : buffer();
+    while (true)
+    {
+        auto current = read_manifest(conn, path);
+        try
+        {
+            conn.set(path, encoded, current.data_version).get();
+        }
+        catch (const version_mismatch&)
+        {
+            // Another writer switched the manifest in between -- its generation is now the one to replace
+            continue;
+        }
+
+        if (current.info)
+            erase_generation(conn, path, current.info->generation);
+        return;
+    }
+}
+
+static buffer read_blob(const client& conn, const std::string& path)
+{
+    optional<std::string> missing;
+    while (true)
+    {
+        auto current = read_manifest(conn, path);
+        if (!current.info)
+            zk::throw_exception(no_entry());
+
+        try
+        {
+            return read_generation(conn, path, *current.info);
+        }
+        catch (const no_entry&)
+        {
+            // The generation was replaced while it was being read, so start over with the new one. If the manifest
+            // still points at a generation which is missing chunks, the blob is broken.
+            if (missing == current.info->generation)
+                zk::throw_exception(marshalling_error());
+            missing = current.info->generation;
+        }
+    }
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// blob_store                                                                                                         //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+blob_store::blob_store(client conn, std::string path, std::size_t chunk_size) :
+        _conn(std::move(conn)),
+        _path(std::move(path)),
+        _chunk_size(chunk_size)
+{
+    if (_chunk_size == 0U || _chunk_size > detail::max_chunk_size)
+        zk::throw_exception(std::invalid_argument("Blob chunk size must be between 1 byte and 1000 KiB"));
+
+    detail::ensure_path(_conn, _path);
+}
+
+future<blob_info> blob_store::write(buffer data)
+{
+    return zk::async(zk::launch::async,
+                     [conn = _conn, path = _path, chunk_size = _chunk_size, data = std::move(data)] () mutable
+                     {
+                         auto info = detail::write_generation(conn, path, data, chunk_size);
+                         detail::switch_manifest(conn, path, info);
+                         return info;
+                     }
+                    );
+}
+
+future<buffer> blob_store::read() const
+{
+    return zk::async(zk::launch::async, [conn = _conn, path = _path] { return detail::read_blob(conn, path); });
+}
+
+future<optional<blob_info>> blob_store::info() const
+{
+    return zk::async(zk::launch::async, [conn = _conn, path = _path] { return detail::read_manifest(conn, path).info; });
+}
+
+future<void> blob_store::erase()
+{
+    return zk::async(zk::launch::async,
+                     [conn = _conn, path = _path] () mutable { detail::switch_manifest(conn, path, nullopt); }
+                    );
+}
+
+}
@@ -0,0 +1,120 @@
+/// \file
+/// Storing data larger than the size limit of a single entry.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/buffer.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+#include <zk/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+/// Describes the blob currently held by a \ref blob_store. This is what the manifest entry holds.
+struct blob_info final
+{
+    /// The name of the entry holding the chunks of this version of the blob. Every write creates a new generation.
+    std::string generation;
+
+    /// The size of the blob in bytes.
+    std::size_t size = 0U;
+
+    /// The size of every chunk but the last.
+    std::size_t chunk_size = 0U;
+
+    /// The number of chunks the blob is split over.
+    std::size_t chunk_count = 0U;
+
+    /// The 64-bit FNV-1a hash of the blob.
+    std::uint64_t checksum = 0U;
+};
+
+std::ostream& operator<<(std::ostream&, const blob_info&);
+
+std::string to_string(const blob_info&);
+
+/// Stores a blob of any size at a given path, working around the limit on the size of a single entry (1 MiB by
+/// default). The blob is split into chunks, which are written as children of a generation entry:
+///
+/// \code
+/// path                      manifest: generation, size, chunk size, chunk count and checksum
+/// path/gen-0000000007       a generation: one per write
+/// path/gen-0000000007/chunk-000000
+/// path/gen-0000000007/chunk-000001
+/// ...
+/// \endcode
+///
+/// A write creates a new generation, fills it with \ref client::commit batches of chunks (several batches are in
+/// flight at once), then switches the manifest to it with a version-checked \ref client::set. Chunks are never
+/// modified, so a reader which follows the manifest sees either the old blob or the new one, never a mix of the two.
+/// Once the manifest has been switched, the previous generation is erased. A reader which was still fetching it gets
+/// \ref no_entry for a chunk, reads the manifest again and starts over with the new generation. The checksum in the
+/// manifest is checked after every read.
+///
+/// Reads fetch the chunks with several \ref client::get operations in flight at once, copying each into its place in a
+/// buffer allocated up front with the size from the manifest.
+///
+/// \code
+/// zk::recipes::blob_store routes(client, "/artifacts/routing-table");
+/// routes.write(std::move(table)).get();
+/// ...
+/// zk::buffer table = routes.read().get();
+/// \endcode
+///
+/// \note If a writer dies between creating its generation and switching the manifest, the generation is left behind.
+///  It is not referenced by the manifest, so readers never see it.
+class blob_store final
+{
+public:
+    /// The default size of each chunk. This leaves room for a few chunks per transaction under the server's limit.
+    static constexpr std::size_t default_chunk_size = 256U * 1024U;
+
+public:
+    /// Create a store at \a path. The entry (and any missing ancestors) is created if it does not exist.
+    ///
+    /// \param chunk_size The size to split blobs into. This only affects writes; blobs are read with the chunk size they
+    ///  were written with.
+    /// \throws std::invalid_argument if \a chunk_size is \c 0 or more than 1000 KiB, which could not be written.
+    explicit blob_store(client conn, std::string path, std::size_t chunk_size = default_chunk_size);
+
+    /// The path of the manifest.
+    const std::string& path() const { return _path; }
+
+    /// The size blobs are split into when written.
+    std::size_t chunk_size() const { return _chunk_size; }
+
+    /// Replace the blob with \a data. If another writer replaces the blob at the same time, the last one to switch the
+    /// manifest wins.
+    future<blob_info> write(buffer data);
+
+    /// Read the whole blob.
+    ///
+    /// \throws no_entry if no blob has been written, the future will be delivered with \ref no_entry.
+    /// \throws marshalling_error if the chunks do not match the manifest, the future will be delivered with
+    ///  \ref marshalling_error.
+    future<buffer> read() const;
+
+    /// Get the description of the current blob, or \c nullopt if no blob has been written.
+    future<optional<blob_info>> info() const;
+
+    /// Erase the blob and all of its chunks. The manifest entry is left, but empty, so it reads as no blob.
+    future<void> erase();
+
+private:
+    client      _conn;
+    std::string _path;
+    std::size_t _chunk_size;
+};
+
+/// \}
+
+}
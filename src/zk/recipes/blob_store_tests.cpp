@@ -0,0 +1,80 @@
+#include <zk/server/server_tests.hpp>
+
+#include <zk/error.hpp>
+
+#include <stdexcept>
+#include <string>
+
+#include "blob_store.hpp"
+
+namespace zk::recipes
+{
+
+class blob_store_tests :
+        public server::single_server_fixture
+{ };
+
+static buffer pattern_of(std::size_t size, unsigned seed)
+{
+    buffer out(size);
+    std::uint32_t state = seed;
+    for (auto& c : out)
+    {
+        state = state * 1664525U + 1013904223U;
+        c = char(state >> 24);
+    }
+    return out;
+}
+
+GTEST_TEST_F(blob_store_tests, round_trip)
+{
+    blob_store store(get_connected_client(), "/blob_store_tests/round_trip", 64U * 1024U);
+    CHECK_THROWS(no_entry) { store.read().get(); };
+    CHECK_FALSE(store.info().get());
+
+    // Larger than a single entry can hold, and not a multiple of the chunk size
+    auto data = pattern_of(3U * 1024U * 1024U + 17U, 1U);
+    auto info = store.write(data).get();
+    CHECK_EQ(data.size(), info.size);
+    CHECK_EQ(49U, info.chunk_count);
+
+    CHECK_TRUE(data == store.read().get());
+    CHECK_EQ(info.generation, store.info().get()->generation);
+}
+
+GTEST_TEST_F(blob_store_tests, replace)
+{
+    auto c = get_connected_client();
+    blob_store store(c, "/blob_store_tests/replace", 16U * 1024U);
+
+    auto first  = store.write(pattern_of(100U * 1024U, 1U)).get();
+    auto second = pattern_of(40U * 1024U, 2U);
+    auto info   = store.write(second).get();
+    CHECK_NE(first.generation, info.generation);
+    CHECK_TRUE(second == store.read().get());
+
+    // The replaced generation is erased
+    CHECK_EQ(std::vector<std::string>({ info.generation }), c.get_children(store.path()).get().children());
+
+    store.erase().get();
+    CHECK_THROWS(no_entry) { store.read().get(); };
+    CHECK_TRUE(c.get_children(store.path()).get().children().empty());
+}
+
+GTEST_TEST_F(blob_store_tests, empty_blob)
+{
+    blob_store store(get_connected_client(), "/blob_store_tests/empty_blob");
+    auto info = store.write(buffer()).get();
+    CHECK_EQ(0U, info.chunk_count);
+    CHECK_TRUE(store.read().get().empty());
+}
+
+GTEST_TEST_F(blob_store_tests, invalid_chunk_size)
+{
+    CHECK_THROWS(std::invalid_argument)
+    {
+        blob_store store(get_connected_client(), "/blob_store_tests/invalid_chunk_size", 0U);
+    };
+}
+
+}
@@ -0,0 +1,278 @@
+#include "counter.hpp"
+
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/results.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// counter_core                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+static const string_view shard_prefix = "shard-";
+
+static buffer encode_value(std::int64_t value)
+{
+    auto text = std::to_string(value);
+    return buffer(text.begin(), text.end());
+}
+
+static std::int64_t decode_value(const buffer& data)
+{
+    if (data.empty())
+        return 0;
+
+    try
+    {
+        return std::stoll(std::string(data.begin(), data.end()));
+    }
+    catch (const std::exception&)
+    {
+        zk::throw_exception(marshalling_error());
+    }
+}
+
+/// The stripe of the accumulators the calling thread adds to. This is picked once per thread, so a thread always hits
+/// the same cache line.
+static std::size_t stripe_of_this_thread(std::size_t stripe_count)
+{
+    static thread_local std::size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return hash % stripe_count;
+}
+
+class counter_core final :
+        public std::enable_shared_from_this<counter_core>
+{
+public:
+    explicit counter_core(client conn, std::string path, std::chrono::milliseconds flush_interval) :
+            _conn(std::move(conn)),
+            _path(std::move(path)),
+            _flush_interval(flush_interval),
+            _drained(0),
+            _written(0),
+            _stopping(false)
+    {
+        for (auto& stripe : _stripes)
+            stripe.value.store(0, std::memory_order_relaxed);
+
+        ensure_path(_conn, _path);
+        auto created   = _conn.create(child_path(_path, shard_prefix), encode_value(0), create_mode::sequential).get();
+        _shard_path    = created.name();
+        _shard_version = version(0);
+    }
+
+    const std::string& path() const { return _path; }
+
+    void start()
+    {
+        _worker = std::thread([this] { run(); });
+    }
+
+    void stop() noexcept
+    {
+        {
+            std::unique_lock<std::mutex> ax(_stop_protect);
+            _stopping = true;
+        }
+        _stop_cond.notify_all();
+        if (_worker.joinable())
+            _worker.join();
+
+        try
+        {
+            flush_now();
+        }
+        catch (...)
+        {
+            // Nothing left to retry with -- the increments which were not written are lost
+        }
+    }
+
+    void add(std::int64_t delta) noexcept
+    {
+        _stripes[stripe_of_this_thread(_stripes.size())].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    std::int64_t pending() const noexcept
+    {
+        std::int64_t sum = _drained.load(std::memory_order_relaxed) - _written.load(std::memory_order_relaxed);
+        for (const auto& stripe : _stripes)
+            sum += stripe.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    future<void> flush()
+    {
+        return zk::async(zk::launch::async, [self = shared_from_this()] { self->flush_now(); });
+    }
+
+    future<std::int64_t> total() const
+    {
+        return zk::async(zk::launch::async, [self = shared_from_this()] { return self->read_total(); });
+    }
+
+private:
+    std::int64_t drain() noexcept
+    {
+        std::int64_t sum = 0;
+        for (auto& stripe : _stripes)
+            sum += stripe.value.exchange(0, std::memory_order_relaxed);
+        return sum;
+    }
+
+    void flush_now()
+    {
+        std::unique_lock<std::mutex> ax(_flush_protect);
+
+        // Move the accumulators into the running total first, so they are kept if the write fails
+        _drained.fetch_add(drain(), std::memory_order_relaxed);
+        auto target = _drained.load(std::memory_order_relaxed);
+        if (target == _written.load(std::memory_order_relaxed))
+            return;
+
+        while (true)
+        {
+            try
+            {
+                // The version check stops a write whose reply was lost from replacing a newer total if the server
+                // only gets to it later
+                auto result = _conn.set(_shard_path, encode_value(target), _shard_version).get();
+                _shard_version = result.stat().data_version;
+                _written.store(target, std::memory_order_relaxed);
+                return;
+            }
+            catch (const version_mismatch&)
+            {
+                // Only this counter writes the shard, so an earlier write whose reply was lost was applied after all.
+                // It wrote an older total, so write this one over it.
+                _shard_version = _conn.get(_shard_path).get().stat().data_version;
+            }
+        }
+    }
+
+    std::int64_t read_total() const
+    {
+        // Read every shard of every counter. The reads are all sent before waiting for any of them.
+        auto children = _conn.get_children(_path).get().children();
+        std::vector<future<get_result>> reads;
+        reads.reserve(children.size());
+        for (const auto& name : children)
+        {
+            if (string_view(name).substr(0, shard_prefix.size()) == shard_prefix)
+                reads.emplace_back(_conn.get(child_path(_path, name)));
+        }
+
+        std::int64_t sum = 0;
+        for (auto& read : reads)
+            sum += decode_value(read.get().data());
+        return sum;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> ax(_stop_protect);
+        while (!_stopping)
+        {
+            if (_stop_cond.wait_for(ax, _flush_interval, [this] { return _stopping; }))
+                break;
+
+            ax.unlock();
+            try
+            {
+                flush_now();
+            }
+            catch (...)
+            {
+                // The increments are kept for the next attempt
+            }
+            ax.lock();
+        }
+    }
+
+private:
+    /// An accumulator on its own cache line.
+    struct alignas(64) stripe final
+    {
+        std::atomic<std::int64_t> value;
+    };
+
+private:
+    client                    _conn;
+    std::string               _path;
+    std::chrono::milliseconds _flush_interval;
+    std::array<stripe, 16>    _stripes;
+
+    std::mutex                _flush_protect;
+    std::string               _shard_path;
+    version                   _shard_version; //!< The version of the shard after the last write which succeeded.
+    std::atomic<std::int64_t> _drained;       //!< Every increment taken out of the stripes so far.
+    std::atomic<std::int64_t> _written;       //!< The value of \c _drained the server last confirmed.
+
+    std::mutex                _stop_protect;
+    std::condition_variable   _stop_cond;
+    bool                      _stopping;
+    std::thread               _worker;
+};
+
+}
+
+using detail::counter_core;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// counter                                                                                                            //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+counter::counter(client conn, std::string path, std::chrono::milliseconds flush_interval) :
+        _core(std::make_shared<counter_core>(std::move(conn), std::move(path), flush_interval))
+{
+    _core->start();
+}
+
+counter::~counter() noexcept
+{
+    _core->stop();
+}
+
+const std::string& counter::path() const
+{
+    return _core->path();
+}
+
+void counter::add(std::int64_t delta) noexcept
+{
+    _core->add(delta);
+}
+
+std::int64_t counter::pending() const noexcept
+{
+    return _core->pending();
+}
+
+future<void> counter::flush()
+{
+    return _core->flush();
+}
+
+future<std::int64_t> counter::total() const
+{
+    return _core->total();
+}
+
+}
@@ -0,0 +1,91 @@
+/// \file
+/// A counter shared between processes, which batches increments to avoid contention.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+namespace detail
+{
+
+class counter_core;
+
+}
+
+/// A counter shared between any number of processes, using the entry at a given path as its root. Updating a single
+/// entry with a read-modify-write loop of \ref client::set with version checks collapses under contention, as every
+/// writer but one fails each round. Instead:
+///
+/// - \ref add only updates an accumulator in memory, striped by thread so threads incrementing the same counter do not
+///   fight over one cache line.
+/// - Each \c counter creates its own shard entry under the root and is the only one to write it, so writers never
+///   conflict.
+/// - A background thread flushes every \c flush_interval with a single \ref client::set, so the number of writes does
+///   not grow with the number of increments. The shard holds the running total of its counter rather than a sum of
+///   deltas, so writing it again after a failure with an unknown outcome (such as \ref connection_loss, where the
+///   server might have applied the write before the reply was lost) can not count anything twice.
+///
+/// The \ref total is the sum of all the shards, so it is eventually exact: it includes every increment which has been
+/// flushed, which is every increment once all writers have been flushed or destroyed. Shards stay after their counter
+/// is destroyed, so a root gains one entry for every \c counter ever created on it -- prefer a few long-lived counters
+/// over many short-lived ones.
+///
+/// \code
+/// zk::recipes::counter requests(client, "/counters/requests");
+/// requests.add(1);
+/// ...
+/// std::int64_t count = requests.total().get();
+/// \endcode
+class counter final
+{
+public:
+    /// Create a counter rooted at \a path. The root is created if it does not exist, then the shard of this counter.
+    ///
+    /// \param flush_interval How often increments are written to the server in the background.
+    explicit counter(client                    conn,
+                     std::string               path,
+                     std::chrono::milliseconds flush_interval = std::chrono::milliseconds(100)
+                    );
+
+    counter(const counter&) = delete;
+    counter& operator=(const counter&) = delete;
+
+    /// Stop flushing in the background and make a last attempt to flush increments which have not been written.
+    ~counter() noexcept;
+
+    /// The path of the root of the counter.
+    const std::string& path() const;
+
+    /// Add \a delta to the counter. This only updates memory; the change is written by the next flush.
+    void add(std::int64_t delta) noexcept;
+
+    /// The sum of the increments which have not been written to the server yet.
+    std::int64_t pending() const noexcept;
+
+    /// Write all pending increments now. If this fails, the increments are kept for the next flush, even if the server
+    /// might have applied the write -- flushing them again does not count them twice.
+    future<void> flush();
+
+    /// Read the total of all shards, which includes every flushed increment from every process.
+    future<std::int64_t> total() const;
+
+private:
+    std::shared_ptr<detail::counter_core> _core;
+};
+
+/// \}
+
+}
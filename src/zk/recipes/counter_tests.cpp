@@ -0,0 +1,205 @@
+#include <zk/connection.hpp>
+#include <zk/error.hpp>
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+#include <zk/server/server_tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "counter.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class counter_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(counter_tests, add_from_threads)
+{
+    counter c(get_connected_client(), "/counter_tests/add_from_threads", 1h);
+
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx)
+        threads.emplace_back([&c] { for (int x = 0; x < 1000; ++x) c.add(1); });
+    for (auto& thread : threads)
+        thread.join();
+
+    // The flush interval is long, so nothing has been written yet
+    CHECK_EQ(4000, c.pending());
+    CHECK_EQ(0, c.total().get());
+
+    c.flush().get();
+    CHECK_EQ(0, c.pending());
+    CHECK_EQ(4000, c.total().get());
+}
+
+GTEST_TEST_F(counter_tests, shared_between_counters)
+{
+    counter a(get_connected_client(), "/counter_tests/shared_between_counters", 10ms);
+    {
+        counter b(get_connected_client(), "/counter_tests/shared_between_counters", 1h);
+        b.add(-5);
+        // Destroying the counter flushes what is left
+    }
+
+    a.add(12);
+    a.flush().get();
+    CHECK_EQ(7, a.total().get());
+
+    a.add(3);
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (a.total().get() != 10 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(10ms);
+    CHECK_EQ(10, a.total().get());
+}
+
+/// Forwards everything to a real connection, but can make a \c set look like it failed after the server applied it --
+/// as happens when the connection is lost before the reply arrives.
+class lost_reply_connection final :
+        public connection
+{
+public:
+    explicit lost_reply_connection(std::shared_ptr<connection> inner, error_code lost_with) :
+            _inner(std::move(inner)),
+            _lost_with(lost_with),
+            _lose_replies(0U)
+    { }
+
+    /// Apply the next \a count writes, but fail them.
+    void lose_next_replies(std::size_t count) { _lose_replies.store(count); }
+
+    void close() override { _inner->close(); }
+
+    future<get_result> get(path_view path, const request_options& options) override
+    {
+        return _inner->get(path, options);
+    }
+
+    future<watch_result> watch(path_view path, const request_options& options) override
+    {
+        return _inner->watch(path, options);
+    }
+
+    future<get_children_result> get_children(path_view path, const request_options& options) override
+    {
+        return _inner->get_children(path, options);
+    }
+
+    future<watch_children_result> watch_children(path_view path, const request_options& options) override
+    {
+        return _inner->watch_children(path, options);
+    }
+
+    future<exists_result> exists(path_view path, const request_options& options) override
+    {
+        return _inner->exists(path, options);
+    }
+
+    future<watch_exists_result> watch_exists(path_view path, const request_options& options) override
+    {
+        return _inner->watch_exists(path, options);
+    }
+
+    future<create_result> create(path_view              path,
+                                 const buffer&          data,
+                                 const acl&             rules,
+                                 create_mode            mode,
+                                 const request_options& options
+                                ) override
+    {
+        return _inner->create(path, data, rules, mode, options);
+    }
+
+    future<set_result> set(path_view path, const buffer& data, version check, const request_options& options) override
+    {
+        auto result = _inner->set(path, data, check, options);
+
+        auto remaining = _lose_replies.load();
+        if (remaining == 0U || !_lose_replies.compare_exchange_strong(remaining, remaining - 1U))
+            return result;
+
+        result.get();
+        promise<set_result> lost;
+        lost.set_exception(get_exception_ptr_of(_lost_with));
+        return lost.get_future();
+    }
+
+    future<void> erase(path_view path, version check, const request_options& options) override
+    {
+        return _inner->erase(path, check, options);
+    }
+
+    future<get_acl_result> get_acl(path_view path, const request_options& options) const override
+    {
+        return _inner->get_acl(path, options);
+    }
+
+    future<void> set_acl(path_view path, const acl& rules, acl_version check, const request_options& options) override
+    {
+        return _inner->set_acl(path, rules, check, options);
+    }
+
+    future<multi_result> commit(multi_op&& txn, const request_options& options) override
+    {
+        return _inner->commit(std::move(txn), options);
+    }
+
+    future<void> load_fence(const request_options& options) override
+    {
+        return _inner->load_fence(options);
+    }
+
+    zk::state state() const override { return _inner->state(); }
+
+private:
+    std::shared_ptr<connection> _inner;
+    error_code                  _lost_with;
+    std::atomic<std::size_t>    _lose_replies;
+};
+
+GTEST_TEST_F(counter_tests, lost_reply)
+{
+    for (auto lost_with : { error_code::connection_loss, error_code::operation_timeout })
+    {
+        auto inner = connection::connect(get_connection_string());
+        auto state = inner->watch_state();
+        if (inner->state() != zk::state::connected)
+            state.get();
+        auto conn = std::make_shared<lost_reply_connection>(std::move(inner), lost_with);
+
+        auto    path = "/counter_tests/lost_reply/" + to_string(lost_with);
+        counter c(client(conn), path, 1h);
+
+        c.add(5);
+        conn->lose_next_replies(1U);
+        try
+        {
+            c.flush().get();
+            CHECK_FAIL() << "flush should have failed with " << lost_with;
+        }
+        catch (const error& ex)
+        {
+            CHECK_EQ(lost_with, ex.code());
+        }
+
+        // The write went through, but the counter can not know that -- flushing again must not count it twice
+        CHECK_EQ(5, c.pending());
+        CHECK_EQ(5, c.total().get());
+        c.flush().get();
+        CHECK_EQ(0, c.pending());
+        CHECK_EQ(5, c.total().get());
+
+        c.add(2);
+        c.flush().get();
+        CHECK_EQ(7, c.total().get());
+    }
+}
+
+}
@@ -0,0 +1,86 @@
+#include "nodes.hpp"
+
+#include <zk/client.hpp>
+#include <zk/error.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace zk::recipes::detail
+{
+
+void ensure_path(client& conn, string_view path)
+{
+    // Check the full path first, as it usually exists and this saves a create per ancestor.
+    if (path.empty() || path == "/" || conn.exists(path).get())
+        return;
+
+    for (auto slash = path.find('/', 1U); ; slash = path.find('/', slash + 1U))
+    {
+        auto prefix = path.substr(0, slash);
+        try
+        {
+            conn.create(prefix, buffer()).get();
+        }
+        catch (const entry_exists&)
+        { }
+
+        if (slash == string_view::npos)
+            break;
+    }
+}
+
+std::string child_path(string_view parent, string_view name)
+{
+    std::string out;
+    out.reserve(parent.size() + name.size() + 1U);
+    out.append(parent.data(), parent.size());
+    if (out.empty() || out.back() != '/')
+        out.push_back('/');
+    out.append(name.data(), name.size());
+    return out;
+}
+
+string_view leaf_of(string_view path)
+{
+    auto slash = path.rfind('/');
+    return slash == string_view::npos ? path : path.substr(slash + 1U);
+}
+
+optional<std::int64_t> sequence_of(string_view name)
+{
+    // The server always formats the sequence as 10 digits (it might be negative if the counter overflows)
+    static constexpr std::size_t digits = 10U;
+    if (name.size() < digits)
+        return nullopt;
+
+    auto suffix = name.substr(name.size() - digits);
+    auto negative = suffix.front() == '-';
+    std::int64_t out = 0;
+    for (std::size_t idx = negative ? 1U : 0U; idx < digits; ++idx)
+    {
+        if (suffix[idx] < '0' || suffix[idx] > '9')
+            return nullopt;
+        out = out * 10 + (suffix[idx] - '0');
+    }
+    return negative ? -out : out;
+}
+
+std::vector<std::string> sorted_by_sequence(std::vector<std::string> names)
+{
+    std::vector<std::pair<std::int64_t, std::string>> keyed;
+    keyed.reserve(names.size());
+    for (auto& name : names)
+    {
+        if (auto seq = sequence_of(name))
+            keyed.emplace_back(*seq, std::move(name));
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    names.clear();
+    for (auto& item : keyed)
+        names.emplace_back(std::move(item.second));
+    return names;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/forwards.hpp>
+#include <zk/optional.hpp>
+#include <zk/string_view.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace zk::recipes::detail
+{
+
+/** Create the entry at \a path and all of its missing ancestors as empty, persistent entries. Entries which already
+ *  exist are left alone.
+**/
+void ensure_path(client& conn, string_view path);
+
+/** Get the path of the child \a name of \a parent. **/
+std::string child_path(string_view parent, string_view name);
+
+/** Get the last component of \a path. **/
+string_view leaf_of(string_view path);
+
+/** Get the sequence number the server appended to \a name when creating it with \ref create_mode::sequential, or
+ *  \c nullopt if \a name does not end in one.
+**/
+optional<std::int64_t> sequence_of(string_view name);
+
+/** Sort \a names by their \ref sequence_of, dropping any which do not have one. Names created with different prefixes
+ *  under the same parent are ordered by creation, as the server shares one sequence between all children of a parent.
+**/
+std::vector<std::string> sorted_by_sequence(std::vector<std::string> names);
+
+}
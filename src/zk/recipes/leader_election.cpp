@@ -0,0 +1,437 @@
+#include "leader_election.hpp"
+
+#include <zk/connection.hpp>
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/results.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// election_core                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Wakes the election thread when one of the watches it is waiting on is triggered or the election is stopped. This is
+/// shared with the watches, which can outlive the election.
+class election_signal final
+{
+public:
+    election_signal() :
+            _round(0U),
+            _changed(false),
+            _stopping(false)
+    { }
+
+    /// Start a new round of watches: from now on, triggers of the watches of earlier rounds are ignored.
+    std::uint64_t next_round()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _changed = false;
+        return ++_round;
+    }
+
+    /// A watch of \a round was triggered.
+    void notify(std::uint64_t round)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (round != _round)
+            return;
+
+        _changed = true;
+        _wakeup.notify_all();
+    }
+
+    void stop()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _stopping = true;
+        _wakeup.notify_all();
+    }
+
+    /// Block until a watch of the current round is triggered or the election is stopped.
+    void wait()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _wakeup.wait(ax, [this] { return _changed || _stopping; });
+    }
+
+    /// Block for \a delay, unless the election is stopped first.
+    void wait_for(std::chrono::milliseconds delay)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _wakeup.wait_for(ax, delay, [this] { return _stopping; });
+    }
+
+private:
+    std::mutex              _protect;
+    std::condition_variable _wakeup;
+    std::uint64_t           _round;
+    bool                    _changed;
+    bool                    _stopping;
+};
+
+/// Watches a single candidate entry for the \ref election_signal. Candidate entries are ephemeral, so they never have
+/// children: the child watch is only triggered when the entry is erased or the session changes, and if the entry is
+/// already gone, the fetch fails and leaves no watch behind.
+class entry_listener final :
+        public watch_children_listener
+{
+public:
+    explicit entry_listener(std::shared_ptr<election_signal> signal, std::uint64_t round) :
+            _signal(std::move(signal)),
+            _round(round)
+    { }
+
+    /// Get a future which is delivered once the watch is armed, or with \ref no_entry if the entry is gone.
+    future<void> armed()
+    {
+        return _armed.get_future();
+    }
+
+    virtual void on_children(get_children_result) override
+    {
+        _armed.set_value();
+    }
+
+    virtual void on_error(zk::exception_ptr ex) override
+    {
+        _armed.set_exception(std::move(ex));
+    }
+
+    virtual void on_event(event) override
+    {
+        _signal->notify(_round);
+    }
+
+private:
+    std::shared_ptr<election_signal> _signal;
+    std::uint64_t                    _round;
+    promise<void>                    _armed;
+};
+
+class election_core final
+{
+public:
+    /// How long to wait before checking the election again after an operation failed (most likely because the
+    /// connection is in trouble).
+    static constexpr std::chrono::milliseconds retry_delay = std::chrono::milliseconds(50);
+
+public:
+    explicit election_core(client conn, std::string path, buffer data) :
+            _conn(std::move(conn)),
+            _path(std::move(path)),
+            _data(std::move(data)),
+            _stopping(false),
+            _signal(std::make_shared<election_signal>()),
+            _leader(false),
+            _stopped(false)
+    {
+        _worker = std::thread([this] { run(); });
+    }
+
+    ~election_core() noexcept
+    {
+        stop();
+    }
+
+    const std::string& path() const { return _path; }
+
+    bool is_leader() const
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        return _leader;
+    }
+
+    future<void> leadership_gained()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        return add_waiter(_gained_waiters, _leader);
+    }
+
+    future<void> leadership_lost()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        return add_waiter(_lost_waiters, false);
+    }
+
+    void stop() noexcept
+    {
+        if (_stopping.exchange(true))
+        {
+            if (_worker.joinable())
+                _worker.join();
+            return;
+        }
+        _signal->stop();
+
+        // Remove the entry from here instead of waiting for the worker to notice, so the next candidate is notified as
+        // soon as possible.
+        std::unique_lock<std::mutex> ax(_protect);
+        auto node = std::exchange(_node, nullopt);
+        ax.unlock();
+        if (node)
+            erase_quietly(*node);
+
+        _worker.join();
+    }
+
+private:
+    /// Must be called with \c _protect held.
+    future<void> add_waiter(std::vector<promise<void>>& waiters, bool ready)
+    {
+        promise<void> p;
+        auto out = p.get_future();
+        if (ready)
+            p.set_value();
+        else if (_stopped)
+            p.set_exception(get_exception_ptr_of(error_code::closed));
+        else
+            waiters.emplace_back(std::move(p));
+        return out;
+    }
+
+    void erase_quietly(const std::string& node) noexcept
+    {
+        try
+        {
+            _conn.erase(node).get();
+        }
+        catch (...)
+        {
+            // The entry is gone already or the session is -- either way, the entry is ephemeral, so it will not outlive
+            // the session.
+        }
+    }
+
+    void set_leader(bool leader)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (_leader == leader)
+            return;
+
+        _leader = leader;
+        auto waiters = std::move(leader ? _gained_waiters : _lost_waiters);
+        ax.unlock();
+
+        for (auto& p : waiters)
+            p.set_value();
+    }
+
+    /// Make sure this candidate has an entry, creating one if needed.
+    ///
+    /// \returns The name of the entry (relative to the root) or \c nullopt if the election is stopping.
+    optional<std::string> ensure_node()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        if (_node)
+            return std::string(leaf_of(*_node));
+        ax.unlock();
+
+        ensure_path(_conn, _path);
+        auto node = _conn.create(child_path(_path, "candidate-"),
+                                 _data,
+                                 create_mode::ephemeral | create_mode::sequential
+                                )
+                         .get()
+                         .name();
+
+        ax.lock();
+        if (_stopping)
+        {
+            // stop() already looked for the entry to remove, so it is up to this thread.
+            ax.unlock();
+            erase_quietly(node);
+            return nullopt;
+        }
+        _node = node;
+        return std::string(leaf_of(node));
+    }
+
+    /// Arm a watch for the removal of the entry \a name, which is part of \a round (see \ref entry_listener).
+    ///
+    /// \returns \c true if the watch was armed or \c false if the entry is already gone.
+    bool watch_entry(string_view name, std::uint64_t round)
+    {
+        auto listener = std::make_shared<entry_listener>(_signal, round);
+        auto armed    = listener->armed();
+        _conn.listen_children(child_path(_path, name), std::move(listener));
+        try
+        {
+            armed.get();
+            return true;
+        }
+        catch (const no_entry&)
+        {
+            return false;
+        }
+    }
+
+    /// Check the state of the election and arm watches for the next change which might affect it.
+    ///
+    /// \returns \c true if the watches are armed, \c false if the state should be checked again right away.
+    bool check_election()
+    {
+        auto own = ensure_node();
+        if (!own)
+            return false;
+
+        auto round  = _signal->next_round();
+        auto sorted = sorted_by_sequence(_conn.get_children(_path).get().children());
+        auto iter   = std::find(sorted.begin(), sorted.end(), *own);
+        if (iter == sorted.end() || !watch_entry(*own, round))
+        {
+            // The entry was removed out from under us: the session expired (and was maybe recovered), someone erased
+            // it, or this is racing with stop(). Either way, this is not the leader anymore. Watching our own entry is
+            // what tells us this happened while waiting.
+            set_leader(false);
+            std::unique_lock<std::mutex> ax(_protect);
+            _node = nullopt;
+            return false;
+        }
+        else if (iter == sorted.begin())
+        {
+            set_leader(true);
+            return true;
+        }
+        else
+        {
+            set_leader(false);
+            return watch_entry(*std::prev(iter), round);
+        }
+    }
+
+    /// Handle a change of the state of the session.
+    void on_state_change(future<zk::state>& change)
+    {
+        try
+        {
+            change.get();
+        }
+        catch (const session_expired&)
+        {
+            // The server removed the entry when the session expired; wait for the session to come back (the next
+            // operation will fail until it does).
+            set_leader(false);
+            std::unique_lock<std::mutex> ax(_protect);
+            _node = nullopt;
+        }
+        catch (...)
+        {
+            // Nothing else changes leadership -- if the connection was closed, the next operation fails.
+        }
+        change = _conn.watch_state();
+    }
+
+    void run()
+    {
+        auto state_change = _conn.watch_state();
+        while (!_stopping)
+        {
+            try
+            {
+                // A change of the session which matters to the election also triggers the watches: the connection
+                // delivers them with a session event or, when the session is recovered, the own entry is gone.
+                if (check_election())
+                    _signal->wait();
+            }
+            catch (...)
+            {
+                // Most likely the connection is in trouble -- give it a moment before trying again.
+                _signal->wait_for(retry_delay);
+            }
+
+            if (state_change.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                on_state_change(state_change);
+        }
+
+        std::unique_lock<std::mutex> ax(_protect);
+        auto node = std::exchange(_node, nullopt);
+        ax.unlock();
+        if (node)
+            erase_quietly(*node);
+        set_leader(false);
+
+        ax.lock();
+        _stopped = true;
+        auto gained_waiters = std::move(_gained_waiters);
+        auto lost_waiters   = std::move(_lost_waiters);
+        ax.unlock();
+        for (auto& p : gained_waiters)
+            p.set_exception(get_exception_ptr_of(error_code::closed));
+        for (auto& p : lost_waiters)
+            p.set_exception(get_exception_ptr_of(error_code::closed));
+    }
+
+private:
+    client                           _conn;
+    std::string                      _path;
+    buffer                           _data;
+    std::atomic<bool>                _stopping;
+    std::shared_ptr<election_signal> _signal;
+    mutable std::mutex               _protect;
+    optional<std::string>            _node;
+    bool                             _leader;
+    bool                             _stopped;
+    std::vector<promise<void>>       _gained_waiters;
+    std::vector<promise<void>>       _lost_waiters;
+    std::thread                      _worker;
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// leader_election                                                                                                    //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+leader_election::leader_election(client conn, std::string path, buffer data) :
+        _core(std::make_unique<detail::election_core>(std::move(conn), std::move(path), std::move(data)))
+{ }
+
+leader_election::~leader_election() noexcept
+{
+    resign();
+}
+
+const std::string& leader_election::path() const
+{
+    return _core->path();
+}
+
+bool leader_election::is_leader() const
+{
+    return _core->is_leader();
+}
+
+future<void> leader_election::leadership_gained()
+{
+    return _core->leadership_gained();
+}
+
+future<void> leader_election::leadership_lost()
+{
+    return _core->leadership_lost();
+}
+
+void leader_election::resign()
+{
+    _core->stop();
+}
+
+}
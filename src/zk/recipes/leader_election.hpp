@@ -0,0 +1,90 @@
+/// \file
+/// Electing a single leader from a group of candidates.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/buffer.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+
+#include <memory>
+#include <string>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+namespace detail
+{
+
+class election_core;
+
+}
+
+/// A candidate in an election for a single leader among any number of processes, using the entry at a given path as
+/// its root. Each candidate creates a sequential ephemeral entry under the root and the candidate with the lowest
+/// sequence number is the leader. Each other candidate watches only the entry just before its own, so when the leader
+/// goes away, exactly one candidate is notified and it takes over without waiting for anything else. The watches are
+/// delivered through \ref client::listen_children, which wakes the election right away -- nothing polls the list of
+/// candidates or the watches.
+///
+/// The election is run on a thread owned by the candidate, which sleeps until a watch is triggered. Each candidate also
+/// watches its own entry, so it notices when the entry is removed. Changes to the session are tracked through
+/// \ref client::watch_state when the watches wake the thread: leadership is lost when the session expires (as the entry
+/// is removed by the server), and the candidate rejoins the election once the session is usable again (for example,
+/// with \ref connection_params::session_recovery). A leader which loses its connection to the ensemble is still the
+/// leader until the session expires; if the work it does must stop while disconnected, check \ref client::state.
+///
+/// \code
+/// zk::recipes::leader_election election(client, "/elections/shard-12");
+/// election.leadership_gained().get();
+/// // ...do the work of the leader until this is ready...
+/// auto lost = election.leadership_lost();
+/// \endcode
+class leader_election final
+{
+public:
+    /// Join the election rooted at \a path. The root (and any missing ancestors) is created if it does not exist.
+    ///
+    /// \param data The data of the entry of this candidate, which other processes can read to find the leader.
+    explicit leader_election(client conn, std::string path, buffer data = buffer());
+
+    leader_election(const leader_election&) = delete;
+    leader_election& operator=(const leader_election&) = delete;
+
+    /// Leave the election (see \ref resign).
+    ~leader_election() noexcept;
+
+    /// The path of the root of the election.
+    const std::string& path() const;
+
+    /// Is this candidate currently the leader?
+    bool is_leader() const;
+
+    /// Get a future which is delivered when this candidate becomes the leader. If it is already the leader, the future
+    /// is already delivered.
+    ///
+    /// \throws closed if the candidate resigns before becoming the leader, the future will be delivered with
+    ///  \ref closed.
+    future<void> leadership_gained();
+
+    /// Get a future which is delivered when this candidate stops being the leader. If it is not currently the leader,
+    /// this is delivered after it is next elected and then loses leadership.
+    ///
+    /// \throws closed if the candidate resigns without being the leader, the future will be delivered with
+    ///  \ref closed.
+    future<void> leadership_lost();
+
+    /// Leave the election. If this candidate is the leader, the next candidate is notified as soon as the entry of this
+    /// one is removed. This waits for the thread running the election to stop and can be called more than once.
+    void resign();
+
+private:
+    std::unique_ptr<detail::election_core> _core;
+};
+
+/// \}
+
+}
@@ -0,0 +1,69 @@
+#include <zk/error.hpp>
+#include <zk/server/server_tests.hpp>
+
+#include <chrono>
+
+#include "leader_election.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class leader_election_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(leader_election_tests, single_candidate)
+{
+    leader_election a(get_connected_client(), "/leader_election_tests/single_candidate");
+
+    a.leadership_gained().get();
+    CHECK_TRUE(a.is_leader());
+
+    auto lost = a.leadership_lost();
+    CHECK_EQ(std::future_status::timeout, lost.wait_for(100ms));
+    a.resign();
+    lost.get();
+    CHECK_FALSE(a.is_leader());
+}
+
+GTEST_TEST_F(leader_election_tests, failover)
+{
+    leader_election a(get_connected_client(), "/leader_election_tests/failover");
+    a.leadership_gained().get();
+
+    leader_election b(get_connected_client(), "/leader_election_tests/failover");
+    leader_election c(get_connected_client(), "/leader_election_tests/failover");
+    auto b_gained = b.leadership_gained();
+    auto c_gained = c.leadership_gained();
+    CHECK_EQ(std::future_status::timeout, b_gained.wait_for(200ms));
+    CHECK_FALSE(b.is_leader());
+
+    auto a_lost = a.leadership_lost();
+    a.resign();
+    a_lost.get();
+    b_gained.get();
+    CHECK_TRUE(b.is_leader());
+
+    // Only the next candidate in line takes over
+    CHECK_EQ(std::future_status::timeout, c_gained.wait_for(200ms));
+    b.resign();
+    c_gained.get();
+    CHECK_TRUE(c.is_leader());
+}
+
+GTEST_TEST_F(leader_election_tests, resign_before_elected)
+{
+    leader_election a(get_connected_client(), "/leader_election_tests/resign_before_elected");
+    a.leadership_gained().get();
+
+    leader_election b(get_connected_client(), "/leader_election_tests/resign_before_elected");
+    auto b_gained = b.leadership_gained();
+    b.resign();
+    CHECK_THROWS(closed) { b_gained.get(); };
+    CHECK_THROWS(closed) { b.leadership_lost().get(); };
+    CHECK_TRUE(a.is_leader());
+}
+
+}
@@ -0,0 +1,395 @@
+#include "lock.hpp"
+
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/results.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// lock_metrics                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+lock_metrics::lock_metrics() noexcept :
+        _acquisitions(0U),
+        _total_wait(0),
+        _max_wait(0),
+        _last_wait(0)
+{ }
+
+lock_metrics::duration lock_metrics::mean_wait() const noexcept
+{
+    auto count = acquisitions();
+    if (count == 0U)
+        return duration(0);
+    else
+        return duration(total_wait().count() / duration::rep(count));
+}
+
+void lock_metrics::record(duration wait) noexcept
+{
+    auto nanos = wait.count();
+    _acquisitions.fetch_add(1U, std::memory_order_relaxed);
+    _total_wait.fetch_add(nanos, std::memory_order_relaxed);
+    _last_wait.store(nanos, std::memory_order_relaxed);
+
+    auto prev_max = _max_wait.load(std::memory_order_relaxed);
+    while (prev_max < nanos && !_max_wait.compare_exchange_weak(prev_max, nanos, std::memory_order_relaxed))
+    { }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// lock_core                                                                                                          //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+enum class lock_mode
+{
+    exclusive,
+    shared,
+};
+
+/// The state of a single participant in a lock. This is shared with the thread acquiring the lock, so the participant
+/// can be destroyed while an acquisition is in progress.
+class lock_core final :
+        public std::enable_shared_from_this<lock_core>
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+public:
+    /// \param typed Is this a \ref shared_mutex, where entries are marked as readers or writers?
+    explicit lock_core(client conn, std::string path, bool typed) :
+            _conn(std::move(conn)),
+            _path(std::move(path)),
+            _typed(typed),
+            _busy(false),
+            _abandoned(false),
+            _mode(lock_mode::exclusive)
+    { }
+
+    const std::string& path() const { return _path; }
+
+    const lock_metrics& metrics() const { return _metrics; }
+
+    bool owns(lock_mode mode) const
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        return _node && _mode == mode;
+    }
+
+    /// Start acquiring the lock in the given \a mode on a new thread. The result is \c true if the lock was acquired,
+    /// which is always the case if \a wait is set.
+    template <typename TResult>
+    future<TResult> acquire(lock_mode mode, bool wait)
+    {
+        try
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            if (_busy || _node)
+                zk::throw_exception(std::logic_error("Lock " + _path + " is already held or being acquired"));
+            _busy = true;
+        }
+        catch (...)
+        {
+            promise<TResult> p;
+            p.set_exception(zk::current_exception());
+            return p.get_future();
+        }
+
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), mode, wait, start = clock::now()]
+                         {
+                             return static_cast<TResult>(self->run(mode, wait, start));
+                         }
+                        );
+    }
+
+    future<void> release(lock_mode mode)
+    {
+        std::string node;
+        try
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            if (!_node || _mode != mode)
+                zk::throw_exception(std::logic_error("Lock " + _path + " is not held in the requested mode"));
+            node = std::move(*_node);
+            _node.reset();
+        }
+        catch (...)
+        {
+            promise<void> p;
+            p.set_exception(zk::current_exception());
+            return p.get_future();
+        }
+
+        return _conn.erase(node);
+    }
+
+    /// Called when the owner of this participant is destroyed. Release the lock now if it is held or as soon as the
+    /// acquisition in progress completes.
+    void abandon() noexcept
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _abandoned = true;
+        if (_node)
+        {
+            // Nobody is waiting for the result, so don't wait for it either -- the entry is ephemeral, so the worst case
+            // of this failing is the lock is held until the session ends.
+            _conn.erase(*_node);
+            _node.reset();
+        }
+    }
+
+private:
+    string_view prefix_of(lock_mode mode) const
+    {
+        if (!_typed)
+            return "lock-";
+        else if (mode == lock_mode::exclusive)
+            return "write-";
+        else
+            return "read-";
+    }
+
+    /// Find the entry the entry at \a idx of \a sorted has to wait for or \c nullopt if it holds the lock.
+    optional<std::string> blocker_of(const std::vector<std::string>& sorted, std::size_t idx, lock_mode mode) const
+    {
+        if (idx == 0U)
+            return nullopt;
+        else if (!_typed || mode == lock_mode::exclusive)
+            return sorted[idx - 1U];
+
+        // A reader only has to wait for the writer closest to it -- other readers do not exclude it and all the writers
+        // before that one will be released first.
+        auto writer_prefix = prefix_of(lock_mode::exclusive);
+        for (auto iter = sorted.rend() - std::ptrdiff_t(idx); iter != sorted.rend(); ++iter)
+        {
+            if (string_view(*iter).substr(0, writer_prefix.size()) == writer_prefix)
+                return *iter;
+        }
+        return nullopt;
+    }
+
+    /// Create the entry for this participant and wait until it holds the lock.
+    ///
+    /// \returns The path of the entry if the lock is held or \c nullopt if \a wait is not set and it is not.
+    optional<std::string> run_acquire(lock_mode mode, bool wait, clock::time_point start)
+    {
+        detail::ensure_path(_conn, _path);
+        auto node = _conn.create(child_path(_path, prefix_of(mode)),
+                                 buffer(),
+                                 create_mode::ephemeral | create_mode::sequential
+                                )
+                         .get()
+                         .name();
+        auto own = std::string(leaf_of(node));
+
+        try
+        {
+            while (true)
+            {
+                auto sorted = sorted_by_sequence(_conn.get_children(_path).get().children());
+                auto iter   = std::find(sorted.begin(), sorted.end(), own);
+                if (iter == sorted.end())
+                    zk::throw_exception(no_entry());
+
+                auto blocker = blocker_of(sorted, std::size_t(std::distance(sorted.begin(), iter)), mode);
+                if (!blocker)
+                {
+                    _metrics.record(clock::now() - start);
+                    return node;
+                }
+                else if (!wait)
+                {
+                    _conn.erase(node).get();
+                    return nullopt;
+                }
+
+                // Only watch the blocker -- when it goes away, check the children again, as the blocker might have
+                // been a waiter which gave up rather than the holder of the lock. This is a data watch rather than an
+                // existence watch: if the blocker is already gone, the fetch fails and leaves no watch behind on a
+                // sequential name which will never be used again.
+                try
+                {
+                    _conn.watch(child_path(_path, *blocker)).get().next().get();
+                }
+                catch (const no_entry&)
+                { }
+            }
+        }
+        catch (...)
+        {
+            _conn.erase(node);
+            throw;
+        }
+    }
+
+    bool run(lock_mode mode, bool wait, clock::time_point start)
+    {
+        optional<std::string> node;
+        try
+        {
+            node = run_acquire(mode, wait, start);
+        }
+        catch (...)
+        {
+            finish(nullopt, mode);
+            throw;
+        }
+        return finish(std::move(node), mode);
+    }
+
+    bool finish(optional<std::string> node, lock_mode mode)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _busy = false;
+        if (!node)
+            return false;
+
+        if (_abandoned)
+        {
+            _conn.erase(*node);
+            return false;
+        }
+
+        _node = std::move(node);
+        _mode = mode;
+        return true;
+    }
+
+private:
+    client                _conn;
+    std::string           _path;
+    bool                  _typed;
+    lock_metrics          _metrics;
+    mutable std::mutex    _protect;
+    bool                  _busy;
+    bool                  _abandoned;
+    optional<std::string> _node;
+    lock_mode             _mode;
+};
+
+}
+
+using detail::lock_core;
+using detail::lock_mode;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// mutex                                                                                                              //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+mutex::mutex(client conn, std::string path) :
+        _core(std::make_shared<lock_core>(std::move(conn), std::move(path), false))
+{ }
+
+mutex::~mutex() noexcept
+{
+    _core->abandon();
+}
+
+const std::string& mutex::path() const
+{
+    return _core->path();
+}
+
+future<void> mutex::lock()
+{
+    return _core->acquire<void>(lock_mode::exclusive, true);
+}
+
+future<bool> mutex::try_lock()
+{
+    return _core->acquire<bool>(lock_mode::exclusive, false);
+}
+
+future<void> mutex::unlock()
+{
+    return _core->release(lock_mode::exclusive);
+}
+
+bool mutex::owns_lock() const
+{
+    return _core->owns(lock_mode::exclusive);
+}
+
+const lock_metrics& mutex::metrics() const
+{
+    return _core->metrics();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// shared_mutex                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+shared_mutex::shared_mutex(client conn, std::string path) :
+        _core(std::make_shared<lock_core>(std::move(conn), std::move(path), true))
+{ }
+
+shared_mutex::~shared_mutex() noexcept
+{
+    _core->abandon();
+}
+
+const std::string& shared_mutex::path() const
+{
+    return _core->path();
+}
+
+future<void> shared_mutex::lock()
+{
+    return _core->acquire<void>(lock_mode::exclusive, true);
+}
+
+future<bool> shared_mutex::try_lock()
+{
+    return _core->acquire<bool>(lock_mode::exclusive, false);
+}
+
+future<void> shared_mutex::unlock()
+{
+    return _core->release(lock_mode::exclusive);
+}
+
+future<void> shared_mutex::lock_shared()
+{
+    return _core->acquire<void>(lock_mode::shared, true);
+}
+
+future<bool> shared_mutex::try_lock_shared()
+{
+    return _core->acquire<bool>(lock_mode::shared, false);
+}
+
+future<void> shared_mutex::unlock_shared()
+{
+    return _core->release(lock_mode::shared);
+}
+
+bool shared_mutex::owns_lock() const
+{
+    return _core->owns(lock_mode::exclusive);
+}
+
+bool shared_mutex::owns_shared_lock() const
+{
+    return _core->owns(lock_mode::shared);
+}
+
+const lock_metrics& shared_mutex::metrics() const
+{
+    return _core->metrics();
+}
+
+}
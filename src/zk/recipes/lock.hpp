@@ -0,0 +1,180 @@
+/// \file
+/// Distributed locks built on sequential ephemeral entries.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace zk::recipes
+{
+
+/// \defgroup Recipes
+/// Coordination primitives built out of \ref client operations, following the
+/// <a href="https://zookeeper.apache.org/doc/current/recipes.html">ZooKeeper recipes</a>.
+/// \{
+
+namespace detail
+{
+
+class lock_core;
+
+}
+
+/// Measures how long a lock takes to acquire: the time from the call to \c lock until the lock is held. This is updated
+/// from the thread acquiring the lock and can be read from any thread.
+class lock_metrics final
+{
+public:
+    using duration = std::chrono::nanoseconds;
+
+public:
+    lock_metrics() noexcept;
+
+    /// The number of times the lock was acquired.
+    std::uint64_t acquisitions() const noexcept { return _acquisitions.load(std::memory_order_relaxed); }
+
+    /// The time spent waiting for all acquisitions.
+    duration total_wait() const noexcept { return duration(_total_wait.load(std::memory_order_relaxed)); }
+
+    /// The longest time spent waiting for a single acquisition.
+    duration max_wait() const noexcept { return duration(_max_wait.load(std::memory_order_relaxed)); }
+
+    /// The time spent waiting for the most recent acquisition.
+    duration last_wait() const noexcept { return duration(_last_wait.load(std::memory_order_relaxed)); }
+
+    /// The average time spent waiting for an acquisition or \c 0 if the lock was never acquired.
+    duration mean_wait() const noexcept;
+
+    /// Record an acquisition which took \a wait.
+    void record(duration wait) noexcept;
+
+private:
+    std::atomic<std::uint64_t>  _acquisitions;
+    std::atomic<duration::rep>  _total_wait;
+    std::atomic<duration::rep>  _max_wait;
+    std::atomic<duration::rep>  _last_wait;
+};
+
+/// An exclusive lock shared between any number of processes, using the entry at a given path as its root. Each
+/// participant waiting for the lock creates a sequential ephemeral entry under the root, and the participant with the
+/// lowest sequence number holds the lock. Each waiter watches only the entry just before its own with
+/// \ref client::watch_exists, so releasing the lock wakes exactly one waiter, instead of all of them -- the cost of
+/// handing the lock over does not grow with the number of waiters.
+///
+/// Since the entries are ephemeral, a participant which loses its session releases the lock automatically. Keep in mind
+/// that the process might not notice this until it tries to use the session again.
+///
+/// A \c mutex is one participant: it can hold the lock at most once and does not protect threads in the same process
+/// from each other.
+///
+/// \code
+/// zk::recipes::mutex lock(client, "/locks/my-resource");
+/// lock.lock().get();
+/// // ...do work...
+/// lock.unlock().get();
+/// \endcode
+class mutex final
+{
+public:
+    /// Create a participant in the lock rooted at \a path. The root (and any missing ancestors) is created when the
+    /// lock is first acquired.
+    explicit mutex(client conn, std::string path);
+
+    mutex(const mutex&) = delete;
+    mutex& operator=(const mutex&) = delete;
+
+    /// Release the lock if it is held. If an acquisition is still in progress, the lock is released as soon as it
+    /// completes.
+    ~mutex() noexcept;
+
+    /// The path of the root of the lock.
+    const std::string& path() const;
+
+    /// Acquire the lock. The returned future is delivered once the lock is held. This is run on its own thread, so keep
+    /// in mind that destroying the future waits for the acquisition to complete.
+    ///
+    /// \throws std::logic_error if this participant already holds or is acquiring the lock, the future will be delivered
+    ///  with \c std::logic_error.
+    /// \throws no_entry if the entry of this participant was removed while waiting (most likely because the session
+    ///  expired), the future will be delivered with \ref no_entry.
+    future<void> lock();
+
+    /// Acquire the lock if no other participant holds it or is waiting for it. The returned future is delivered with
+    /// \c true if the lock was acquired.
+    future<bool> try_lock();
+
+    /// Release the lock.
+    ///
+    /// \throws std::logic_error if this participant does not hold the lock, the future will be delivered with
+    ///  \c std::logic_error.
+    future<void> unlock();
+
+    /// Does this participant hold the lock?
+    bool owns_lock() const;
+
+    /// Measurements of how long this participant took to acquire the lock.
+    const lock_metrics& metrics() const;
+
+private:
+    std::shared_ptr<detail::lock_core> _core;
+};
+
+/// A lock which can be held exclusively by one participant or shared by any number of participants, but not both. This
+/// works like \ref mutex, but each entry under the root is marked as either a reader or a writer. A reader only waits
+/// for the closest writer before it and a writer waits for the entry just before it, so no participant is woken for a
+/// release which does not let it proceed. Participants are granted the lock in the order they asked for it, so a
+/// steady stream of readers can not starve a writer.
+///
+/// A \c shared_mutex can not use the same root as a \ref mutex.
+class shared_mutex final
+{
+public:
+    /// Create a participant in the lock rooted at \a path.
+    explicit shared_mutex(client conn, std::string path);
+
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    /// Release the lock if it is held.
+    ~shared_mutex() noexcept;
+
+    /// The path of the root of the lock.
+    const std::string& path() const;
+
+    /// \{
+    /// Acquire, try to acquire or release exclusive ownership. These behave like their counterparts in \ref mutex.
+    future<void> lock();
+    future<bool> try_lock();
+    future<void> unlock();
+    /// \}
+
+    /// \{
+    /// Acquire, try to acquire or release shared ownership. These behave like their counterparts in \ref mutex.
+    future<void> lock_shared();
+    future<bool> try_lock_shared();
+    future<void> unlock_shared();
+    /// \}
+
+    /// Does this participant hold the lock exclusively?
+    bool owns_lock() const;
+
+    /// Does this participant share ownership of the lock?
+    bool owns_shared_lock() const;
+
+    /// Measurements of how long this participant took to acquire the lock, in either mode.
+    const lock_metrics& metrics() const;
+
+private:
+    std::shared_ptr<detail::lock_core> _core;
+};
+
+/// \}
+
+}
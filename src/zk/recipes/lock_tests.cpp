@@ -0,0 +1,90 @@
+#include <zk/server/server_tests.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+#include "lock.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class lock_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(lock_tests, mutex_exclusive)
+{
+    mutex a(get_connected_client(), "/lock_tests/mutex_exclusive");
+    mutex b(get_connected_client(), "/lock_tests/mutex_exclusive");
+
+    a.lock().get();
+    CHECK_TRUE(a.owns_lock());
+    CHECK_FALSE(b.try_lock().get());
+
+    auto b_locked = b.lock();
+    CHECK_EQ(std::future_status::timeout, b_locked.wait_for(200ms));
+
+    a.unlock().get();
+    b_locked.get();
+    CHECK_TRUE(b.owns_lock());
+    CHECK_FALSE(a.owns_lock());
+    b.unlock().get();
+
+    CHECK_EQ(1U, a.metrics().acquisitions());
+    CHECK_EQ(1U, b.metrics().acquisitions());
+    CHECK_LE(200ms, b.metrics().max_wait());
+}
+
+GTEST_TEST_F(lock_tests, mutex_misuse)
+{
+    mutex a(get_connected_client(), "/lock_tests/mutex_misuse");
+
+    CHECK_THROWS(std::logic_error) { a.unlock().get(); };
+
+    a.lock().get();
+    CHECK_THROWS(std::logic_error) { a.lock().get(); };
+    a.unlock().get();
+}
+
+GTEST_TEST_F(lock_tests, mutex_released_on_destroy)
+{
+    mutex b(get_connected_client(), "/lock_tests/mutex_released_on_destroy");
+    {
+        mutex a(get_connected_client(), "/lock_tests/mutex_released_on_destroy");
+        a.lock().get();
+    }
+    b.lock().get();
+    b.unlock().get();
+}
+
+GTEST_TEST_F(lock_tests, shared_mutex_readers_share)
+{
+    shared_mutex r1(get_connected_client(), "/lock_tests/shared_mutex_readers_share");
+    shared_mutex r2(get_connected_client(), "/lock_tests/shared_mutex_readers_share");
+    shared_mutex w(get_connected_client(), "/lock_tests/shared_mutex_readers_share");
+
+    r1.lock_shared().get();
+    r2.lock_shared().get();
+    CHECK_TRUE(r1.owns_shared_lock());
+    CHECK_TRUE(r2.owns_shared_lock());
+    CHECK_FALSE(w.try_lock().get());
+
+    auto w_locked = w.lock();
+    CHECK_EQ(std::future_status::timeout, w_locked.wait_for(200ms));
+    r1.unlock_shared().get();
+    CHECK_EQ(std::future_status::timeout, w_locked.wait_for(200ms));
+    r2.unlock_shared().get();
+    w_locked.get();
+    CHECK_TRUE(w.owns_lock());
+
+    // A reader has to wait for the writer
+    CHECK_FALSE(r1.try_lock_shared().get());
+    CHECK_THROWS(std::logic_error) { w.unlock_shared().get(); };
+    w.unlock().get();
+    CHECK_TRUE(r1.try_lock_shared().get());
+    r1.unlock_shared().get();
+}
+
+}
@@ -0,0 +1,291 @@
+#include "queue.hpp"
+
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/retry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// queue_core                                                                                                         //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// The state of a consumer. This is shared with the thread taking items, so the \ref queue can be destroyed while a
+/// \c pop is in progress.
+class queue_core final :
+        public std::enable_shared_from_this<queue_core>
+{
+public:
+    explicit queue_core(client conn, std::string path) :
+            _conn(std::move(conn)),
+            _settle_conn(_conn.retry() ? _conn : _conn.with_retry(retry_policy())),
+            _path(std::move(path)),
+            _item_prefix(child_path(_path, "item-"))
+    {
+        ensure_path(_conn, _path);
+    }
+
+    const std::string& path() const { return _path; }
+
+    future<create_result> push(buffer data)
+    {
+        return _conn.create(_item_prefix, std::move(data), create_mode::sequential);
+    }
+
+    future<multi_result> push_all(std::vector<buffer> items)
+    {
+        multi_op txn;
+        txn.reserve(items.size());
+        for (auto& item : items)
+            txn.push_back(op::create(_item_prefix, std::move(item), create_mode::sequential));
+        return _conn.commit(std::move(txn));
+    }
+
+    future<std::vector<buffer>> take(std::size_t max_items, bool wait)
+    {
+        try
+        {
+            if (max_items == 0U)
+                zk::throw_exception(std::invalid_argument("max_items must be greater than 0"));
+        }
+        catch (...)
+        {
+            promise<std::vector<buffer>> p;
+            p.set_exception(zk::current_exception());
+            return p.get_future();
+        }
+
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), max_items, wait]
+                         {
+                             return self->run(max_items, wait);
+                         }
+                        );
+    }
+
+private:
+    /// An item the data was requested for, but which has not been claimed yet.
+    struct fetched_item final
+    {
+        std::string        path;
+        future<get_result> result;
+    };
+
+    /// An item which is about to be claimed.
+    struct candidate final
+    {
+        std::string path;
+        buffer      data;
+        version     data_version;
+    };
+
+    /// Request the data of the next known items until \a count are in flight. These are requested all at once, so
+    /// waiting for them costs a single round trip.
+    void prefetch(std::size_t count)
+    {
+        while (_fetched.size() < count && !_names.empty())
+        {
+            auto path = child_path(_path, _names.front());
+            _names.pop_front();
+            auto result = _conn.get(path);
+            _fetched.push_back(fetched_item{ std::move(path), std::move(result) });
+        }
+    }
+
+    /// Claim up to \a max_items of the known items.
+    ///
+    /// \returns The data of the claimed items, which is empty if all the known items were taken by other consumers.
+    std::vector<buffer> claim(std::size_t max_items)
+    {
+        prefetch(max_items);
+
+        std::vector<candidate> candidates;
+        candidates.reserve(std::min(max_items, _fetched.size()));
+        while (candidates.size() < max_items && !_fetched.empty())
+        {
+            auto item = std::move(_fetched.front());
+            _fetched.pop_front();
+            try
+            {
+                auto result = item.result.get();
+                auto data_version = result.stat().data_version;
+                candidates.push_back(candidate{ std::move(item.path), std::move(result.data()), data_version });
+            }
+            catch (const no_entry&)
+            {
+                // Taken by another consumer since the list of children was fetched
+            }
+        }
+
+        // Start reading the next batch while this one is claimed
+        prefetch(max_items);
+
+        while (!candidates.empty())
+        {
+            // The version check protects against claiming a stale item: if the data changed after it was prefetched,
+            // the erase fails and the item is dropped instead of delivering the old data.
+            multi_op txn;
+            txn.reserve(candidates.size());
+            for (const auto& item : candidates)
+                txn.push_back(op::erase(item.path, item.data_version));
+
+            try
+            {
+                _conn.commit(std::move(txn)).get();
+            }
+            catch (const transaction_failed& ex)
+            {
+                // Another consumer claimed this one first -- the rest of the batch is likely still available
+                candidates.erase(candidates.begin() + std::ptrdiff_t(ex.failed_op_index()));
+                continue;
+            }
+            catch (const connection_loss&)
+            {
+                if (!settle(candidates))
+                    continue;
+            }
+            catch (const operation_timeout&)
+            {
+                if (!settle(candidates))
+                    continue;
+            }
+
+            std::vector<buffer> out;
+            out.reserve(candidates.size());
+            for (auto& item : candidates)
+                out.emplace_back(std::move(item.data));
+            return out;
+        }
+        return {};
+    }
+
+    /// Find out if a commit of \a candidates which failed with an unknown outcome was applied. The transaction erases
+    /// all of them or none, so if any is still there, it was not applied: the ones which are gone were taken by other
+    /// consumers and are dropped from \a candidates, to be claimed again.
+    ///
+    /// \returns \c true if the commit was applied and \a candidates are claimed.
+    bool settle(std::vector<candidate>& candidates)
+    {
+        // The list is read with retries, as the connection was just lost -- if that fails too, the outcome stays
+        // unknown and the batch is lost with the exception
+        auto children = _settle_conn.get_children(_path).get().children();
+        std::unordered_set<string_view> remaining(children.begin(), children.end());
+        auto is_gone = [&] (const candidate& item) { return remaining.count(leaf_of(item.path)) == 0U; };
+
+        if (std::all_of(candidates.begin(), candidates.end(), is_gone))
+            return true;
+
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), is_gone), candidates.end());
+        return false;
+    }
+
+    /// Fetch the list of children. When \a wait is set, this also makes sure there is a watch for the next change,
+    /// leaving a new one only if the last one was triggered -- a watch which is not needed yet is kept for the next
+    /// time the queue is empty instead of piling up another.
+    std::vector<std::string> refresh(bool wait)
+    {
+        if (wait && (!_changed || _changed->wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+        {
+            auto watch = _conn.watch_children(_path).get();
+            _changed = std::move(watch.next());
+            return std::move(watch.initial().children());
+        }
+        else
+        {
+            return _conn.get_children(_path).get().children();
+        }
+    }
+
+    std::vector<buffer> run(std::size_t max_items, bool wait)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        while (true)
+        {
+            if (_names.empty() && _fetched.empty())
+            {
+                auto sorted = sorted_by_sequence(refresh(wait));
+                _names.assign(std::make_move_iterator(sorted.begin()), std::make_move_iterator(sorted.end()));
+
+                if (_names.empty())
+                {
+                    if (!wait)
+                        return {};
+
+                    auto changed = std::move(*_changed);
+                    _changed.reset();
+                    changed.get();
+                    continue;
+                }
+            }
+
+            auto out = claim(max_items);
+            if (!out.empty() || (!wait && _names.empty() && _fetched.empty()))
+                return out;
+        }
+    }
+
+private:
+    client                   _conn;
+    client                   _settle_conn;
+    std::string              _path;
+    std::string              _item_prefix;
+    std::mutex               _protect;
+    std::deque<std::string>  _names;
+    std::deque<fetched_item> _fetched;
+    optional<future<event>>  _changed;
+};
+
+}
+
+using detail::queue_core;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// queue                                                                                                              //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+queue::queue(client conn, std::string path) :
+        _core(std::make_shared<queue_core>(std::move(conn), std::move(path)))
+{ }
+
+queue::~queue() noexcept = default;
+
+const std::string& queue::path() const
+{
+    return _core->path();
+}
+
+future<create_result> queue::push(buffer data)
+{
+    return _core->push(std::move(data));
+}
+
+future<multi_result> queue::push_all(std::vector<buffer> items)
+{
+    return _core->push_all(std::move(items));
+}
+
+future<std::vector<buffer>> queue::pop(std::size_t max_items)
+{
+    return _core->take(max_items, true);
+}
+
+future<std::vector<buffer>> queue::try_pop(std::size_t max_items)
+{
+    return _core->take(max_items, false);
+}
+
+}
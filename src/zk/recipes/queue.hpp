@@ -0,0 +1,94 @@
+/// \file
+/// A first-in, first-out queue which consumers take from in batches.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/buffer.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+namespace detail
+{
+
+class queue_core;
+
+}
+
+/// A queue shared between any number of producers and consumers, using the entry at a given path as its root. Each item
+/// is a persistent sequential entry under the root, so items are taken in the order they were pushed.
+///
+/// Taking items one at a time costs a \ref client::get_children and an \ref client::erase per item. Instead, a consumer
+/// fetches the list of children once and remembers it between calls, reads the data of the next items all at once
+/// (and the items after those while the current ones are being claimed), and claims a whole batch with a single
+/// \ref client::commit of versioned \ref op::erase operations. When another consumer claimed one of the items first,
+/// the transaction fails at that item, which is dropped and the rest are claimed again. An item is delivered to exactly
+/// one consumer.
+///
+/// If the commit fails with an unknown outcome (\ref connection_loss or \ref operation_timeout), the consumer reads the
+/// list of children again to find out if it was applied: the transaction erases all of the batch or none of it, so the
+/// batch is delivered if none of its items are left and claimed again without the missing ones otherwise. This can not
+/// tell the batch apart from one whose items were all claimed by other consumers in the meantime, in which case those
+/// items are delivered twice. If reading the list fails as well, the \c pop fails with that error and the batch is
+/// not delivered, even if it was claimed.
+///
+/// While waiting for items, a consumer keeps a single child watch on the root: a new one is only left once the last
+/// one was triggered.
+///
+/// A \c queue is one participant: calls to \ref pop and \ref try_pop on the same instance are run one at a time.
+///
+/// \code
+/// zk::recipes::queue jobs(client, "/queues/jobs");
+/// jobs.push(buffer(...)).get();
+/// for (const auto& job : jobs.pop(100).get())
+///     run(job);
+/// \endcode
+class queue final
+{
+public:
+    /// Join the queue rooted at \a path. The root (and any missing ancestors) is created if it does not exist.
+    explicit queue(client conn, std::string path);
+
+    queue(const queue&) = delete;
+    queue& operator=(const queue&) = delete;
+
+    ~queue() noexcept;
+
+    /// The path of the root of the queue.
+    const std::string& path() const;
+
+    /// Add an item with \a data to the back of the queue.
+    future<create_result> push(buffer data);
+
+    /// Add all of \a items to the back of the queue in one transaction, in the order they are given.
+    future<multi_result> push_all(std::vector<buffer> items);
+
+    /// Take up to \a max_items from the front of the queue, waiting until there is at least one. This is run on its own
+    /// thread, so keep in mind that destroying the future waits for it to complete.
+    ///
+    /// \throws std::invalid_argument if \a max_items is \c 0, the future will be delivered with
+    ///  \c std::invalid_argument.
+    future<std::vector<buffer>> pop(std::size_t max_items);
+
+    /// Take up to \a max_items from the front of the queue. The result is empty if the queue is.
+    future<std::vector<buffer>> try_pop(std::size_t max_items);
+
+private:
+    std::shared_ptr<detail::queue_core> _core;
+};
+
+/// \}
+
+}
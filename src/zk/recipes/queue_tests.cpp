@@ -0,0 +1,235 @@
+#include <zk/connection.hpp>
+#include <zk/error.hpp>
+#include <zk/multi.hpp>
+#include <zk/results.hpp>
+#include <zk/server/server_tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "queue.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class queue_tests :
+        public server::single_server_fixture
+{ };
+
+static buffer buffer_from(const std::string& source)
+{
+    return buffer(source.begin(), source.end());
+}
+
+static std::string string_from(const buffer& source)
+{
+    return std::string(source.begin(), source.end());
+}
+
+GTEST_TEST_F(queue_tests, fifo_batches)
+{
+    queue q(get_connected_client(), "/queue_tests/fifo_batches");
+    for (int idx = 0; idx < 10; ++idx)
+        q.push(buffer_from(std::to_string(idx))).get();
+
+    auto first = q.pop(4U).get();
+    CHECK_EQ(4U, first.size());
+    for (std::size_t idx = 0U; idx < first.size(); ++idx)
+        CHECK_EQ(std::to_string(idx), string_from(first[idx]));
+
+    auto rest = q.try_pop(100U).get();
+    CHECK_EQ(6U, rest.size());
+    CHECK_EQ("4", string_from(rest.front()));
+    CHECK_EQ("9", string_from(rest.back()));
+
+    CHECK_TRUE(q.try_pop(100U).get().empty());
+    CHECK_THROWS(std::invalid_argument) { q.try_pop(0U).get(); };
+}
+
+GTEST_TEST_F(queue_tests, pop_waits_for_push)
+{
+    queue consumer(get_connected_client(), "/queue_tests/pop_waits_for_push");
+    queue producer(get_connected_client(), "/queue_tests/pop_waits_for_push");
+
+    auto popped = consumer.pop(10U);
+    CHECK_EQ(std::future_status::timeout, popped.wait_for(200ms));
+
+    producer.push_all({ buffer_from("a"), buffer_from("b") }).get();
+    auto items = popped.get();
+    CHECK_EQ(2U, items.size());
+    CHECK_EQ("a", string_from(items[0]));
+    CHECK_EQ("b", string_from(items[1]));
+}
+
+GTEST_TEST_F(queue_tests, competing_consumers)
+{
+    queue producer(get_connected_client(), "/queue_tests/competing_consumers");
+    queue a(get_connected_client(), "/queue_tests/competing_consumers");
+    queue b(get_connected_client(), "/queue_tests/competing_consumers");
+
+    std::vector<buffer> pushed;
+    for (int idx = 0; idx < 50; ++idx)
+        pushed.emplace_back(buffer_from(std::to_string(idx)));
+    producer.push_all(std::move(pushed)).get();
+
+    // Both consumers see the same list of children, so they race for the same items
+    std::multiset<std::string> taken;
+    while (taken.size() < 50U)
+    {
+        auto from_a = a.try_pop(8U);
+        auto from_b = b.try_pop(8U);
+        for (const auto& item : from_a.get())
+            taken.insert(string_from(item));
+        for (const auto& item : from_b.get())
+            taken.insert(string_from(item));
+    }
+
+    CHECK_EQ(50U, taken.size());
+    CHECK_EQ(50U, std::set<std::string>(taken.begin(), taken.end()).size());
+}
+
+/// Forwards everything to a real connection, but can fail a \c commit with \ref connection_loss, either after the
+/// server applied it (as happens when the connection is lost before the reply arrives) or without sending it at all.
+class lost_commit_connection final :
+        public connection
+{
+public:
+    explicit lost_commit_connection(std::shared_ptr<connection> inner) :
+            _inner(std::move(inner)),
+            _fail_commits(0U),
+            _apply_failed(false)
+    { }
+
+    /// Fail the next \a count commits, applying them first if \a applied is set.
+    void fail_next_commits(std::size_t count, bool applied)
+    {
+        _apply_failed.store(applied);
+        _fail_commits.store(count);
+    }
+
+    void close() override { _inner->close(); }
+
+    future<get_result> get(path_view path, const request_options& options) override
+    {
+        return _inner->get(path, options);
+    }
+
+    future<watch_result> watch(path_view path, const request_options& options) override
+    {
+        return _inner->watch(path, options);
+    }
+
+    future<get_children_result> get_children(path_view path, const request_options& options) override
+    {
+        return _inner->get_children(path, options);
+    }
+
+    future<watch_children_result> watch_children(path_view path, const request_options& options) override
+    {
+        return _inner->watch_children(path, options);
+    }
+
+    future<exists_result> exists(path_view path, const request_options& options) override
+    {
+        return _inner->exists(path, options);
+    }
+
+    future<watch_exists_result> watch_exists(path_view path, const request_options& options) override
+    {
+        return _inner->watch_exists(path, options);
+    }
+
+    future<create_result> create(path_view              path,
+                                 const buffer&          data,
+                                 const acl&             rules,
+                                 create_mode            mode,
+                                 const request_options& options
+                                ) override
+    {
+        return _inner->create(path, data, rules, mode, options);
+    }
+
+    future<set_result> set(path_view path, const buffer& data, version check, const request_options& options) override
+    {
+        return _inner->set(path, data, check, options);
+    }
+
+    future<void> erase(path_view path, version check, const request_options& options) override
+    {
+        return _inner->erase(path, check, options);
+    }
+
+    future<get_acl_result> get_acl(path_view path, const request_options& options) const override
+    {
+        return _inner->get_acl(path, options);
+    }
+
+    future<void> set_acl(path_view path, const acl& rules, acl_version check, const request_options& options) override
+    {
+        return _inner->set_acl(path, rules, check, options);
+    }
+
+    future<multi_result> commit(multi_op&& txn, const request_options& options) override
+    {
+        auto remaining = _fail_commits.load();
+        if (remaining == 0U || !_fail_commits.compare_exchange_strong(remaining, remaining - 1U))
+            return _inner->commit(std::move(txn), options);
+
+        if (_apply_failed.load())
+            _inner->commit(std::move(txn), options).get();
+
+        promise<multi_result> lost;
+        lost.set_exception(get_exception_ptr_of(error_code::connection_loss));
+        return lost.get_future();
+    }
+
+    future<void> load_fence(const request_options& options) override
+    {
+        return _inner->load_fence(options);
+    }
+
+    zk::state state() const override { return _inner->state(); }
+
+private:
+    std::shared_ptr<connection> _inner;
+    std::atomic<std::size_t>    _fail_commits;
+    std::atomic<bool>           _apply_failed;
+};
+
+GTEST_TEST_F(queue_tests, lost_commit)
+{
+    for (bool applied : { true, false })
+    {
+        auto inner = connection::connect(get_connection_string());
+        auto state = inner->watch_state();
+        if (inner->state() != zk::state::connected)
+            state.get();
+        auto conn = std::make_shared<lost_commit_connection>(std::move(inner));
+
+        queue q(client(conn), std::string("/queue_tests/lost_commit/") + (applied ? "applied" : "dropped"));
+        for (int idx = 0; idx < 5; ++idx)
+            q.push(buffer_from(std::to_string(idx))).get();
+
+        // Whether the claim went through or not, the batch must come out once and in order
+        conn->fail_next_commits(1U, applied);
+        auto first = q.pop(3U).get();
+        CHECK_EQ(3U, first.size());
+        for (std::size_t idx = 0U; idx < first.size(); ++idx)
+            CHECK_EQ(std::to_string(idx), string_from(first[idx]));
+
+        auto rest = q.try_pop(100U).get();
+        CHECK_EQ(2U, rest.size());
+        CHECK_EQ("3", string_from(rest.front()));
+        CHECK_EQ("4", string_from(rest.back()));
+        CHECK_TRUE(q.try_pop(100U).get().empty());
+    }
+}
+
+}
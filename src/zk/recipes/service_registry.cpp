@@ -0,0 +1,578 @@
+#include "service_registry.hpp"
+
+#include <zk/connection.hpp>
+#include <zk/error.hpp>
+#include <zk/exceptions.hpp>
+#include <zk/optional.hpp>
+#include <zk/results.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+#include "detail/nodes.hpp"
+
+namespace zk::recipes
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// registry_snapshot                                                                                                  //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+registry_snapshot::registry_snapshot(service_map services) noexcept :
+        _services(std::move(services))
+{ }
+
+std::shared_ptr<const registry_snapshot::instance_list> registry_snapshot::instances(string_view service) const
+{
+    static const auto empty = std::make_shared<const instance_list>();
+
+    auto iter = _services.find(service);
+    if (iter == _services.end())
+        return empty;
+    else
+        return iter->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// registry_core                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Collects the changes reported by the watches of the mirror and wakes the mirror thread for them. This is shared with
+/// the watches, which can outlive the registry.
+class mirror_signal final
+{
+public:
+    /// The changes reported since the mirror thread last looked.
+    struct changes final
+    {
+        std::set<std::string>                         services;
+        std::set<std::pair<std::string, std::string>> instances;
+        bool                                          stopping = false;
+    };
+
+public:
+    /// The children of \a service changed.
+    void children_changed(std::string service)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _changes.services.insert(std::move(service));
+        _wakeup.notify_all();
+    }
+
+    /// The instance \a id of \a service changed.
+    void instance_changed(std::string service, std::string id)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _changes.instances.emplace(std::move(service), std::move(id));
+        _wakeup.notify_all();
+    }
+
+    /// Wake the mirror thread without a change, such as for a new subscription.
+    void poke()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _poked = true;
+        _wakeup.notify_all();
+    }
+
+    void stop()
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _changes.stopping = true;
+        _wakeup.notify_all();
+    }
+
+    /// Block until there is something for the mirror thread to do or \a delay passes (if it is set), then take the
+    /// changes reported so far.
+    changes wait(optional<std::chrono::milliseconds> delay)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        auto ready = [this]
+                     {
+                         return _poked || _changes.stopping || !_changes.services.empty()
+                             || !_changes.instances.empty();
+                     };
+        if (delay)
+            _wakeup.wait_for(ax, *delay, ready);
+        else
+            _wakeup.wait(ax, ready);
+
+        _poked = false;
+        changes out;
+        out.services.swap(_changes.services);
+        out.instances.swap(_changes.instances);
+        out.stopping = _changes.stopping;
+        return out;
+    }
+
+private:
+    std::mutex              _protect;
+    std::condition_variable _wakeup;
+    changes                 _changes;
+    bool                    _poked = false;
+};
+
+/// Hands the children of a service to the mirror thread and reports the trigger of the watch to the
+/// \ref mirror_signal.
+class children_relay final :
+        public watch_children_listener
+{
+public:
+    explicit children_relay(std::shared_ptr<mirror_signal> signal, std::string service) :
+            _signal(std::move(signal)),
+            _service(std::move(service))
+    { }
+
+    future<get_children_result> result() { return _result.get_future(); }
+
+    virtual void on_children(get_children_result result) override
+    {
+        _result.set_value(std::move(result));
+    }
+
+    virtual void on_error(zk::exception_ptr ex) override
+    {
+        _result.set_exception(std::move(ex));
+    }
+
+    virtual void on_event(event) override
+    {
+        _signal->children_changed(_service);
+    }
+
+private:
+    std::shared_ptr<mirror_signal> _signal;
+    std::string                    _service;
+    promise<get_children_result>   _result;
+};
+
+/// Hands the payload of an instance to the mirror thread and reports the trigger of the watch to the
+/// \ref mirror_signal.
+class instance_relay final :
+        public watch_listener
+{
+public:
+    explicit instance_relay(std::shared_ptr<mirror_signal> signal, std::string service, std::string id) :
+            _signal(std::move(signal)),
+            _service(std::move(service)),
+            _id(std::move(id))
+    { }
+
+    future<get_result> result() { return _result.get_future(); }
+
+    virtual void on_data(get_result result) override
+    {
+        _result.set_value(std::move(result));
+    }
+
+    virtual void on_error(zk::exception_ptr ex) override
+    {
+        _result.set_exception(std::move(ex));
+    }
+
+    virtual void on_event(event) override
+    {
+        _signal->instance_changed(_service, _id);
+    }
+
+private:
+    std::shared_ptr<mirror_signal> _signal;
+    std::string                    _service;
+    std::string                    _id;
+    promise<get_result>            _result;
+};
+
+class registry_core final :
+        public std::enable_shared_from_this<registry_core>
+{
+public:
+    /// How long to wait before trying again to mirror a service after an operation failed (most likely because the
+    /// connection is in trouble).
+    static constexpr std::chrono::milliseconds retry_delay = std::chrono::milliseconds(50);
+
+public:
+    explicit registry_core(client conn, std::string path) :
+            _conn(std::move(conn)),
+            _path(std::move(path)),
+            _snapshot(std::make_shared<const registry_snapshot>()),
+            _signal(std::make_shared<mirror_signal>()),
+            _stopping(false)
+    {
+        ensure_path(_conn, _path);
+    }
+
+    const std::string& path() const { return _path; }
+
+    void start()
+    {
+        _worker = std::thread([this] { run(); });
+    }
+
+    void stop() noexcept
+    {
+        {
+            std::unique_lock<std::mutex> ax(_protect);
+            _stopping = true;
+        }
+        _signal->stop();
+        if (_worker.joinable())
+            _worker.join();
+
+        std::unique_lock<std::mutex> ax(_protect);
+        auto registered = std::move(_registered);
+        ax.unlock();
+        for (const auto& instance_path : registered)
+        {
+            try
+            {
+                _conn.erase(instance_path).get();
+            }
+            catch (...)
+            {
+                // The entry is ephemeral, so it will go away with the session at the latest
+            }
+        }
+    }
+
+    future<void> register_instance(std::string service, std::string id, buffer payload)
+    {
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), service = std::move(service), id = std::move(id),
+                          payload = std::move(payload)
+                         ]
+                         {
+                             auto service_path  = child_path(self->_path, service);
+                             auto instance_path = child_path(service_path, id);
+                             ensure_path(self->_conn, service_path);
+                             self->_conn.create(instance_path, payload, create_mode::ephemeral).get();
+
+                             std::unique_lock<std::mutex> ax(self->_protect);
+                             self->_registered.insert(std::move(instance_path));
+                         }
+                        );
+    }
+
+    future<void> update_instance(std::string service, std::string id, buffer payload)
+    {
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), service = std::move(service), id = std::move(id),
+                          payload = std::move(payload)
+                         ]
+                         {
+                             self->_conn.set(child_path(child_path(self->_path, service), id), payload).get();
+                         }
+                        );
+    }
+
+    future<void> deregister_instance(std::string service, std::string id)
+    {
+        return zk::async(zk::launch::async,
+                         [self = shared_from_this(), service = std::move(service), id = std::move(id)]
+                         {
+                             auto instance_path = child_path(child_path(self->_path, service), id);
+                             self->_conn.erase(instance_path).get();
+
+                             std::unique_lock<std::mutex> ax(self->_protect);
+                             self->_registered.erase(instance_path);
+                         }
+                        );
+    }
+
+    future<void> subscribe(std::string service)
+    {
+        promise<void> p;
+        auto out = p.get_future();
+
+        std::unique_lock<std::mutex> ax(_protect);
+        if (_stopping)
+        {
+            p.set_exception(get_exception_ptr_of(error_code::closed));
+            return out;
+        }
+        _subscriptions.emplace_back(std::move(service), std::move(p));
+        ax.unlock();
+        _signal->poke();
+        return out;
+    }
+
+    std::shared_ptr<const registry_snapshot> snapshot() const
+    {
+        std::unique_lock<std::mutex> ax(_snapshot_protect);
+        return _snapshot;
+    }
+
+private:
+    struct service_mirror final
+    {
+        using instance_list = registry_snapshot::instance_list;
+
+        std::string                          path;
+        bool                                 resync   = true;
+        bool                                 modified = false;
+        std::map<std::string, buffer>        instances;
+        std::shared_ptr<const instance_list> published;
+        std::vector<promise<void>>           waiters;
+    };
+
+    /// Fetch the instances \a ids of \a service and watch them. All the requests are sent before waiting for any.
+    void load_instances(const std::string& service, service_mirror& mirror, const std::vector<std::string>& ids)
+    {
+        std::vector<future<get_result>> fetches;
+        fetches.reserve(ids.size());
+        for (const auto& id : ids)
+        {
+            auto relay = std::make_shared<instance_relay>(_signal, service, id);
+            fetches.emplace_back(relay->result());
+            _conn.listen(child_path(mirror.path, id), std::move(relay));
+        }
+
+        for (std::size_t idx = 0U; idx < ids.size(); ++idx)
+        {
+            try
+            {
+                mirror.instances[ids[idx]] = std::move(fetches[idx].get().data());
+            }
+            catch (const no_entry&)
+            {
+                // Removed again already -- the watch on the children will report it
+                mirror.instances.erase(ids[idx]);
+            }
+        }
+        mirror.modified = true;
+    }
+
+    /// Fetch the list of children of \a service, load the ones which are new and drop the ones which are gone. The
+    /// instances are the previous list, so instances which did not change are not fetched again.
+    void refresh_children(const std::string& service, service_mirror& mirror)
+    {
+        auto relay  = std::make_shared<children_relay>(_signal, service);
+        auto result = relay->result();
+        _conn.listen_children(mirror.path, std::move(relay));
+
+        const auto children = result.get().children();
+        std::set<string_view> current(children.begin(), children.end());
+        for (auto iter = mirror.instances.begin(); iter != mirror.instances.end(); )
+        {
+            if (current.count(iter->first) == 0U)
+            {
+                iter = mirror.instances.erase(iter);
+                mirror.modified = true;
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        std::vector<std::string> added;
+        for (const auto& name : children)
+        {
+            if (mirror.instances.count(name) == 0U)
+                added.push_back(name);
+        }
+        if (!added.empty())
+            load_instances(service, mirror, added);
+    }
+
+    void resync(const std::string& service, service_mirror& mirror)
+    {
+        ensure_path(_conn, mirror.path);
+        mirror.instances.clear();
+        mirror.modified = true;
+        refresh_children(service, mirror);
+        mirror.resync = false;
+    }
+
+    /// Apply the \a changes reported by the watches of \a service.
+    void update(const std::string& service, service_mirror& mirror, const mirror_signal::changes& changes)
+    {
+        if (changes.services.count(service) != 0U)
+            refresh_children(service, mirror);
+
+        std::vector<std::string> changed;
+        for (auto iter = changes.instances.lower_bound({ service, std::string() });
+             iter != changes.instances.end() && iter->first == service;
+             ++iter
+            )
+        {
+            // An instance which is no longer mirrored was removed, and the watch on the children reported that
+            if (mirror.instances.count(iter->second) != 0U)
+                changed.push_back(iter->second);
+        }
+        if (!changed.empty())
+            load_instances(service, mirror, changed);
+    }
+
+    void publish()
+    {
+        registry_snapshot::service_map services;
+        for (auto& [name, mirror] : _services)
+        {
+            if (mirror.modified || !mirror.published)
+            {
+                auto list = std::make_shared<registry_snapshot::instance_list>();
+                list->reserve(mirror.instances.size());
+                for (const auto& [id, payload] : mirror.instances)
+                    list->push_back(service_instance{ id, payload });
+                mirror.published = std::move(list);
+                mirror.modified  = false;
+            }
+            services.emplace(name, mirror.published);
+        }
+
+        std::shared_ptr<const registry_snapshot> next = std::make_shared<registry_snapshot>(std::move(services));
+        std::unique_lock<std::mutex> ax(_snapshot_protect);
+        _snapshot.swap(next);
+        ax.unlock();
+
+        for (auto& [name, mirror] : _services)
+        {
+            if (mirror.resync)
+                continue;
+            for (auto& waiter : mirror.waiters)
+                waiter.set_value();
+            mirror.waiters.clear();
+        }
+    }
+
+    void run()
+    {
+        bool retry = false;
+        while (true)
+        {
+            auto changes = _signal->wait(retry ? some(retry_delay) : nullopt);
+            if (changes.stopping)
+                break;
+
+            std::unique_lock<std::mutex> ax(_protect);
+            auto subscriptions = std::move(_subscriptions);
+            _subscriptions.clear();
+            ax.unlock();
+
+            bool changed = false;
+            for (auto& [service, waiter] : subscriptions)
+            {
+                auto [iter, inserted] = _services.try_emplace(service);
+                if (inserted)
+                    iter->second.path = child_path(_path, service);
+                iter->second.waiters.emplace_back(std::move(waiter));
+                changed = true;
+            }
+
+            retry = false;
+            for (auto& [name, mirror] : _services)
+            {
+                try
+                {
+                    if (mirror.resync)
+                        resync(name, mirror);
+                    else
+                        update(name, mirror, changes);
+                }
+                catch (...)
+                {
+                    // Most likely the connection is in trouble -- start over with this service after a while
+                    mirror.resync = true;
+                    retry         = true;
+                }
+                changed = changed || mirror.modified;
+            }
+
+            if (changed)
+                publish();
+        }
+
+        std::unique_lock<std::mutex> ax(_protect);
+        for (auto& [service, waiter] : _subscriptions)
+            waiter.set_exception(get_exception_ptr_of(error_code::closed));
+        _subscriptions.clear();
+        ax.unlock();
+
+        for (auto& [name, mirror] : _services)
+        {
+            for (auto& waiter : mirror.waiters)
+                waiter.set_exception(get_exception_ptr_of(error_code::closed));
+        }
+    }
+
+private:
+    client                                             _conn;
+    std::string                                        _path;
+
+    mutable std::mutex                                 _snapshot_protect;
+    std::shared_ptr<const registry_snapshot>           _snapshot;
+
+    std::shared_ptr<mirror_signal>                     _signal;
+
+    std::mutex                                         _protect;
+    bool                                               _stopping;
+    std::vector<std::pair<std::string, promise<void>>> _subscriptions;
+    std::set<std::string>                              _registered;
+
+    // Only used by the mirror thread
+    std::map<std::string, service_mirror>              _services;
+    std::thread                                        _worker;
+};
+
+}
+
+using detail::registry_core;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// service_registry                                                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+service_registry::service_registry(client conn, std::string path) :
+        _core(std::make_shared<registry_core>(std::move(conn), std::move(path)))
+{
+    _core->start();
+}
+
+service_registry::~service_registry() noexcept
+{
+    _core->stop();
+}
+
+const std::string& service_registry::path() const
+{
+    return _core->path();
+}
+
+future<void> service_registry::register_instance(std::string service, std::string id, buffer payload)
+{
+    return _core->register_instance(std::move(service), std::move(id), std::move(payload));
+}
+
+future<void> service_registry::update_instance(std::string service, std::string id, buffer payload)
+{
+    return _core->update_instance(std::move(service), std::move(id), std::move(payload));
+}
+
+future<void> service_registry::deregister_instance(std::string service, std::string id)
+{
+    return _core->deregister_instance(std::move(service), std::move(id));
+}
+
+future<void> service_registry::subscribe(std::string service)
+{
+    return _core->subscribe(std::move(service));
+}
+
+std::shared_ptr<const registry_snapshot> service_registry::snapshot() const
+{
+    return _core->snapshot();
+}
+
+std::shared_ptr<const registry_snapshot::instance_list> service_registry::lookup(string_view service) const
+{
+    return _core->snapshot()->instances(service);
+}
+
+}
@@ -0,0 +1,127 @@
+/// \file
+/// Registering service instances and resolving them from a local mirror.
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/buffer.hpp>
+#include <zk/client.hpp>
+#include <zk/future.hpp>
+#include <zk/string_view.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace zk::recipes
+{
+
+/// \addtogroup Recipes
+/// \{
+
+namespace detail
+{
+
+class registry_core;
+
+}
+
+/// A registered instance of a service.
+struct service_instance final
+{
+    /// The name of the instance, which is unique within its service.
+    std::string id;
+
+    /// The data the instance was registered with, such as its address.
+    buffer payload;
+};
+
+/// An immutable view of the instances of every service a \ref service_registry is subscribed to. A new snapshot is
+/// published for every change, so a snapshot can be held and read from any thread without synchronization.
+class registry_snapshot final
+{
+public:
+    using instance_list = std::vector<service_instance>;
+    using service_map   = std::map<std::string, std::shared_ptr<const instance_list>, std::less<>>;
+
+public:
+    registry_snapshot() = default;
+
+    explicit registry_snapshot(service_map services) noexcept;
+
+    /// The instances of \a service, sorted by \ref service_instance::id. This is empty if the service has no instances
+    /// or is not subscribed to.
+    std::shared_ptr<const instance_list> instances(string_view service) const;
+
+    /// All the subscribed services.
+    const service_map& services() const { return _services; }
+
+private:
+    service_map _services;
+};
+
+/// Registers instances of services and keeps a local mirror of the instances of the services it is subscribed to, using
+/// the entry at a given path as its root. Each instance is an ephemeral entry at <tt>root/service/id</tt> holding the
+/// payload, so an instance is removed when the process which registered it loses its session.
+///
+/// The mirror of a service is kept up to date by a thread owned by the registry, with a \ref client::listen_children on
+/// the service and a \ref client::listen on each instance. The thread sleeps until one of those watches is triggered;
+/// the watch callback only records what changed and wakes it. When the children change, only the added instances are
+/// fetched; when an instance changes, only that instance is fetched. Each change publishes a new
+/// \ref registry_snapshot, sharing the instance lists of the services which did not change. \ref lookup and
+/// \ref snapshot never talk to the server or wait for the thread updating the mirror: they copy the pointer to the
+/// latest snapshot under a mutex which is only ever held to copy or replace that pointer, so resolving an endpoint
+/// costs a short lock instead of a round trip.
+///
+/// \code
+/// zk::recipes::service_registry registry(client, "/services");
+/// registry.register_instance("billing", "host-17:8080", buffer(...)).get();
+/// registry.subscribe("billing").get();
+/// for (const auto& instance : *registry.lookup("billing"))
+///     ...
+/// \endcode
+class service_registry final
+{
+public:
+    /// Create a registry rooted at \a path. The root (and any missing ancestors) is created if it does not exist.
+    explicit service_registry(client conn, std::string path);
+
+    service_registry(const service_registry&) = delete;
+    service_registry& operator=(const service_registry&) = delete;
+
+    /// Stop updating the mirror and remove the instances registered through this registry.
+    ~service_registry() noexcept;
+
+    /// The path of the root of the registry.
+    const std::string& path() const;
+
+    /// Register the instance \a id of \a service with \a payload.
+    ///
+    /// \throws entry_exists If \a service already has an instance named \a id, the future will be delivered with
+    ///  \ref entry_exists.
+    future<void> register_instance(std::string service, std::string id, buffer payload);
+
+    /// Replace the payload of the instance \a id of \a service.
+    future<void> update_instance(std::string service, std::string id, buffer payload);
+
+    /// Remove the instance \a id of \a service.
+    future<void> deregister_instance(std::string service, std::string id);
+
+    /// Start mirroring the instances of \a service. The returned future is delivered once a snapshot including the
+    /// service is published. Subscribing to a service more than once has no effect.
+    future<void> subscribe(std::string service);
+
+    /// The latest snapshot of the subscribed services.
+    std::shared_ptr<const registry_snapshot> snapshot() const;
+
+    /// The instances of \a service in the latest snapshot. This is the same as <tt>snapshot()->instances(service)</tt>.
+    std::shared_ptr<const registry_snapshot::instance_list> lookup(string_view service) const;
+
+private:
+    std::shared_ptr<detail::registry_core> _core;
+};
+
+/// \}
+
+}
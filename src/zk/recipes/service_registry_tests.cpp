@@ -0,0 +1,75 @@
+#include <zk/server/server_tests.hpp>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "service_registry.hpp"
+
+namespace zk::recipes
+{
+
+using namespace std::chrono_literals;
+
+class service_registry_tests :
+        public server::single_server_fixture
+{ };
+
+static buffer buffer_from(const std::string& source)
+{
+    return buffer(source.begin(), source.end());
+}
+
+/// Wait for the mirror of \a registry to catch up until \a check passes.
+static bool eventually(const std::function<bool ()>& check)
+{
+    for (auto until = std::chrono::steady_clock::now() + 10s; std::chrono::steady_clock::now() < until; )
+    {
+        if (check())
+            return true;
+        std::this_thread::sleep_for(10ms);
+    }
+    return check();
+}
+
+GTEST_TEST_F(service_registry_tests, mirror_follows_changes)
+{
+    service_registry server(get_connected_client(), "/service_registry_tests/mirror_follows_changes");
+    service_registry consumer(get_connected_client(), "/service_registry_tests/mirror_follows_changes");
+
+    server.register_instance("billing", "a", buffer_from("10.0.0.1:80")).get();
+    consumer.subscribe("billing").get();
+    auto initial = consumer.lookup("billing");
+    CHECK_EQ(1U, initial->size());
+    CHECK_EQ("a", initial->front().id);
+    CHECK_TRUE(consumer.lookup("unknown")->empty());
+
+    server.register_instance("billing", "b", buffer_from("10.0.0.2:80")).get();
+    CHECK_TRUE(eventually([&] { return consumer.lookup("billing")->size() == 2U; }));
+
+    server.update_instance("billing", "a", buffer_from("10.0.0.3:80")).get();
+    CHECK_TRUE(eventually([&] { return consumer.lookup("billing")->front().payload == buffer_from("10.0.0.3:80"); }));
+
+    server.deregister_instance("billing", "a").get();
+    CHECK_TRUE(eventually([&] { return consumer.lookup("billing")->size() == 1U; }));
+    CHECK_EQ("b", consumer.lookup("billing")->front().id);
+
+    // Snapshots which were taken are not changed by later updates
+    CHECK_EQ(1U, initial->size());
+    CHECK_EQ("a", initial->front().id);
+}
+
+GTEST_TEST_F(service_registry_tests, instances_removed_on_destroy)
+{
+    service_registry consumer(get_connected_client(), "/service_registry_tests/instances_removed_on_destroy");
+    consumer.subscribe("search").get();
+    {
+        service_registry server(get_connected_client(), "/service_registry_tests/instances_removed_on_destroy");
+        server.register_instance("search", "a", buffer_from("a")).get();
+        CHECK_TRUE(eventually([&] { return consumer.lookup("search")->size() == 1U; }));
+    }
+    CHECK_TRUE(eventually([&] { return consumer.lookup("search")->empty(); }));
+}
+
+}
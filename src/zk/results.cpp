@@ -1,4 +1,5 @@
 #include "results.hpp"
+#include "detail/children_diff.hpp"
 
 #include <ostream>
 #include <sstream>
@@ -300,6 +301,66 @@ std::string to_string(const watch_children_result& self)
 static_assert(std::is_nothrow_move_constructible_v<watch_children_result>);
 static_assert(std::is_nothrow_move_assignable_v<watch_children_result>);
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// children_diff                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+children_diff::children_diff(children_list_type added, children_list_type removed, const stat& parent_stat) noexcept :
+        _added(std::move(added)),
+        _removed(std::move(removed)),
+        _parent_stat(parent_stat)
+{ }
+
+children_diff::~children_diff() noexcept
+{ }
+
+std::ostream& operator<<(std::ostream& os, const children_diff& self)
+{
+    os << "children_diff{added=";
+    print_range(os, self.added());
+    os << " removed=";
+    print_range(os, self.removed());
+    os << " parent=" << self.parent_stat();
+    return os << '}';
+}
+
+std::string to_string(const children_diff& self)
+{
+    return to_string_generic(self);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// watch_children_diff_result                                                                                         //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+watch_children_diff_result::watch_children_diff_result(get_children_result                          initial,
+                                                       std::shared_ptr<detail::children_diff_state> state
+                                                      ) noexcept :
+        _initial(std::move(initial)),
+        _state(std::move(state))
+{ }
+
+watch_children_diff_result::~watch_children_diff_result() noexcept
+{ }
+
+future<children_diff> watch_children_diff_result::next()
+{
+    return _state->next();
+}
+
+std::ostream& operator<<(std::ostream& os, const watch_children_diff_result& self)
+{
+    return os << "watch_children_diff_result{initial=" << self.initial() << '}';
+}
+
+std::string to_string(const watch_children_diff_result& self)
+{
+    return to_string_generic(self);
+}
+
+static_assert(std::is_nothrow_move_constructible_v<watch_children_diff_result>);
+static_assert(std::is_nothrow_move_assignable_v<watch_children_diff_result>);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // watch_exists_result                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
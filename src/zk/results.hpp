@@ -5,6 +5,7 @@
 #include <zk/config.hpp>
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -336,6 +337,104 @@ std::ostream& operator<<(std::ostream&, const watch_children_result&);
 
 std::string to_string(const watch_children_result&);
 
+/// The change to the children of an entry between two triggers of a \ref client::watch_children_diff.
+class children_diff final
+{
+public:
+    using children_list_type = get_children_result::children_list_type;
+
+public:
+    explicit children_diff(children_list_type added, children_list_type removed, const stat& parent_stat) noexcept;
+
+    children_diff(const children_diff&)            = default;
+    children_diff& operator=(const children_diff&) = default;
+
+    children_diff(children_diff&&)            = default;
+    children_diff& operator=(children_diff&&) = default;
+
+    ~children_diff() noexcept;
+
+    /// \{
+    /// The names of the children which were created since the previous list. There is no guarantee on ordering.
+    const children_list_type& added() const & { return _added; }
+    children_list_type&       added() &       { return _added; }
+    children_list_type        added() &&      { return std::move(_added); }
+    /// \}
+
+    /// \{
+    /// The names of the children which were erased since the previous list. There is no guarantee on ordering.
+    const children_list_type& removed() const & { return _removed; }
+    children_list_type&       removed() &       { return _removed; }
+    children_list_type        removed() &&      { return std::move(_removed); }
+    /// \}
+
+    /// \{
+    /// The \ref zk::stat of the entry queried, as of the list the difference was taken against.
+    const stat& parent_stat() const { return _parent_stat; }
+    stat&       parent_stat()       { return _parent_stat; }
+    /// \}
+
+    /// Is this change empty? This happens when children were created and erased again between two lists.
+    bool empty() const { return _added.empty() && _removed.empty(); }
+
+private:
+    children_list_type _added;
+    children_list_type _removed;
+    stat               _parent_stat;
+};
+
+std::ostream& operator<<(std::ostream&, const children_diff&);
+
+std::string to_string(const children_diff&);
+
+namespace detail
+{
+
+class children_diff_state;
+
+}
+
+/// The result type of \ref client::watch_children_diff.
+class watch_children_diff_result final
+{
+public:
+    explicit watch_children_diff_result(get_children_result                          initial,
+                                        std::shared_ptr<detail::children_diff_state> state
+                                       ) noexcept;
+
+    watch_children_diff_result(const watch_children_diff_result&)            = delete;
+    watch_children_diff_result& operator=(const watch_children_diff_result&) = delete;
+
+    watch_children_diff_result(watch_children_diff_result&&)            = default;
+    watch_children_diff_result& operator=(watch_children_diff_result&&) = default;
+
+    ~watch_children_diff_result() noexcept;
+
+    /// \{
+    /// The initial result of the fetch, which is the full list of children.
+    const get_children_result& initial() const & { return _initial; }
+    get_children_result&       initial() &       { return _initial; }
+    get_children_result        initial() &&      { return std::move(_initial); }
+    /// \}
+
+    /// Get a future which is delivered with the next change to the children. Each call waits for the change after the
+    /// one delivered by the previous call, re-arming the watch as needed, so a single result can follow an entry for as
+    /// long as it exists. The change is fetched as soon as the watch is triggered, without a thread waiting for it, so a
+    /// future which is no longer wanted can simply be dropped.
+    ///
+    /// \throws no_entry if the watched entry was erased, the change with all the remaining children in
+    ///  \ref children_diff::removed is delivered first, then the next future is delivered with \ref no_entry.
+    future<children_diff> next();
+
+private:
+    get_children_result                          _initial;
+    std::shared_ptr<detail::children_diff_state> _state;
+};
+
+std::ostream& operator<<(std::ostream&, const watch_children_diff_result&);
+
+std::string to_string(const watch_children_diff_result&);
+
 /// The result type of \ref client::watch_exists.
 class watch_exists_result final
 {
@@ -0,0 +1,139 @@
+#include "retry.hpp"
+#include "error.hpp"
+#include "multi.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <random>
+#include <sstream>
+
+namespace zk
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// retry_policy                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::uint32_t bit_of(request_type type)
+{
+    return std::uint32_t(1) << static_cast<int>(type);
+}
+
+static constexpr std::uint32_t bit_of(op_type type)
+{
+    return std::uint32_t(1) << static_cast<int>(type);
+}
+
+static constexpr std::uint32_t default_idempotent_requests = bit_of(request_type::get)
+                                                           | bit_of(request_type::watch)
+                                                           | bit_of(request_type::get_children)
+                                                           | bit_of(request_type::watch_children)
+                                                           | bit_of(request_type::exists)
+                                                           | bit_of(request_type::watch_exists)
+                                                           | bit_of(request_type::get_acl)
+                                                           | bit_of(request_type::commit)
+                                                           | bit_of(request_type::load_fence);
+
+static constexpr std::uint32_t default_idempotent_ops = bit_of(op_type::check);
+
+retry_policy::retry_policy() noexcept :
+        _max_attempts(5U),
+        _initial_backoff(10),
+        _max_backoff(1000),
+        _multiplier(2.0),
+        _jitter(1.0),
+        _idempotent_requests(default_idempotent_requests),
+        _idempotent_ops(default_idempotent_ops)
+{ }
+
+retry_policy retry_policy::never()
+{
+    retry_policy out;
+    out.max_attempts() = 1U;
+    return out;
+}
+
+bool retry_policy::idempotent(request_type type) const
+{
+    return (_idempotent_requests & bit_of(type)) != 0U;
+}
+
+void retry_policy::idempotent(request_type type, bool value)
+{
+    if (value)
+        _idempotent_requests |= bit_of(type);
+    else
+        _idempotent_requests &= ~bit_of(type);
+}
+
+bool retry_policy::idempotent(op_type type) const
+{
+    return (_idempotent_ops & bit_of(type)) != 0U;
+}
+
+void retry_policy::idempotent(op_type type, bool value)
+{
+    if (value)
+        _idempotent_ops |= bit_of(type);
+    else
+        _idempotent_ops &= ~bit_of(type);
+}
+
+bool retry_policy::idempotent(const multi_op& txn) const
+{
+    return idempotent(request_type::commit)
+        && std::all_of(txn.begin(), txn.end(), [this] (const op& x) { return idempotent(x.type()); });
+}
+
+bool retry_policy::should_retry(error_code error, std::size_t attempt) const
+{
+    // Anything else (such as a deadline passing) can never be retried, whatever the attempt
+    if (error != error_code::connection_loss && error != error_code::throttled)
+        return false;
+
+    return attempt < _max_attempts;
+}
+
+retry_policy::duration retry_policy::max_backoff_for(std::size_t attempt) const
+{
+    auto growth = std::pow(std::max(_multiplier, 1.0), double(std::max<std::size_t>(attempt, 1U) - 1U));
+    auto delay  = double(_initial_backoff.count()) * growth;
+    // Compare as floating-point, as the growth can easily be larger than any integer.
+    if (!(delay < double(_max_backoff.count())))
+        return _max_backoff;
+    else
+        return duration(duration::rep(delay));
+}
+
+retry_policy::duration retry_policy::backoff(std::size_t attempt) const
+{
+    auto delay  = max_backoff_for(attempt);
+    auto jitter = std::clamp(_jitter, 0.0, 1.0);
+    if (jitter == 0.0 || delay.count() <= 0)
+        return delay;
+
+    thread_local std::minstd_rand rng(std::random_device{}());
+    std::uniform_real_distribution<double> removed(0.0, jitter);
+    return duration(duration::rep(double(delay.count()) * (1.0 - removed(rng))));
+}
+
+std::ostream& operator<<(std::ostream& os, const retry_policy& self)
+{
+    os << "{max_attempts=" << self.max_attempts();
+    os << " initial_backoff=" << self.initial_backoff().count() << "ms";
+    os << " max_backoff=" << self.max_backoff().count() << "ms";
+    os << " multiplier=" << self.multiplier();
+    os << " jitter=" << self.jitter();
+    return os << '}';
+}
+
+std::string to_string(const retry_policy& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+}
@@ -0,0 +1,134 @@
+/// \file
+/// Controls how operations which fail with a transient error are retried.
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "forwards.hpp"
+
+namespace zk
+{
+
+/// \addtogroup Client
+/// \{
+
+/// Describes how a \ref client retries operations which fail because of a transient problem with the connection. A
+/// failure is transient if the operation might succeed when issued again without any change: \ref connection_loss
+/// (which includes a session moving to another server in the ensemble) and \ref throttled. Any other error is delivered
+/// to the caller as-is.
+///
+/// Retrying is only safe if issuing the operation twice has the same effect as issuing it once. When the connection is
+/// lost, there is no way to know if the server applied the operation before the reply was lost, so an operation is only
+/// retried if its type is marked as \ref idempotent. By default, only reads, watches and \ref client::load_fence are;
+/// a \ref client::commit is retried only if every operation in it is idempotent, which is only \ref op_type::check by
+/// default. Before marking a write as idempotent, consider what a second attempt does: a version-checked
+/// \ref client::set fails with \ref version_mismatch if the first attempt was applied and a non-sequential
+/// \ref client::create fails with \ref entry_exists.
+///
+/// The delay before each retry grows exponentially from \ref initial_backoff by \ref multiplier up to
+/// \ref max_backoff. A random fraction (up to \ref jitter) of each delay is removed, so clients which lost their
+/// connection at the same moment do not all retry at the same moment. If the operation also has a timeout (see
+/// \ref client::with_timeout), the timeout covers all attempts.
+///
+/// \code
+/// zk::retry_policy policy;
+/// policy.max_attempts() = 10U;
+/// policy.idempotent(zk::request_type::set, true);
+/// auto retrying = client.with_retry(policy);
+/// \endcode
+class retry_policy final
+{
+public:
+    using duration = std::chrono::milliseconds;
+
+public:
+    /// Create a policy with default values: up to 5 attempts, with backoff starting at 10 milliseconds and doubling up
+    /// to 1 second, with full jitter.
+    retry_policy() noexcept;
+
+    /// A policy which never retries.
+    static retry_policy never();
+
+    /// \{
+    /// The maximum number of times an operation is attempted, including the first. A value of \c 1 (or \c 0) means
+    /// operations are never retried.
+    std::size_t  max_attempts() const { return _max_attempts; }
+    std::size_t& max_attempts()       { return _max_attempts; }
+    /// \}
+
+    /// \{
+    /// The delay before the first retry.
+    duration  initial_backoff() const { return _initial_backoff; }
+    duration& initial_backoff()       { return _initial_backoff; }
+    /// \}
+
+    /// \{
+    /// The upper bound on the delay before any retry.
+    duration  max_backoff() const { return _max_backoff; }
+    duration& max_backoff()       { return _max_backoff; }
+    /// \}
+
+    /// \{
+    /// How much the delay grows after each attempt. Values less than \c 1 are treated as \c 1.
+    double  multiplier() const { return _multiplier; }
+    double& multiplier()       { return _multiplier; }
+    /// \}
+
+    /// \{
+    /// The largest fraction of each delay which is randomly removed, from \c 0 (always wait the full delay) to \c 1
+    /// (wait anywhere from no time to the full delay). Values outside of this range are clamped.
+    double  jitter() const { return _jitter; }
+    double& jitter()       { return _jitter; }
+    /// \}
+
+    /// \{
+    /// Is it safe to retry an operation of the given \a type? Marking \ref request_type::commit as idempotent allows
+    /// transactions to be retried, but only if every operation in them is also idempotent.
+    bool idempotent(request_type type) const;
+    void idempotent(request_type type, bool value);
+    /// \}
+
+    /// \{
+    /// Is it safe to retry a transaction containing operations of the given \a type?
+    bool idempotent(op_type type) const;
+    void idempotent(op_type type, bool value);
+    /// \}
+
+    /// Is it safe to retry the transaction \a txn?
+    bool idempotent(const multi_op& txn) const;
+
+    /// Should an operation which failed with \a error on attempt number \a attempt (starting at \c 1) be attempted
+    /// again? This only checks the error and the number of attempts -- the caller is responsible for checking the
+    /// operation is \ref idempotent.
+    bool should_retry(error_code error, std::size_t attempt) const;
+
+    /// Get the delay between attempt number \a attempt (starting at \c 1) and the next one. This is random if
+    /// \ref jitter is not \c 0.
+    duration backoff(std::size_t attempt) const;
+
+    /// Get the delay between attempt number \a attempt and the next one before jitter is applied. This is the upper
+    /// bound of \ref backoff.
+    duration max_backoff_for(std::size_t attempt) const;
+
+private:
+    std::size_t   _max_attempts;
+    duration      _initial_backoff;
+    duration      _max_backoff;
+    double        _multiplier;
+    double        _jitter;
+    std::uint32_t _idempotent_requests;
+    std::uint32_t _idempotent_ops;
+};
+
+std::ostream& operator<<(std::ostream&, const retry_policy&);
+
+std::string to_string(const retry_policy&);
+
+/// \}
+
+}
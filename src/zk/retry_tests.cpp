@@ -0,0 +1,76 @@
+#include <zk/tests/test.hpp>
+
+#include "error.hpp"
+#include "multi.hpp"
+#include "retry.hpp"
+#include "trace.hpp"
+
+namespace zk
+{
+
+GTEST_TEST(retry_policy_tests, defaults)
+{
+    retry_policy policy;
+    CHECK_EQ(5U, policy.max_attempts());
+
+    CHECK_TRUE(policy.idempotent(request_type::get));
+    CHECK_TRUE(policy.idempotent(request_type::watch_children));
+    CHECK_TRUE(policy.idempotent(request_type::load_fence));
+    CHECK_FALSE(policy.idempotent(request_type::create));
+    CHECK_FALSE(policy.idempotent(request_type::set));
+    CHECK_FALSE(policy.idempotent(request_type::erase));
+
+    CHECK_TRUE(policy.idempotent(multi_op{ op::check("/a"), op::check("/b") }));
+    CHECK_FALSE(policy.idempotent(multi_op{ op::check("/a"), op::set("/b", buffer()) }));
+
+    policy.idempotent(op_type::set, true);
+    CHECK_TRUE(policy.idempotent(multi_op{ op::check("/a"), op::set("/b", buffer()) }));
+    policy.idempotent(request_type::commit, false);
+    CHECK_FALSE(policy.idempotent(multi_op{ op::check("/a") }));
+}
+
+GTEST_TEST(retry_policy_tests, should_retry)
+{
+    retry_policy policy;
+    policy.max_attempts() = 3U;
+
+    CHECK_TRUE(policy.should_retry(error_code::connection_loss, 1U));
+    CHECK_TRUE(policy.should_retry(error_code::throttled, 2U));
+    CHECK_FALSE(policy.should_retry(error_code::connection_loss, 3U));
+    CHECK_FALSE(policy.should_retry(error_code::operation_timeout, 1U));
+    CHECK_FALSE(policy.should_retry(error_code::session_expired, 1U));
+    CHECK_FALSE(policy.should_retry(error_code::no_entry, 1U));
+
+    CHECK_FALSE(retry_policy::never().should_retry(error_code::connection_loss, 1U));
+}
+
+GTEST_TEST(retry_policy_tests, backoff_bounds)
+{
+    using std::chrono::milliseconds;
+
+    retry_policy policy;
+    policy.initial_backoff() = milliseconds(10);
+    policy.max_backoff()     = milliseconds(100);
+    policy.multiplier()      = 3.0;
+
+    CHECK_EQ(milliseconds(10), policy.max_backoff_for(1U));
+    CHECK_EQ(milliseconds(30), policy.max_backoff_for(2U));
+    CHECK_EQ(milliseconds(90), policy.max_backoff_for(3U));
+    CHECK_EQ(milliseconds(100), policy.max_backoff_for(4U));
+    CHECK_EQ(milliseconds(100), policy.max_backoff_for(1000U));
+
+    for (std::size_t attempt = 1U; attempt < 8U; ++attempt)
+    {
+        for (int sample = 0; sample < 100; ++sample)
+        {
+            auto delay = policy.backoff(attempt);
+            CHECK_LE(milliseconds(0), delay);
+            CHECK_GE(policy.max_backoff_for(attempt), delay);
+        }
+    }
+
+    policy.jitter() = 0.0;
+    CHECK_EQ(milliseconds(30), policy.backoff(2U));
+}
+
+}
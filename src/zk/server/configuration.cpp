@@ -1,13 +1,15 @@
 #include "configuration.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <cstdlib>
 #include <fstream>
 #include <istream>
+#include <limits>
 #include <ostream>
-#include <regex>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 namespace zk::server
 {
@@ -27,22 +29,148 @@ std::ostream& operator<<(std::ostream& os, const server_id& self)
     return os << self.value;
 }
 
-namespace
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// server_spec                                                                                                        //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+[[noreturn]]
+static void throw_invalid_spec(string_view src, const char* problem)
 {
+    throw std::invalid_argument("Invalid server address \"" + std::string(src) + "\": " + problem);
+}
 
-constexpr std::size_t not_a_line = ~0UL;
+/// Take the address at the front of \a rest, up to the next \c ':' or the end. A bracketed IPv6 address keeps its
+/// brackets.
+static string_view take_address(string_view src, string_view& rest)
+{
+    std::size_t end;
+    if (!rest.empty() && rest[0] == '[')
+    {
+        end = rest.find(']');
+        if (end == string_view::npos)
+            throw_invalid_spec(src, "unterminated '['");
+        ++end;
+        if (end < rest.size() && rest[end] != ':')
+            throw_invalid_spec(src, "expected ':' after ']'");
+    }
+    else
+    {
+        end = std::min(rest.find(':'), rest.size());
+    }
+
+    auto out = rest.substr(0U, end);
+    if (out.empty())
+        throw_invalid_spec(src, "missing address");
+    rest.remove_prefix(end);
+    return out;
+}
+
+/// Take the port at the front of \a rest, up to the next \c ':' or the end.
+static std::uint16_t take_port(string_view src, string_view& rest)
+{
+    auto end  = std::min(rest.find(':'), rest.size());
+    auto text = rest.substr(0U, end);
+    if (text.empty() || text.size() > 5U || text.find_first_not_of("0123456789") != string_view::npos)
+        throw_invalid_spec(src, "expected a port number");
+
+    unsigned long value = 0U;
+    for (char c : text)
+        value = value * 10U + static_cast<unsigned long>(c - '0');
+    if (value > std::numeric_limits<std::uint16_t>::max())
+        throw_invalid_spec(src, "port number out of range");
+
+    rest.remove_prefix(end);
+    return static_cast<std::uint16_t>(value);
+}
+
+/// Remove the \c ':' at the front of \a rest.
+static void take_colon(string_view src, string_view& rest)
+{
+    if (rest.empty() || rest[0] != ':')
+        throw_invalid_spec(src, "expected ':'");
+    rest.remove_prefix(1U);
+}
 
-class zero_copy_streambuf final :
-        public std::streambuf
+server_spec server_spec::parse(string_view src)
 {
-public:
-    zero_copy_streambuf(string_view input)
+    auto semicolon = src.find(';');
+    auto rest      = src.substr(0U, semicolon);
+
+    server_spec out;
+    out.hostname = std::string(take_address(src, rest));
+    take_colon(src, rest);
+    out.peer_port = take_port(src, rest);
+    take_colon(src, rest);
+    out.leader_port = take_port(src, rest);
+    if (!rest.empty())
+    {
+        take_colon(src, rest);
+        if (rest != "participant" && rest != "observer")
+            throw_invalid_spec(src, "role must be \"participant\" or \"observer\"");
+        out.role = std::string(rest);
+    }
+
+    if (semicolon != string_view::npos)
     {
-        // We are just going to read from it, so this const_cast is okay
-        ptr<char> p = const_cast<ptr<char>>(input.data());
-        setg(p, p, p + input.size());
+        auto client = src.substr(semicolon + 1U);
+        if (client.find(':') != string_view::npos || (!client.empty() && client[0] == '['))
+        {
+            out.client_address = std::string(take_address(src, client));
+            take_colon(src, client);
+        }
+        out.client_port = take_port(src, client);
+        if (!client.empty())
+            throw_invalid_spec(src, "unexpected text after the client port");
     }
-};
+
+    return out;
+}
+
+bool operator==(const server_spec& lhs, const server_spec& rhs)
+{
+    return lhs.hostname       == rhs.hostname
+        && lhs.peer_port      == rhs.peer_port
+        && lhs.leader_port    == rhs.leader_port
+        && lhs.role           == rhs.role
+        && lhs.client_address == rhs.client_address
+        && lhs.client_port    == rhs.client_port;
+}
+
+bool operator!=(const server_spec& lhs, const server_spec& rhs)
+{
+    return !(lhs == rhs);
+}
+
+std::ostream& operator<<(std::ostream& os, const server_spec& self)
+{
+    os << self.hostname << ':' << self.peer_port << ':' << self.leader_port;
+    if (self.role)
+        os << ':' << *self.role;
+    if (self.client_port)
+    {
+        os << ';';
+        if (self.client_address)
+            os << *self.client_address << ':';
+        os << *self.client_port;
+    }
+    return os;
+}
+
+std::string to_string(const server_spec& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// configuration                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+constexpr std::size_t not_a_line = ~0UL;
 
 }
 
@@ -115,102 +243,166 @@ static std::set<std::string> parse_whitelist(string_view source)
     return out;
 }
 
-configuration configuration::from_lines(std::vector<std::string> lines)
+/// Read a number the way \c std::atol does: leading whitespace and a sign are allowed, parsing stops at the first
+/// character which is not a digit and a string with no digits is \c 0.
+static long parse_long(string_view src)
 {
-    static const std::regex line_expr(R"(^([^=]+)=([^ #]+)[ #]*$)",
-                                      std::regex_constants::ECMAScript | std::regex_constants::optimize
-                                     );
-    constexpr auto name_idx = 1U;
-    constexpr auto data_idx = 2U;
+    std::size_t idx = 0U;
+    while (idx < src.size() && std::isspace(static_cast<unsigned char>(src[idx])))
+        ++idx;
 
-    configuration out;
+    bool negative = false;
+    if (idx < src.size() && (src[idx] == '+' || src[idx] == '-'))
+        negative = src[idx++] == '-';
 
-    for (std::size_t line_no = 0U; line_no < lines.size(); ++line_no)
-    {
-        const auto& line = lines[line_no];
+    long out = 0;
+    for (; idx < src.size() && '0' <= src[idx] && src[idx] <= '9'; ++idx)
+        out = out * 10 + (src[idx] - '0');
+    return negative ? -out : out;
+}
 
-        if (line.empty() || line[0] == '#')
-            continue;
+/// Split \a line into the \a name and \a data of a setting. This accepts the same lines as `^([^=]+)=([^ #]+)[ #]*$`:
+/// the name is everything before the first \c '=' and the data runs up to the first space or \c '#', after which there
+/// can only be more of those.
+///
+/// \returns \c false if the line is not a setting (it is then kept as-is, but otherwise ignored).
+static bool split_setting(string_view line, string_view& name, string_view& data)
+{
+    auto eq = line.find('=');
+    if (eq == 0U || eq == string_view::npos)
+        return false;
 
-        std::smatch match;
-        if (std::regex_match(line, match, line_expr))
-        {
-            auto name = match[name_idx].str();
-            auto data = match[data_idx].str();
+    auto rest = line.substr(eq + 1U);
+    auto end  = rest.find_first_of(" #");
+    if (end != string_view::npos && rest.find_first_not_of(" #", end) != string_view::npos)
+        return false;
 
-            if (name == "clientPort")
-            {
-                out._client_port = { std::uint16_t(std::atoi(data.c_str())), line_no };
-            }
-            else if (name == "dataDir")
-            {
-                out._data_directory = { std::move(data), line_no };
-            }
-            else if (name == "tickTime")
-            {
-                out._tick_time = { std::chrono::milliseconds(std::atol(data.c_str())), line_no };
-            }
-            else if (name == "initLimit")
-            {
-                out._init_limit = { std::size_t(std::atol(data.c_str())), line_no };
-            }
-            else if (name == "syncLimit")
-            {
-                out._sync_limit = { std::size_t(std::atol(data.c_str())), line_no };
-            }
-            else if (name == "leaderServes")
-            {
-                out._leader_serves = { (data == "yes"), line_no };
-            }
-            else if (name == "4lw.commands.whitelist")
-            {
-                out._four_letter_word_whitelist = { parse_whitelist(data), line_no };
-            }
-            else if (name.find("server.") == 0U)
-            {
-                auto id = std::size_t(std::atol(name.c_str() + 7));
-                out._server_paths.insert({ server_id(id), { std::move(data), line_no } });
-            }
-            else
-            {
-                out._unknown_settings.insert({ std::move(name), { std::move(data), line_no } });
-            }
-        }
-    }
+    name = line.substr(0U, eq);
+    data = rest.substr(0U, end);
+    return !data.empty();
+}
 
-    out._lines = std::move(lines);
-    return out;
+static constexpr string_view server_prefix = "server.";
+
+static bool is_server_setting(string_view name)
+{
+    return name.substr(0U, server_prefix.size()) == server_prefix;
 }
 
-configuration configuration::from_stream(std::istream& stream)
+static server_id server_id_of(string_view name)
 {
-    std::vector<std::string> lines;
-    std::string              line;
+    return server_id(std::size_t(parse_long(name.substr(server_prefix.size()))));
+}
+
+void configuration::parse_line(std::string line)
+{
+    auto line_no = _lines.size();
 
-    while(std::getline(stream, line))
+    string_view name;
+    string_view data;
+    if (!line.empty() && line[0] != '#' && split_setting(line, name, data))
     {
-        lines.emplace_back(std::move(line));
+        if (name == "clientPort")
+            _client_port = { std::uint16_t(parse_long(data)), line_no };
+        else if (name == "dataDir")
+            _data_directory = { std::string(data), line_no };
+        else if (name == "tickTime")
+            _tick_time = { std::chrono::milliseconds(parse_long(data)), line_no };
+        else if (name == "initLimit")
+            _init_limit = { std::size_t(parse_long(data)), line_no };
+        else if (name == "syncLimit")
+            _sync_limit = { std::size_t(parse_long(data)), line_no };
+        else if (name == "leaderServes")
+            _leader_serves = { (data == "yes"), line_no };
+        else if (name == "4lw.commands.whitelist")
+            _four_letter_word_whitelist = { parse_whitelist(data), line_no };
+        else if (name == "dynamicConfigFile")
+            _dynamic_config_file = { std::string(data), line_no };
+        else if (is_server_setting(name))
+            _server_paths.insert({ server_id_of(name), { std::string(data), line_no } });
+        else
+            _unknown_settings.insert({ std::string(name), { std::string(data), line_no } });
     }
 
-    if (stream.eof())
-        return from_lines(std::move(lines));
-    else
+    _lines.emplace_back(std::move(line));
+}
+
+void configuration::parse_dynamic_line(std::string line)
+{
+    // A dynamic configuration only holds the membership of the ensemble -- server.N, as well as group.N and weight.N
+    // for hierarchical quorums, which are kept as lines but not interpreted.
+    string_view name;
+    string_view data;
+    if (!line.empty() && line[0] != '#' && split_setting(line, name, data) && is_server_setting(name))
+        _dynamic_server_paths.insert({ server_id_of(name), { std::string(data), _dynamic_lines.size() } });
+
+    _dynamic_lines.emplace_back(std::move(line));
+}
+
+/// Call \a action with each line of \a stream as it is read.
+///
+/// \throws std::runtime_error if reading stops before the end of the stream.
+template <typename FAction>
+static void for_each_line(std::istream& stream, const FAction& action)
+{
+    std::string line;
+    while (std::getline(stream, line))
+        action(std::move(line));
+
+    if (!stream.eof())
         throw std::runtime_error("Loading configuration did not reach EOF");
 }
 
+configuration configuration::from_lines(std::vector<std::string> lines)
+{
+    configuration out;
+    out._lines.reserve(lines.size());
+    for (auto& line : lines)
+        out.parse_line(std::move(line));
+    return out;
+}
+
+configuration configuration::from_stream(std::istream& stream)
+{
+    configuration out;
+    for_each_line(stream, [&] (std::string line) { out.parse_line(std::move(line)); });
+    return out;
+}
+
 configuration configuration::from_file(std::string filename)
 {
     std::ifstream inf(filename.c_str());
     auto out = from_stream(inf);
     out._source_file = std::move(filename);
+
+    if (out._dynamic_config_file.value)
+    {
+        std::ifstream dynamic_inf(out._dynamic_config_file.value->c_str());
+        if (!dynamic_inf)
+            throw std::runtime_error("Could not open dynamic configuration file " + *out._dynamic_config_file.value);
+        out.load_dynamic(dynamic_inf);
+    }
     return out;
 }
 
 configuration configuration::from_string(string_view value)
 {
-    zero_copy_streambuf buff(value);
-    std::istream        stream(&buff);
-    return from_stream(stream);
+    // Split the lines the same way std::getline would: a final line without a '\n' still counts, but the empty string
+    // after a final '\n' does not.
+    configuration out;
+    while (!value.empty())
+    {
+        auto end = value.find('\n');
+        out.parse_line(std::string(value.substr(0U, end)));
+        value.remove_prefix(end == string_view::npos ? value.size() : end + 1U);
+    }
+    return out;
+}
+
+configuration& configuration::load_dynamic(std::istream& stream)
+{
+    for_each_line(stream, [&] (std::string line) { parse_dynamic_line(std::move(line)); });
+    return *this;
 }
 
 bool configuration::is_minimal() const
@@ -223,7 +415,7 @@ bool configuration::is_minimal() const
 }
 
 template <typename T, typename FEncode>
-void configuration::set(setting<T>& target, optional<T> value, string_view key, const FEncode& encode)
+void configuration::set(line_list& lines, setting<T>& target, optional<T> value, string_view key, const FEncode& encode)
 {
     std::string target_line;
     if (value)
@@ -236,8 +428,8 @@ void configuration::set(setting<T>& target, optional<T> value, string_view key,
     if (target.line == not_a_line && value)
     {
         target.value = std::move(value);
-        target.line  = _lines.size();
-        _lines.emplace_back(std::move(target_line));
+        target.line  = lines.size();
+        lines.emplace_back(std::move(target_line));
     }
     else if (target.line == not_a_line && !value)
     {
@@ -245,11 +437,17 @@ void configuration::set(setting<T>& target, optional<T> value, string_view key,
     }
     else
     {
-        target.value        = std::move(value);
-        _lines[target.line] = std::move(target_line);
+        target.value       = std::move(value);
+        lines[target.line] = std::move(target_line);
     }
 }
 
+template <typename T, typename FEncode>
+void configuration::set(setting<T>& target, optional<T> value, string_view key, const FEncode& encode)
+{
+    set(_lines, target, std::move(value), key, encode);
+}
+
 template <typename T>
 void configuration::set(setting<T>& target, optional<T> value, string_view key)
 {
@@ -356,11 +554,33 @@ configuration& configuration::four_letter_word_whitelist(optional<std::set<std::
     return *this;
 }
 
+const optional<std::string>& configuration::dynamic_config_file() const
+{
+    return _dynamic_config_file.value;
+}
+
+configuration& configuration::dynamic_config_file(optional<std::string> path)
+{
+    set(_dynamic_config_file, std::move(path), "dynamicConfigFile");
+    return *this;
+}
+
 std::map<server_id, std::string> configuration::servers() const
 {
     std::map<server_id, std::string> out;
     for (const auto& entry : _server_paths)
         out.insert({ entry.first, *entry.second.value });
+    for (const auto& entry : _dynamic_server_paths)
+        out.insert({ entry.first, *entry.second.value });
+
+    return out;
+}
+
+std::map<server_id, server_spec> configuration::server_specs() const
+{
+    std::map<server_id, server_spec> out;
+    for (const auto& entry : servers())
+        out.insert({ entry.first, server_spec::parse(entry.second) });
 
     return out;
 }
@@ -370,19 +590,30 @@ configuration& configuration::add_server(server_id     id,
                                          std::uint16_t peer_port,
                                          std::uint16_t leader_port
                                         )
+{
+    server_spec spec;
+    spec.hostname    = std::move(hostname);
+    spec.peer_port   = peer_port;
+    spec.leader_port = leader_port;
+    return add_server(id, spec);
+}
+
+configuration& configuration::add_server(server_id id, const server_spec& spec)
 {
     id.ensure_valid();
 
-    if (_server_paths.count(id))
+    if (_server_paths.count(id) || _dynamic_server_paths.count(id))
         throw std::runtime_error(std::string("Already a server with ID ") + std::to_string(id.value));
 
-    hostname += ":";
-    hostname += std::to_string(peer_port);
-    hostname += ":";
-    hostname += std::to_string(leader_port);
-
-    auto iter = _server_paths.emplace(id, setting<std::string>()).first;
-    set(iter->second, some(std::move(hostname)), std::string("server.") + std::to_string(iter->first.value));
+    bool  dynamic = bool(_dynamic_config_file.value);
+    auto& paths   = dynamic ? _dynamic_server_paths : _server_paths;
+    auto  iter    = paths.emplace(id, setting<std::string>()).first;
+    set(dynamic ? _dynamic_lines : _lines,
+        iter->second,
+        some(to_string(spec)),
+        std::string(server_prefix) + std::to_string(iter->first.value),
+        [] (const std::string& x) -> const std::string& { return x; }
+       );
     return *this;
 }
 
@@ -397,16 +628,8 @@ std::map<std::string, std::string> configuration::unknown_settings() const
 
 configuration& configuration::add_setting(std::string key, std::string value)
 {
-    // This process is really inefficient, but people should not be using this very often. This is done this way because
-    // it is possible to specify a key that has a known setting (such as "dataDir"), which needs to be picked up
-    // correctly. `from_lines` has this logic, so just use it. Taking that matching logic out would be the best approach
-    // to take, but since this shouldn't be used, I haven't bothered.
-    auto source_file = _source_file;
-    auto lines       = _lines;
-    lines.emplace_back(key + "=" + value);
-
-    *this        = configuration::from_lines(std::move(lines));
-    _source_file = std::move(source_file);
+    // Parsing the line picks up a key with a known setting (such as "dataDir") the same way loading it would
+    parse_line(key + "=" + value);
     return *this;
 }
 
@@ -418,14 +641,30 @@ void configuration::save(std::ostream& os) const
     os.flush();
 }
 
+void configuration::save_dynamic(std::ostream& os) const
+{
+    for (const auto& line : _dynamic_lines)
+        os << line << std::endl;
+
+    os.flush();
+}
+
 void configuration::save_file(std::string filename)
 {
     std::ofstream ofs(filename.c_str());
     save(ofs);
-    if (ofs)
-        _source_file = std::move(filename);
-    else
+    if (!ofs)
         throw std::runtime_error("Error saving file");
+
+    if (_dynamic_config_file.value && !_dynamic_lines.empty())
+    {
+        std::ofstream dynamic_ofs(_dynamic_config_file.value->c_str());
+        save_dynamic(dynamic_ofs);
+        if (!dynamic_ofs)
+            throw std::runtime_error("Error saving dynamic configuration file");
+    }
+
+    _source_file = std::move(filename);
 }
 
 bool operator==(const configuration& lhs, const configuration& rhs)
@@ -446,11 +685,8 @@ bool operator==(const configuration& lhs, const configuration& rhs)
         && lhs.sync_limit()                 == rhs.sync_limit()
         && lhs.leader_serves()              == rhs.leader_serves()
         && lhs.four_letter_word_whitelist() == rhs.four_letter_word_whitelist()
-        && lhs._server_paths.size()         == rhs._server_paths.size()
-        && lhs._server_paths.end()          == std::mismatch(lhs._server_paths.begin(), lhs._server_paths.end(),
-                                                             rhs._server_paths.begin(), rhs._server_paths.end(),
-                                                             same_items
-                                                            ).first
+        && lhs.dynamic_config_file()        == rhs.dynamic_config_file()
+        && lhs.servers()                    == rhs.servers()
         && lhs._unknown_settings.size()     == rhs._unknown_settings.size()
         && lhs._unknown_settings.end()      == std::mismatch(lhs._unknown_settings.begin(), lhs._unknown_settings.end(),
                                                              rhs._unknown_settings.begin(), rhs._unknown_settings.end(),
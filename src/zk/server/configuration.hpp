@@ -47,6 +47,45 @@ struct server_id :
     friend std::ostream& operator<<(std::ostream&, const server_id&);
 };
 
+/// The address of a server in the ensemble, as given in a \c server.N setting. The full form is
+/// `hostname:peer_port:leader_port[:role][;[client_address:]client_port]`, where the role and the client part were
+/// added in ZooKeeper 3.5 (with dynamic reconfiguration). An IPv6 \c hostname or \c client_address is written in brackets,
+/// as in `[::1]`.
+struct server_spec final
+{
+    /// The address peers connect to this server at.
+    std::string hostname;
+
+    /// The port used to move ZooKeeper data on.
+    std::uint16_t peer_port = 2888U;
+
+    /// The port used for leader election.
+    std::uint16_t leader_port = 3888U;
+
+    /// Either \c "participant" or \c "observer". If unset, the server is a participant.
+    optional<std::string> role;
+
+    /// The address the server accepts client connections on. If unset, clients can connect on any address.
+    optional<std::string> client_address;
+
+    /// The port the server accepts client connections on. This is how ZooKeeper 3.5 configures the client port of each
+    /// server in a dynamic configuration file.
+    optional<std::uint16_t> client_port;
+
+    /// Parse a \c server.N value.
+    ///
+    /// \throws std::invalid_argument if \a src is not a valid server address.
+    static server_spec parse(string_view src);
+};
+
+bool operator==(const server_spec& lhs, const server_spec& rhs);
+bool operator!=(const server_spec& lhs, const server_spec& rhs);
+
+/// Prints the spec in the form it has in a \c server.N setting.
+std::ostream& operator<<(std::ostream&, const server_spec&);
+
+std::string to_string(const server_spec&);
+
 /// Represents a configuration which should be run by \ref server instance. This can also be used to modify an existing
 /// ZooKeeper server configuration file in a safer manner than the unfortunate operating practice of \c sed, \c awk, and
 /// \c perl.
@@ -108,10 +147,14 @@ public:
     /// through a file with \c save or it can run directly from the command line.
     static configuration make_minimal(std::string data_directory, std::uint16_t client_port = default_client_port);
 
-    /// Load the configuration from a file.
+    /// Load the configuration from a file. If it sets \ref dynamic_config_file, the servers are loaded from that file
+    /// as well (see \ref load_dynamic).
+    ///
+    /// \throws std::runtime_error if the dynamic configuration file can not be read.
     static configuration from_file(std::string filename);
 
-    /// Load configuration from the provided \a stream.
+    /// Load configuration from the provided \a stream. Each line is parsed as it is read, so the source is never held
+    /// in memory more than once. A dynamic configuration file is \e not loaded -- use \ref load_dynamic for that.
     static configuration from_stream(std::istream& stream);
 
     /// Load configuration from the provided \a lines.
@@ -120,6 +163,11 @@ public:
     /// Load configuration directly from the in-memory \a value.
     static configuration from_string(string_view value);
 
+    /// Load the servers from a ZooKeeper 3.5 dynamic configuration file (see \ref dynamic_config_file) from \a stream.
+    /// The \c server.N settings there are reported by \ref servers along with the ones from the main file and are
+    /// written back by \ref save_dynamic.
+    configuration& load_dynamic(std::istream& stream);
+
     ~configuration() noexcept;
 
     /// Get the source file. This will only have a value if this was created by \ref from_file.
@@ -192,10 +240,23 @@ public:
     configuration&               four_letter_word_whitelist(optional<std::set<std::string>> words);
     /// \}
 
-    /// Get the servers which are part of the ZooKeeper ensemble.
+    /// \{
+    /// The ZooKeeper 3.5 dynamic configuration file, which holds the \c server.N settings so they can be changed while
+    /// the ensemble runs. A relative path is relative to the working directory of the server, as it is for ZooKeeper.
+    const optional<std::string>& dynamic_config_file() const;
+    configuration&               dynamic_config_file(optional<std::string> path);
+    /// \}
+
+    /// Get the servers which are part of the ZooKeeper ensemble, from both the main and the dynamic configuration.
     std::map<server_id, std::string> servers() const;
 
-    /// Add a new server to the configuration.
+    /// Get the servers which are part of the ZooKeeper ensemble, parsed.
+    ///
+    /// \throws std::invalid_argument if a \c server.N setting is not a valid \ref server_spec.
+    std::map<server_id, server_spec> server_specs() const;
+
+    /// Add a new server to the configuration. If a \ref dynamic_config_file is set, the server is added to the dynamic
+    /// configuration.
     ///
     /// \param id The cluster unique ID of this server.
     /// \param hostname The address of the server to connect to.
@@ -209,6 +270,11 @@ public:
                               std::uint16_t leader_port = default_leader_port
                              );
 
+    /// Add a new server described by \a spec to the configuration.
+    ///
+    /// \see add_server
+    configuration& add_server(server_id id, const server_spec& spec);
+
     /// Get settings that were in the configuration file (or manually added with \ref add_setting) but unknown to this
     /// library.
     std::map<std::string, std::string> unknown_settings() const;
@@ -224,8 +290,12 @@ public:
     /// \see save_file
     void save(std::ostream& stream) const;
 
+    /// Write the dynamic configuration (the servers loaded by \ref load_dynamic or added while a
+    /// \ref dynamic_config_file is set) to the provided \a stream.
+    void save_dynamic(std::ostream& stream) const;
+
     /// Save this configuration to \a filename. On successful save, \c source_file will but updated to reflect the new
-    /// file.
+    /// file. If there is a dynamic configuration, it is saved to \ref dynamic_config_file as well.
     void save_file(std::string filename);
 
     /// \{
@@ -249,12 +319,21 @@ private:
         std::size_t line;
     };
 
+    template <typename T, typename FEncode>
+    void set(line_list& lines, setting<T>& target, optional<T> value, string_view key, const FEncode& encode);
+
     template <typename T, typename FEncode>
     void set(setting<T>& target, optional<T> value, string_view key, const FEncode& encode);
 
     template <typename T>
     void set(setting<T>& target, optional<T> value, string_view key);
 
+    /// Parse \a line as the next line of the main configuration and keep it.
+    void parse_line(std::string line);
+
+    /// Parse \a line as the next line of the dynamic configuration and keep it.
+    void parse_dynamic_line(std::string line);
+
 private:
     explicit configuration();
 
@@ -268,8 +347,11 @@ private:
     setting<std::size_t>                        _sync_limit;
     setting<bool>                               _leader_serves;
     setting<std::set<std::string>>              _four_letter_word_whitelist;
+    setting<std::string>                        _dynamic_config_file;
     std::map<server_id, setting<std::string>>   _server_paths;
     std::map<std::string, setting<std::string>> _unknown_settings;
+    line_list                                   _dynamic_lines;
+    std::map<server_id, setting<std::string>>   _dynamic_server_paths;
 };
 
 /// \}
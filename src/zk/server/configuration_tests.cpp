@@ -1,8 +1,13 @@
 #include <zk/string_view.hpp>
 #include <zk/tests/test.hpp>
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
 
 #include "configuration.hpp"
 
@@ -99,4 +104,122 @@ GTEST_TEST(configuration_tests, four_letter_words)
     CHECK_TRUE(expected == parsed.four_letter_word_whitelist());
 }
 
+GTEST_TEST(configuration_tests, line_syntax)
+{
+    // Only spaces and '#' can follow the value -- a line with a trailing comment is not a setting
+    auto parsed = configuration::from_string("tickTime=3000  ##\n"
+                                             "initLimit=7#comment\n"
+                                             "=orphan\n"
+                                             "syncLimit=\n"
+                                             "weird==value\n"
+                                             "noEnd=value"
+                                            );
+    CHECK_EQ(3000U, parsed.tick_time().count());
+    CHECK_EQ(configuration::default_init_limit, parsed.init_limit());
+    CHECK_EQ(configuration::default_sync_limit, parsed.sync_limit());
+    auto unknown = parsed.unknown_settings();
+    CHECK_EQ(2U, unknown.size());
+    CHECK_EQ("=value", unknown.at("weird"));
+    CHECK_EQ("value",  unknown.at("noEnd"));
+
+    // Changing a setting rewrites the line it came from
+    parsed.tick_time(std::chrono::milliseconds(1000));
+    std::ostringstream os;
+    parsed.save(os);
+    CHECK_EQ(0U, os.str().find("tickTime=1000\ninitLimit=7#comment\n"));
+}
+
+GTEST_TEST(configuration_tests, server_spec)
+{
+    auto plain = server_spec::parse("zookeeper1:2888:3888");
+    CHECK_EQ("zookeeper1", plain.hostname);
+    CHECK_EQ(2888U, plain.peer_port);
+    CHECK_EQ(3888U, plain.leader_port);
+    CHECK_FALSE(plain.role);
+    CHECK_FALSE(plain.client_port);
+    CHECK_EQ("zookeeper1:2888:3888", to_string(plain));
+
+    auto full = server_spec::parse("[fd2d::73b]:2888:3888:observer;0.0.0.0:2181");
+    CHECK_EQ("[fd2d::73b]", full.hostname);
+    CHECK_EQ("observer", full.role.value());
+    CHECK_EQ("0.0.0.0", full.client_address.value());
+    CHECK_EQ(2181U, full.client_port.value());
+    CHECK_EQ("[fd2d::73b]:2888:3888:observer;0.0.0.0:2181", to_string(full));
+
+    auto port_only = server_spec::parse("zk-2:2888:3888;2182");
+    CHECK_FALSE(port_only.client_address);
+    CHECK_EQ(2182U, port_only.client_port.value());
+
+    CHECK_THROWS(std::invalid_argument) { server_spec::parse("zk-1"); };
+    CHECK_THROWS(std::invalid_argument) { server_spec::parse("zk-1:2888"); };
+    CHECK_THROWS(std::invalid_argument) { server_spec::parse("zk-1:2888:99999"); };
+    CHECK_THROWS(std::invalid_argument) { server_spec::parse("zk-1:2888:3888:leader"); };
+    CHECK_THROWS(std::invalid_argument) { server_spec::parse("zk-1:2888:3888;"); };
+}
+
+static string_view configuration_dynamic_example =
+R"(# generated by reconfig
+server.1=zk-1:2888:3888:participant;2181
+server.2=zk-2:2888:3888:participant;2181
+server.3=zk-3:2888:3888:observer;0.0.0.0:2181
+)";
+
+GTEST_TEST(configuration_tests, dynamic_config)
+{
+    auto parsed = configuration::from_string("tickTime=2000\ndataDir=/var/lib/zookeeper\n"
+                                             "dynamicConfigFile=/etc/zookeeper/zoo.cfg.dynamic\n"
+                                            );
+    CHECK_EQ("/etc/zookeeper/zoo.cfg.dynamic", parsed.dynamic_config_file().value());
+    CHECK_TRUE(parsed.servers().empty());
+
+    std::istringstream dynamic_source{ std::string(configuration_dynamic_example) };
+    parsed.load_dynamic(dynamic_source);
+    auto specs = parsed.server_specs();
+    CHECK_EQ(3U, specs.size());
+    CHECK_EQ("observer", specs.at(server_id(3)).role.value());
+
+    // New servers join the dynamic configuration, which is saved on its own
+    parsed.add_server(server_id(4), server_spec::parse("zk-4:2888:3888:participant;2181"));
+    CHECK_THROWS(std::runtime_error) { parsed.add_server(server_id(1), "zk-1"); };
+
+    std::ostringstream static_os;
+    parsed.save(static_os);
+    CHECK_EQ(std::string::npos, static_os.str().find("server."));
+
+    std::ostringstream dynamic_os;
+    parsed.save_dynamic(dynamic_os);
+    CHECK_EQ(std::string(configuration_dynamic_example) + "server.4=zk-4:2888:3888:participant;2181\n",
+             dynamic_os.str()
+            );
+}
+
+GTEST_TEST(configuration_tests, dynamic_config_file)
+{
+    char dir_template[] = "/tmp/zkpp-configuration-XXXXXX";
+    std::string dir     = ::mkdtemp(dir_template);
+    auto main_file      = dir + "/zoo.cfg";
+    auto dynamic_file   = dir + "/zoo.cfg.dynamic";
+
+    {
+        std::ofstream main_ofs(main_file);
+        main_ofs << "dataDir=" << dir << "\ndynamicConfigFile=" << dynamic_file << "\n";
+        std::ofstream dynamic_ofs(dynamic_file);
+        dynamic_ofs << configuration_dynamic_example;
+    }
+
+    auto loaded = configuration::from_file(main_file);
+    CHECK_EQ(3U, loaded.servers().size());
+    CHECK_EQ("zk-2:2888:3888:participant;2181", loaded.servers().at(server_id(2)));
+
+    std::remove(dynamic_file.c_str());
+    CHECK_THROWS(std::runtime_error) { configuration::from_file(main_file); };
+
+    loaded.save_file(main_file);
+    CHECK_EQ(loaded, configuration::from_file(main_file));
+
+    std::remove(dynamic_file.c_str());
+    std::remove(main_file.c_str());
+    ::rmdir(dir.c_str());
+}
+
 }
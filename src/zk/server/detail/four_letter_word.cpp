@@ -0,0 +1,118 @@
+#include "four_letter_word.hpp"
+#include "close.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace zk::server::detail
+{
+
+namespace
+{
+
+/** Owns a socket for the length of a single exchange. **/
+class socket_handle final
+{
+public:
+    explicit socket_handle(int fd) noexcept :
+            _fd(fd)
+    { }
+
+    socket_handle(const socket_handle&) = delete;
+    socket_handle& operator=(const socket_handle&) = delete;
+
+    ~socket_handle() noexcept
+    {
+        if (_fd >= 0)
+            ::close(_fd);
+    }
+
+    int get() const noexcept { return _fd; }
+
+private:
+    int _fd;
+};
+
+}
+
+/** Wait until \a fd has any of \a events or \a deadline passes.
+ *
+ *  \returns \c false if the deadline passed or the wait failed.
+**/
+static bool wait_for(int fd, short events, std::chrono::steady_clock::time_point deadline)
+{
+    while (true)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline
+                                                                               - std::chrono::steady_clock::now()
+                                                                              );
+        if (remaining.count() <= 0)
+            return false;
+
+        ::pollfd entry = { fd, events, 0 };
+        int rc = ::poll(&entry, 1, int(remaining.count()));
+        if (rc > 0)
+            return true;
+        else if (rc < 0 && errno != EINTR)
+            return false;
+    }
+}
+
+optional<std::string> send_four_letter_word(std::uint16_t port, string_view word, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    socket_handle sock(::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (sock.get() < 0)
+        return nullopt;
+
+    ::sockaddr_in addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::connect(sock.get(), reinterpret_cast<const ::sockaddr*>(&addr), sizeof addr) != 0)
+    {
+        if (errno != EINPROGRESS || !wait_for(sock.get(), POLLOUT, deadline))
+            return nullopt;
+
+        int       err     = 0;
+        socklen_t err_len = sizeof err;
+        if (::getsockopt(sock.get(), SOL_SOCKET, SO_ERROR, &err, &err_len) != 0 || err != 0)
+            return nullopt;
+    }
+
+    // The word is only 4 bytes, which always fits in the send buffer of a fresh connection
+    if (::send(sock.get(), word.data(), word.size(), MSG_NOSIGNAL) != ::ssize_t(word.size()))
+        return nullopt;
+
+    std::string out;
+    char        buffer[4096];
+    while (wait_for(sock.get(), POLLIN, deadline))
+    {
+        auto rc = ::recv(sock.get(), buffer, sizeof buffer, 0);
+        if (rc > 0)
+            out.append(buffer, std::size_t(rc));
+        else if (rc == 0)
+            return out;
+        else if (errno != EINTR && errno != EAGAIN)
+            return nullopt;
+    }
+    return nullopt;
+}
+
+bool is_serving(std::uint16_t port, std::chrono::milliseconds timeout)
+{
+    auto response = send_four_letter_word(port, "srvr", timeout);
+    return response && response->find("Mode: ") != std::string::npos;
+}
+
+}
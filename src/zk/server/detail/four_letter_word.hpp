@@ -0,0 +1,28 @@
+#pragma once
+
+#include <zk/config.hpp>
+#include <zk/optional.hpp>
+#include <zk/string_view.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace zk::server::detail
+{
+
+/** Send the four letter word command \a word (such as \c "srvr" or \c "ruok") to the server listening on \a port of
+ *  this machine and read the whole response.
+ *
+ *  \param timeout How long to wait for the whole exchange, from connecting to the server closing the connection.
+ *  \returns The response or \c nullopt if the server could not be reached or did not answer in time.
+**/
+optional<std::string> send_four_letter_word(std::uint16_t port, string_view word, std::chrono::milliseconds timeout);
+
+/** Is the server listening on \a port of this machine serving clients? This asks with \c srvr (the only command
+ *  allowed by default since ZooKeeper 3.5), which only reports a \c Mode once the server has joined a quorum or is
+ *  running standalone.
+**/
+bool is_serving(std::uint16_t port, std::chrono::milliseconds timeout);
+
+}
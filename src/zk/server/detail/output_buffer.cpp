@@ -0,0 +1,84 @@
+#include "output_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace zk::server::detail
+{
+
+output_buffer::output_buffer(std::size_t capacity) :
+        _storage(capacity),
+        _start(0U),
+        _size(0U),
+        _discarded(0U)
+{ }
+
+output_buffer::~output_buffer() noexcept = default;
+
+void output_buffer::commit(std::size_t size) noexcept
+{
+    if (size == 0U)
+        return;
+
+    auto overflow = _size + size > _storage.size() ? _size + size - _storage.size() : std::size_t(0U);
+    _discarded += overflow;
+    _start      = (_start + overflow) % _storage.size();
+    _size      += size - overflow;
+}
+
+void output_buffer::write(const char* data, std::size_t size)
+{
+    // Only the last `capacity` bytes of `data` could survive the write
+    auto skip = size > capacity() ? size - capacity() : std::size_t(0U);
+    if (skip != 0U)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+        _discarded += skip;
+    }
+    data += skip;
+    size -= skip;
+    if (size == 0U)
+        return;
+
+    fill(size,
+         [&] (char* first, std::size_t first_size, char* second, std::size_t second_size)
+         {
+             std::memcpy(first, data, first_size);
+             std::memcpy(second, data + first_size, second_size);
+             return first_size + second_size;
+         }
+        );
+}
+
+std::string output_buffer::contents() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+
+    std::string out;
+    out.reserve(_size);
+    auto first = std::min(_size, _storage.size() - _start);
+    out.append(_storage.data() + _start, first);
+    out.append(_storage.data(), _size - first);
+    return out;
+}
+
+void output_buffer::clear()
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    _start = 0U;
+    _size  = 0U;
+}
+
+std::size_t output_buffer::size() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    return _size;
+}
+
+std::size_t output_buffer::discarded() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    return _discarded;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace zk::server::detail
+{
+
+/** A bounded record of the most recent output of a process. Once \c capacity bytes have been written, every write
+ *  discards the oldest bytes to make room, so a chatty process costs a fixed amount of memory no matter how long it
+ *  runs. All operations are safe to call concurrently.
+**/
+class output_buffer final
+{
+public:
+    /** Create an empty buffer which keeps the last \a capacity bytes written to it. **/
+    explicit output_buffer(std::size_t capacity);
+
+    output_buffer(const output_buffer&) = delete;
+    output_buffer& operator=(const output_buffer&) = delete;
+
+    ~output_buffer() noexcept;
+
+    /** Append \a size bytes from \a data, discarding the oldest contents if there is not enough room. **/
+    void write(const char* data, std::size_t size);
+
+    /** Let \a reader put up to \a max bytes straight into the storage of this buffer, with no intermediate copy. The
+     *  new bytes replace the oldest contents exactly as they would with \c write. The buffer is locked for the call.
+     *
+     *  \param reader Called once as `reader(first, first_size, second, second_size)` with the (at most two) spans the
+     *   next bytes go into, in order. It returns how many bytes it filled, starting from \c first. If it throws, the
+     *   contents are left as they were, except for whatever it wrote over.
+     *  \returns The number of bytes \a reader filled.
+    **/
+    template <typename FReader>
+    std::size_t fill(std::size_t max, FReader&& reader)
+    {
+        std::unique_lock<std::mutex> ax(_protect);
+
+        auto cap = _storage.size();
+        max      = std::min(max, cap);
+        auto end   = cap == 0U ? std::size_t(0U) : (_start + _size) % cap;
+        auto first = std::min(max, cap - end);
+
+        std::size_t filled = reader(_storage.data() + end, first, _storage.data(), max - first);
+        commit(filled);
+        return filled;
+    }
+
+    /** Get a copy of the current contents, oldest first. **/
+    std::string contents() const;
+
+    /** Remove everything from the buffer. This does not reset \c discarded. **/
+    void clear();
+
+    /** How many bytes are currently held? This is never more than \c capacity. **/
+    std::size_t size() const;
+
+    /** The most bytes this buffer will hold. **/
+    std::size_t capacity() const noexcept { return _storage.size(); }
+
+    /** How many bytes have been discarded to make room for newer output since this buffer was created? **/
+    std::size_t discarded() const;
+
+private:
+    /** Account for \a size bytes which were just put after the newest contents. \c _protect must be held. **/
+    void commit(std::size_t size) noexcept;
+
+private:
+    mutable std::mutex _protect;
+    std::vector<char>  _storage;
+    std::size_t        _start;     //!< Index of the oldest byte in \c _storage.
+    std::size_t        _size;      //!< Number of bytes held, starting from \c _start and wrapping around.
+    std::size_t        _discarded;
+};
+
+}
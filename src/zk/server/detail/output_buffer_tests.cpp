@@ -0,0 +1,80 @@
+#include <zk/tests/test.hpp>
+
+#include "output_buffer.hpp"
+
+namespace zk::server::detail
+{
+
+static void write(output_buffer& buf, const std::string& contents)
+{
+    buf.write(contents.data(), contents.size());
+}
+
+GTEST_TEST(output_buffer_tests, under_capacity)
+{
+    output_buffer buf(16U);
+    write(buf, "Hello, ");
+    write(buf, "world!");
+    CHECK_EQ("Hello, world!", buf.contents());
+    CHECK_EQ(13U, buf.size());
+    CHECK_EQ(0U, buf.discarded());
+}
+
+GTEST_TEST(output_buffer_tests, wraps_around)
+{
+    output_buffer buf(8U);
+    write(buf, "abcdef");
+    write(buf, "ghij");
+    CHECK_EQ("cdefghij", buf.contents());
+    CHECK_EQ(2U, buf.discarded());
+
+    write(buf, "klm");
+    CHECK_EQ("fghijklm", buf.contents());
+    CHECK_EQ(5U, buf.discarded());
+}
+
+GTEST_TEST(output_buffer_tests, oversized_write)
+{
+    output_buffer buf(4U);
+    write(buf, "ab");
+    write(buf, "0123456789");
+    CHECK_EQ("6789", buf.contents());
+    CHECK_EQ(8U, buf.discarded());
+}
+
+GTEST_TEST(output_buffer_tests, matches_unbounded)
+{
+    output_buffer buf(97U);
+    std::string   all;
+    for (std::size_t idx = 0U; idx < 200U; ++idx)
+    {
+        std::string piece(idx % 31U, char('a' + idx % 26U));
+        write(buf, piece);
+        all += piece;
+
+        auto expected = all.size() > 97U ? all.substr(all.size() - 97U) : all;
+        CHECK_EQ(expected, buf.contents());
+        CHECK_EQ(all.size() - expected.size(), buf.discarded());
+    }
+}
+
+GTEST_TEST(output_buffer_tests, clear)
+{
+    output_buffer buf(4U);
+    write(buf, "abcdef");
+    buf.clear();
+    CHECK_EQ("", buf.contents());
+    CHECK_EQ(2U, buf.discarded());
+    write(buf, "xyz");
+    CHECK_EQ("xyz", buf.contents());
+}
+
+GTEST_TEST(output_buffer_tests, zero_capacity)
+{
+    output_buffer buf(0U);
+    write(buf, "abc");
+    CHECK_EQ("", buf.contents());
+    CHECK_EQ(3U, buf.discarded());
+}
+
+}
@@ -0,0 +1,146 @@
+#include "output_reactor.hpp"
+#include "close.hpp"
+#include "output_buffer.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace zk::server::detail
+{
+
+/** The most to read from one descriptor per wakeup. The \c epoll set is level-triggered, so a descriptor with more than
+ *  this is read again on the next pass -- after every other ready descriptor has had its turn. Reads go straight into
+ *  the ring of the sink, so this costs no memory of its own.
+**/
+static constexpr std::size_t read_chunk_size = 64U * 1024U;
+
+static void add_to_set(int epoll_fd, int fd)
+{
+    ::epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        throw std::system_error(errno, std::system_category(), "epoll_ctl(EPOLL_CTL_ADD)");
+}
+
+static void remove_from_set(int epoll_fd, int fd) noexcept
+{
+    // ENOENT or EBADF mean the kernel already dropped it (closing the last reference does that), which is the goal
+    ::epoll_event ev{};
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+output_reactor::output_reactor() :
+        _epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+        _running(true)
+{
+    if (_epoll_fd == -1)
+        throw std::system_error(errno, std::system_category(), "epoll_create1");
+
+    try
+    {
+        add_to_set(_epoll_fd, _wakeup.native_handle());
+        _worker = std::thread([this] { run(); });
+    }
+    catch (...)
+    {
+        detail::close(_epoll_fd);
+        throw;
+    }
+}
+
+output_reactor::~output_reactor() noexcept
+{
+    _running.store(false, std::memory_order_release);
+    _wakeup.notify_one();
+    if (_worker.joinable())
+        _worker.join();
+
+    ::close(_epoll_fd);
+}
+
+output_reactor& output_reactor::instance()
+{
+    static output_reactor inst;
+    return inst;
+}
+
+void output_reactor::attach(pipe::handle fd, std::shared_ptr<output_buffer> sink)
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    add_to_set(_epoll_fd, fd);
+    _sinks[fd] = std::move(sink);
+}
+
+void output_reactor::detach(pipe::handle fd)
+{
+    // The worker holds _protect for as long as it handles events, so once we have it, no read of fd is in progress
+    std::unique_lock<std::mutex> ax(_protect);
+    if (_sinks.erase(fd) != 0U)
+        remove_from_set(_epoll_fd, fd);
+}
+
+std::size_t output_reactor::attached_count() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    return _sinks.size();
+}
+
+bool output_reactor::transfer(pipe::handle fd, output_buffer& sink)
+{
+    try
+    {
+        return read_into(fd, sink, read_chunk_size).end_of_file;
+    }
+    catch (const std::system_error&)
+    {
+        // The descriptor is unusable, so treat it as closed
+        return true;
+    }
+}
+
+void output_reactor::run() noexcept
+{
+    ::epoll_event events[64];
+
+    while (_running.load(std::memory_order_acquire))
+    {
+        int count = ::epoll_wait(_epoll_fd, events, int(sizeof events / sizeof events[0]), -1);
+        if (count == -1)
+        {
+            // LCOV_EXCL_START: Only EINTR is possible with a valid epoll descriptor and buffer
+            if (errno == EINTR)
+                continue;
+            else
+                return;
+            // LCOV_EXCL_STOP
+        }
+
+        std::unique_lock<std::mutex> ax(_protect);
+        for (int idx = 0; idx < count; ++idx)
+        {
+            int fd = events[idx].data.fd;
+            if (fd == _wakeup.native_handle())
+            {
+                _wakeup.try_wait();
+                continue;
+            }
+
+            // The descriptor might have been detached between epoll_wait returning and us taking the lock
+            auto iter = _sinks.find(fd);
+            if (iter == _sinks.end())
+                continue;
+
+            if (transfer(fd, *iter->second))
+            {
+                remove_from_set(_epoll_fd, fd);
+                _sinks.erase(iter);
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "event_handle.hpp"
+#include "pipe.hpp"
+
+namespace zk::server::detail
+{
+
+class output_buffer;
+
+/** Captures the output of any number of subprocesses with a single \c epoll thread. Each attached file descriptor is
+ *  read as soon as it has data and its contents are written into the \c output_buffer it was attached with. When the
+ *  writing side closes, the descriptor is detached automatically.
+ *
+ *  Every \c server in a process shares \c instance, so running dozens of servers costs one thread instead of one each.
+**/
+class output_reactor final
+{
+public:
+    /** Create a reactor with its own thread. Most code should use \c instance instead. **/
+    output_reactor();
+
+    output_reactor(const output_reactor&) = delete;
+    output_reactor& operator=(const output_reactor&) = delete;
+
+    ~output_reactor() noexcept;
+
+    /** Get the reactor shared by the whole process. It is created on first use. **/
+    static output_reactor& instance();
+
+    /** Start capturing everything readable from \a fd into \a sink. The descriptor must be non-blocking and stay open
+     *  until it is detached, either by \c detach or by reaching end of file.
+     *
+     *  \throws std::system_error if \a fd could not be added to the \c epoll set.
+    **/
+    void attach(pipe::handle fd, std::shared_ptr<output_buffer> sink);
+
+    /** Stop capturing from \a fd. Once this returns, the reactor will not read from \a fd again, so it is safe to close
+     *  or read from it directly. Detaching a descriptor which is not attached does nothing.
+    **/
+    void detach(pipe::handle fd);
+
+    /** How many descriptors are currently attached? **/
+    std::size_t attached_count() const;
+
+private:
+    void run() noexcept;
+
+    /** Read what is available from \a fd into \a sink.
+     *
+     *  \returns \c true if the writing end is closed.
+    **/
+    bool transfer(pipe::handle fd, output_buffer& sink);
+
+private:
+    int                                                    _epoll_fd;
+    event_handle                                           _wakeup;
+    std::atomic<bool>                                      _running;
+    mutable std::mutex                                     _protect;
+    std::map<pipe::handle, std::shared_ptr<output_buffer>> _sinks;
+    std::thread                                            _worker;
+};
+
+}
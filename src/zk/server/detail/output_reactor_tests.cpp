@@ -0,0 +1,86 @@
+#include <zk/tests/test.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "output_buffer.hpp"
+#include "output_reactor.hpp"
+#include "subprocess.hpp"
+
+namespace zk::server::detail
+{
+
+template <typename FPredicate>
+static bool wait_for(FPredicate&& pred)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+GTEST_TEST(output_reactor_tests, captures_pipe)
+{
+    output_reactor reactor;
+    auto           sink = std::make_shared<output_buffer>(1024U);
+
+    pipe p;
+    reactor.attach(p.native_read_handle(), sink);
+    CHECK_EQ(1U, reactor.attached_count());
+
+    p.write("Hello, ");
+    p.write("world!");
+    CHECK_TRUE(wait_for([&] { return sink->size() == 13U; }));
+    CHECK_EQ("Hello, world!", sink->contents());
+
+    reactor.detach(p.native_read_handle());
+    CHECK_EQ(0U, reactor.attached_count());
+
+    // nothing reads the pipe once it is detached
+    p.write("more");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK_EQ("Hello, world!", sink->contents());
+    CHECK_EQ("more", p.read());
+}
+
+GTEST_TEST(output_reactor_tests, detaches_at_eof)
+{
+    output_reactor reactor;
+    auto           sink = std::make_shared<output_buffer>(1024U);
+
+    subprocess proc("echo", { "Hello, world!" });
+    reactor.attach(proc.stdout().native_read_handle(), sink);
+
+    CHECK_TRUE(wait_for([&] { return reactor.attached_count() == 0U; }));
+    CHECK_EQ("Hello, world!\n", sink->contents());
+}
+
+GTEST_TEST(output_reactor_tests, many_processes)
+{
+    output_reactor reactor;
+
+    std::vector<std::unique_ptr<subprocess>>    procs;
+    std::vector<std::shared_ptr<output_buffer>> sinks;
+    for (std::size_t idx = 0U; idx < 32U; ++idx)
+    {
+        procs.emplace_back(std::make_unique<subprocess>("seq", subprocess::argument_list{ "1000" }));
+        sinks.emplace_back(std::make_shared<output_buffer>(64U));
+        reactor.attach(procs.back()->stdout().native_read_handle(), sinks.back());
+    }
+
+    CHECK_TRUE(wait_for([&] { return reactor.attached_count() == 0U; }));
+    for (const auto& sink : sinks)
+    {
+        // seq 1000 writes 3893 bytes; only the tail is kept
+        CHECK_EQ(64U, sink->size());
+        CHECK_EQ(3893U - 64U, sink->discarded());
+        CHECK_EQ("1000\n", sink->contents().substr(59U));
+    }
+}
+
+}
@@ -1,10 +1,12 @@
 #include "close.hpp"
+#include "output_buffer.hpp"
 #include "pipe.hpp"
 
 #include <algorithm>
 #include <system_error>
 
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace zk::server::detail
@@ -92,30 +94,156 @@ std::string pipe::read(optional<std::size_t> max)
     {
         char read_buf[4096];
 
-        ssize_t rc = ::read(_read_fd, read_buf, sizeof read_buf);
-        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
-            rc = 0;
-
-        if (rc < 0 && errno == EINTR)
+        read_result result;
+        try
         {
-            continue;
+            result = read(read_buf, sizeof read_buf);
         }
-        else if (rc < 0 && errno != EINTR)
+        catch (const std::system_error&)
         {
             if (out.empty())
-                throw std::system_error(errno, std::system_category(), "Failed to read from pipe");
+                throw;
             else
                 return out;
         }
+
+        if (result.size == 0U)
+            return out;
+        out.append(read_buf, result.size);
+    }
+}
+
+read_result pipe::read(ptr<char> dest, std::size_t max)
+{
+    if (_read_fd == -1)
+        throw pipe_closed();
+
+    while (true)
+    {
+        ssize_t rc = ::read(_read_fd, dest, max);
+        if (rc > 0)
+            return { std::size_t(rc), false };
+        else if (rc == 0)
+            return { 0U, max != 0U };
+        else if (errno == EINTR)
+            continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return { 0U, false };
+        else
+            throw std::system_error(errno, std::system_category(), "Failed to read from pipe");
+    }
+}
+
+read_result read_into(int fd, output_buffer& dest, std::size_t max)
+{
+    if (max == 0U)
+        return { 0U, false };
+
+    // With no storage to read into, read into scratch space so the pipe still drains and the bytes count as discarded
+    if (dest.capacity() == 0U)
+    {
+        char scratch[4096];
+        auto rc = ::read(fd, scratch, std::min(max, sizeof scratch));
+        if (rc > 0)
+        {
+            dest.write(scratch, std::size_t(rc));
+            return { std::size_t(rc), false };
+        }
         else if (rc == 0)
         {
-            return out;
+            return { 0U, true };
+        }
+        else if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return { 0U, false };
         }
         else
         {
-            out.append(read_buf, rc);
+            throw std::system_error(errno, std::system_category(), "Failed to read from pipe");
         }
     }
+
+    bool end_of_file = false;
+    auto size        = dest.fill(max,
+                                 [&] (char* first, std::size_t first_size, char* second, std::size_t second_size)
+                                 {
+                                     ::iovec spans[] = { { first, first_size }, { second, second_size } };
+                                     while (true)
+                                     {
+                                         ssize_t rc = ::readv(fd, spans, second_size == 0U ? 1 : 2);
+                                         if (rc >= 0)
+                                         {
+                                             end_of_file = rc == 0;
+                                             return std::size_t(rc);
+                                         }
+                                         else if (errno == EINTR)
+                                         {
+                                             continue;
+                                         }
+                                         else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                                         {
+                                             return std::size_t(0U);
+                                         }
+                                         else
+                                         {
+                                             throw std::system_error(errno, std::system_category(),
+                                                                     "Failed to read from pipe"
+                                                                    );
+                                         }
+                                     }
+                                 }
+                                );
+    return { size, end_of_file };
+}
+
+read_result pipe::read(output_buffer& dest, std::size_t max)
+{
+    if (_read_fd == -1)
+        throw pipe_closed();
+
+    return read_into(_read_fd, dest, max);
+}
+
+read_result pipe::splice_to(handle dest, std::size_t max)
+{
+    if (_read_fd == -1)
+        throw pipe_closed();
+
+    std::size_t moved = 0U;
+    while (moved < max)
+    {
+        ssize_t rc = ::splice(_read_fd, nullptr, dest, nullptr, max - moved, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (rc > 0)
+            moved += std::size_t(rc);
+        else if (rc == 0)
+            return { moved, true };
+        else if (errno == EINTR)
+            continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else
+            throw std::system_error(errno, std::system_category(), "Failed to splice from pipe");
+    }
+    return { moved, false };
+}
+
+std::size_t pipe::tee_to(pipe& dest, std::size_t max)
+{
+    if (_read_fd == -1 || dest._write_fd == -1)
+        throw pipe_closed();
+
+    while (true)
+    {
+        ssize_t rc = ::tee(_read_fd, dest._write_fd, max, SPLICE_F_NONBLOCK);
+        if (rc >= 0)
+            return std::size_t(rc);
+        else if (errno == EINTR)
+            continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0U;
+        else
+            throw std::system_error(errno, std::system_category(), "Failed to tee from pipe");
+    }
 }
 
 void pipe::write(const std::string& contents)
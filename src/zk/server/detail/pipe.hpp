@@ -3,12 +3,15 @@
 #include <zk/config.hpp>
 #include <zk/optional.hpp>
 
+#include <cstddef>
 #include <stdexcept>
 #include <string>
 
 namespace zk::server::detail
 {
 
+class output_buffer;
+
 /** Used to specify behavior of POSIX resources when \c exec is called. **/
 enum class on_exec
 {
@@ -33,6 +36,20 @@ public:
     virtual ~pipe_closed() noexcept;
 };
 
+/** The outcome of a non-blocking transfer out of a pipe. **/
+struct read_result final
+{
+    std::size_t size;        //!< The number of bytes transferred.
+    bool        end_of_file; //!< Is the writing end closed with nothing left to read?
+};
+
+/** Read what is available from the non-blocking \a fd (up to \a max bytes) straight into the storage of \a dest with a
+ *  single \c readv, replacing its oldest contents as needed.
+ *
+ *  \throws std::system_error if the read fails for a reason other than there being nothing to read.
+**/
+read_result read_into(int fd, output_buffer& dest, std::size_t max);
+
 /** A unidirectional data channel that can be used for interprocess communication or as a signal-safe mechanism for
  *  in-process communication.
 **/
@@ -73,6 +90,38 @@ public:
     **/
     std::string read(optional<std::size_t> max = nullopt);
 
+    /** Read what is available (up to \a max bytes) into \a dest with a single \c read. Unlike the \c std::string
+     *  version, this never allocates, so a caller reading in a loop can reuse one buffer.
+     *
+     *  \throws pipe_closed if the pipe is already closed.
+     *  \throws std::system_error if the read fails for a reason other than there being nothing to read.
+    **/
+    read_result read(ptr<char> dest, std::size_t max);
+
+    /** Read what is available (up to \a max bytes) straight into the ring of \a dest. See \c read_into.
+     *
+     *  \throws pipe_closed if the pipe is already closed.
+    **/
+    read_result read(output_buffer& dest, std::size_t max);
+
+    /** Move what is available (up to \a max bytes) from this pipe to \a dest with \c splice, so the data never passes
+     *  through user space. \a dest can be a file, socket or the write end of another pipe; a file must not be opened
+     *  with \c O_APPEND, which \c splice does not support. This stops early if \a dest is a pipe which is full.
+     *
+     *  \throws pipe_closed if the pipe is already closed.
+     *  \throws std::system_error if the splice fails.
+    **/
+    read_result splice_to(handle dest, std::size_t max);
+
+    /** Copy what is available (up to \a max bytes) into \a dest with \c tee, without consuming it from this pipe. This
+     *  is useful in combination with \c splice_to, as in copying output to a log file while still reading it.
+     *
+     *  \returns The number of bytes copied, which can be less than what is available if \a dest is full.
+     *  \throws pipe_closed if either pipe is closed.
+     *  \throws std::system_error if the tee fails.
+    **/
+    std::size_t tee_to(pipe& dest, std::size_t max);
+
     /** Write the \a contents into the pipe.
      *
      *  \throws pipe_closed if the pipe is already closed (this typically happens when communicating with a subprocess
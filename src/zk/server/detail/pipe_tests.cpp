@@ -1,7 +1,11 @@
 #include <zk/tests/test.hpp>
 
+#include "output_buffer.hpp"
 #include "pipe.hpp"
 
+#include <cstdio>
+
+#include <fcntl.h>
 #include <unistd.h>
 
 namespace zk::server::detail
@@ -23,5 +27,102 @@ GTEST_TEST(pipe_tests, read_write)
     CHECK_EQ(buff, out);
 }
 
+GTEST_TEST(pipe_tests, read_buffer)
+{
+    pipe p;
+    p.write("Hello, world!");
+
+    char buffer[8];
+    auto first = p.read(buffer, sizeof buffer);
+    CHECK_EQ(8U, first.size);
+    CHECK_FALSE(first.end_of_file);
+    CHECK_EQ("Hello, w", std::string(buffer, first.size));
+
+    auto second = p.read(buffer, sizeof buffer);
+    CHECK_EQ("orld!", std::string(buffer, second.size));
+
+    // nothing left, but the writer is still open
+    auto empty = p.read(buffer, sizeof buffer);
+    CHECK_EQ(0U, empty.size);
+    CHECK_FALSE(empty.end_of_file);
+
+    p.close_write();
+    CHECK_TRUE(p.read(buffer, sizeof buffer).end_of_file);
+}
+
+GTEST_TEST(pipe_tests, read_output_buffer)
+{
+    output_buffer buf(10U);
+
+    pipe p;
+    p.write("0123456");
+    CHECK_EQ(7U, p.read(buf, 100U).size);
+    p.write("789abcdef");
+    CHECK_EQ(9U, p.read(buf, 100U).size);
+    CHECK_EQ("6789abcdef", buf.contents());
+    CHECK_EQ(6U, buf.discarded());
+
+    // at most the capacity is read at once
+    p.write(std::string(25U, 'x'));
+    CHECK_EQ(10U, p.read(buf, 100U).size);
+    CHECK_EQ(std::string(10U, 'x'), buf.contents());
+    CHECK_EQ(15U, p.read().size());
+
+    p.close_write();
+    CHECK_TRUE(p.read(buf, 100U).end_of_file);
+}
+
+GTEST_TEST(pipe_tests, splice_to_pipe)
+{
+    pipe src;
+    pipe dest;
+    src.write("Hello, world!");
+
+    auto result = src.splice_to(dest.native_write_handle(), 5U);
+    CHECK_EQ(5U, result.size);
+    CHECK_EQ("Hello", dest.read());
+
+    result = src.splice_to(dest.native_write_handle(), 100U);
+    CHECK_EQ(8U, result.size);
+    CHECK_FALSE(result.end_of_file);
+    CHECK_EQ(", world!", dest.read());
+
+    src.close_write();
+    CHECK_TRUE(src.splice_to(dest.native_write_handle(), 100U).end_of_file);
+}
+
+GTEST_TEST(pipe_tests, splice_to_file)
+{
+    std::FILE* file = std::tmpfile();
+    CHECK_TRUE(file != nullptr);
+
+    std::string buff(100000U, 'a');
+    pipe p;
+    std::size_t written = 0U;
+    while (written < buff.size())
+    {
+        auto piece = std::min(buff.size() - written, std::size_t(4096U));
+        p.write(buff.substr(written, piece));
+        written += piece;
+        CHECK_EQ(piece, p.splice_to(::fileno(file), piece).size);
+    }
+
+    CHECK_EQ(::off_t(buff.size()), ::lseek(::fileno(file), 0, SEEK_END));
+    std::fclose(file);
+}
+
+GTEST_TEST(pipe_tests, tee)
+{
+    pipe src;
+    pipe copy;
+    src.write("Hello, world!");
+
+    CHECK_EQ(13U, src.tee_to(copy, 100U));
+    CHECK_EQ("Hello, world!", copy.read());
+    CHECK_EQ("Hello, world!", src.read());
+
+    // nothing to copy
+    CHECK_EQ(0U, src.tee_to(copy, 100U));
 }
 
+}
@@ -15,6 +15,17 @@
 namespace zk::server::detail
 {
 
+/** The pipes are created non-blocking for the parent's sake, but the flag is shared with the ends handed to the child.
+ *  Programs expect blocking standard streams -- with a non-blocking one, output is lost (or the program dies) whenever
+ *  the parent falls behind and the pipe fills up.
+**/
+static void make_blocking(int fd) noexcept
+{
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags != -1)
+        ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
 static pid_t create_subproc(pipe&                     stdin_pipe,
                             pipe&                     stdout_pipe,
                             pipe&                     stderr_pipe,
@@ -41,6 +52,9 @@ static pid_t create_subproc(pipe&                     stdin_pipe,
         stdout_pipe.close();
         stderr_pipe.subsume_write(STDERR_FILENO, on_exec::keep_open);
         stderr_pipe.close();
+        make_blocking(STDIN_FILENO);
+        make_blocking(STDOUT_FILENO);
+        make_blocking(STDERR_FILENO);
 
         ::execvp(program_name.c_str(),
                  const_cast<char**>(arg_ptrs.data())
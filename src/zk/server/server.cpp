@@ -2,17 +2,15 @@
 
 #include <zk/future.hpp>
 
-#include <cerrno>
-#include <exception>
-#include <iostream>
-#include <system_error>
+#include <stdexcept>
+#include <utility>
 
 #include <signal.h>
-#include <sys/select.h>
 
 #include "classpath.hpp"
 #include "configuration.hpp"
-#include "detail/event_handle.hpp"
+#include "detail/output_buffer.hpp"
+#include "detail/output_reactor.hpp"
 #include "detail/subprocess.hpp"
 
 namespace zk::server
@@ -30,16 +28,42 @@ static void validate_settings(const configuration& settings)
     }
 }
 
-server::server(classpath packages, configuration settings) :
-        _running(true),
-        _shutdown_event(std::make_unique<detail::event_handle>())
+static std::unique_ptr<detail::subprocess> start_process(const classpath& packages, const configuration& settings)
+{
+    detail::subprocess::argument_list args = { "-cp", packages.command_line(),
+                                               "org.apache.zookeeper.server.quorum.QuorumPeerMain",
+                                             };
+    if (settings.is_minimal())
+    {
+        args.emplace_back(std::to_string(settings.client_port()));
+        args.emplace_back(settings.data_directory().value());
+    }
+    else
+    {
+        args.emplace_back(settings.source_file().value());
+    }
+
+    return std::make_unique<detail::subprocess>("java", std::move(args));
+}
+
+server::server(classpath packages, configuration settings, std::size_t output_capacity) :
+        _output(std::make_shared<detail::output_buffer>(output_capacity)),
+        _terminating(false)
 {
     validate_settings(settings);
-    _worker = std::thread([this, packages = std::move(packages), settings = std::move(settings)] ()
-                          {
-                              this->run_process(packages, settings);
-                          }
-                         );
+    _process = start_process(packages, settings);
+
+    auto& reactor = detail::output_reactor::instance();
+    reactor.attach(_process->stdout().native_read_handle(), _output);
+    try
+    {
+        reactor.attach(_process->stderr().native_read_handle(), _output);
+    }
+    catch (...)
+    {
+        reactor.detach(_process->stdout().native_read_handle());
+        throw;
+    }
 }
 
 server::server(configuration settings) :
@@ -51,86 +75,51 @@ server::~server() noexcept
     shutdown(true);
 }
 
-void server::shutdown(bool wait_for_stop)
+/** Collect whatever is left in \a src after the reactor has let go of it. **/
+static void drain_into(detail::pipe& src, detail::output_buffer& dest)
 {
-    _running.store(false, std::memory_order_release);
-    _shutdown_event->notify_one();
-
-    if (wait_for_stop && _worker.joinable())
-        _worker.join();
+    auto contents = src.read();
+    dest.write(contents.data(), contents.size());
 }
 
-static void wait_for_event(int fd1, int fd2, int fd3)
+void server::shutdown(bool wait_for_stop)
 {
-    // This could be implemented with epoll instead of select, but since N=3, it doesn't really matter
-    ::fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(fd1, &read_fds);
-    FD_SET(fd2, &read_fds);
-    FD_SET(fd3, &read_fds);
-
-    int nfds = std::max(std::max(fd1, fd2), fd3) + 1;
-    int rc   = ::select(nfds, &read_fds, nullptr, nullptr, nullptr);
-    if (rc < 0)
+    std::unique_lock<std::mutex> ax(_protect);
+    if (!_process)
+        return;
+
+    if (!wait_for_stop)
     {
-        if (errno == EINTR)
-            return;
-        else
-            throw std::system_error(errno, std::system_category(), "select");
+        // The reactor keeps collecting output until the process exits and closes its end of the pipes
+        if (!std::exchange(_terminating, true))
+            _process->signal(SIGTERM);
+        return;
     }
+
+    _process->terminate();
+
+    auto& reactor = detail::output_reactor::instance();
+    reactor.detach(_process->stdout().native_read_handle());
+    reactor.detach(_process->stderr().native_read_handle());
+    drain_into(_process->stdout(), *_output);
+    drain_into(_process->stderr(), *_output);
+
+    _process.reset();
 }
 
-void server::run_process(const classpath& packages, const configuration& settings)
+std::string server::recent_output() const
 {
-    detail::subprocess::argument_list args = { "-cp", packages.command_line(),
-                                               "org.apache.zookeeper.server.quorum.QuorumPeerMain",
-                                             };
-    if (settings.is_minimal())
-    {
-        args.emplace_back(std::to_string(settings.client_port()));
-        args.emplace_back(settings.data_directory().value());
-    }
-    else
-    {
-        args.emplace_back(settings.source_file().value());
-    }
+    return _output->contents();
+}
 
-    detail::subprocess proc("java", std::move(args));
-
-    auto drain_pipes = [&] ()
-                       {
-                           bool read_anything = true;
-                           while (read_anything)
-                           {
-                               read_anything = false;
-
-                               auto out = proc.stdout().read();
-                               if (!out.empty())
-                               {
-                                   read_anything = true;
-                                   std::cout << out;
-                               }
-
-                               auto err = proc.stderr().read();
-                               if (!err.empty())
-                               {
-                                   read_anything = true;
-                                   std::cerr << out;
-                               }
-                           }
-                       };
-
-    while (_running.load(std::memory_order_acquire))
-    {
-        wait_for_event(proc.stdout().native_read_handle(),
-                       proc.stderr().native_read_handle(),
-                       _shutdown_event->native_handle()
-                      );
+std::size_t server::output_capacity() const
+{
+    return _output->capacity();
+}
 
-        drain_pipes();
-    }
-    proc.terminate();
-    drain_pipes();
+std::size_t server::output_discarded() const
+{
+    return _output->discarded();
 }
 
 }
@@ -2,11 +2,10 @@
 
 #include <zk/config.hpp>
 
-#include <atomic>
-#include <exception>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
-#include <thread>
 
 namespace zk::server
 {
@@ -14,7 +13,8 @@ namespace zk::server
 namespace detail
 {
 
-class event_handle;
+class output_buffer;
+class subprocess;
 
 }
 
@@ -26,16 +26,24 @@ class classpath;
 class configuration;
 
 /// Controls a ZooKeeper server process on this local machine.
+///
+/// The output of the process is not echoed anywhere. Instead, the most recent \ref output_capacity bytes of it are kept
+/// and can be seen with \ref recent_output. Every server in a process shares a single thread to collect this.
 class server final
 {
+public:
+    /// The default number of bytes of output to keep.
+    static constexpr std::size_t default_output_capacity = 64U * 1024U;
+
 public:
     /// Create a running server process with the specified \a packages and \a settings.
     ///
     /// \param packages The classpath to use to find ZooKeeper's \c QuorumPeerMain class.
     /// \param settings The server settings to run with.
+    /// \param output_capacity The number of bytes of the most recent output to keep (see \ref recent_output).
     /// \throws std::invalid_argument If `settings.is_minimal()` is \c false and `settings.source_file()` is \c nullopt.
     ///  This is because non-minimal configurations require ZooKeeper to be launched with a file.
-    explicit server(classpath packages, configuration settings);
+    explicit server(classpath packages, configuration settings, std::size_t output_capacity = default_output_capacity);
 
     /// Create a running server with the specified \a settings using the system-provided default packages for ZooKeeper
     /// (see \ref classpath::system_default).
@@ -56,16 +64,24 @@ public:
     ///  termination.
     void shutdown(bool wait_for_stop = false);
 
-private:
-    void run_process(const classpath&, const configuration&);
+    /// Get the most recent output of the server process (standard output and standard error, interleaved in the order
+    /// it was collected). This is at most \ref output_capacity bytes -- older output is discarded.
+    std::string recent_output() const;
+
+    /// The most bytes of output \ref recent_output will keep.
+    std::size_t output_capacity() const;
+
+    /// How many bytes of output have been discarded to stay within \ref output_capacity?
+    std::size_t output_discarded() const;
 
 private:
-    std::atomic<bool>                     _running;
-    std::unique_ptr<detail::event_handle> _shutdown_event;
-    std::thread                           _worker;
+    mutable std::mutex                     _protect;
+    std::shared_ptr<detail::output_buffer> _output;
+    std::unique_ptr<detail::subprocess>    _process;
+    bool                                   _terminating;
 
     // NOTE: The configuration is NOT stored in the server object. This is because configuration can be changed by the
-    // ZK process in cases like ensemble reconfiguration. It is the job of run_process to deal with this.
+    // ZK process in cases like ensemble reconfiguration. It is only used to build the command line.
 };
 
 /// \}
@@ -2,10 +2,14 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <exception>
 #include <fstream>
+#include <future>
 #include <sstream>
 #include <stdexcept>
 #include <system_error>
+#include <thread>
+#include <utility>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -13,6 +17,7 @@
 #include "classpath.hpp"
 #include "configuration.hpp"
 #include "server.hpp"
+#include "detail/four_letter_word.hpp"
 
 namespace zk::server
 {
@@ -101,11 +106,6 @@ server_group server_group::make_ensemble(std::size_t size, const configuration&
             srvr->settings.add_server(id2, "127.0.0.1", srvr2->peer_port, srvr2->leader_port);
         }
 
-        create_directory(srvr->path);
-        create_directory(srvr->path + "/data");
-        save_id_file(srvr->path + "/data/myid", id);
-        srvr->settings.save_file(srvr->path + "/settings.cfg");
-
         if (!std::exchange(first, false))
             conn_str_os << ',';
         conn_str_os << "127.0.0.1:" << srvr->settings.client_port();
@@ -113,6 +113,39 @@ server_group server_group::make_ensemble(std::size_t size, const configuration&
     conn_str_os << '/';
     out._conn_string = conn_str_os.str();
 
+    // Every server has its own directory, so they can all be written at once -- this is mostly waiting on the disk
+    std::vector<std::future<void>> preparations;
+    preparations.reserve(out._servers.size());
+    for (const auto& [id, srvr] : out._servers)
+    {
+        preparations.emplace_back(std::async(std::launch::async,
+                                             [id = id, srvr = srvr]
+                                             {
+                                                 create_directory(srvr->path);
+                                                 create_directory(srvr->path + "/data");
+                                                 save_id_file(srvr->path + "/data/myid", id);
+                                                 srvr->settings.save_file(srvr->path + "/settings.cfg");
+                                             }
+                                            )
+                                 );
+    }
+    // Wait for all of them before rethrowing the first failure, so nothing is still writing when we unwind
+    std::exception_ptr failure;
+    for (auto& preparation : preparations)
+    {
+        try
+        {
+            preparation.get();
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = std::current_exception();
+        }
+    }
+    if (failure)
+        std::rethrow_exception(failure);
+
     return out;
 }
 
@@ -123,15 +156,89 @@ const std::string& server_group::get_connection_string()
 
 void server_group::start_all_servers(const classpath& packages)
 {
+    // Each server spends most of its construction spawning the JVM, so launch them all at once
+    std::vector<std::pair<std::shared_ptr<info>, std::future<std::shared_ptr<server>>>> launches;
     for (auto& [name, srvr] : _servers)
     {
         static_cast<void>(name);
 
         if (!srvr->instance)
         {
-            srvr->instance = std::make_shared<server>(packages, srvr->settings);
+            launches.emplace_back(srvr,
+                                  std::async(std::launch::async,
+                                             [&packages, srvr = srvr]
+                                             {
+                                                 return std::make_shared<server>(packages, srvr->settings);
+                                             }
+                                            )
+                                 );
+        }
+    }
+
+    std::exception_ptr failure;
+    for (auto& [srvr, launch] : launches)
+    {
+        try
+        {
+            srvr->instance = launch.get();
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = std::current_exception();
         }
     }
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+bool server_group::wait_until_ready(std::chrono::milliseconds timeout) const
+{
+    static constexpr auto probe_interval = std::chrono::milliseconds(50);
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::vector<std::uint16_t> pending;
+    pending.reserve(_servers.size());
+    for (const auto& [id, srvr] : _servers)
+    {
+        static_cast<void>(id);
+        pending.push_back(srvr->settings.client_port());
+    }
+
+    while (true)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline
+                                                                               - std::chrono::steady_clock::now()
+                                                                              );
+        if (remaining.count() <= 0)
+            return pending.empty();
+
+        // Probe every member which is not yet serving concurrently -- a member still electing a leader answers
+        // quickly, but one which has not opened its port yet can take the whole timeout to refuse
+        std::vector<std::future<bool>> probes;
+        probes.reserve(pending.size());
+        for (auto port : pending)
+        {
+            probes.emplace_back(std::async(std::launch::async,
+                                           [port, remaining] { return detail::is_serving(port, remaining); }
+                                          )
+                               );
+        }
+
+        auto next = pending.begin();
+        for (std::size_t idx = 0U; idx < pending.size(); ++idx)
+        {
+            if (!probes[idx].get())
+                *next++ = pending[idx];
+        }
+        pending.erase(next, pending.end());
+
+        if (pending.empty())
+            return true;
+
+        std::this_thread::sleep_until(std::min(deadline, std::chrono::steady_clock::now() + probe_interval));
+    }
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include <zk/config.hpp>
 
+#include <chrono>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -27,7 +28,8 @@ class server;
 /// auto servers = zk::server::server_group::make_ensemble(3U,
 ///                                                        zk::server::configuration::make_minimal("test-data")
 ///                                                       );
-/// servers.start_all_servers();
+/// servers.start_all_servers(zk::server::classpath::system_default());
+/// servers.wait_until_ready(std::chrono::seconds(30));
 /// auto client = zk::client::connect(servers.get_connection_string()).get();
 /// // do things with client...
 /// \endcode
@@ -52,10 +54,17 @@ public:
     /// Get a connection string which can connect to any the servers in the group.
     const std::string& get_connection_string();
 
-    /// Start all servers in the group. Note that this does not wait for the servers to be up-and-running. Use a
-    /// \ref client instance to check for connectability.
+    /// Start all servers in the group. The servers are launched concurrently, but this does not wait for them to be
+    /// up-and-running -- use \ref wait_until_ready for that.
     void start_all_servers(const classpath& packages);
 
+    /// Wait until every server in the group is serving clients, probing each client port with the \c srvr four letter
+    /// word. A member counts as ready once it reports a mode (\c standalone, \c leader or \c follower), which means
+    /// the ensemble has a quorum.
+    ///
+    /// \returns \c true if every server is ready; \c false if \a timeout passed first.
+    bool wait_until_ready(std::chrono::milliseconds timeout) const;
+
     /// How many servers are in this group?
     std::size_t size() const { return _servers.size(); }
 
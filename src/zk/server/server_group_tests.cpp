@@ -19,10 +19,28 @@ GTEST_TEST(server_group_tests, ensemble)
     delete_directory("ensemble");
     auto group = server_group::make_ensemble(5U, configuration::make_minimal("ensemble"));
     group.start_all_servers(test_package_registry::instance().find_newest_classpath().value());
+    CHECK_TRUE(group.wait_until_ready(std::chrono::seconds(60)));
 
     // connect and get data from the ensemble
     auto c = client::connect(group.get_connection_string()).get();
     CHECK_TRUE(c.exists("/").get());
 }
 
+GTEST_TEST(server_group_tests, wait_until_ready_times_out)
+{
+    delete_directory("ensemble-unstarted");
+    auto group = server_group::make_ensemble(3U, configuration::make_minimal("ensemble-unstarted"));
+
+    // nothing was started, so nothing can answer
+    auto started = std::chrono::steady_clock::now();
+    CHECK_FALSE(group.wait_until_ready(std::chrono::milliseconds(200)));
+    CHECK_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(5));
+}
+
+GTEST_TEST(server_group_tests, empty_is_ready)
+{
+    server_group group;
+    CHECK_TRUE(group.wait_until_ready(std::chrono::milliseconds(0)));
+}
+
 }
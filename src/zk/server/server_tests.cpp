@@ -42,10 +42,7 @@ void delete_directory(std::string path)
 
 void server_fixture::SetUp()
 {
-    delete_directory("zk-data");
-    _server = std::make_shared<server>(test_package_registry::instance().find_newest_classpath().value(),
-                                       configuration::make_minimal("zk-data")
-                                      );
+    start_server(false);
     _conn_string = "zk://127.0.0.1:2181";
 }
 
@@ -71,6 +68,16 @@ void server_fixture::stop_server(bool wait_for_stop)
     _server->shutdown(wait_for_stop);
 }
 
+void server_fixture::start_server(bool keep_data)
+{
+    if (!keep_data)
+        delete_directory("zk-data");
+
+    _server = std::make_shared<server>(test_package_registry::instance().find_newest_classpath().value(),
+                                       configuration::make_minimal("zk-data")
+                                      );
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // single_server_fixture                                                                                              //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,10 @@ protected:
 
     void stop_server(bool wait_for_stop = true);
 
+    /// Start the server again after \ref stop_server. If \a keep_data is set, sessions which have not expired are still
+    /// valid; otherwise, the server starts empty and every client session is expired when it reconnects.
+    void start_server(bool keep_data = true);
+
 private:
     std::shared_ptr<server> _server;
     std::string             _conn_string;
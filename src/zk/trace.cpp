@@ -0,0 +1,146 @@
+#include "trace.hpp"
+#include "exceptions.hpp"
+
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace zk
+{
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// request_type                                                                                                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const request_type& self)
+{
+    switch (self)
+    {
+    case request_type::get:            return os << "get";
+    case request_type::watch:          return os << "watch";
+    case request_type::get_children:   return os << "get_children";
+    case request_type::watch_children: return os << "watch_children";
+    case request_type::exists:         return os << "exists";
+    case request_type::watch_exists:   return os << "watch_exists";
+    case request_type::create:         return os << "create";
+    case request_type::set:            return os << "set";
+    case request_type::erase:          return os << "erase";
+    case request_type::get_acl:        return os << "get_acl";
+    case request_type::set_acl:        return os << "set_acl";
+    case request_type::commit:         return os << "commit";
+    case request_type::load_fence:     return os << "load_fence";
+    default:                           return os << "request_type(" << static_cast<int>(self) << ')';
+    }
+}
+
+std::string to_string(const request_type& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// request_trace                                                                                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const request_trace& self)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    os << '{' << self.id << ' ' << self.type << ' ' << self.path;
+    os << " request_size=" << self.request_size;
+    os << " response_size=" << self.response_size;
+    if (self.transaction)
+        os << " zxid=" << self.transaction->value;
+    os << " error=" << self.error;
+    if (self.send_time != request_trace::time_point())
+        os << " queued_us=" << duration_cast<microseconds>(self.send_time - self.start_time).count();
+    if (self.complete_time != request_trace::time_point())
+        os << " elapsed_us=" << duration_cast<microseconds>(self.elapsed()).count();
+    return os << '}';
+}
+
+std::string to_string(const request_trace& self)
+{
+    std::ostringstream os;
+    os << self;
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// request_observer                                                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+request_observer::~request_observer() noexcept = default;
+
+void request_observer::on_start(const request_trace&)
+{ }
+
+void request_observer::on_send(const request_trace&)
+{ }
+
+void request_observer::on_complete(const request_trace&)
+{ }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// request_recorder                                                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+request_recorder::request_recorder(std::size_t capacity) :
+        _capacity(capacity),
+        _total_count(0U)
+{
+    if (capacity == 0U)
+        zk::throw_exception(std::invalid_argument("request_recorder capacity must be greater than 0"));
+
+    _traces.reserve(capacity);
+}
+
+request_recorder::~request_recorder() noexcept = default;
+
+std::size_t request_recorder::total_count() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    return _total_count;
+}
+
+std::vector<request_trace> request_recorder::recent() const
+{
+    std::unique_lock<std::mutex> ax(_protect);
+
+    // Until the buffer wraps, the traces are already in order. After that, the oldest is the next one to be replaced.
+    std::vector<request_trace> out;
+    out.reserve(_traces.size());
+    auto oldest = _traces.size() < _capacity ? 0U : _total_count % _capacity;
+    for (std::size_t idx = 0U; idx < _traces.size(); ++idx)
+        out.emplace_back(_traces[(oldest + idx) % _traces.size()]);
+    return out;
+}
+
+void request_recorder::dump(std::ostream& os) const
+{
+    for (const auto& trace : recent())
+        os << trace << '\n';
+    os.flush();
+}
+
+void request_recorder::clear()
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    _traces.clear();
+    _total_count = 0U;
+}
+
+void request_recorder::on_complete(const request_trace& trace)
+{
+    std::unique_lock<std::mutex> ax(_protect);
+    if (_traces.size() < _capacity)
+        _traces.emplace_back(trace);
+    else
+        _traces[_total_count % _capacity] = trace;
+    ++_total_count;
+}
+
+}
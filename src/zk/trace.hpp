@@ -0,0 +1,184 @@
+/// \file
+/// Hooks for observing the lifecycle of requests issued through a \ref zk::connection.
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "error.hpp"
+#include "forwards.hpp"
+#include "optional.hpp"
+#include "types.hpp"
+
+/// \addtogroup Client
+/// \{
+
+/// \def ZKPP_ENABLE_TRACING
+/// Should the library report request lifecycle events to \ref zk::request_observer instances? If this is set to \c 0,
+/// the calls to observers are compiled out of the library entirely and \ref zk::connection::observer has no effect.
+/// This value only matters when compiling the library itself.
+#ifndef ZKPP_ENABLE_TRACING
+#   define ZKPP_ENABLE_TRACING 1
+#endif
+
+/// \}
+
+namespace zk
+{
+
+/// \addtogroup Client
+/// \{
+
+/// Describes the type of a request issued through a \ref connection. Unlike \ref op_type, which only describes the
+/// parts of a \ref multi_op, this covers every operation.
+enum class request_type : int
+{
+    get,            //!< \ref client::get
+    watch,          //!< \ref client::watch
+    get_children,   //!< \ref client::get_children
+    watch_children, //!< \ref client::watch_children
+    exists,         //!< \ref client::exists
+    watch_exists,   //!< \ref client::watch_exists
+    create,         //!< \ref client::create
+    set,            //!< \ref client::set
+    erase,          //!< \ref client::erase
+    get_acl,        //!< \ref client::get_acl
+    set_acl,        //!< \ref client::set_acl
+    commit,         //!< \ref client::commit
+    load_fence,     //!< \ref client::load_fence
+};
+
+std::ostream& operator<<(std::ostream&, const request_type&);
+
+std::string to_string(const request_type&);
+
+/// Information about a single request as it moves through a \ref connection. The fields are filled in as the request
+/// progresses, so a \ref request_observer will see more of them populated in \ref request_observer::on_complete than
+/// in \ref request_observer::on_start.
+struct request_trace final
+{
+public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+public:
+    /// A process-unique identifier for this request. This can be used to correlate events for the same request or to
+    /// attach the request to an external trace.
+    std::uint64_t id = 0U;
+
+    /// The operation which was requested.
+    request_type type = request_type::get;
+
+    /// The path the request was issued against. For \ref request_type::commit, this is the path of the first operation
+    /// in the transaction.
+    std::string path;
+
+    /// The number of payload bytes sent with the request (the data of a \c create or \c set).
+    std::size_t request_size = 0U;
+
+    /// The number of payload bytes received in the response (the data of a \c get or the child names of a
+    /// \c get_children).
+    std::size_t response_size = 0U;
+
+    /// The \ref stat::modified_transaction of the entry the request touched, if the response contained a \ref stat.
+    optional<transaction_id> transaction;
+
+    /// The outcome of the request. This is \ref error_code::ok until the request completes.
+    error_code error = error_code::ok;
+
+    /// When the request was issued.
+    time_point start_time;
+
+    /// When the request was handed to the underlying client for sending.
+    time_point send_time;
+
+    /// When the response (or failure) was delivered.
+    time_point complete_time;
+
+    /// The time between \ref start_time and \ref complete_time.
+    clock::duration elapsed() const { return complete_time - start_time; }
+};
+
+std::ostream& operator<<(std::ostream&, const request_trace&);
+
+std::string to_string(const request_trace&);
+
+/// Receives lifecycle events for requests issued through a \ref connection (see \ref connection::observer). Every
+/// request receives exactly one \ref on_start and one \ref on_complete; \ref on_send is skipped for requests which
+/// fail before they can be handed to the underlying client and is repeated for each retry (see \ref retry_policy).
+///
+/// Events are delivered on the thread which caused them -- \ref on_start and \ref on_send on the thread issuing the
+/// request and \ref on_complete on the connection's completion thread. Implementations must be thread-safe and should
+/// return quickly, as they delay the delivery of results.
+///
+/// The default implementation of each function does nothing, so only the events of interest need to be overridden.
+/// Exceptions thrown from any of these functions are ignored.
+class request_observer
+{
+public:
+    virtual ~request_observer() noexcept;
+
+    /// Called when a request is issued.
+    virtual void on_start(const request_trace& trace);
+
+    /// Called when the request has been marshalled and is handed to the underlying client for sending.
+    virtual void on_send(const request_trace& trace);
+
+    /// Called when the request completes, successfully or not.
+    virtual void on_complete(const request_trace& trace);
+};
+
+/// A \ref request_observer which remembers the most recently completed requests in a fixed-size ring buffer. This is
+/// useful for tracking down tail latency -- install one on a connection and \ref dump it when a slow request is noticed.
+///
+/// \code
+/// auto recorder = std::make_shared<zk::request_recorder>(1024U);
+/// conn->observer(recorder);
+/// // ...later
+/// recorder->dump(std::cerr);
+/// \endcode
+class request_recorder final :
+        public request_observer
+{
+public:
+    /// Create a recorder which remembers the last \a capacity requests.
+    ///
+    /// \throws std::invalid_argument if \a capacity is \c 0.
+    explicit request_recorder(std::size_t capacity);
+
+    virtual ~request_recorder() noexcept;
+
+    /// The maximum number of requests this recorder remembers.
+    std::size_t capacity() const { return _capacity; }
+
+    /// The total number of requests which have completed since this recorder was created (or \ref clear was called).
+    /// This can be larger than \ref capacity.
+    std::size_t total_count() const;
+
+    /// Get the remembered requests, ordered from the oldest to the most recently completed.
+    std::vector<request_trace> recent() const;
+
+    /// Write the remembered requests to \a os, one per line, ordered from the oldest to the most recently completed.
+    void dump(std::ostream& os) const;
+
+    /// Forget all remembered requests.
+    void clear();
+
+    virtual void on_complete(const request_trace& trace) override;
+
+private:
+    std::size_t                _capacity;
+    mutable std::mutex         _protect;
+    std::vector<request_trace> _traces;
+    std::size_t                _total_count;
+};
+
+/// \}
+
+}
@@ -0,0 +1,149 @@
+#include <zk/server/server_tests.hpp>
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+
+#include "client.hpp"
+#include "connection.hpp"
+#include "exceptions.hpp"
+#include "trace.hpp"
+
+namespace zk
+{
+
+static request_trace make_trace(std::uint64_t id, request_type type = request_type::get)
+{
+    request_trace out;
+    out.id   = id;
+    out.type = type;
+    out.path = "/trace-" + std::to_string(id);
+    return out;
+}
+
+GTEST_TEST(request_type_tests, stringify)
+{
+    CHECK_EQ("get",            to_string(request_type::get));
+    CHECK_EQ("watch_children", to_string(request_type::watch_children));
+    CHECK_EQ("commit",         to_string(request_type::commit));
+    CHECK_EQ("load_fence",     to_string(request_type::load_fence));
+}
+
+GTEST_TEST(request_recorder_tests, zero_capacity)
+{
+    CHECK_THROWS(std::invalid_argument) { request_recorder(0U); };
+}
+
+GTEST_TEST(request_recorder_tests, before_wrap)
+{
+    request_recorder recorder(4U);
+    recorder.on_complete(make_trace(1U));
+    recorder.on_complete(make_trace(2U));
+
+    auto traces = recorder.recent();
+    CHECK_EQ(2U, traces.size());
+    CHECK_EQ(1U, traces[0].id);
+    CHECK_EQ(2U, traces[1].id);
+    CHECK_EQ(2U, recorder.total_count());
+}
+
+GTEST_TEST(request_recorder_tests, wraparound)
+{
+    request_recorder recorder(3U);
+    for (std::uint64_t id = 1U; id <= 7U; ++id)
+        recorder.on_complete(make_trace(id));
+
+    auto traces = recorder.recent();
+    CHECK_EQ(3U, traces.size());
+    CHECK_EQ(5U, traces[0].id);
+    CHECK_EQ(6U, traces[1].id);
+    CHECK_EQ(7U, traces[2].id);
+    CHECK_EQ(7U, recorder.total_count());
+
+    std::ostringstream os;
+    recorder.dump(os);
+    CHECK_EQ(0U, os.str().find("{5 get /trace-5"));
+
+    recorder.clear();
+    CHECK_EQ(0U, recorder.recent().size());
+    CHECK_EQ(0U, recorder.total_count());
+}
+
+#if ZKPP_ENABLE_TRACING
+
+namespace
+{
+
+class counting_observer final :
+        public request_observer
+{
+public:
+    virtual void on_start(const request_trace&) override { ++start_count; }
+
+    virtual void on_send(const request_trace&) override { ++send_count; }
+
+    virtual void on_complete(const request_trace&) override { ++complete_count; }
+
+public:
+    std::atomic<std::size_t> start_count{0U};
+    std::atomic<std::size_t> send_count{0U};
+    std::atomic<std::size_t> complete_count{0U};
+};
+
+}
+
+class trace_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(trace_tests, records_requests)
+{
+    auto conn     = connection::connect(get_connection_string());
+    auto recorder = std::make_shared<request_recorder>(16U);
+    conn->observer(recorder);
+    client c(conn);
+
+    auto name = c.create("/trace-test", buffer(5U, 'x')).get().name();
+    c.get(name).get();
+    CHECK_THROWS(no_entry) { c.get("/trace-test/bogus").get(); };
+
+    auto traces = recorder->recent();
+    CHECK_EQ(3U, traces.size());
+
+    CHECK_TRUE(request_type::create == traces[0].type);
+    CHECK_EQ("/trace-test", traces[0].path);
+    CHECK_EQ(5U, traces[0].request_size);
+    CHECK_TRUE(error_code::ok == traces[0].error);
+
+    CHECK_TRUE(request_type::get == traces[1].type);
+    CHECK_EQ(5U, traces[1].response_size);
+    CHECK_TRUE(traces[1].transaction.has_value());
+    CHECK_TRUE(traces[0].id < traces[1].id);
+    CHECK_TRUE(traces[1].start_time <= traces[1].send_time);
+    CHECK_TRUE(traces[1].send_time <= traces[1].complete_time);
+
+    CHECK_TRUE(error_code::no_entry == traces[2].error);
+    c.close();
+}
+
+GTEST_TEST_F(trace_tests, observer_sees_every_event)
+{
+    auto conn     = connection::connect(get_connection_string());
+    auto observer = std::make_shared<counting_observer>();
+    conn->observer(observer);
+    client c(conn);
+
+    c.exists("/").get();
+    c.get_children("/").get();
+    conn->observer(nullptr);
+    c.exists("/").get();
+
+    CHECK_EQ(2U, observer->start_count.load());
+    CHECK_EQ(2U, observer->send_count.load());
+    CHECK_EQ(2U, observer->complete_count.load());
+    c.close();
+}
+
+#endif
+
+}
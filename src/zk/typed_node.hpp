@@ -0,0 +1,291 @@
+/// \file
+/// Reading and writing entries as typed values, with the conversion picked at compile time.
+#pragma once
+
+#include <zk/config.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "buffer.hpp"
+#include "client.hpp"
+#include "error.hpp"
+#include "exceptions.hpp"
+#include "future.hpp"
+#include "results.hpp"
+#include "string_view.hpp"
+#include "types.hpp"
+
+namespace zk
+{
+
+/// \addtogroup Client
+/// \{
+
+/// Converts values of a trivially-copyable (and default-constructible) type \c T to and from their bytes in memory.
+/// This is the fastest way to store a plain struct, but the stored form depends on the layout and byte order of the
+/// platform which wrote it.
+template <typename T>
+struct memcpy_codec
+{
+    static_assert(std::is_trivially_copyable_v<T>, "memcpy_codec can only be used with trivially-copyable types");
+
+    static buffer encode(const T& value)
+    {
+        buffer out(sizeof(T), '\0');
+        std::memcpy(out.data(), &value, sizeof(T));
+        return out;
+    }
+
+    /// \throws marshalling_error if \a data is not exactly the size of \c T.
+    static T decode(const buffer& data)
+    {
+        if (data.size() != sizeof(T))
+            zk::throw_exception(marshalling_error());
+
+        T out;
+        std::memcpy(&out, data.data(), sizeof(T));
+        return out;
+    }
+};
+
+/// Converts integers to and from a fixed-width, big-endian form, which reads the same on any platform.
+template <typename T>
+struct big_endian_codec
+{
+    static_assert(std::is_integral_v<T>, "big_endian_codec can only be used with integer types");
+
+    using unsigned_type = std::make_unsigned_t<T>;
+
+    static buffer encode(T value)
+    {
+        buffer out(sizeof(T), '\0');
+        auto   bits = static_cast<unsigned_type>(value);
+        for (std::size_t idx = sizeof(T); idx > 0U; --idx)
+        {
+            out[idx - 1U] = static_cast<char>(static_cast<unsigned char>(bits & 0xffU));
+            bits = static_cast<unsigned_type>(bits >> 8U);
+        }
+        return out;
+    }
+
+    /// \throws marshalling_error if \a data is not exactly \c sizeof(T) bytes.
+    static T decode(const buffer& data)
+    {
+        if (data.size() != sizeof(T))
+            zk::throw_exception(marshalling_error());
+
+        unsigned_type bits = 0U;
+        for (std::size_t idx = 0U; idx < sizeof(T); ++idx)
+            bits = static_cast<unsigned_type>((bits << 8U) | static_cast<unsigned char>(data[idx]));
+        return static_cast<T>(bits);
+    }
+};
+
+/// The codec a \ref typed_node uses for \c T unless told otherwise. Specialize this for your own types to give them a
+/// conversion; a specialization needs static \c encode and \c decode functions with the same signatures as
+/// \ref memcpy_codec. Without a specialization, integers use \ref big_endian_codec and other trivially-copyable types
+/// use \ref memcpy_codec.
+///
+/// \code
+/// template <>
+/// struct zk::serializer<my_config>
+/// {
+///     static zk::buffer encode(const my_config& value);
+///     static my_config decode(const zk::buffer& data);
+/// };
+/// \endcode
+template <typename T>
+struct serializer :
+        std::conditional_t<std::is_integral_v<T>, big_endian_codec<T>, memcpy_codec<T>>
+{ };
+
+/// \ref serializer for \c bool, stored as a single byte.
+template <>
+struct serializer<bool> final
+{
+    static buffer encode(bool value)
+    {
+        return buffer(1U, value ? '\1' : '\0');
+    }
+
+    static bool decode(const buffer& data)
+    {
+        if (data.size() != 1U)
+            zk::throw_exception(marshalling_error());
+        return data[0] != '\0';
+    }
+};
+
+/// \ref serializer for \c std::string, stored as its characters.
+template <>
+struct serializer<std::string> final
+{
+    static buffer encode(const std::string& value)
+    {
+        return buffer(value.begin(), value.end());
+    }
+
+    static std::string decode(const buffer& data)
+    {
+        return std::string(data.begin(), data.end());
+    }
+};
+
+/// The result of reading a \ref typed_node.
+template <typename T>
+class typed_result final
+{
+public:
+    explicit typed_result(T value, const zk::stat& stat) :
+            _value(std::move(value)),
+            _stat(stat)
+    { }
+
+    /// \{
+    /// The value of the entry.
+    const T& value() const & { return _value; }
+    T&       value() &       { return _value; }
+    T        value() &&      { return std::move(_value); }
+    /// \}
+
+    /// \{
+    /// The \ref zk::stat of the entry at the time it was read.
+    const zk::stat& stat() const { return _stat; }
+    zk::stat&       stat()       { return _stat; }
+    /// \}
+
+private:
+    T        _value;
+    zk::stat _stat;
+};
+
+/// The result of watching a \ref typed_node.
+template <typename T>
+class typed_watch_result final
+{
+public:
+    explicit typed_watch_result(typed_result<T> initial, future<event> next) :
+            _initial(std::move(initial)),
+            _next(std::move(next))
+    { }
+
+    /// \{
+    /// The value when the watch was set.
+    const typed_result<T>& initial() const & { return _initial; }
+    typed_result<T>&       initial() &       { return _initial; }
+    typed_result<T>        initial() &&      { return std::move(_initial); }
+    /// \}
+
+    /// \{
+    /// The future which is delivered when the entry changes.
+    const future<event>& next() const & { return _next; }
+    future<event>&       next() &       { return _next; }
+    future<event>        next() &&      { return std::move(_next); }
+    /// \}
+
+private:
+    typed_result<T> _initial;
+    future<event>   _next;
+};
+
+/// An entry holding a value of type \c T, converted with \c Codec. The codec is a type with static \c encode and
+/// \c decode functions, so the conversion is resolved at compile time and inlined: writing encodes straight into the
+/// \ref buffer sent with the request and reading decodes straight from the \ref buffer the reply was delivered in.
+///
+/// The request for \ref get and \ref watch is sent right away, but the returned future is deferred: the reply is
+/// decoded on the thread which calls \c get on it, so no thread is started to do the conversion. Keep in mind that
+/// \c wait_for on a deferred future returns \c std::future_status::deferred instead of waiting.
+///
+/// \code
+/// zk::typed_node<std::int64_t> epoch(client, "/cluster/epoch");
+/// auto current = epoch.get().get();
+/// epoch.set(current.value() + 1, current.stat().data_version).get();
+/// \endcode
+///
+/// \tparam Codec How to convert \c T (see \ref serializer).
+template <typename T, typename Codec = serializer<T>>
+class typed_node final
+{
+public:
+    using value_type = T;
+    using codec_type = Codec;
+
+public:
+    explicit typed_node(client conn, std::string path) :
+            _conn(std::move(conn)),
+            _path(std::move(path))
+    { }
+
+    /// The path of the entry.
+    const std::string& path() const { return _path; }
+
+    /// Convert \a value to the form stored in the entry.
+    static buffer encode(const T& value)
+    {
+        return Codec::encode(value);
+    }
+
+    /// Convert the stored \a data to a value.
+    ///
+    /// \throws marshalling_error if the codec can not convert \a data.
+    static T decode(const buffer& data)
+    {
+        return Codec::decode(data);
+    }
+
+    /// Read the value of the entry.
+    ///
+    /// \throws no_entry if the entry does not exist, the future will be delivered with \ref no_entry.
+    /// \throws marshalling_error if the entry does not hold a value the codec can convert, the future will be delivered
+    ///  with \ref marshalling_error.
+    future<typed_result<T>> get() const
+    {
+        return zk::async(zk::launch::deferred,
+                         [fetch = _conn.get(_path)] () mutable
+                         {
+                             auto result = fetch.get();
+                             return typed_result<T>(decode(result.data()), result.stat());
+                         }
+                        );
+    }
+
+    /// Read the value of the entry and leave a watch on it (see \ref client::watch).
+    future<typed_watch_result<T>> watch() const
+    {
+        return zk::async(zk::launch::deferred,
+                         [fetch = _conn.watch(_path)] () mutable
+                         {
+                             auto result = fetch.get();
+                             return typed_watch_result<T>(typed_result<T>(decode(result.initial().data()),
+                                                                          result.initial().stat()
+                                                                         ),
+                                                          std::move(result.next())
+                                                         );
+                         }
+                        );
+    }
+
+    /// Create the entry holding \a value (see \ref client::create).
+    future<create_result> create(const T& value, create_mode mode = create_mode::normal)
+    {
+        return _conn.create(_path, encode(value), mode);
+    }
+
+    /// Replace the value of the entry with \a value (see \ref client::set).
+    future<set_result> set(const T& value, version check = version::any())
+    {
+        return _conn.set(_path, encode(value), check);
+    }
+
+private:
+    client      _conn;
+    std::string _path;
+};
+
+/// \}
+
+}
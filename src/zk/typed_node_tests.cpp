@@ -0,0 +1,101 @@
+#include <zk/server/server_tests.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "error.hpp"
+#include "typed_node.hpp"
+
+namespace zk
+{
+
+struct typed_node_point final
+{
+    std::int32_t x;
+    std::int32_t y;
+};
+
+struct typed_node_version final
+{
+    int major;
+    int minor;
+};
+
+template <>
+struct serializer<typed_node_version> final
+{
+    static buffer encode(const typed_node_version& value)
+    {
+        auto text = std::to_string(value.major) + "." + std::to_string(value.minor);
+        return buffer(text.begin(), text.end());
+    }
+
+    static typed_node_version decode(const buffer& data)
+    {
+        auto text = std::string(data.begin(), data.end());
+        auto dot  = text.find('.');
+        if (dot == std::string::npos)
+            zk::throw_exception(marshalling_error());
+        return typed_node_version{ std::stoi(text.substr(0, dot)), std::stoi(text.substr(dot + 1U)) };
+    }
+};
+
+GTEST_TEST(serializer_tests, big_endian)
+{
+    auto encoded = serializer<std::uint32_t>::encode(0x01020304U);
+    CHECK_EQ(std::string("\x01\x02\x03\x04"), std::string(encoded.begin(), encoded.end()));
+    CHECK_EQ(0x01020304U, serializer<std::uint32_t>::decode(encoded));
+
+    CHECK_EQ(-2, serializer<std::int16_t>::decode(serializer<std::int16_t>::encode(-2)));
+    CHECK_EQ(std::numeric_limits<std::int64_t>::min(),
+             serializer<std::int64_t>::decode(serializer<std::int64_t>::encode(std::numeric_limits<std::int64_t>::min()))
+            );
+
+    CHECK_THROWS(marshalling_error) { serializer<std::uint32_t>::decode(buffer(3U, '\0')); };
+}
+
+GTEST_TEST(serializer_tests, trivially_copyable)
+{
+    auto decoded = serializer<typed_node_point>::decode(serializer<typed_node_point>::encode(typed_node_point{ 3, -4 }));
+    CHECK_EQ(3, decoded.x);
+    CHECK_EQ(-4, decoded.y);
+
+    CHECK_THROWS(marshalling_error) { serializer<typed_node_point>::decode(buffer(1U, '\0')); };
+}
+
+class typed_node_tests :
+        public server::single_server_fixture
+{ };
+
+GTEST_TEST_F(typed_node_tests, integer)
+{
+    typed_node<std::int64_t> epoch(get_connected_client(), "/typed_node_tests_integer");
+    epoch.create(41).get();
+
+    auto current = epoch.get().get();
+    CHECK_EQ(41, current.value());
+    epoch.set(current.value() + 1, current.stat().data_version).get();
+
+    auto watch = epoch.watch().get();
+    CHECK_EQ(42, watch.initial().value());
+    epoch.set(43).get();
+    watch.next().get();
+    CHECK_EQ(43, epoch.get().get().value());
+}
+
+GTEST_TEST_F(typed_node_tests, user_serializer)
+{
+    auto c = get_connected_client();
+    typed_node<typed_node_version> version_node(c, "/typed_node_tests_user_serializer");
+    version_node.create(typed_node_version{ 3, 5 }).get();
+
+    CHECK_EQ(std::string("3.5"), serializer<std::string>::decode(c.get(version_node.path()).get().data()));
+    CHECK_EQ(5, version_node.get().get().value().minor);
+
+    // Data the codec can not convert is delivered as a marshalling_error
+    c.set(version_node.path(), buffer(4U, 'x')).get();
+    CHECK_THROWS(marshalling_error) { version_node.get().get(); };
+}
+
+}